@@ -0,0 +1,385 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Throughput benchmarks for the audio calculators, one calculator at a time
+// and chained into the log mel spectrogram and MFCC front ends, on synthetic
+// noise. Every benchmark reports the hours of audio processed per second.
+//
+// For machine-readable results, e.g. to track regressions, run
+//   bazel run -c opt \
+//     //mediapipe/calculators/audio:audio_calculators_benchmark -- \
+//     --benchmark_out=audio_benchmarks.json --benchmark_out_format=json
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+#include "absl/strings/substitute.h"
+#include "mediapipe/calculators/audio/mfcc_mel_calculators.pb.h"
+#include "mediapipe/calculators/audio/rational_factor_resample_calculator.pb.h"
+#include "mediapipe/calculators/audio/spectrogram_calculator.pb.h"
+#include "mediapipe/calculators/audio/time_series_framer_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace {
+
+// Duration of the synthetic audio processed by each benchmark iteration.
+constexpr double kDurationSeconds = 60.0;
+// Sample rate of the audio fed to the spectrogram in the front ends.
+constexpr double kFrontEndSampleRate = 16000.0;
+
+Packet MakeHeader(double sample_rate, int num_channels) {
+  TimeSeriesHeader* header = new TimeSeriesHeader();
+  header->set_sample_rate(sample_rate);
+  header->set_num_channels(num_channels);
+  return Adopt(header);
+}
+
+// Returns kDurationSeconds of uniform noise in packets of packet_size_samples.
+// All packets share the same payload, so that generating the input does not
+// dominate the benchmarks.
+std::vector<Packet> MakeNoisePackets(double sample_rate, int num_channels,
+                                     int packet_size_samples) {
+  const int num_samples = kDurationSeconds * sample_rate;
+  const Packet payload =
+      Adopt(new Matrix(Matrix::Random(num_channels, packet_size_samples)));
+  std::vector<Packet> packets;
+  for (int sample = 0; sample + packet_size_samples <= num_samples;
+       sample += packet_size_samples) {
+    packets.push_back(payload.At(Timestamp(
+        round(sample / sample_rate * Timestamp::kTimestampUnitsPerSecond))));
+  }
+  return packets;
+}
+
+void SetAudioCounters(double sample_rate, int num_channels,
+                      benchmark::State* state) {
+  state->SetItemsProcessed(state->iterations() * num_channels *
+                           static_cast<int64>(kDurationSeconds * sample_rate));
+  state->counters["audio_hours_per_second"] =
+      benchmark::Counter(state->iterations() * kDurationSeconds / 3600,
+                         benchmark::Counter::kIsRate);
+}
+
+// Runs a single calculator on the given input stream for each iteration.
+void RunCalculator(const CalculatorGraphConfig::Node& node_config,
+                   const Packet& header, const std::vector<Packet>& packets,
+                   benchmark::State* state) {
+  CalculatorRunner runner(node_config);
+  runner.MutableInputs()->Index(0).header = header;
+  runner.MutableInputs()->Index(0).packets = packets;
+  for (auto _ : *state) {
+    auto status = runner.Run();
+    if (!status.ok()) {
+      state->SkipWithError(status.ToString().c_str());
+      return;
+    }
+  }
+}
+
+void SetSpectrogramOptions(SpectrogramCalculatorOptions* options) {
+  options->set_frame_duration_seconds(0.025);
+  options->set_frame_overlap_seconds(0.015);
+}
+
+// Returns the output of a SpectrogramCalculator on noise at
+// kFrontEndSampleRate, to feed the mel and MFCC calculators.
+CalculatorRunner::StreamContents ComputeSpectrogram(int packet_size_samples) {
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("SpectrogramCalculator");
+  node_config.add_input_stream("audio");
+  node_config.add_output_stream("spectrogram");
+  SetSpectrogramOptions(node_config.mutable_options()->MutableExtension(
+      SpectrogramCalculatorOptions::ext));
+  CalculatorRunner runner(node_config);
+  runner.MutableInputs()->Index(0).header = MakeHeader(kFrontEndSampleRate, 1);
+  runner.MutableInputs()->Index(0).packets =
+      MakeNoisePackets(kFrontEndSampleRate, 1, packet_size_samples);
+  MEDIAPIPE_CHECK_OK(runner.Run());
+  return runner.Outputs().Index(0);
+}
+
+// Args: sample rate, number of channels, number of samples per input packet.
+void BM_TimeSeriesFramer(benchmark::State& state) {
+  const double sample_rate = state.range(0);
+  const int num_channels = state.range(1);
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("TimeSeriesFramerCalculator");
+  node_config.add_input_stream("audio");
+  node_config.add_output_stream("frames");
+  auto* options = node_config.mutable_options()->MutableExtension(
+      TimeSeriesFramerCalculatorOptions::ext);
+  options->set_frame_duration_seconds(0.025);
+  options->set_frame_overlap_seconds(0.015);
+  options->set_window_function(TimeSeriesFramerCalculatorOptions::HANN);
+  RunCalculator(node_config, MakeHeader(sample_rate, num_channels),
+                MakeNoisePackets(sample_rate, num_channels, state.range(2)),
+                &state);
+  SetAudioCounters(sample_rate, num_channels, &state);
+}
+
+// Args: sample rate, number of channels, number of samples per input packet.
+void BM_RationalFactorResample(benchmark::State& state) {
+  const double sample_rate = state.range(0);
+  const int num_channels = state.range(1);
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("RationalFactorResampleCalculator");
+  node_config.add_input_stream("audio");
+  node_config.add_output_stream("resampled");
+  node_config.mutable_options()
+      ->MutableExtension(RationalFactorResampleCalculatorOptions::ext)
+      ->set_target_sample_rate(kFrontEndSampleRate);
+  RunCalculator(node_config, MakeHeader(sample_rate, num_channels),
+                MakeNoisePackets(sample_rate, num_channels, state.range(2)),
+                &state);
+  SetAudioCounters(sample_rate, num_channels, &state);
+}
+
+// Args: sample rate, number of channels, number of samples per input packet.
+void BM_Spectrogram(benchmark::State& state) {
+  const double sample_rate = state.range(0);
+  const int num_channels = state.range(1);
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("SpectrogramCalculator");
+  node_config.add_input_stream("audio");
+  node_config.add_output_stream("spectrogram");
+  auto* options = node_config.mutable_options()->MutableExtension(
+      SpectrogramCalculatorOptions::ext);
+  SetSpectrogramOptions(options);
+  options->set_allow_multichannel_input(num_channels > 1);
+  RunCalculator(node_config, MakeHeader(sample_rate, num_channels),
+                MakeNoisePackets(sample_rate, num_channels, state.range(2)),
+                &state);
+  SetAudioCounters(sample_rate, num_channels, &state);
+}
+
+// Args: number of samples per packet of the audio the spectrogram was
+// computed from, number of mel channels.
+void BM_MelSpectrum(benchmark::State& state) {
+  const auto spectrogram = ComputeSpectrogram(state.range(0));
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("MelSpectrumCalculator");
+  node_config.add_input_stream("spectrogram");
+  node_config.add_output_stream("mel");
+  auto* options = node_config.mutable_options()->MutableExtension(
+      MelSpectrumCalculatorOptions::ext);
+  options->set_channel_count(state.range(1));
+  options->set_max_frequency_hertz(7500.0);
+  RunCalculator(node_config, spectrogram.header, spectrogram.packets, &state);
+  SetAudioCounters(kFrontEndSampleRate, 1, &state);
+}
+
+// Args: number of samples per packet of the audio the spectrogram was
+// computed from, number of MFCCs.
+void BM_Mfcc(benchmark::State& state) {
+  const auto spectrogram = ComputeSpectrogram(state.range(0));
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("MfccCalculator");
+  node_config.add_input_stream("spectrogram");
+  node_config.add_output_stream("mfcc");
+  auto* options = node_config.mutable_options()->MutableExtension(
+      MfccCalculatorOptions::ext);
+  options->set_mfcc_count(state.range(1));
+  options->mutable_mel_spectrum_params()->set_max_frequency_hertz(7500.0);
+  RunCalculator(node_config, spectrogram.header, spectrogram.packets, &state);
+  SetAudioCounters(kFrontEndSampleRate, 1, &state);
+}
+
+// Args: number of samples per packet of the audio the spectrogram was
+// computed from.
+void BM_StabilizedLog(benchmark::State& state) {
+  const auto spectrogram = ComputeSpectrogram(state.range(0));
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("StabilizedLogCalculator");
+  node_config.add_input_stream("spectrogram");
+  node_config.add_output_stream("log_spectrogram");
+  RunCalculator(node_config, spectrogram.header, spectrogram.packets, &state);
+  SetAudioCounters(kFrontEndSampleRate, 1, &state);
+}
+
+// Returns a graph resampling the mono "audio" input stream to
+// kFrontEndSampleRate and computing its spectrogram, followed by the given
+// front end nodes reading the "spectrogram" stream.
+CalculatorGraphConfig FrontEndConfig(double sample_rate,
+                                     const std::string& front_end_nodes) {
+  std::string resampler_node;
+  std::string spectrogram_input = "audio";
+  if (sample_rate != kFrontEndSampleRate) {
+    resampler_node = absl::Substitute(
+        R"pb(
+          node {
+            calculator: "RationalFactorResampleCalculator"
+            input_stream: "audio"
+            output_stream: "resampled"
+            options {
+              [mediapipe.RationalFactorResampleCalculatorOptions.ext] {
+                target_sample_rate: $0
+              }
+            }
+          }
+        )pb",
+        kFrontEndSampleRate);
+    spectrogram_input = "resampled";
+  }
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(absl::Substitute(
+      R"pb(
+        input_stream: "audio"
+        $0
+        node {
+          calculator: "SpectrogramCalculator"
+          input_stream: "$1"
+          output_stream: "spectrogram"
+          options {
+            [mediapipe.SpectrogramCalculatorOptions.ext] {
+              frame_duration_seconds: 0.025
+              frame_overlap_seconds: 0.015
+            }
+          }
+        }
+        $2
+      )pb",
+      resampler_node, spectrogram_input, front_end_nodes));
+}
+
+// Runs the graph on the "audio" input stream for each iteration.
+void RunGraph(const CalculatorGraphConfig& config, const Packet& header,
+              const std::vector<Packet>& packets, benchmark::State* state) {
+  CalculatorGraph graph;
+  auto status = graph.Initialize(config);
+  for (auto _ : *state) {
+    if (status.ok()) status = graph.StartRun({}, {{"audio", header}});
+    for (const Packet& packet : packets) {
+      if (!status.ok()) break;
+      status = graph.AddPacketToInputStream("audio", packet);
+    }
+    if (status.ok()) status = graph.CloseAllPacketSources();
+    if (status.ok()) status = graph.WaitUntilDone();
+    if (!status.ok()) {
+      state->SkipWithError(status.ToString().c_str());
+      return;
+    }
+  }
+}
+
+// Args: sample rate, number of samples per input packet.
+void BM_LogMelFrontEnd(benchmark::State& state) {
+  const double sample_rate = state.range(0);
+  const CalculatorGraphConfig config = FrontEndConfig(sample_rate, R"pb(
+    node {
+      calculator: "MelSpectrumCalculator"
+      input_stream: "spectrogram"
+      output_stream: "mel"
+      options {
+        [mediapipe.MelSpectrumCalculatorOptions.ext] {
+          channel_count: 64
+          max_frequency_hertz: 7500
+        }
+      }
+    }
+    node {
+      calculator: "StabilizedLogCalculator"
+      input_stream: "mel"
+      output_stream: "log_mel"
+    }
+  )pb");
+  RunGraph(config, MakeHeader(sample_rate, 1),
+           MakeNoisePackets(sample_rate, 1, state.range(1)), &state);
+  SetAudioCounters(sample_rate, 1, &state);
+}
+
+// Args: sample rate, number of samples per input packet.
+void BM_MfccFrontEnd(benchmark::State& state) {
+  const double sample_rate = state.range(0);
+  const CalculatorGraphConfig config = FrontEndConfig(sample_rate, R"pb(
+    node {
+      calculator: "MfccCalculator"
+      input_stream: "spectrogram"
+      output_stream: "mfcc"
+      options {
+        [mediapipe.MfccCalculatorOptions.ext] {
+          mfcc_count: 13
+          mel_spectrum_params { max_frequency_hertz: 7500 }
+        }
+      }
+    }
+  )pb");
+  RunGraph(config, MakeHeader(sample_rate, 1),
+           MakeNoisePackets(sample_rate, 1, state.range(1)), &state);
+  SetAudioCounters(sample_rate, 1, &state);
+}
+
+// Sample rates, channel counts and packet sizes of 10 ms and 100 ms.
+void AudioArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"sample_rate", "channels", "packet_samples"});
+  for (int sample_rate : {16000, 44100, 48000}) {
+    for (int num_channels : {1, 2, 8}) {
+      for (int packet_ms : {10, 100}) {
+        benchmark->Args({sample_rate, num_channels,
+                         sample_rate * packet_ms / 1000});
+      }
+    }
+  }
+}
+
+// Sample rates to resample to kFrontEndSampleRate, channel counts and packet
+// sizes of 100 ms.
+void ResampleArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"sample_rate", "channels", "packet_samples"});
+  for (int sample_rate : {44100, 48000}) {
+    for (int num_channels : {1, 2, 8}) {
+      benchmark->Args({sample_rate, num_channels, sample_rate / 10});
+    }
+  }
+}
+
+// Sample rates and packet sizes of 10 ms and 100 ms of mono audio.
+void FrontEndArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"sample_rate", "packet_samples"});
+  for (int sample_rate : {16000, 44100, 48000}) {
+    for (int packet_ms : {10, 100}) {
+      benchmark->Args({sample_rate, sample_rate * packet_ms / 1000});
+    }
+  }
+}
+
+BENCHMARK(BM_TimeSeriesFramer)->Apply(AudioArgs);
+BENCHMARK(BM_RationalFactorResample)->Apply(ResampleArgs);
+BENCHMARK(BM_Spectrogram)->Apply(AudioArgs);
+BENCHMARK(BM_MelSpectrum)
+    ->ArgNames({"packet_samples", "mel_channels"})
+    ->Args({160, 64})
+    ->Args({1600, 64})
+    ->Args({1600, 128});
+BENCHMARK(BM_Mfcc)
+    ->ArgNames({"packet_samples", "mfccs"})
+    ->Args({160, 13})
+    ->Args({1600, 13})
+    ->Args({1600, 40});
+BENCHMARK(BM_StabilizedLog)->ArgName("packet_samples")->Arg(160)->Arg(1600);
+BENCHMARK(BM_LogMelFrontEnd)->Apply(FrontEndArgs);
+BENCHMARK(BM_MfccFrontEnd)->Apply(FrontEndArgs);
+
+}  // namespace
+}  // namespace mediapipe
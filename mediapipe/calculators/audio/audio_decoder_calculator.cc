@@ -12,10 +12,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <deque>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/util/audio_decoder.h"
 #include "mediapipe/util/audio_decoder.pb.h"
 
@@ -45,6 +51,9 @@ namespace mediapipe {
 //   }
 // }
 //
+// With AudioDecoderOptions.prefetch_packets set, decoding runs on a background
+// thread which stays at most that many packets ahead of the graph.
+//
 // TODO: support decoding multiple streams.
 class AudioDecoderCalculator : public CalculatorBase {
  public:
@@ -55,7 +64,22 @@ class AudioDecoderCalculator : public CalculatorBase {
   absl::Status Close(CalculatorContext* cc) override;
 
  private:
+  // Decodes packets into prefetch_queue_ until the decoder is exhausted or
+  // fails, or the calculator is closed. Runs on prefetch_thread_.
+  void Prefetch();
+
   std::unique_ptr<AudioDecoder> decoder_;
+
+  int max_prefetch_packets_ = 0;
+  std::unique_ptr<ThreadPool> prefetch_thread_;
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  std::deque<Packet> prefetch_queue_ ABSL_GUARDED_BY(mutex_);
+  // The decoder status which ended prefetching, e.g. tool::StatusStop() at
+  // the end of the file.
+  absl::Status prefetch_status_ ABSL_GUARDED_BY(mutex_);
+  bool prefetch_done_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stop_prefetch_ ABSL_GUARDED_BY(mutex_) = false;
 };
 
 absl::Status AudioDecoderCalculator::GetContract(CalculatorContract* cc) {
@@ -87,10 +111,60 @@ absl::Status AudioDecoderCalculator::Open(CalculatorContext* cc) {
     cc->Outputs().Tag("AUDIO_HEADER").SetHeader(Adopt(header.release()));
   }
   cc->Outputs().Tag("AUDIO_HEADER").Close();
+
+  max_prefetch_packets_ = decoder_options.prefetch_packets();
+  if (max_prefetch_packets_ > 0) {
+    prefetch_thread_ = absl::make_unique<ThreadPool>("AudioDecoderPrefetch",
+                                                     /*num_threads=*/1);
+    prefetch_thread_->StartWorkers();
+    prefetch_thread_->Schedule([this] { Prefetch(); });
+  }
   return absl::OkStatus();
 }
 
+void AudioDecoderCalculator::Prefetch() {
+  while (true) {
+    {
+      absl::MutexLock lock(&mutex_);
+      while (static_cast<int>(prefetch_queue_.size()) >=
+                 max_prefetch_packets_ &&
+             !stop_prefetch_) {
+        cond_.Wait(&mutex_);
+      }
+      if (stop_prefetch_) {
+        prefetch_done_ = true;
+        return;
+      }
+    }
+    Packet data;
+    int options_index = -1;
+    const absl::Status status = decoder_->GetData(&options_index, &data);
+    absl::MutexLock lock(&mutex_);
+    if (!status.ok()) {
+      prefetch_status_ = status;
+      prefetch_done_ = true;
+      cond_.SignalAll();
+      return;
+    }
+    prefetch_queue_.push_back(std::move(data));
+    cond_.SignalAll();
+  }
+}
+
 absl::Status AudioDecoderCalculator::Process(CalculatorContext* cc) {
+  if (prefetch_thread_) {
+    absl::MutexLock lock(&mutex_);
+    while (prefetch_queue_.empty() && !prefetch_done_) {
+      cond_.Wait(&mutex_);
+    }
+    if (prefetch_queue_.empty()) {
+      return prefetch_status_;
+    }
+    cc->Outputs().Tag("AUDIO").AddPacket(std::move(prefetch_queue_.front()));
+    prefetch_queue_.pop_front();
+    cond_.SignalAll();
+    return absl::OkStatus();
+  }
   Packet data;
   int options_index = -1;
   auto status = decoder_->GetData(&options_index, &data);
@@ -101,6 +175,15 @@ absl::Status AudioDecoderCalculator::Process(CalculatorContext* cc) {
 }
 
 absl::Status AudioDecoderCalculator::Close(CalculatorContext* cc) {
+  if (prefetch_thread_) {
+    {
+      absl::MutexLock lock(&mutex_);
+      stop_prefetch_ = true;
+      cond_.SignalAll();
+    }
+    // Waits for Prefetch() to return before the decoder is closed.
+    prefetch_thread_.reset();
+  }
   return decoder_->Close();
 }
 
@@ -13,8 +13,10 @@
 // limitations under the License.
 
 #include "absl/flags/flag.h"
+#include "absl/strings/substitute.h"
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
@@ -147,4 +149,40 @@ TEST(AudioDecoderCalculatorTest, TestAAC) {
               std::ceil(44100.0 * 2 / 1024));
 }
 
+TEST(AudioDecoderCalculatorTest, PrefetchMatchesSynchronousDecoding) {
+  const std::string input_file_path = file::JoinPath(
+      "./",
+      "/mediapipe/calculators/audio/"
+      "testdata/sine_wave_1k_44100_stereo_2_sec_mp3.audio");
+  std::vector<Packet> outputs[2];
+  for (int prefetch_packets : {0, 4}) {
+    CalculatorGraphConfig::Node node_config =
+        ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+            R"pb(
+              calculator: "AudioDecoderCalculator"
+              input_side_packet: "INPUT_FILE_PATH:input_file_path"
+              output_stream: "AUDIO:audio"
+              output_stream: "AUDIO_HEADER:audio_header"
+              node_options {
+                [type.googleapis.com/mediapipe.AudioDecoderOptions]: {
+                  audio_stream { stream_index: 0 }
+                  prefetch_packets: $0
+                }
+              })pb",
+            prefetch_packets));
+    CalculatorRunner runner(node_config);
+    runner.MutableSidePackets()->Tag("INPUT_FILE_PATH") =
+        MakePacket<std::string>(input_file_path);
+    MP_ASSERT_OK(runner.Run());
+    outputs[prefetch_packets > 0] = runner.Outputs().Tag("AUDIO").packets;
+  }
+  ASSERT_FALSE(outputs[0].empty());
+  ASSERT_EQ(outputs[0].size(), outputs[1].size());
+  for (int i = 0; i < outputs[0].size(); ++i) {
+    EXPECT_EQ(outputs[0][i].Timestamp(), outputs[1][i].Timestamp());
+    EXPECT_TRUE(outputs[0][i].Get<Matrix>().isApprox(
+        outputs[1][i].Get<Matrix>()));
+  }
+}
+
 }  // namespace mediapipe
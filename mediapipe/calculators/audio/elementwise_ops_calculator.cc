@@ -0,0 +1,145 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines ElementwiseOpsCalculator.
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "Eigen/Core"
+#include "mediapipe/calculators/audio/elementwise_ops_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/time_series_util.h"
+
+namespace mediapipe {
+
+namespace {
+// Number of values to which all the ops are applied before moving on to the
+// next values. Small enough for the values to stay in the L1 cache.
+constexpr int64 kBlockSize = 1024;
+}  // namespace
+
+// Applies a chain of element-wise ops to a TimeSeries stream in a single pass
+// over the data, e.g. to replace a chain of ElementwiseSquareCalculator,
+// StabilizedLogCalculator and friends. The ops are applied block by block, so
+// each value is loaded from and stored to memory once however long the chain
+// is. If the calculator is the only owner of the input packet, the input
+// matrix is reused for the output, otherwise it is copied once.
+//
+// Example config:
+// node {
+//   calculator: "ElementwiseOpsCalculator"
+//   input_stream: "input_time_series"
+//   output_stream: "output_time_series"
+//   options {
+//     [mediapipe.ElementwiseOpsCalculatorOptions.ext] {
+//       op { type: OFFSET value: 0.00001 }
+//       op { type: LOG }
+//       op { type: SCALE value: 10 }
+//     }
+//   }
+// }
+class ElementwiseOpsCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<Matrix>(
+        // Input stream with TimeSeriesHeader.
+    );
+    cc->Outputs().Index(0).Set<Matrix>(
+        // Output stream with TimeSeriesHeader.
+    );
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    const auto& options = cc->Options<ElementwiseOpsCalculatorOptions>();
+    ops_.assign(options.op().begin(), options.op().end());
+
+    // If the input packets have a header, propagate the header to the output.
+    if (!cc->Inputs().Index(0).Header().IsEmpty()) {
+      TimeSeriesHeader input_header;
+      MP_RETURN_IF_ERROR(time_series_util::FillTimeSeriesHeaderIfValid(
+          cc->Inputs().Index(0).Header(), &input_header));
+      cc->Outputs().Index(0).SetHeader(
+          Adopt(new TimeSeriesHeader(input_header)));
+    }
+    cc->SetOffset(0);
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    ASSIGN_OR_RETURN(std::unique_ptr<Matrix> matrix,
+                     cc->Inputs().Index(0).Value().ConsumeOrCopy<Matrix>());
+    float* data = matrix->data();
+    const int64 size = matrix->size();
+    for (int64 start = 0; start < size; start += kBlockSize) {
+      Eigen::Map<Eigen::ArrayXf> block(data + start,
+                                       std::min(kBlockSize, size - start));
+      for (const auto& op : ops_) {
+        MP_RETURN_IF_ERROR(ApplyOp(op, &block));
+      }
+    }
+    cc->Outputs().Index(0).Add(matrix.release(), cc->InputTimestamp());
+    return absl::OkStatus();
+  }
+
+ private:
+  static absl::Status ApplyOp(const ElementwiseOpsCalculatorOptions::Op& op,
+                              Eigen::Map<Eigen::ArrayXf>* block) {
+    switch (op.type()) {
+      case ElementwiseOpsCalculatorOptions::Op::SCALE:
+        *block *= op.value();
+        return absl::OkStatus();
+      case ElementwiseOpsCalculatorOptions::Op::OFFSET:
+        *block += op.value();
+        return absl::OkStatus();
+      case ElementwiseOpsCalculatorOptions::Op::SQUARE:
+        *block = block->square();
+        return absl::OkStatus();
+      case ElementwiseOpsCalculatorOptions::Op::SQRT:
+        *block = block->sqrt();
+        return absl::OkStatus();
+      case ElementwiseOpsCalculatorOptions::Op::ABS:
+        *block = block->abs();
+        return absl::OkStatus();
+      case ElementwiseOpsCalculatorOptions::Op::NEGATE:
+        *block = -*block;
+        return absl::OkStatus();
+      case ElementwiseOpsCalculatorOptions::Op::LOG:
+        *block = block->log();
+        return absl::OkStatus();
+      case ElementwiseOpsCalculatorOptions::Op::EXP:
+        *block = block->exp();
+        return absl::OkStatus();
+      case ElementwiseOpsCalculatorOptions::Op::MAX:
+        *block = block->max(op.value());
+        return absl::OkStatus();
+      case ElementwiseOpsCalculatorOptions::Op::MIN:
+        *block = block->min(op.value());
+        return absl::OkStatus();
+    }
+    return absl::InvalidArgumentError("Unrecognized op type.");
+  }
+
+  std::vector<ElementwiseOpsCalculatorOptions::Op> ops_;
+};
+REGISTER_CALCULATOR(ElementwiseOpsCalculator);
+
+}  // namespace mediapipe
@@ -0,0 +1,228 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "Eigen/Core"
+#include "absl/memory/memory.h"
+#include "mediapipe/calculators/audio/elementwise_ops_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/util/time_series_test_util.h"
+
+namespace mediapipe {
+namespace {
+
+const int kNumChannels = 3;
+// More than one block of values, to cover the blocked application.
+const int kNumSamples = 1000;
+
+class ElementwiseOpsCalculatorTest
+    : public TimeSeriesCalculatorTest<ElementwiseOpsCalculatorOptions> {
+ protected:
+  void SetUp() override {
+    calculator_name_ = "ElementwiseOpsCalculator";
+    input_sample_rate_ = 8000.0;
+    num_input_channels_ = kNumChannels;
+    num_input_samples_ = kNumSamples;
+  }
+
+  void AddOp(ElementwiseOpsCalculatorOptions::Op::Type type,
+             float value = 0.0) {
+    auto* op = options_.add_op();
+    op->set_type(type);
+    op->set_value(value);
+  }
+
+  // Runs the graph on a packet of the given input and returns the output.
+  Matrix RunOnInput(const Matrix& input) {
+    InitializeGraph();
+    FillInputHeader();
+    AppendInputPacket(new Matrix(input), 0 /* timestamp */);
+    MP_EXPECT_OK(RunGraph());
+    ExpectOutputHeaderEqualsInputHeader();
+    return runner_->Outputs().Index(0).packets[0].Get<Matrix>();
+  }
+};
+
+TEST_F(ElementwiseOpsCalculatorTest, IsNoOpWithoutOps) {
+  const Matrix input = Matrix::Random(kNumChannels, kNumSamples);
+  ExpectApproximatelyEqual(input, RunOnInput(input));
+}
+
+TEST_F(ElementwiseOpsCalculatorTest, ComputesStabilizedLog) {
+  AddOp(ElementwiseOpsCalculatorOptions::Op::ABS);
+  AddOp(ElementwiseOpsCalculatorOptions::Op::OFFSET, 0.1);
+  AddOp(ElementwiseOpsCalculatorOptions::Op::LOG);
+  AddOp(ElementwiseOpsCalculatorOptions::Op::SCALE, 2.5);
+  const Matrix input = Matrix::Random(kNumChannels, kNumSamples);
+  ExpectApproximatelyEqual(2.5f * (input.array().abs() + 0.1f).log(),
+                           RunOnInput(input));
+}
+
+TEST_F(ElementwiseOpsCalculatorTest, AppliesAllOpsInOrder) {
+  AddOp(ElementwiseOpsCalculatorOptions::Op::SQUARE);
+  AddOp(ElementwiseOpsCalculatorOptions::Op::SQRT);
+  AddOp(ElementwiseOpsCalculatorOptions::Op::NEGATE);
+  AddOp(ElementwiseOpsCalculatorOptions::Op::EXP);
+  AddOp(ElementwiseOpsCalculatorOptions::Op::MAX, 0.5);
+  AddOp(ElementwiseOpsCalculatorOptions::Op::MIN, 0.8);
+  const Matrix input = Matrix::Random(kNumChannels, kNumSamples);
+  ExpectApproximatelyEqual(
+      (-input.array().abs()).exp().max(0.5f).min(0.8f).matrix(),
+      RunOnInput(input));
+}
+
+TEST_F(ElementwiseOpsCalculatorTest, ProcessesMultiplePackets) {
+  AddOp(ElementwiseOpsCalculatorOptions::Op::SCALE, -2.0);
+  InitializeGraph();
+  FillInputHeader();
+  std::vector<Matrix> inputs;
+  for (int i = 0; i < 3; ++i) {
+    inputs.push_back(Matrix::Random(kNumChannels, kNumSamples));
+    AppendInputPacket(new Matrix(inputs.back()),
+                      i * Timestamp::kTimestampUnitsPerSecond);
+  }
+  MP_ASSERT_OK(RunGraph());
+  ASSERT_EQ(inputs.size(), runner_->Outputs().Index(0).packets.size());
+  for (int i = 0; i < static_cast<int>(inputs.size()); ++i) {
+    // The inputs are unchanged, even though the ops are applied in place.
+    ExpectApproximatelyEqual(
+        -2.0f * inputs[i],
+        runner_->Outputs().Index(0).packets[i].Get<Matrix>());
+    ExpectApproximatelyEqual(
+        inputs[i], runner_->MutableInputs()->Index(0).packets[i].Get<Matrix>());
+  }
+}
+
+// Runs ElementwiseOpsCalculator in a CalculatorGraph on kNumPackets input
+// packets, and returns for each output packet whether it holds the matrix of
+// its input packet.  Unless keep_inputs is true, the graph is the only owner
+// of the input packets.
+std::vector<bool> RunGraphAndCheckReuse(int num_packets, bool keep_inputs) {
+  CalculatorGraphConfig config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+        input_stream: "input"
+        node {
+          calculator: "ElementwiseOpsCalculator"
+          input_stream: "input"
+          output_stream: "output"
+          options {
+            [mediapipe.ElementwiseOpsCalculatorOptions.ext] {
+              op { type: SQUARE }
+              op { type: OFFSET value: 1 }
+              op { type: LOG }
+            }
+          }
+        }
+      )pb");
+  CalculatorGraph graph;
+  MP_EXPECT_OK(graph.Initialize(config));
+  std::vector<const float*> output_data;
+  MP_EXPECT_OK(graph.ObserveOutputStream("output", [&](const Packet& packet) {
+    output_data.push_back(packet.Get<Matrix>().data());
+    return absl::OkStatus();
+  }));
+  MP_EXPECT_OK(graph.StartRun({}));
+
+  std::vector<Packet> inputs;
+  std::vector<const float*> input_data;
+  for (int i = 0; i < num_packets; ++i) {
+    auto matrix =
+        absl::make_unique<Matrix>(Matrix::Random(kNumChannels, kNumSamples));
+    input_data.push_back(matrix->data());
+    Packet packet = Adopt(matrix.release()).At(Timestamp(i));
+    if (keep_inputs) {
+      inputs.push_back(packet);
+    }
+    MP_EXPECT_OK(graph.AddPacketToInputStream("input", std::move(packet)));
+  }
+  MP_EXPECT_OK(graph.CloseAllInputStreams());
+  MP_EXPECT_OK(graph.WaitUntilDone());
+
+  std::vector<bool> reused;
+  EXPECT_EQ(num_packets, output_data.size());
+  for (int i = 0; i < output_data.size(); ++i) {
+    reused.push_back(output_data[i] == input_data[i]);
+  }
+  return reused;
+}
+
+// In a graph, uniquely owned input matrices are transformed in place.
+TEST(ElementwiseOpsCalculatorGraphTest, ReusesUniquelyOwnedInputs) {
+  EXPECT_EQ(std::vector<bool>(5, true), RunGraphAndCheckReuse(5, false));
+}
+
+// Input matrices which are still referenced elsewhere are copied.
+TEST(ElementwiseOpsCalculatorGraphTest, CopiesSharedInputs) {
+  EXPECT_EQ(std::vector<bool>(5, false), RunGraphAndCheckReuse(5, true));
+}
+
+// Measures the ops in a CalculatorGraph, which unlike CalculatorRunner does
+// not keep references to the input packets, including the graph setup and the
+// input generation.
+// Arg: 1 if the caller keeps the input packets, which forces a copy.
+void BM_ElementwiseOpsGraph(benchmark::State& state) {
+  for (auto _ : state) {
+    RunGraphAndCheckReuse(100, state.range(0));
+  }
+  state.SetItemsProcessed(state.iterations() * 100 * kNumChannels *
+                          kNumSamples);
+}
+BENCHMARK(BM_ElementwiseOpsGraph)->Arg(0)->Arg(1);
+
+// Measures a chain of 4 ops, on one second of 64 channel features at 16 kHz.
+// Arg: number of samples per packet.
+void BM_ElementwiseOps(benchmark::State& state) {
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("ElementwiseOpsCalculator");
+  node_config.add_input_stream("input");
+  node_config.add_output_stream("output");
+  auto* options = node_config.mutable_options()->MutableExtension(
+      ElementwiseOpsCalculatorOptions::ext);
+  options->add_op()->set_type(ElementwiseOpsCalculatorOptions::Op::SQUARE);
+  auto* offset = options->add_op();
+  offset->set_type(ElementwiseOpsCalculatorOptions::Op::OFFSET);
+  offset->set_value(1e-5);
+  options->add_op()->set_type(ElementwiseOpsCalculatorOptions::Op::LOG);
+  auto* scale = options->add_op();
+  scale->set_type(ElementwiseOpsCalculatorOptions::Op::SCALE);
+  scale->set_value(10.0);
+
+  const int num_samples = state.range(0);
+  const Packet payload = Adopt(new Matrix(Matrix::Random(64, num_samples)));
+  for (auto _ : state) {
+    state.PauseTiming();
+    CalculatorRunner runner(node_config);
+    for (int i = 0; i < 16000 / num_samples; ++i) {
+      runner.MutableInputs()->Index(0).packets.push_back(
+          payload.At(Timestamp(i)));
+    }
+    state.ResumeTiming();
+    MP_ASSERT_OK(runner.Run());
+  }
+  state.SetItemsProcessed(state.iterations() * 64 * 16000);
+}
+BENCHMARK(BM_ElementwiseOps)->Arg(160)->Arg(1600)->Arg(16000);
+
+}  // namespace
+}  // namespace mediapipe
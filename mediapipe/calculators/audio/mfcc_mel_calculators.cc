@@ -19,6 +19,7 @@
 // commonly used as acoustic features in speech and other audio tasks.
 // Both calculators expect as input the SQUARED_MAGNITUDE-domain outputs
 // from the MediaPipe SpectrogramCalculator object.
+#include <cmath>
 #include <memory>
 #include <vector>
 
@@ -31,6 +32,7 @@
 #include "mediapipe/calculators/audio/mfcc_mel_calculators.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/matrix_pool.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/status.h"
@@ -121,7 +123,8 @@ absl::Status FramewiseTransformCalculatorBase::Open(CalculatorContext* cc) {
 absl::Status FramewiseTransformCalculatorBase::Process(CalculatorContext* cc) {
   const Matrix& input = cc->Inputs().Index(0).Get<Matrix>();
   const int num_frames = input.cols();
-  std::unique_ptr<Matrix> output(new Matrix(num_output_channels_, num_frames));
+  std::unique_ptr<Matrix> output =
+      MatrixPool::Default()->Get(num_output_channels_, num_frames);
   // The main work here is converting each column of the float Matrix
   // into a vector of doubles, which is what our target functions from
   // dsp_core consume, and doing the reverse with their output.
@@ -144,6 +147,8 @@ absl::Status FramewiseTransformCalculatorBase::Process(CalculatorContext* cc) {
     output->col(frame) = output_frame_map.cast<float>();
   }
   cc->Outputs().Index(0).Add(output.release(), cc->InputTimestamp());
+  // input must not be accessed after this.
+  MatrixPool::Default()->Recycle(&cc->Inputs().Index(0).Value());
 
   return absl::OkStatus();
 }
@@ -226,6 +231,8 @@ REGISTER_CALCULATOR(MfccCalculator);
 // Note: This code computes a mel-frequency filterbank, using a simple
 // algorithm that gives bad results (some mel channels that are always zero)
 // if you ask for too many channels.
+// If log_output is set, outputs log-Mel spectra instead, saving a separate
+// pass over the frames downstream.
 class MelSpectrumCalculator : public FramewiseTransformCalculatorBase {
  public:
   static absl::Status GetContract(CalculatorContract* cc) {
@@ -240,6 +247,8 @@ class MelSpectrumCalculator : public FramewiseTransformCalculatorBase {
     mel_filterbank_.reset(new audio_dsp::MelFilterbank());
     int input_length = header.num_channels();
     set_num_output_channels(mel_spectrum_options.channel_count());
+    log_output_ = mel_spectrum_options.log_output();
+    log_offset_ = mel_spectrum_options.log_offset();
     // An upstream calculator (such as SpectrogramCalculator) must store
     // the sample rate of its input audio waveform in the TimeSeries Header.
     // audio_dsp::MelFilterBank needs to know this to
@@ -265,10 +274,17 @@ class MelSpectrumCalculator : public FramewiseTransformCalculatorBase {
   void TransformFrame(const std::vector<double>& input,
                       std::vector<double>* output) const override {
     mel_filterbank_->Compute(input, output);
+    if (log_output_) {
+      for (double& value : *output) {
+        value = std::log(value + log_offset_);
+      }
+    }
   }
 
  private:
   std::unique_ptr<audio_dsp::MelFilterbank> mel_filterbank_;
+  bool log_output_ = false;
+  double log_offset_ = 0.0;
 };
 REGISTER_CALCULATOR(MelSpectrumCalculator);
 
@@ -11,6 +11,7 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <cmath>
 #include <vector>
 
 #include "Eigen/Core"
@@ -138,6 +139,22 @@ TEST_F(MelSpectrumCalculatorTest, AudioSampleRateFromInputHeader) {
 
   CheckResults(options_.channel_count());
 }
+TEST_F(MelSpectrumCalculatorTest, LogOutput) {
+  audio_sample_rate_ = kAudioSampleRate;
+  options_.set_log_output(true);
+  SetupGraphAndHeader();
+  SetupRandomInputPackets();
+
+  MP_EXPECT_OK(Run());
+
+  CheckOutputPacketMetadata(options_.channel_count(), num_samples_per_packet_);
+  // Mel spectra are non-negative, so their logs are bounded by the offset.
+  for (const auto& packet : output().packets) {
+    const Matrix& data = packet.Get<Matrix>();
+    EXPECT_TRUE(data.allFinite());
+    EXPECT_GE(data.minCoeff(), std::log(options_.log_offset()) - 1e-5);
+  }
+}
 TEST_F(MelSpectrumCalculatorTest, NoAudioSampleRate) {
   // Leave audio_sample_rate_ == kUnset, so it is not present in the
   // input TimeSeriesHeader; expect failure.
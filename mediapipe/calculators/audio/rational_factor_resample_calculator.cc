@@ -16,7 +16,13 @@
 
 #include "mediapipe/calculators/audio/rational_factor_resample_calculator.h"
 
-#include "audio/dsp/resampler_q.h"
+#include <map>
+#include <string>
+#include <tuple>
+
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/ret_check.h"
 
 using audio_dsp::Resampler;
 
@@ -70,17 +76,32 @@ absl::Status RationalFactorResampleCalculator::Open(CalculatorContext* cc) {
   source_sample_rate_ = input_header.sample_rate();
   num_channels_ = input_header.num_channels();
 
+  RET_CHECK_GE(resample_options.num_threads(), 1)
+      << "num_threads must be positive.";
   // Don't create resamplers for pass-thru (sample rates are equal).
   if (source_sample_rate_ != target_sample_rate_) {
     resampler_.resize(num_channels_);
     for (auto& r : resampler_) {
-      r = ResamplerFromOptions(source_sample_rate_, target_sample_rate_,
-                               resample_options);
+      r = resample_options.share_resampler_filters()
+              ? SharedResamplerFromOptions(source_sample_rate_,
+                                           target_sample_rate_,
+                                           resample_options)
+              : ResamplerFromOptions(source_sample_rate_, target_sample_rate_,
+                                     resample_options);
       if (!r) {
         LOG(ERROR) << "Failed to initialize resampler.";
         return absl::UnknownError("Failed to initialize resampler.");
       }
     }
+    input_vectors_.resize(num_channels_);
+    output_vectors_.resize(num_channels_);
+    const int num_threads =
+        std::min(resample_options.num_threads(), num_channels_);
+    if (num_threads > 1) {
+      pool_ = absl::make_unique<ThreadPool>("RationalFactorResample",
+                                            num_threads);
+      pool_->StartWorkers();
+    }
   }
 
   TimeSeriesHeader* output_header = new TimeSeriesHeader(input_header);
@@ -135,16 +156,32 @@ absl::Status RationalFactorResampleCalculator::ProcessInternal(
 bool RationalFactorResampleCalculator::Resample(const Matrix& input_frame,
                                                 Matrix* output_frame,
                                                 bool should_flush) {
-  std::vector<float> input_vector;
-  std::vector<float> output_vector;
-  for (int i = 0; i < input_frame.rows(); ++i) {
-    CopyChannelToVector(input_frame, i, &input_vector);
+  auto resample_channel = [this, &input_frame, should_flush](int i) {
     if (should_flush) {
-      resampler_[i]->Flush(&output_vector);
+      resampler_[i]->Flush(&output_vectors_[i]);
     } else {
-      resampler_[i]->ProcessSamples(input_vector, &output_vector);
+      CopyChannelToVector(input_frame, i, &input_vectors_[i]);
+      resampler_[i]->ProcessSamples(input_vectors_[i], &output_vectors_[i]);
+    }
+  };
+  if (pool_ && input_frame.rows() > 1) {
+    absl::BlockingCounter counter(input_frame.rows());
+    for (int i = 0; i < input_frame.rows(); ++i) {
+      pool_->Schedule([&resample_channel, &counter, i] {
+        resample_channel(i);
+        counter.DecrementCount();
+      });
     }
-    CopyVectorToChannel(output_vector, output_frame, i);
+    counter.Wait();
+  } else {
+    for (int i = 0; i < input_frame.rows(); ++i) {
+      resample_channel(i);
+    }
+  }
+  // The output matrix is sized by the first channel, so it is filled in
+  // after all channels are resampled.
+  for (int i = 0; i < input_frame.rows(); ++i) {
+    CopyVectorToChannel(output_vectors_[i], output_frame, i);
   }
   return true;
 }
@@ -154,7 +191,45 @@ std::unique_ptr<Resampler<float>>
 RationalFactorResampleCalculator::ResamplerFromOptions(
     const double source_sample_rate, const double target_sample_rate,
     const RationalFactorResampleCalculatorOptions& options) {
-  std::unique_ptr<Resampler<float>> resampler;
+  std::unique_ptr<Resampler<float>> resampler =
+      NewQResampler(source_sample_rate, target_sample_rate, options);
+  if (resampler != nullptr && !resampler->Valid()) {
+    resampler = std::unique_ptr<Resampler<float>>();
+  }
+  return resampler;
+}
+
+// static
+std::unique_ptr<Resampler<float>>
+RationalFactorResampleCalculator::SharedResamplerFromOptions(
+    const double source_sample_rate, const double target_sample_rate,
+    const RationalFactorResampleCalculatorOptions& options) {
+  using Key = std::tuple<double, double, std::string>;
+  static absl::Mutex mutex(absl::kConstInit);
+  // Guarded by mutex.
+  static auto* prototypes =
+      new std::map<Key, std::unique_ptr<audio_dsp::QResampler<float>>>();
+
+  const Key key(
+      source_sample_rate, target_sample_rate,
+      options.resampler_rational_factor_options().SerializeAsString());
+  absl::MutexLock lock(&mutex);
+  auto& prototype = (*prototypes)[key];
+  if (!prototype) {
+    prototype = NewQResampler(source_sample_rate, target_sample_rate, options);
+  }
+  if (!prototype->Valid()) {
+    return nullptr;
+  }
+  // The copy has its own state, but not the cost of designing the filter.
+  return absl::make_unique<audio_dsp::QResampler<float>>(*prototype);
+}
+
+// static
+std::unique_ptr<audio_dsp::QResampler<float>>
+RationalFactorResampleCalculator::NewQResampler(
+    const double source_sample_rate, const double target_sample_rate,
+    const RationalFactorResampleCalculatorOptions& options) {
   const auto& rational_factor_options =
       options.resampler_rational_factor_options();
   audio_dsp::QResamplerParams params;
@@ -177,12 +252,8 @@ RationalFactorResampleCalculator::ResamplerFromOptions(
 
   // NOTE: QResampler supports multichannel resampling, so the code might be
   // simplified using a single instance rather than one per channel.
-  resampler = absl::make_unique<audio_dsp::QResampler<float>>(
+  return absl::make_unique<audio_dsp::QResampler<float>>(
       source_sample_rate, target_sample_rate, /*num_channels=*/1, params);
-  if (resampler != nullptr && !resampler->Valid()) {
-    resampler = std::unique_ptr<Resampler<float>>();
-  }
-  return resampler;
 }
 
 REGISTER_CALCULATOR(RationalFactorResampleCalculator);
@@ -22,12 +22,14 @@
 #include "Eigen/Core"
 #include "absl/strings/str_cat.h"
 #include "audio/dsp/resampler.h"
+#include "audio/dsp/resampler_q.h"
 #include "mediapipe/calculators/audio/rational_factor_resample_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/util/time_series_util.h"
 
 namespace mediapipe {
@@ -39,6 +41,12 @@ namespace mediapipe {
 //
 // NOTE: This calculator uses QResampler, despite the name, which supersedes
 // RationalFactorResampler.
+//
+// Channels are resampled independently. With num_threads > 1, they are
+// resampled in parallel, which pays off for inputs with many channels such
+// as microphone arrays. With share_resampler_filters, the resampling filter
+// is designed once per rate pair and options for the whole process and
+// copied for each channel and calculator instance.
 class RationalFactorResampleCalculator : public CalculatorBase {
  public:
   struct TestAccess;
@@ -72,6 +80,18 @@ class RationalFactorResampleCalculator : public CalculatorBase {
       const double source_sample_rate, const double target_sample_rate,
       const RationalFactorResampleCalculatorOptions& options);
 
+  // Returns a QResampler copied from a prototype, which is designed once per
+  // rate pair and options and cached for the lifetime of the process.
+  // Returns null if the options specify an invalid resampler.
+  static std::unique_ptr<ResamplerType> SharedResamplerFromOptions(
+      const double source_sample_rate, const double target_sample_rate,
+      const RationalFactorResampleCalculatorOptions& options);
+
+  // Returns a QResampler specified by the options, which may be invalid.
+  static std::unique_ptr<audio_dsp::QResampler<float>> NewQResampler(
+      const double source_sample_rate, const double target_sample_rate,
+      const RationalFactorResampleCalculatorOptions& options);
+
   // Does Timestamp bookkeeping and resampling common to Process() and
   // Close().  Returns FAIL if the resampler state becomes
   // inconsistent.
@@ -92,6 +112,11 @@ class RationalFactorResampleCalculator : public CalculatorBase {
   bool check_inconsistent_timestamps_;
   int num_channels_;
   std::vector<std::unique_ptr<ResamplerType>> resampler_;
+  // Per channel input and output samples, reused across packets.
+  std::vector<std::vector<float>> input_vectors_;
+  std::vector<std::vector<float>> output_vectors_;
+  // Resamples channels in parallel if num_threads > 1.
+  std::unique_ptr<ThreadPool> pool_;
 };
 
 // Test-only access to RationalFactorResampleCalculator methods.
@@ -19,6 +19,8 @@
 #include <deque>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "Eigen/Core"
 #include "absl/strings/string_view.h"
@@ -27,6 +29,7 @@
 #include "mediapipe/calculators/audio/spectrogram_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/matrix_pool.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
 #include "mediapipe/framework/port/core_proto_inc.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -38,6 +41,20 @@
 
 namespace mediapipe {
 
+namespace {
+// Returns a matrix for output frames, whose values are unspecified.
+// Real-valued matrices are taken from the MatrixPool.
+template <class OutputMatrixType>
+OutputMatrixType NewOutputFrames(int rows, int cols) {
+  return OutputMatrixType(rows, cols);
+}
+
+template <>
+Matrix NewOutputFrames<Matrix>(int rows, int cols) {
+  return std::move(*MatrixPool::Default()->Get(rows, cols));
+}
+}  // namespace
+
 // MediaPipe Calculator for computing the "spectrogram" (short-time Fourier
 // transform squared-magnitude, by default) of a multichannel input
 // time series, including optionally overlapping frames.  Options are
@@ -64,6 +81,10 @@ namespace mediapipe {
 // rounded to the nearest integer number of samples.  Conseqently, all output
 // frames will be based on the same number of input samples, and each
 // analysis frame will advance from its predecessor by the same time step.
+//
+// If min_frames_per_packet is set, input samples are accumulated until they
+// complete that many frames, so that each packet carries many frames and the
+// per-packet overhead of this and downstream calculators is amortized.
 class SpectrogramCalculator : public CalculatorBase {
  public:
   static absl::Status GetContract(CalculatorContract* cc) {
@@ -141,6 +162,14 @@ class SpectrogramCalculator : public CalculatorBase {
     return frame_duration_samples_ - frame_overlap_samples_;
   }
 
+  // Returns the number of frames completed by the given number of samples.
+  int64 NumCompletedFrames(int64 num_samples) const {
+    if (num_samples < frame_duration_samples_) {
+      return 0;
+    }
+    return (num_samples - frame_duration_samples_) / frame_step_samples() + 1;
+  }
+
   // Take the next set of input samples, already translated into a
   // vector<float> and pass them to the spectrogram object.
   // Convert the output of the spectrogram object into a Matrix (or an
@@ -149,11 +178,11 @@ class SpectrogramCalculator : public CalculatorBase {
   absl::Status ProcessVector(const Matrix& input_stream, CalculatorContext* cc);
 
   // Templated function to process either real- or complex-output spectrogram.
+  // postprocess_output_fn converts all the output frames of a channel in place.
   template <class OutputMatrixType>
   absl::Status ProcessVectorToOutput(
       const Matrix& input_stream,
-      const OutputMatrixType postprocess_output_fn(const OutputMatrixType&),
-      CalculatorContext* cc);
+      void postprocess_output_fn(OutputMatrixType*), CalculatorContext* cc);
 
   // Use the MediaPipe timestamp instead of the estimated one. Useful when the
   // data is intermittent.
@@ -183,6 +212,13 @@ class SpectrogramCalculator : public CalculatorBase {
   std::vector<std::unique_ptr<audio_dsp::Spectrogram>> spectrogram_generators_;
   // Fixed scale factor applied to output values (regardless of type).
   double output_scale_;
+  // Minimum number of frames per output packet, see options.
+  int min_frames_per_packet_;
+  // Input samples accumulated until they complete min_frames_per_packet_
+  // frames.
+  Matrix pending_input_;
+  // One channel of the input, reused across packets.
+  std::vector<float> input_vector_;
 
   static const float kLnPowerToDb;
 };
@@ -230,6 +266,10 @@ absl::Status SpectrogramCalculator::Open(CalculatorContext* cc) {
   allow_multichannel_input_ = spectrogram_options.allow_multichannel_input();
 
   output_scale_ = spectrogram_options.output_scale();
+  min_frames_per_packet_ = spectrogram_options.min_frames_per_packet();
+  RET_CHECK(min_frames_per_packet_ <= 1 || !use_local_timestamp_)
+      << "min_frames_per_packet requires use_local_timestamp to be false.";
+  pending_input_.resize(num_input_channels_, 0);
 
   std::vector<double> window;
   switch (spectrogram_options.window_type()) {
@@ -284,6 +324,7 @@ absl::Status SpectrogramCalculator::Open(CalculatorContext* cc) {
     cc->Outputs().Index(0).SetHeader(
         Adopt(multichannel_output_header.release()));
   }
+  cumulative_input_samples_ = 0;
   cumulative_completed_frames_ = 0;
   last_completed_frames_ = 0;
   initial_input_timestamp_ = Timestamp::Unstarted();
@@ -310,13 +351,30 @@ absl::Status SpectrogramCalculator::Process(CalculatorContext* cc) {
 
   cumulative_input_samples_ += input_stream.cols();
 
-  return ProcessVector(input_stream, cc);
+  if (min_frames_per_packet_ <= 1) {
+    const absl::Status status = ProcessVector(input_stream, cc);
+    // input_stream must not be accessed after this.
+    MatrixPool::Default()->Recycle(&cc->Inputs().Index(0).Value());
+    return status;
+  }
+  const int num_pending_samples = pending_input_.cols();
+  pending_input_.conservativeResize(Eigen::NoChange,
+                                    num_pending_samples + input_stream.cols());
+  pending_input_.rightCols(input_stream.cols()) = input_stream;
+  MatrixPool::Default()->Recycle(&cc->Inputs().Index(0).Value());
+  if (NumCompletedFrames(cumulative_input_samples_) -
+          cumulative_completed_frames_ <
+      min_frames_per_packet_) {
+    return absl::OkStatus();
+  }
+  const absl::Status status = ProcessVector(pending_input_, cc);
+  pending_input_.resize(num_input_channels_, 0);
+  return status;
 }
 
 template <class OutputMatrixType>
 absl::Status SpectrogramCalculator::ProcessVectorToOutput(
-    const Matrix& input_stream,
-    const OutputMatrixType postprocess_output_fn(const OutputMatrixType&),
+    const Matrix& input_stream, void postprocess_output_fn(OutputMatrixType*),
     CalculatorContext* cc) {
   std::unique_ptr<std::vector<OutputMatrixType>> spectrogram_matrices(
       new std::vector<OutputMatrixType>());
@@ -328,12 +386,12 @@ absl::Status SpectrogramCalculator::ProcessVectorToOutput(
     output_vectors.clear();
 
     // Copy one row (channel) of the input matrix into the std::vector.
-    std::vector<float> input_vector(input_stream.cols());
-    Eigen::Map<Matrix>(&input_vector[0], 1, input_vector.size()) =
+    input_vector_.resize(input_stream.cols());
+    Eigen::Map<Matrix>(input_vector_.data(), 1, input_vector_.size()) =
         input_stream.row(channel);
 
     if (!spectrogram_generators_[channel]->ComputeSpectrogram(
-            input_vector, &output_vectors)) {
+            input_vector_, &output_vectors)) {
       return absl::Status(absl::StatusCode::kInternal,
                           "Spectrogram returned failure");
     }
@@ -348,17 +406,20 @@ absl::Status SpectrogramCalculator::ProcessVectorToOutput(
     // any output frames.
     if (!output_vectors.empty()) {
       // Translate the returned values into a matrix of output frames.
-      OutputMatrixType output_frames(num_output_channels_,
-                                     output_vectors.size());
+      OutputMatrixType output_frames = NewOutputFrames<OutputMatrixType>(
+          num_output_channels_, output_vectors.size());
       for (int frame = 0; frame < output_vectors.size(); ++frame) {
-        Eigen::Map<const OutputMatrixType> frame_map(
+        output_frames.col(frame) = Eigen::Map<const OutputMatrixType>(
             &output_vectors[frame][0], output_vectors[frame].size(), 1);
-        // The underlying dsp object returns squared magnitudes; here
-        // we optionally translate to linear magnitude or dB.
-        output_frames.col(frame) =
-            output_scale_ * postprocess_output_fn(frame_map);
       }
-      spectrogram_matrices->push_back(output_frames);
+      // The underlying dsp object returns squared magnitudes; here
+      // we optionally translate to linear magnitude or dB, vectorized over
+      // all the frames at once.
+      postprocess_output_fn(&output_frames);
+      if (output_scale_ != 1.0) {
+        output_frames *= static_cast<float>(output_scale_);
+      }
+      spectrogram_matrices->push_back(std::move(output_frames));
     }
   }
   // If the input is very short, there may not be enough accumulated,
@@ -373,7 +434,7 @@ absl::Status SpectrogramCalculator::ProcessVectorToOutput(
                                  CurrentOutputTimestamp(cc));
     } else {
       cc->Outputs().Index(0).Add(
-          new OutputMatrixType(spectrogram_matrices->at(0)),
+          new OutputMatrixType(std::move(spectrogram_matrices->at(0))),
           CurrentOutputTimestamp(cc));
     }
     cumulative_completed_frames_ += output_vectors.size();
@@ -397,29 +458,25 @@ absl::Status SpectrogramCalculator::ProcessVector(const Matrix& input_stream,
     case SpectrogramCalculatorOptions::COMPLEX: {
       return ProcessVectorToOutput(
           input_stream,
-          +[](const Eigen::MatrixXcf& col) -> const Eigen::MatrixXcf {
-            return col;
-          }, cc);
+          +[](Eigen::MatrixXcf* frames) {}, cc);
     }
     case SpectrogramCalculatorOptions::SQUARED_MAGNITUDE: {
       return ProcessVectorToOutput(
           input_stream,
-          +[](const Matrix& col) -> const Matrix {
-            return col;
-          }, cc);
+          +[](Matrix* frames) {}, cc);
     }
     case SpectrogramCalculatorOptions::LINEAR_MAGNITUDE: {
       return ProcessVectorToOutput(
           input_stream,
-          +[](const Matrix& col) -> const Matrix {
-            return col.array().sqrt().matrix();
+          +[](Matrix* frames) {
+            frames->array() = frames->array().sqrt();
           }, cc);
     }
     case SpectrogramCalculatorOptions::DECIBELS: {
       return ProcessVectorToOutput(
           input_stream,
-          +[](const Matrix& col) -> const Matrix {
-            return kLnPowerToDb * col.array().log().matrix();
+          +[](Matrix* frames) {
+            frames->array() = kLnPowerToDb * frames->array().log();
           }, cc);
     }
     // clang-format on
@@ -442,8 +499,13 @@ absl::Status SpectrogramCalculator::Close(CalculatorContext* cc) {
       required_padding_samples =
           frame_duration_samples_ - cumulative_input_samples_;
     }
-    return ProcessVector(
-        Matrix::Zero(num_input_channels_, required_padding_samples), cc);
+    const int num_pending_samples = pending_input_.cols();
+    pending_input_.conservativeResize(
+        Eigen::NoChange, num_pending_samples + required_padding_samples);
+    pending_input_.rightCols(required_padding_samples).setZero();
+  }
+  if (pending_input_.cols() > 0) {
+    return ProcessVector(pending_input_, cc);
   }
 
   return absl::OkStatus();
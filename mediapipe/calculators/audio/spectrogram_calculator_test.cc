@@ -388,6 +388,59 @@ TEST_F(SpectrogramCalculatorTest, TrailingSamplesNoPad) {
   EXPECT_EQ(OutputFramesPerPacket(), expected_output_packet_sizes);
 }
 
+TEST_F(SpectrogramCalculatorTest, MinFramesPerPacketNoPad) {
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_frame_overlap_seconds(60.0 / input_sample_rate_);
+  options_.set_pad_final_packet(false);
+  options_.set_min_frames_per_packet(4);
+  const std::vector<int> input_packet_sizes = {100, 100, 100, 100,
+                                               100, 100, 100};
+  // Without min_frames_per_packet, the output packet sizes would be
+  // {1, 2, 3, 2, 3, 2, 3}.
+  const std::vector<int> expected_output_packet_sizes = {6, 5, 5};
+
+  InitializeGraph();
+  FillInputHeader();
+  SetupConstantInputPackets(input_packet_sizes);
+
+  MP_ASSERT_OK(Run());
+
+  CheckOutputHeadersAndTimestamps();
+  EXPECT_EQ(OutputFramesPerPacket(), expected_output_packet_sizes);
+}
+
+TEST_F(SpectrogramCalculatorTest, MinFramesPerPacketWithPad) {
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_frame_overlap_seconds(60.0 / input_sample_rate_);
+  options_.set_pad_final_packet(true);
+  options_.set_min_frames_per_packet(4);
+  const std::vector<int> input_packet_sizes = {100, 100, 100, 100};
+  // The last 2 frames are held until Close, where they are output along with
+  // the frame completed by the padding.
+  const std::vector<int> expected_output_packet_sizes = {6, 3};
+
+  InitializeGraph();
+  FillInputHeader();
+  SetupConstantInputPackets(input_packet_sizes);
+
+  MP_ASSERT_OK(Run());
+
+  CheckOutputHeadersAndTimestamps();
+  EXPECT_EQ(OutputFramesPerPacket(), expected_output_packet_sizes);
+}
+
+TEST_F(SpectrogramCalculatorTest, MinFramesPerPacketRequiresCumulativeTime) {
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_min_frames_per_packet(4);
+  options_.set_use_local_timestamp(true);
+
+  InitializeGraph();
+  FillInputHeader();
+  SetupConstantInputPackets({100});
+
+  EXPECT_FALSE(Run().ok());
+}
+
 TEST_F(SpectrogramCalculatorTest, NoTrailingSamplesWithPad) {
   options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
   options_.set_frame_overlap_seconds(60.0 / input_sample_rate_);
@@ -891,5 +944,48 @@ void BM_ProcessDC(benchmark::State& state) {
 
 BENCHMARK(BM_ProcessDC);
 
+// Measures computing the decibel spectrogram of 10 minutes of 16 kHz noise in
+// 25 ms frames with a 10 ms step, and reports the throughput in hours of
+// audio per second.
+// Args: number of samples per input packet, min_frames_per_packet.
+void BM_Spectrogram(benchmark::State& state) {
+  const int packet_size_samples = state.range(0);
+  const double sample_rate = 16000.0;
+  const int num_samples = 600 * sample_rate;
+
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("SpectrogramCalculator");
+  node_config.add_input_stream("input_audio");
+  node_config.add_output_stream("output_spectrogram");
+  SpectrogramCalculatorOptions* options =
+      node_config.mutable_options()->MutableExtension(
+          SpectrogramCalculatorOptions::ext);
+  options->set_frame_duration_seconds(0.025);
+  options->set_frame_overlap_seconds(0.015);
+  options->set_output_type(SpectrogramCalculatorOptions::DECIBELS);
+  options->set_min_frames_per_packet(state.range(1));
+
+  CalculatorRunner runner(node_config);
+  TimeSeriesHeader* header = new TimeSeriesHeader();
+  header->set_sample_rate(sample_rate);
+  header->set_num_channels(1);
+  runner.MutableInputs()->Index(0).header = Adopt(header);
+  const Packet payload =
+      Adopt(new Matrix(Matrix::Random(1, packet_size_samples)));
+  for (int sample = 0; sample + packet_size_samples <= num_samples;
+       sample += packet_size_samples) {
+    runner.MutableInputs()->Index(0).packets.push_back(payload.At(Timestamp(
+        round(sample / sample_rate * Timestamp::kTimestampUnitsPerSecond))));
+  }
+
+  for (auto _ : state) {
+    MP_ASSERT_OK(runner.Run());
+  }
+  state.counters["audio_hours_per_second"] = benchmark::Counter(
+      state.iterations() * num_samples / sample_rate / 3600,
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Spectrogram)->Args({160, 0})->Args({160, 100})->Args({16000, 0});
+
 }  // anonymous namespace
 }  // namespace mediapipe
@@ -74,7 +74,7 @@ class StabilizedLogCalculator : public CalculatorBase {
   }
 
   absl::Status Process(CalculatorContext* cc) override {
-    auto input_matrix = cc->Inputs().Index(0).Get<Matrix>();
+    const Matrix& input_matrix = cc->Inputs().Index(0).Get<Matrix>();
     if (input_matrix.array().isNaN().any()) {
       return absl::InvalidArgumentError("NaN input to log operation.");
     }
@@ -83,8 +83,11 @@ class StabilizedLogCalculator : public CalculatorBase {
         return absl::OutOfRangeError("Negative input to log operation.");
       }
     }
-    std::unique_ptr<Matrix> output_frame(new Matrix(
-        output_scale_ * (input_matrix.array() + stabilizer_).log().matrix()));
+    // Reuse the input matrix if this calculator is its only owner.
+    ASSIGN_OR_RETURN(std::unique_ptr<Matrix> output_frame,
+                     cc->Inputs().Index(0).Value().ConsumeOrCopy<Matrix>());
+    output_frame->array() =
+        output_scale_ * (output_frame->array() + stabilizer_).log();
     cc->Outputs().Index(0).Add(output_frame.release(), cc->InputTimestamp());
     return absl::OkStatus();
   }
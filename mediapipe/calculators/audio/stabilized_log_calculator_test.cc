@@ -12,8 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include <cmath>
+#include <memory>
+#include <vector>
 
 #include "Eigen/Core"
+#include "absl/memory/memory.h"
 #include "mediapipe/calculators/audio/stabilized_log_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
@@ -22,6 +25,7 @@
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/util/time_series_test_util.h"
 
@@ -138,4 +142,48 @@ TEST_F(StabilizedLogCalculatorTest, NegativeValuesDoNotCheckFailIfCheckIsOff) {
   // Results are undefined.
 }
 
+// In a graph, which unlike CalculatorRunner does not keep references to the
+// input packets, the log is computed in place in the input matrices.
+TEST_F(StabilizedLogCalculatorTest, ReusesUniquelyOwnedInputsInGraph) {
+  const int kNumPackets = 5;
+  CalculatorGraphConfig config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+        input_stream: "input"
+        node {
+          calculator: "StabilizedLogCalculator"
+          input_stream: "input"
+          output_stream: "output"
+        }
+      )pb");
+  *config.mutable_node(0)->mutable_options()->MutableExtension(
+      StabilizedLogCalculatorOptions::ext) = options_;
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  std::vector<Packet> outputs;
+  MP_ASSERT_OK(graph.ObserveOutputStream("output", [&](const Packet& packet) {
+    outputs.push_back(packet);
+    return absl::OkStatus();
+  }));
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  std::vector<Matrix> inputs;
+  std::vector<const float*> input_data;
+  for (int i = 0; i < kNumPackets; ++i) {
+    inputs.push_back(Matrix::Random(kNumChannels, kNumSamples).array().abs());
+    auto matrix = absl::make_unique<Matrix>(inputs.back());
+    input_data.push_back(matrix->data());
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "input", Adopt(matrix.release()).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  ASSERT_EQ(kNumPackets, outputs.size());
+  for (int i = 0; i < kNumPackets; ++i) {
+    EXPECT_EQ(input_data[i], outputs[i].Get<Matrix>().data());
+    ExpectApproximatelyEqual((inputs[i].array() + kStabilizer).log(),
+                             outputs[i].Get<Matrix>());
+  }
+}
+
 }  // namespace mediapipe
@@ -15,15 +15,18 @@
 // Defines TimeSeriesFramerCalculator.
 #include <math.h>
 
+#include <algorithm>
 #include <deque>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "Eigen/Core"
 #include "audio/dsp/window_functions.h"
 #include "mediapipe/calculators/audio/time_series_framer_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/matrix_pool.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
@@ -92,6 +95,14 @@ class TimeSeriesFramerCalculator : public CalculatorBase {
   void EnqueueInput(CalculatorContext* cc);
   // Constructs and emits framed output packets.
   void FrameOutput(CalculatorContext* cc);
+  // Removes the first num_samples samples from the internal buffer.
+  void DropSamples(int num_samples);
+  // Copies the first num_samples samples of the internal buffer into the first
+  // columns of output_frame.
+  void CopySamples(int num_samples, Matrix* output_frame) const;
+  // Returns the timestamp of the sample at the given index in the internal
+  // buffer.
+  Timestamp SampleTimestamp(int index);
 
   Timestamp CurrentOutputTimestamp() {
     if (use_local_timestamp_) {
@@ -144,9 +155,17 @@ class TimeSeriesFramerCalculator : public CalculatorBase {
   Timestamp current_timestamp_;
   int num_channels_;
 
-  // Each entry in this deque consists of a single sample, i.e. a
-  // single column vector, and its timestamp.
-  std::deque<std::pair<Matrix, Timestamp>> sample_buffer_;
+  // Circular buffer of the buffered samples, one sample per column. The
+  // buffered samples are the num_buffered_samples_ columns starting at column
+  // sample_buffer_start_, wrapping around at the end of the matrix.
+  Matrix sample_buffer_;
+  int sample_buffer_start_;
+  int num_buffered_samples_;
+  // Index of the first buffered sample since the start of the stream.
+  int64 first_buffered_sample_;
+  // Timestamp and index since the start of the stream of the first sample of
+  // each input packet that has buffered samples.
+  std::deque<std::pair<Timestamp, int64>> input_packet_starts_;
 
   bool use_window_;
   Matrix window_;
@@ -157,42 +176,88 @@ REGISTER_CALCULATOR(TimeSeriesFramerCalculator);
 
 void TimeSeriesFramerCalculator::EnqueueInput(CalculatorContext* cc) {
   const Matrix& input_frame = cc->Inputs().Index(0).Get<Matrix>();
+  const int num_input_samples = input_frame.cols();
+  if (num_input_samples == 0) {
+    return;
+  }
+
+  const int num_samples = num_buffered_samples_ + num_input_samples;
+  if (num_samples > sample_buffer_.cols()) {
+    // Grows the buffer geometrically, moving the buffered samples to its start.
+    Matrix sample_buffer(
+        num_channels_,
+        std::max<Eigen::Index>(num_samples, 2 * sample_buffer_.cols()));
+    CopySamples(num_buffered_samples_, &sample_buffer);
+    sample_buffer_.swap(sample_buffer);
+    sample_buffer_start_ = 0;
+  }
+  const int capacity = sample_buffer_.cols();
+  const int end = (sample_buffer_start_ + num_buffered_samples_) % capacity;
+  const int num_samples_before_wrap =
+      std::min(num_input_samples, capacity - end);
+  sample_buffer_.middleCols(end, num_samples_before_wrap) =
+      input_frame.leftCols(num_samples_before_wrap);
+  sample_buffer_.leftCols(num_input_samples - num_samples_before_wrap) =
+      input_frame.rightCols(num_input_samples - num_samples_before_wrap);
+
+  input_packet_starts_.emplace_back(
+      cc->InputTimestamp(), first_buffered_sample_ + num_buffered_samples_);
+  num_buffered_samples_ = num_samples;
+}
 
-  for (int i = 0; i < input_frame.cols(); ++i) {
-    sample_buffer_.emplace_back(std::make_pair(
-        input_frame.col(i), CurrentSampleTimestamp(cc->InputTimestamp(), i)));
+void TimeSeriesFramerCalculator::DropSamples(int num_samples) {
+  sample_buffer_start_ =
+      (sample_buffer_start_ + num_samples) % sample_buffer_.cols();
+  num_buffered_samples_ -= num_samples;
+  first_buffered_sample_ += num_samples;
+  while (input_packet_starts_.size() > 1 &&
+         input_packet_starts_[1].second <= first_buffered_sample_) {
+    input_packet_starts_.pop_front();
   }
 }
 
+void TimeSeriesFramerCalculator::CopySamples(int num_samples,
+                                             Matrix* output_frame) const {
+  const int num_samples_before_wrap = std::min<int>(
+      num_samples, sample_buffer_.cols() - sample_buffer_start_);
+  output_frame->leftCols(num_samples_before_wrap) =
+      sample_buffer_.middleCols(sample_buffer_start_, num_samples_before_wrap);
+  output_frame->middleCols(num_samples_before_wrap,
+                           num_samples - num_samples_before_wrap) =
+      sample_buffer_.leftCols(num_samples - num_samples_before_wrap);
+}
+
+Timestamp TimeSeriesFramerCalculator::SampleTimestamp(int index) {
+  const int64 sample = first_buffered_sample_ + index;
+  auto packet_start = input_packet_starts_.rbegin();
+  while (packet_start->second > sample) {
+    ++packet_start;
+  }
+  return CurrentSampleTimestamp(packet_start->first,
+                                sample - packet_start->second);
+}
+
 void TimeSeriesFramerCalculator::FrameOutput(CalculatorContext* cc) {
-  while (sample_buffer_.size() >=
+  while (num_buffered_samples_ >=
          frame_duration_samples_ + samples_still_to_drop_) {
-    while (samples_still_to_drop_ > 0) {
-      sample_buffer_.pop_front();
-      --samples_still_to_drop_;
+    if (samples_still_to_drop_ > 0) {
+      DropSamples(samples_still_to_drop_);
+      samples_still_to_drop_ = 0;
     }
     const int frame_step_samples = next_frame_step_samples();
-    std::unique_ptr<Matrix> output_frame(
-        new Matrix(num_channels_, frame_duration_samples_));
-    for (int i = 0; i < std::min(frame_step_samples, frame_duration_samples_);
-         ++i) {
-      output_frame->col(i) = sample_buffer_.front().first;
-      current_timestamp_ = sample_buffer_.front().second;
-      sample_buffer_.pop_front();
-    }
+    std::unique_ptr<Matrix> output_frame =
+        MatrixPool::Default()->Get(num_channels_, frame_duration_samples_);
+    CopySamples(frame_duration_samples_, output_frame.get());
+    current_timestamp_ = SampleTimestamp(frame_duration_samples_ - 1);
+    DropSamples(std::min(frame_step_samples, frame_duration_samples_));
     const int frame_overlap_samples =
         frame_duration_samples_ - frame_step_samples;
-    if (frame_overlap_samples > 0) {
-      for (int i = 0; i < frame_overlap_samples; ++i) {
-        output_frame->col(i + frame_step_samples) = sample_buffer_[i].first;
-        current_timestamp_ = sample_buffer_[i].second;
-      }
-    } else {
+    if (frame_overlap_samples <= 0) {
       samples_still_to_drop_ = -frame_overlap_samples;
     }
 
     if (use_window_) {
-      *output_frame = (output_frame->array() * window_.array()).matrix();
+      output_frame->array() *= window_.array();
     }
 
     cc->Outputs().Index(0).Add(output_frame.release(),
@@ -215,23 +280,25 @@ absl::Status TimeSeriesFramerCalculator::Process(CalculatorContext* cc) {
   }
 
   EnqueueInput(cc);
+  // The input samples are buffered, so the input buffer can be reused.
+  MatrixPool::Default()->Recycle(&cc->Inputs().Index(0).Value());
   FrameOutput(cc);
 
   return absl::OkStatus();
 }
 
 absl::Status TimeSeriesFramerCalculator::Close(CalculatorContext* cc) {
-  while (samples_still_to_drop_ > 0 && !sample_buffer_.empty()) {
-    sample_buffer_.pop_front();
-    --samples_still_to_drop_;
+  const int num_samples_to_drop =
+      std::min(samples_still_to_drop_, num_buffered_samples_);
+  if (num_samples_to_drop > 0) {
+    DropSamples(num_samples_to_drop);
+    samples_still_to_drop_ -= num_samples_to_drop;
   }
-  if (!sample_buffer_.empty() && pad_final_packet_) {
+  if (num_buffered_samples_ > 0 && pad_final_packet_) {
     std::unique_ptr<Matrix> output_frame(new Matrix);
     output_frame->setZero(num_channels_, frame_duration_samples_);
-    for (int i = 0; i < sample_buffer_.size(); ++i) {
-      output_frame->col(i) = sample_buffer_[i].first;
-      current_timestamp_ = sample_buffer_[i].second;
-    }
+    CopySamples(num_buffered_samples_, output_frame.get());
+    current_timestamp_ = SampleTimestamp(num_buffered_samples_ - 1);
 
     cc->Outputs().Index(0).Add(output_frame.release(),
                                CurrentOutputTimestamp());
@@ -291,6 +358,10 @@ absl::Status TimeSeriesFramerCalculator::Open(CalculatorContext* cc) {
   cumulative_completed_samples_ = 0;
   cumulative_output_frames_ = 0;
   samples_still_to_drop_ = 0;
+  sample_buffer_.resize(num_channels_, 0);
+  sample_buffer_start_ = 0;
+  num_buffered_samples_ = 0;
+  first_buffered_sample_ = 0;
   initial_input_timestamp_ = Timestamp::Unstarted();
   current_timestamp_ = Timestamp::Unstarted();
 
@@ -14,8 +14,10 @@
 
 #include <math.h>
 
+#include <iterator>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Eigen/Core"
@@ -25,6 +27,7 @@
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -45,6 +48,12 @@ class TimeSeriesFramerCalculatorTest
     calculator_name_ = "TimeSeriesFramerCalculator";
     input_sample_rate_ = 4000.0;
     num_input_channels_ = 3;
+    // This range of packet sizes was chosen such that some input
+    // packets will be smaller than the output packet size and other
+    // input packets will be larger.
+    for (int i = 0; i < 10; ++i) {
+      input_packet_sizes_.push_back((i + 1) * 20);
+    }
   }
 
   // Returns a float value with the channel and timestamp separated by
@@ -82,11 +91,8 @@ class TimeSeriesFramerCalculatorTest
   void InitializeInput() {
     concatenated_input_samples_.resize(0, num_input_channels_);
     num_input_samples_ = 0;
-    for (int i = 0; i < 10; ++i) {
-      // This range of packet sizes was chosen such that some input
-      // packets will be smaller than the output packet size and other
-      // input packets will be larger.
-      int packet_size = (i + 1) * 20;
+    input_packet_starts_.clear();
+    for (int packet_size : input_packet_sizes_) {
       double timestamp_seconds = kInitialTimestampOffsetMicroseconds * 1.0e-6 +
                                  num_input_samples_ / input_sample_rate_;
 
@@ -100,10 +106,12 @@ class TimeSeriesFramerCalculatorTest
       concatenated_input_samples_.conservativeResize(
           num_input_channels_, num_input_samples_ + packet_size);
       concatenated_input_samples_.rightCols(packet_size) = *data_frame;
+      const int64 timestamp =
+          round(timestamp_seconds * Timestamp::kTimestampUnitsPerSecond);
+      input_packet_starts_.emplace_back(timestamp, num_input_samples_);
       num_input_samples_ += packet_size;
 
-      AppendInputPacket(data_frame, round(timestamp_seconds *
-                                          Timestamp::kTimestampUnitsPerSecond));
+      AppendInputPacket(data_frame, timestamp);
     }
 
     const int frame_duration_samples = FrameDurationSamples();
@@ -221,8 +229,53 @@ class TimeSeriesFramerCalculatorTest
     }
   }
 
+  // Checks the Timestamps of the full output packets, for an integer number
+  // of samples per frame step. With local timestamps, a packet has the
+  // timestamp of its last sample, inferred from the input packet containing
+  // it. Otherwise, it has the timestamp of its first sample, inferred from the
+  // first input packet.
+  void CheckOutputTimestamps() {
+    const int frame_step_samples =
+        FrameDurationSamples() -
+        time_series_util::SecondsToSamples(options_.frame_overlap_seconds(),
+                                           input_sample_rate_);
+    int num_full_packets = output().packets.size();
+    if (options_.pad_final_packet()) {
+      num_full_packets -= 1;
+    }
+
+    auto packet_start = input_packet_starts_.begin();
+    for (int packet_num = 0; packet_num < num_full_packets; ++packet_num) {
+      int64 expected_timestamp;
+      if (options_.use_local_timestamp()) {
+        const int64 sample =
+            packet_num * frame_step_samples + FrameDurationSamples() - 1;
+        while (std::next(packet_start) != input_packet_starts_.end() &&
+               std::next(packet_start)->second <= sample) {
+          ++packet_start;
+        }
+        expected_timestamp =
+            packet_start->first +
+            round((sample - packet_start->second) / input_sample_rate_ *
+                  Timestamp::kTimestampUnitsPerSecond);
+      } else {
+        expected_timestamp =
+            input_packet_starts_[0].first +
+            round(static_cast<int64>(packet_num) * frame_step_samples /
+                  input_sample_rate_ * Timestamp::kTimestampUnitsPerSecond);
+      }
+      EXPECT_EQ(expected_timestamp,
+                output().packets[packet_num].Timestamp().Value())
+          << "Packet " << packet_num;
+    }
+  }
+
+  // Sizes of the input packets created by InitializeInput().
+  std::vector<int> input_packet_sizes_;
   int num_input_samples_;
   Matrix concatenated_input_samples_;
+  // Timestamp and index of the first sample of each input packet.
+  std::vector<std::pair<int64, int64>> input_packet_starts_;
   Matrix window_;
 };
 
@@ -334,6 +387,54 @@ TEST_F(TimeSeriesFramerCalculatorTest, NoFinalPacketPadding) {
   CheckOutput();
 }
 
+// Many packets smaller than a frame make the buffered samples wrap around the
+// end of the internal buffer, once it stopped growing.
+TEST_F(TimeSeriesFramerCalculatorTest, SmallPacketsWrapAroundBuffer) {
+  input_packet_sizes_.assign(150, 7);
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_frame_overlap_seconds(40.0 / input_sample_rate_);
+  MP_ASSERT_OK(Run());
+  CheckOutput();
+  CheckOutputTimestamps();
+}
+
+TEST_F(TimeSeriesFramerCalculatorTest,
+       SmallPacketsWrapAroundBufferLocalTimestamps) {
+  input_packet_sizes_.assign(150, 7);
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_frame_overlap_seconds(40.0 / input_sample_rate_);
+  options_.set_use_local_timestamp(true);
+  MP_ASSERT_OK(Run());
+  CheckOutput();
+  CheckOutputTimestamps();
+}
+
+// A packet larger than the internal buffer grows it while the buffered
+// samples wrap around, after which small packets wrap around again.
+TEST_F(TimeSeriesFramerCalculatorTest, LargePacketGrowsWrappedBuffer) {
+  input_packet_sizes_.assign(60, 7);
+  input_packet_sizes_.push_back(1000);
+  input_packet_sizes_.insert(input_packet_sizes_.end(), 200, 9);
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_frame_overlap_seconds(40.0 / input_sample_rate_);
+  MP_ASSERT_OK(Run());
+  CheckOutput();
+  CheckOutputTimestamps();
+}
+
+TEST_F(TimeSeriesFramerCalculatorTest,
+       LargePacketGrowsWrappedBufferLocalTimestamps) {
+  input_packet_sizes_.assign(60, 7);
+  input_packet_sizes_.push_back(1000);
+  input_packet_sizes_.insert(input_packet_sizes_.end(), 200, 9);
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_frame_overlap_seconds(40.0 / input_sample_rate_);
+  options_.set_use_local_timestamp(true);
+  MP_ASSERT_OK(Run());
+  CheckOutput();
+  CheckOutputTimestamps();
+}
+
 TEST_F(TimeSeriesFramerCalculatorTest,
        FrameRateHigherThanSampleRate_FrameDurationTooLow) {
   // Try to produce a frame rate 10 times the input sample rate by using a
@@ -481,5 +582,47 @@ TEST_F(TimeSeriesFramerCalculatorTimestampingTest, UseCumulativeTimeStamp) {
   CheckOutputTimestamps();
 }
 
+// Measures framing 10 seconds of 48 kHz audio into 25 ms Hann windowed frames
+// with a 10 ms step.
+// Args: number of channels, number of samples per input packet.
+void BM_FrameAudio(benchmark::State& state) {
+  const int num_channels = state.range(0);
+  const int packet_size_samples = state.range(1);
+  const double sample_rate = 48000.0;
+  const int num_samples = 10 * sample_rate;
+
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("TimeSeriesFramerCalculator");
+  node_config.add_input_stream("input_audio");
+  node_config.add_output_stream("output_frames");
+  auto* options = node_config.mutable_options()->MutableExtension(
+      TimeSeriesFramerCalculatorOptions::ext);
+  options->set_frame_duration_seconds(0.025);
+  options->set_frame_overlap_seconds(0.015);
+  options->set_window_function(TimeSeriesFramerCalculatorOptions::HANN);
+
+  CalculatorRunner runner(node_config);
+  TimeSeriesHeader* header = new TimeSeriesHeader();
+  header->set_sample_rate(sample_rate);
+  header->set_num_channels(num_channels);
+  runner.MutableInputs()->Index(0).header = Adopt(header);
+  const Packet payload = Adopt(new Matrix(
+      Matrix::Random(num_channels, packet_size_samples)));
+  for (int sample = 0; sample + packet_size_samples <= num_samples;
+       sample += packet_size_samples) {
+    runner.MutableInputs()->Index(0).packets.push_back(payload.At(Timestamp(
+        round(sample / sample_rate * Timestamp::kTimestampUnitsPerSecond))));
+  }
+
+  for (auto _ : state) {
+    MP_ASSERT_OK(runner.Run());
+  }
+  state.SetItemsProcessed(state.iterations() * num_samples);
+}
+BENCHMARK(BM_FrameAudio)
+    ->Args({1, 480})
+    ->Args({2, 4800})
+    ->Args({8, 4800});
+
 }  // namespace
 }  // namespace mediapipe
@@ -19,6 +19,7 @@
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "mediapipe/calculators/video/motion_analysis_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
@@ -599,6 +600,46 @@ absl::Status MotionAnalysisCalculator::Close(CalculatorContext* cc) {
   // Guard against empty videos.
   if (motion_analysis_) {
     OutputMotionAnalyzedFrames(true, cc);
+
+    const auto& adaptive_stats = motion_analysis_->GetAdaptiveResolutionStats();
+    if (adaptive_stats.num_frames > 0) {
+      LOG(INFO) << "Adaptive resolution: "
+                << adaptive_stats.num_full_resolution_frames << " of "
+                << adaptive_stats.num_frames
+                << " frames computed at full resolution ("
+                << adaptive_stats.num_resync_frames << " resyncs).";
+      const absl::Duration adaptive_time = adaptive_stats.low_resolution_time +
+                                           adaptive_stats.stability_check_time +
+                                           adaptive_stats.full_resolution_time;
+      LOG(INFO) << "Adaptive resolution time: "
+                << absl::ToDoubleMilliseconds(adaptive_time)
+                << " ms (low resolution: "
+                << absl::ToDoubleMilliseconds(
+                       adaptive_stats.low_resolution_time)
+                << " ms, stability check: "
+                << absl::ToDoubleMilliseconds(
+                       adaptive_stats.stability_check_time)
+                << " ms, full resolution: "
+                << absl::ToDoubleMilliseconds(
+                       adaptive_stats.full_resolution_time)
+                << " ms).";
+      // Without adaptive resolution, every frame is computed at full
+      // resolution, at the measured average cost including resyncs.
+      const int num_full_resolution_computations =
+          adaptive_stats.num_full_resolution_frames +
+          adaptive_stats.num_resync_frames;
+      if (num_full_resolution_computations > 0) {
+        const absl::Duration full_resolution_only_time =
+            adaptive_stats.full_resolution_time /
+            num_full_resolution_computations * adaptive_stats.num_frames;
+        LOG(INFO) << "Adaptive resolution saved an estimated "
+                  << absl::ToDoubleMilliseconds(full_resolution_only_time -
+                                                adaptive_time)
+                  << " ms of "
+                  << absl::ToDoubleMilliseconds(full_resolution_only_time)
+                  << " ms at full resolution only.";
+      }
+    }
   }
   if (csv_file_input_) {
     if (!meta_motions_.empty()) {
@@ -55,11 +55,23 @@ void SetRect(const cv::Rect& region,
   part->set_relative_position(relative_position);
 }
 
+// Returns true if the colors are within the tolerance in every channel.
+bool SimilarColors(const Color& a, const Color& b, int tolerance) {
+  return std::abs(a.r() - b.r()) <= tolerance &&
+         std::abs(a.g() - b.g()) <= tolerance &&
+         std::abs(a.b() - b.b()) <= tolerance;
+}
+
 }  // namespace
 
 // This calculator takes a sequence of images (video) and detects solid color
 // borders as well as the dominant color of the non-border area.  This per-frame
 // information is passed to downstream calculators.
+//
+// Borders are usually static for a whole video. If stable_border_frames is set,
+// borders found with the same size and color on that many consecutive frames
+// are only verified to still be present on the following frames, and searched
+// for again every border_redetection_period frames.
 class BorderDetectionCalculator : public CalculatorBase {
  public:
   BorderDetectionCalculator() : frame_width_(-1), frame_height_(-1) {}
@@ -73,14 +85,27 @@ class BorderDetectionCalculator : public CalculatorBase {
   absl::Status Process(mediapipe::CalculatorContext* cc) override;
 
  private:
+  // Finds the top and bottom borders of the frame and adds them to features.
+  void FindBorders(const cv::Mat& frame, StaticFeatures* features);
+
+  // Returns true if the stable borders are still present in the frame.
+  bool VerifyStableBorders(const cv::Mat& frame);
+
   // Given a color and image direction, check to see if a border of that color
-  // exists.
-  void DetectBorder(const cv::Mat& frame, const Color& color,
-                    const Border::RelativePosition& direction,
-                    StaticFeatures* features);
+  // exists. Returns the last row of the border counted from the frame edge, or
+  // -1 if there is no border.
+  int DetectBorder(const cv::Mat& frame, const Color& color,
+                   const Border::RelativePosition& direction,
+                   StaticFeatures* features);
+
+  // Adds the border ending on the given row (counted from the frame edge) to
+  // features.
+  void AddBorder(const cv::Mat& frame, int last_border,
+                 const Border::RelativePosition& direction,
+                 StaticFeatures* features);
 
   // Provide the percent this color shows up in a given image.
-  double ColorCount(const Color& mask_color, const cv::Mat& image) const;
+  double ColorCount(const Color& mask_color, const cv::Mat& image);
 
   // Set member vars (image size) and confirm no changes frame-to-frame.
   absl::Status SetAndCheckInputs(const cv::Mat& frame);
@@ -94,6 +119,20 @@ class BorderDetectionCalculator : public CalculatorBase {
 
   // Options for processing.
   BorderDetectionCalculatorOptions options_;
+
+  // Last row and color of the top and bottom borders found by the last border
+  // search, the row is -1 if there was no border.
+  int top_border_ = -1;
+  Color top_border_color_;
+  int bottom_border_ = -1;
+  Color bottom_border_color_;
+  // Number of consecutive border searches that found the same borders.
+  int num_stable_searches_ = 0;
+  // Number of frames since the last border search.
+  int frames_since_search_ = 0;
+
+  // Pixels matching the color in ColorCount, reused across calls.
+  cv::Mat color_mask_;
 };
 REGISTER_CALCULATOR(BorderDetectionCalculator);
 
@@ -101,6 +140,10 @@ absl::Status BorderDetectionCalculator::Open(mediapipe::CalculatorContext* cc) {
   options_ = cc->Options<BorderDetectionCalculatorOptions>();
   RET_CHECK_LT(options_.vertical_search_distance(), 0.5)
       << "Search distance must be less than half the full image.";
+  RET_CHECK_GE(options_.stable_border_frames(), 0)
+      << "Number of stable border frames must not be negative.";
+  RET_CHECK_GT(options_.border_redetection_period(), 0)
+      << "Border redetection period must be positive.";
   return absl::OkStatus();
 }
 
@@ -141,16 +184,7 @@ absl::Status BorderDetectionCalculator::Process(
   features->mutable_non_static_area()->set_height(
       std::max(0, frame_height_ - options_.default_padding_px() * 2));
 
-  // Check for border at the top of the frame.
-  Color seed_color_top;
-  FindDominantColor(frame(cv::Rect(0, 0, frame_width_, 1)), &seed_color_top);
-  DetectBorder(frame, seed_color_top, Border::TOP, features.get());
-
-  // Check for border at the bottom of the frame.
-  Color seed_color_bottom;
-  FindDominantColor(frame(cv::Rect(0, frame_height_ - 1, frame_width_, 1)),
-                    &seed_color_bottom);
-  DetectBorder(frame, seed_color_bottom, Border::BOTTOM, features.get());
+  FindBorders(frame, features.get());
 
   // Check the non-border area for a dominant color.
   cv::Mat non_static_frame = frame(
@@ -175,6 +209,67 @@ absl::Status BorderDetectionCalculator::Process(
   return absl::OkStatus();
 }
 
+void BorderDetectionCalculator::FindBorders(const cv::Mat& frame,
+                                            StaticFeatures* features) {
+  if (options_.stable_border_frames() > 0 &&
+      num_stable_searches_ >= options_.stable_border_frames() &&
+      frames_since_search_ < options_.border_redetection_period() &&
+      VerifyStableBorders(frame)) {
+    ++frames_since_search_;
+    if (top_border_ >= 0) {
+      AddBorder(frame, top_border_, Border::TOP, features);
+    }
+    if (bottom_border_ >= 0) {
+      AddBorder(frame, bottom_border_, Border::BOTTOM, features);
+    }
+    return;
+  }
+  frames_since_search_ = 0;
+
+  // Check for border at the top of the frame.
+  Color seed_color_top;
+  FindDominantColor(frame(cv::Rect(0, 0, frame_width_, 1)), &seed_color_top);
+  const int top_border =
+      DetectBorder(frame, seed_color_top, Border::TOP, features);
+
+  // Check for border at the bottom of the frame.
+  Color seed_color_bottom;
+  FindDominantColor(frame(cv::Rect(0, frame_height_ - 1, frame_width_, 1)),
+                    &seed_color_bottom);
+  const int bottom_border =
+      DetectBorder(frame, seed_color_bottom, Border::BOTTOM, features);
+
+  const int tolerance = options_.color_tolerance();
+  const bool same_borders =
+      top_border == top_border_ && bottom_border == bottom_border_ &&
+      (top_border < 0 ||
+       SimilarColors(seed_color_top, top_border_color_, tolerance)) &&
+      (bottom_border < 0 ||
+       SimilarColors(seed_color_bottom, bottom_border_color_, tolerance));
+  num_stable_searches_ = same_borders ? num_stable_searches_ + 1 : 1;
+  top_border_ = top_border;
+  top_border_color_ = seed_color_top;
+  bottom_border_ = bottom_border;
+  bottom_border_color_ = seed_color_bottom;
+}
+
+bool BorderDetectionCalculator::VerifyStableBorders(const cv::Mat& frame) {
+  if (top_border_ >= 0 &&
+      ColorCount(top_border_color_,
+                 frame(cv::Rect(0, 0, frame.cols, top_border_ + 1))) <
+          options_.border_color_pixel_perc()) {
+    return false;
+  }
+  if (bottom_border_ >= 0 &&
+      ColorCount(bottom_border_color_,
+                 frame(cv::Rect(0, frame.rows - bottom_border_ - 1, frame.cols,
+                                bottom_border_ + 1))) <
+          options_.border_color_pixel_perc()) {
+    return false;
+  }
+  return true;
+}
+
 //  Find the dominant color within an image.
 double BorderDetectionCalculator::FindDominantColor(const cv::Mat& image_raw,
                                                     Color* dominant_color) {
@@ -211,25 +306,21 @@ double BorderDetectionCalculator::FindDominantColor(const cv::Mat& image_raw,
 }
 
 double BorderDetectionCalculator::ColorCount(const Color& mask_color,
-                                             const cv::Mat& image) const {
-  int background_count = 0;
-  for (int i = 0; i < image.rows; i++) {
-    const uint8* row_ptr = image.ptr<uint8>(i);
-    for (int j = 0; j < image.cols * 3; j += 3) {
-      if (std::abs(mask_color.r() - static_cast<int>(row_ptr[j + 2])) <=
-              options_.color_tolerance() &&
-          std::abs(mask_color.g() - static_cast<int>(row_ptr[j + 1])) <=
-              options_.color_tolerance() &&
-          std::abs(mask_color.b() - static_cast<int>(row_ptr[j])) <=
-              options_.color_tolerance()) {
-        background_count++;
-      }
-    }
-  }
-  return background_count / static_cast<double>(image.rows * image.cols);
+                                             const cv::Mat& image) {
+  // Matches the pixels within the tolerance of the color in every channel with
+  // vectorized (inclusive) range checks.
+  const int tolerance = options_.color_tolerance();
+  cv::inRange(image,
+              cv::Scalar(mask_color.b() - tolerance, mask_color.g() - tolerance,
+                         mask_color.r() - tolerance),
+              cv::Scalar(mask_color.b() + tolerance, mask_color.g() + tolerance,
+                         mask_color.r() + tolerance),
+              color_mask_);
+  return cv::countNonZero(color_mask_) /
+         static_cast<double>(image.rows * image.cols);
 }
 
-void BorderDetectionCalculator::DetectBorder(
+int BorderDetectionCalculator::DetectBorder(
     const cv::Mat& frame, const Color& color,
     const Border::RelativePosition& direction, StaticFeatures* features) {
   // Search the entire image until we find an object, or hit the max search
@@ -261,9 +352,15 @@ void BorderDetectionCalculator::DetectBorder(
 
   // Reject results that are not borders (or too small).
   if (last_border <= kMinBorderDistance || last_border == search_distance - 1) {
-    return;
+    return -1;
   }
+  AddBorder(frame, last_border, direction, features);
+  return last_border;
+}
 
+void BorderDetectionCalculator::AddBorder(
+    const cv::Mat& frame, int last_border,
+    const Border::RelativePosition& direction, StaticFeatures* features) {
   // Apply defined padding.
   last_border += options_.border_object_padding_px();
 
@@ -64,6 +64,17 @@ const char kConfigPad[] = R"(
     }
     })";
 
+const char kConfigStable[] = R"(
+    calculator: "BorderDetectionCalculator"
+    input_stream: "VIDEO:camera_frames"
+    output_stream: "DETECTED_BORDERS:regions"
+    options:{
+    [mediapipe.autoflip.BorderDetectionCalculatorOptions.ext]:{
+      border_object_padding_px: 0
+      stable_border_frames: 2
+    }
+    })";
+
 const int kTestFrameWidth = 640;
 const int kTestFrameHeight = 480;
 
@@ -369,6 +380,65 @@ TEST(BorderDetectionCalculatorTest, DominantColor) {
   EXPECT_EQ(255, static_features.solid_background().b());
 }
 
+// Returns a black frame with red top and bottom borders of the given height.
+Packet MakeBorderFrame(int width, int height, int border_height) {
+  auto input_frame =
+      ::absl::make_unique<ImageFrame>(ImageFormat::SRGB, width, height);
+  cv::Mat input_mat = mediapipe::formats::MatView(input_frame.get());
+  input_mat.setTo(cv::Scalar(0, 0, 0));
+  if (border_height > 0) {
+    input_mat(cv::Rect(0, 0, width, border_height))
+        .setTo(cv::Scalar(255, 0, 0));
+    input_mat(cv::Rect(0, height - border_height, width, border_height))
+        .setTo(cv::Scalar(255, 0, 0));
+  }
+  return Adopt(input_frame.release());
+}
+
+TEST(BorderDetectionCalculatorTest, StableBordersTest) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfigStable));
+  const int kBorderHeight = 50;
+  const Packet border_frame =
+      MakeBorderFrame(kTestFrameWidth, kTestFrameHeight, kBorderHeight);
+  for (int i = 0; i < 5; ++i) {
+    runner->MutableInputs()->Tag("VIDEO").packets.push_back(
+        border_frame.At(Timestamp(i)));
+  }
+  // The borders disappear once they are stable.
+  runner->MutableInputs()->Tag("VIDEO").packets.push_back(
+      MakeBorderFrame(kTestFrameWidth, kTestFrameHeight, 0).At(Timestamp(5)));
+
+  // Run the calculator.
+  MP_ASSERT_OK(runner->Run());
+
+  const std::vector<Packet>& output_packets =
+      runner->Outputs().Tag("DETECTED_BORDERS").packets;
+  ASSERT_EQ(6, output_packets.size());
+  const auto& first_features = output_packets[0].Get<StaticFeatures>();
+  ASSERT_EQ(2, first_features.border().size());
+  for (int i = 1; i < 5; ++i) {
+    const auto& static_features = output_packets[i].Get<StaticFeatures>();
+    ASSERT_EQ(2, static_features.border().size());
+    for (int j = 0; j < 2; ++j) {
+      EXPECT_EQ(first_features.border(j).relative_position(),
+                static_features.border(j).relative_position());
+      EXPECT_EQ(first_features.border(j).border_position().y(),
+                static_features.border(j).border_position().y());
+      EXPECT_EQ(first_features.border(j).border_position().height(),
+                static_features.border(j).border_position().height());
+    }
+    EXPECT_EQ(first_features.non_static_area().y(),
+              static_features.non_static_area().y());
+    EXPECT_EQ(first_features.non_static_area().height(),
+              static_features.non_static_area().height());
+  }
+  const auto& last_features = output_packets[5].Get<StaticFeatures>();
+  EXPECT_EQ(0, last_features.border().size());
+  EXPECT_EQ(0, last_features.non_static_area().y());
+  EXPECT_EQ(kTestFrameHeight, last_features.non_static_area().height());
+}
+
 void BM_Large(benchmark::State& state) {
   for (auto _ : state) {
     auto runner = ::absl::make_unique<CalculatorRunner>(
@@ -392,6 +462,27 @@ void BM_Large(benchmark::State& state) {
 }
 BENCHMARK(BM_Large);
 
+// Measures detecting the borders of 30 large frames with static borders.
+// Args: stable_border_frames.
+void BM_StableBorders(benchmark::State& state) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig);
+  config.mutable_options()
+      ->MutableExtension(BorderDetectionCalculatorOptions::ext)
+      ->set_stable_border_frames(state.range(0));
+  const Packet border_frame =
+      MakeBorderFrame(kTestFrameLargeWidth, kTestFrameLargeHeight, 140);
+  for (auto _ : state) {
+    auto runner = ::absl::make_unique<CalculatorRunner>(config);
+    for (int i = 0; i < 30; ++i) {
+      runner->MutableInputs()->Tag("VIDEO").packets.push_back(
+          border_frame.At(Timestamp(i)));
+    }
+    MP_ASSERT_OK(runner->Run());
+  }
+  state.SetItemsProcessed(state.iterations() * 30);
+}
+BENCHMARK(BM_StableBorders)->Arg(0)->Arg(3);
+
 }  // namespace
 }  // namespace autoflip
 }  // namespace mediapipe
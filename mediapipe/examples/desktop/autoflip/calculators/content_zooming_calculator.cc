@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <cmath>
+#include <deque>
 #include <memory>
 
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
@@ -63,6 +65,10 @@ using StateCacheType = ContentZoomingCalculatorStateCacheType;
 // using CROP_RECT output.  When more than one detections are received the
 // zoom box is calculated as the union of the detections.  Typical applications
 // include mobile makeover and autofliplive face reframing.
+//
+// By default each frame is reframed as soon as it arrives. Live streams that
+// can afford a fixed latency can set lookahead_frames to smooth the measured
+// crops over a window around each frame before camera smoothing.
 class ContentZoomingCalculator : public CalculatorBase {
  public:
   ContentZoomingCalculator() : initialized_(false) {}
@@ -103,6 +109,30 @@ class ContentZoomingCalculator : public CalculatorBase {
                                     int* pan_offset, int* height);
   // Sets max_frame_value_ and target_aspect_
   absl::Status UpdateAspectAndMax();
+
+  // Crop measured on a frame from its detections, before camera smoothing.
+  struct MeasuredFrame {
+    Timestamp timestamp;
+    int frame_width;
+    int frame_height;
+    // Set for the frame whose smoothed crop becomes the first rect.
+    bool records_first_rect;
+    int offset_x;
+    int offset_y;
+    int height;
+  };
+  // Smooths the camera path with the crop measured on |frame| and outputs the
+  // borders and crop rects at the timestamp of |frame|.
+  absl::Status UpdatePathAndOutput(mediapipe::CalculatorContext* cc,
+                                   const MeasuredFrame& frame);
+  // Outputs the buffered frames that have lookahead_frames frames after them,
+  // or all buffered frames if |flush| is true.
+  absl::Status OutputLookaheadFrames(mediapipe::CalculatorContext* cc,
+                                     bool flush);
+  // Outputs all buffered frames and clears the lookahead window, before the
+  // path solvers are reset or adjusted to a new resolution.
+  absl::Status ResetLookahead(mediapipe::CalculatorContext* cc);
+
   ContentZoomingCalculatorOptions options_;
   // Detection frame width/height.
   int frame_height_;
@@ -132,6 +162,11 @@ class ContentZoomingCalculator : public CalculatorBase {
   // will be 1.0.  Else, will be less than 1.0 to prevent exceeding the size of
   // the image in either dimension.
   float max_frame_value_;
+  // Frames measured when lookahead_frames is set: up to lookahead_frames
+  // frames that were already output, followed by the frames to output.
+  std::deque<MeasuredFrame> measured_frames_;
+  // Index of the next frame to output in measured_frames_.
+  int next_output_index_ = 0;
 };
 REGISTER_CALCULATOR(ContentZoomingCalculator);
 
@@ -188,10 +223,13 @@ absl::Status ContentZoomingCalculator::Open(mediapipe::CalculatorContext* cc) {
               "in kinematic_options_zoom and kinematic_options_tilt "
               "directly.";
   }
+  RET_CHECK_GE(options_.lookahead_frames(), 0)
+      << "lookahead_frames must not be negative.";
   return absl::OkStatus();
 }
 
 absl::Status ContentZoomingCalculator::Close(mediapipe::CalculatorContext* cc) {
+  MP_RETURN_IF_ERROR(OutputLookaheadFrames(cc, /*flush=*/true));
   if (initialized_) {
     MP_RETURN_IF_ERROR(SaveState(cc));
   }
@@ -514,10 +552,16 @@ absl::Status ContentZoomingCalculator::Process(
   MP_RETURN_IF_ERROR(GetVideoResolution(cc, &frame_width, &frame_height));
 
   // Init on first call or re-init always if configured to be stateless.
+  // Frames still buffered for the lookahead are smoothed with the state they
+  // were measured with.
   if (!initialized_) {
+    MP_RETURN_IF_ERROR(ResetLookahead(cc));
     MP_RETURN_IF_ERROR(MaybeLoadState(cc, frame_width, frame_height));
     initialized_ = !options_.is_stateless();
   } else {
+    if (frame_width != frame_width_ || frame_height != frame_height_) {
+      MP_RETURN_IF_ERROR(ResetLookahead(cc));
+    }
     MP_RETURN_IF_ERROR(
         UpdateForResolutionChange(cc, frame_width, frame_height));
   }
@@ -542,6 +586,8 @@ absl::Status ContentZoomingCalculator::Process(
   if (cc->Inputs().HasTag(kDetections)) {
     if (cc->Inputs().Tag(kDetections).IsEmpty()) {
       if (last_only_required_detection_ == 0) {
+        // Keeps the outputs in timestamp order.
+        MP_RETURN_IF_ERROR(OutputLookaheadFrames(cc, /*flush=*/true));
         // If no detections are available and we never had any,
         // simply return the full-image rectangle as crop-rect.
         if (cc->Outputs().HasTag(kCropRect)) {
@@ -616,15 +662,85 @@ absl::Status ContentZoomingCalculator::Process(
     offset_y = last_measured_y_offset_;
   }
 
+  // The first rect is recorded once this frame is output, but its timestamp
+  // is set now, such that the frames measured while this one is buffered for
+  // the lookahead already see the animation and first rect.
+  const bool records_first_rect = first_rect_timestamp_ == Timestamp::Unset();
+  if (records_first_rect) {
+    // Record the time to serve as departure point for the animation.
+    // If we are not allowed to start the animation, set Timestamp::Done.
+    first_rect_timestamp_ =
+        may_start_animation ? cc->InputTimestamp() : Timestamp::Done();
+  }
+
+  const MeasuredFrame measured_frame = {
+      cc->InputTimestamp(), frame_width, frame_height, records_first_rect,
+      offset_x,             offset_y,    height};
+  if (options_.lookahead_frames() == 0) {
+    return UpdatePathAndOutput(cc, measured_frame);
+  }
+  measured_frames_.push_back(measured_frame);
+  return OutputLookaheadFrames(cc, /*flush=*/false);
+}
+
+absl::Status ContentZoomingCalculator::OutputLookaheadFrames(
+    mediapipe::CalculatorContext* cc, bool flush) {
+  const int lookahead_frames = options_.lookahead_frames();
+  const auto num_buffered = [this]() {
+    return static_cast<int>(measured_frames_.size());
+  };
+  while (next_output_index_ < num_buffered() &&
+         (flush || num_buffered() - next_output_index_ > lookahead_frames)) {
+    // Average the crops measured within lookahead_frames of the frame to
+    // output. All buffered frames before it are within the window.
+    const int window_end =
+        std::min(num_buffered(), next_output_index_ + lookahead_frames + 1);
+    double sum_offset_x = 0, sum_offset_y = 0, sum_height = 0;
+    for (int i = 0; i < window_end; ++i) {
+      sum_offset_x += measured_frames_[i].offset_x;
+      sum_offset_y += measured_frames_[i].offset_y;
+      sum_height += measured_frames_[i].height;
+    }
+    MeasuredFrame frame = measured_frames_[next_output_index_];
+    frame.offset_x = std::round(sum_offset_x / window_end);
+    frame.offset_y = std::round(sum_offset_y / window_end);
+    frame.height = std::round(sum_height / window_end);
+    MP_RETURN_IF_ERROR(UpdatePathAndOutput(cc, frame));
+
+    ++next_output_index_;
+    if (next_output_index_ > lookahead_frames) {
+      measured_frames_.pop_front();
+      --next_output_index_;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ContentZoomingCalculator::ResetLookahead(
+    mediapipe::CalculatorContext* cc) {
+  MP_RETURN_IF_ERROR(OutputLookaheadFrames(cc, /*flush=*/true));
+  measured_frames_.clear();
+  next_output_index_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status ContentZoomingCalculator::UpdatePathAndOutput(
+    mediapipe::CalculatorContext* cc, const MeasuredFrame& frame) {
+  const Timestamp& timestamp = frame.timestamp;
+  const int offset_x = frame.offset_x;
+  const int offset_y = frame.offset_y;
+  const int height = frame.height;
+  bool is_animating = IsAnimatingToFirstRect(timestamp);
+
   // Check if the camera is changing in pan, tilt or zoom.  If the camera is in
   // motion disable temporal filtering.
   bool pan_state, tilt_state, zoom_state;
   MP_RETURN_IF_ERROR(path_solver_pan_->PredictMotionState(
-      offset_x, cc->InputTimestamp().Microseconds(), &pan_state));
+      offset_x, timestamp.Microseconds(), &pan_state));
   MP_RETURN_IF_ERROR(path_solver_tilt_->PredictMotionState(
-      offset_y, cc->InputTimestamp().Microseconds(), &tilt_state));
+      offset_y, timestamp.Microseconds(), &tilt_state));
   MP_RETURN_IF_ERROR(path_solver_zoom_->PredictMotionState(
-      height, cc->InputTimestamp().Microseconds(), &zoom_state));
+      height, timestamp.Microseconds(), &zoom_state));
   if (pan_state || tilt_state || zoom_state) {
     path_solver_pan_->ClearHistory();
     path_solver_tilt_->ClearHistory();
@@ -633,7 +749,7 @@ absl::Status ContentZoomingCalculator::Process(
 
   // Compute smoothed zoom camera path.
   MP_RETURN_IF_ERROR(path_solver_zoom_->AddObservation(
-      height, cc->InputTimestamp().Microseconds()));
+      height, timestamp.Microseconds()));
   int path_height;
   MP_RETURN_IF_ERROR(path_solver_zoom_->GetState(&path_height));
   int path_width = path_height * target_aspect_;
@@ -649,9 +765,9 @@ absl::Status ContentZoomingCalculator::Process(
 
   // Compute smoothed pan/tilt paths.
   MP_RETURN_IF_ERROR(path_solver_pan_->AddObservation(
-      offset_x, cc->InputTimestamp().Microseconds()));
+      offset_x, timestamp.Microseconds()));
   MP_RETURN_IF_ERROR(path_solver_tilt_->AddObservation(
-      offset_y, cc->InputTimestamp().Microseconds()));
+      offset_y, timestamp.Microseconds()));
   int path_offset_x;
   MP_RETURN_IF_ERROR(path_solver_pan_->GetState(&path_offset_x));
   int path_offset_y;
@@ -686,31 +802,27 @@ absl::Status ContentZoomingCalculator::Process(
                        features.get());
     cc->Outputs()
         .Tag(kDetectedBorders)
-        .AddPacket(Adopt(features.release()).At(cc->InputTimestamp()));
+        .AddPacket(Adopt(features.release()).At(timestamp));
   }
 
   // Record the first crop rectangle
-  if (first_rect_timestamp_ == Timestamp::Unset()) {
+  if (frame.records_first_rect) {
     first_rect_.set_x_center(path_offset_x / static_cast<float>(frame_width_));
     first_rect_.set_width(path_height * target_aspect_ /
                           static_cast<float>(frame_width_));
     first_rect_.set_y_center(path_offset_y / static_cast<float>(frame_height_));
     first_rect_.set_height(path_height / static_cast<float>(frame_height_));
 
-    // Record the time to serve as departure point for the animation.
-    // If we are not allowed to start the animation, set Timestamp::Done.
-    first_rect_timestamp_ =
-        may_start_animation ? cc->InputTimestamp() : Timestamp::Done();
     // After setting the first rectangle, check whether we should animate to it.
-    is_animating = IsAnimatingToFirstRect(cc->InputTimestamp());
+    is_animating = IsAnimatingToFirstRect(timestamp);
   }
 
   // Transmit downstream to glcroppingcalculator.
   if (cc->Outputs().HasTag(kCropRect)) {
     std::unique_ptr<mediapipe::Rect> gpu_rect;
     if (is_animating) {
-      auto rect =
-          GetAnimationRect(frame_width, frame_height, cc->InputTimestamp());
+      auto rect = GetAnimationRect(frame.frame_width, frame.frame_height,
+                                   timestamp);
       MP_RETURN_IF_ERROR(rect.status());
       gpu_rect = absl::make_unique<mediapipe::Rect>(*rect);
     } else {
@@ -720,15 +832,13 @@ absl::Status ContentZoomingCalculator::Process(
       gpu_rect->set_y_center(path_offset_y);
       gpu_rect->set_height(path_height);
     }
-    cc->Outputs().Tag(kCropRect).Add(gpu_rect.release(),
-                                     Timestamp(cc->InputTimestamp()));
+    cc->Outputs().Tag(kCropRect).Add(gpu_rect.release(), timestamp);
   }
 
   if (cc->Outputs().HasTag(kFirstCropRect)) {
     cc->Outputs()
         .Tag(kFirstCropRect)
-        .Add(new mediapipe::NormalizedRect(first_rect_),
-             Timestamp(cc->InputTimestamp()));
+        .Add(new mediapipe::NormalizedRect(first_rect_), timestamp);
   }
 
   return absl::OkStatus();
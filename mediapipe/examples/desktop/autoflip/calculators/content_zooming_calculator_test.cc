@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cmath>
 #include <memory>
+#include <vector>
 
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/content_zooming_calculator.pb.h"
@@ -967,6 +969,128 @@ TEST(ContentZoomingCalculatorTest, ProvidesConstantFirstRect) {
   }
 }
 
+TEST(ContentZoomingCalculatorTest, LookaheadOutputsEveryFrame) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfigD);
+  auto* options = config.mutable_options()->MutableExtension(
+      ContentZoomingCalculatorOptions::ext);
+  options->set_lookahead_frames(3);
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  for (int i = 0; i < 5; ++i) {
+    AddDetection(cv::Rect_<float>(.4, .5, .1, .1), i * 33333, runner.get());
+  }
+  MP_ASSERT_OK(runner->Run());
+  const auto& output_packets = runner->Outputs().Tag("CROP_RECT").packets;
+  ASSERT_EQ(output_packets.size(), 5);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(output_packets[i].Timestamp(), Timestamp(i * 33333));
+    CheckCropRect(450, 550, 111, 111, i, output_packets);
+  }
+}
+
+// The animation is decided when frames are measured, not when they are output
+// after the lookahead: detections received while animating are ignored, and
+// the animated frames match those without lookahead (see CanControlAnimation).
+TEST(ContentZoomingCalculatorTest, LookaheadAnimatesToFirstRect) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfigE);
+  auto* options = config.mutable_options()->MutableExtension(
+      ContentZoomingCalculatorOptions::ext);
+  options->set_start_zoomed_out(true);
+  options->set_us_to_first_rect(1000000);
+  options->set_us_to_first_rect_delay(500000);
+  options->set_lookahead_frames(2);
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  AddDetectionFrameSize(cv::Rect_<float>(.4, .4, .2, .2), 0, 1000, 1000,
+                        runner.get(), {.animated_zoom = true});
+  AddDetectionFrameSize(cv::Rect_<float>(.1, .1, .2, .2), 400000, 1000, 1000,
+                        runner.get(), {.animated_zoom = false});
+  AddDetectionFrameSize(cv::Rect_<float>(.1, .1, .2, .2), 800000, 1000, 1000,
+                        runner.get(), {.animated_zoom = false});
+  AddDetectionFrameSize(cv::Rect_<float>(.1, .1, .2, .2), 1000000, 1000, 1000,
+                        runner.get(), {.animated_zoom = false});
+  AddDetectionFrameSize(cv::Rect_<float>(.1, .1, .2, .2), 1500000, 1000, 1000,
+                        runner.get(), {.animated_zoom = false});
+  MP_ASSERT_OK(runner->Run());
+  const auto& output_packets = runner->Outputs().Tag("CROP_RECT").packets;
+  ASSERT_EQ(output_packets.size(), 5);
+  CheckCropRect(500, 500, 1000, 1000, 0, output_packets);
+  CheckCropRect(500, 500, 1000, 1000, 1, output_packets);
+  CheckCropRect(500, 500, 470, 470, 2, output_packets);
+  CheckCropRect(500, 500, 222, 222, 3, output_packets);
+  // After the animation, the crop follows the new detection.
+  EXPECT_LT(output_packets[4].Get<mediapipe::Rect>().x_center(), 500);
+}
+
+TEST(ContentZoomingCalculatorTest, ChecksLookaheadFrames) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfigD);
+  auto* options = config.mutable_options()->MutableExtension(
+      ContentZoomingCalculatorOptions::ext);
+  options->set_lookahead_frames(-1);
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  AddDetection(cv::Rect_<float>(.4, .5, .1, .1), 0, runner.get());
+  const auto status = runner->Run();
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.ToString(),
+              testing::HasSubstr("lookahead_frames must not be negative."));
+}
+
+// Reframes a subject moving horizontally at 30 fps, detected with a fixed
+// jitter, and returns the mean distance in pixels between the centers of the
+// crop rects and the subject.
+absl::Status MeanTrackingError(int lookahead_frames, int num_frames,
+                               double* mean_error) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfigD);
+  auto* options = config.mutable_options()->MutableExtension(
+      ContentZoomingCalculatorOptions::ext);
+  options->set_lookahead_frames(lookahead_frames);
+  options->mutable_kinematic_options_pan()->set_min_motion_to_reframe(0.0);
+  options->mutable_kinematic_options_pan()->set_max_velocity(1000);
+  options->mutable_kinematic_options_tilt()->set_min_motion_to_reframe(50.0);
+  options->mutable_kinematic_options_zoom()->set_min_motion_to_reframe(50.0);
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  cv::RNG rng(0);
+  std::vector<float> subject_x_centers;
+  for (int i = 0; i < num_frames; ++i) {
+    const float x_center = .2 + .5 * i / num_frames;
+    subject_x_centers.push_back(x_center * 1000);
+    const float jitter = rng.uniform(-.03f, .03f);
+    AddDetection(cv::Rect_<float>(x_center - .05 + jitter, .45, .1, .1),
+                 i * 33333, runner.get());
+  }
+  MP_RETURN_IF_ERROR(runner->Run());
+  const auto& output_packets = runner->Outputs().Tag("CROP_RECT").packets;
+  RET_CHECK_EQ(static_cast<int>(output_packets.size()), num_frames);
+  double sum_error = 0;
+  for (int i = 0; i < num_frames; ++i) {
+    const auto& rect = output_packets[i].Get<mediapipe::Rect>();
+    sum_error += std::abs(rect.x_center() - subject_x_centers[i]);
+  }
+  *mean_error = sum_error / num_frames;
+  return absl::OkStatus();
+}
+
+TEST(ContentZoomingCalculatorTest, LookaheadReducesTrackingError) {
+  double error, lookahead_error;
+  MP_ASSERT_OK(MeanTrackingError(/*lookahead_frames=*/0, 90, &error));
+  MP_ASSERT_OK(
+      MeanTrackingError(/*lookahead_frames=*/6, 90, &lookahead_error));
+  EXPECT_LT(lookahead_error, error);
+}
+
+// Measures reframing 300 frames of a moving subject with a lookahead window,
+// and reports the tracking error and the latency of the window.
+// Args: lookahead frames.
+void BM_ContentZoomingLookahead(benchmark::State& state) {
+  const int lookahead_frames = state.range(0);
+  double error = 0;
+  for (auto _ : state) {
+    MP_ASSERT_OK(MeanTrackingError(lookahead_frames, 300, &error));
+  }
+  state.SetItemsProcessed(state.iterations() * 300);
+  state.counters["mean_error_px"] = error;
+  state.counters["latency_ms"] = lookahead_frames * 33.333;
+}
+BENCHMARK(BM_ContentZoomingLookahead)->Arg(0)->Arg(6)->Arg(18);
+
 }  // namespace
 }  // namespace autoflip
 
@@ -0,0 +1,151 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+constexpr char kInputVideoFramesTag[] = "VIDEO_FRAMES";
+constexpr char kOutputCroppedFramesTag[] = "CROPPED_FRAMES";
+constexpr char kCropPathFilePathTag[] = "CROP_PATH_FILE_PATH";
+
+cv::Rect ToCvRect(const ExternalRenderFrame::Rect& rect) {
+  return cv::Rect(std::round(rect.x()), std::round(rect.y()),
+                  std::round(rect.width()), std::round(rect.height()));
+}
+}  // namespace
+
+// This calculator renders the cropped video from a CropPath file, written by
+// the CropPathWriterCalculator in the first pass of two-pass AutoFlip. Each
+// input frame is cropped to the "crop from" location of its CropPath frame,
+// scaled to the "render to" location and padded with the padding color, so
+// per frame cost and memory are constant and no frames are buffered.
+//
+// Input frames are matched to CropPath frames by timestamp. If there is no
+// CropPath frame with the same timestamp, the closest preceding one is used.
+//
+// Input:
+//   VIDEO_FRAMES: Original video frames (ImageFrame), at the resolution used
+//     in the first pass.
+// Input side packet:
+//   CROP_PATH_FILE_PATH: Path of the crop path file (std::string).
+// Output:
+//   CROPPED_FRAMES: Cropped frames at the target size of the CropPath.
+//
+// Example config:
+// node {
+//   calculator: "CropPathRenderingCalculator"
+//   input_stream: "VIDEO_FRAMES:video_raw"
+//   input_side_packet: "CROP_PATH_FILE_PATH:crop_path_file"
+//   output_stream: "CROPPED_FRAMES:cropped_frames"
+// }
+class CropPathRenderingCalculator : public CalculatorBase {
+ public:
+  CropPathRenderingCalculator() = default;
+  ~CropPathRenderingCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc);
+
+  absl::Status Open(CalculatorContext* cc) override;
+  absl::Status Process(CalculatorContext* cc) override;
+
+ private:
+  CropPath crop_path_;
+  // Index of the CropPath frame used for the last input frame.
+  int frame_index_ = 0;
+};
+REGISTER_CALCULATOR(CropPathRenderingCalculator);
+
+absl::Status CropPathRenderingCalculator::GetContract(CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputVideoFramesTag).Set<ImageFrame>();
+  cc->InputSidePackets().Tag(kCropPathFilePathTag).Set<std::string>();
+  cc->Outputs().Tag(kOutputCroppedFramesTag).Set<ImageFrame>();
+  return absl::OkStatus();
+}
+
+absl::Status CropPathRenderingCalculator::Open(CalculatorContext* cc) {
+  const auto& path =
+      cc->InputSidePackets().Tag(kCropPathFilePathTag).Get<std::string>();
+  std::string serialized;
+  MP_RETURN_IF_ERROR(file::GetContents(path, &serialized));
+  RET_CHECK(crop_path_.ParseFromString(serialized))
+      << "Could not parse crop path file " << path;
+  RET_CHECK_GT(crop_path_.frame_size(), 0) << "Crop path is empty.";
+  RET_CHECK_GT(crop_path_.target_width(), 0)
+      << "Target width is non-positive.";
+  RET_CHECK_GT(crop_path_.target_height(), 0)
+      << "Target height is non-positive.";
+  cc->SetOffset(TimestampDiff(0));
+  return absl::OkStatus();
+}
+
+absl::Status CropPathRenderingCalculator::Process(CalculatorContext* cc) {
+  const auto& input_frame =
+      cc->Inputs().Tag(kInputVideoFramesTag).Get<ImageFrame>();
+  const cv::Mat input_mat = formats::MatView(&input_frame);
+
+  // Input timestamps are increasing, advance to the last CropPath frame that
+  // is not after the input frame.
+  const uint64 timestamp_us = cc->InputTimestamp().Microseconds();
+  while (frame_index_ + 1 < crop_path_.frame_size() &&
+         crop_path_.frame(frame_index_ + 1).timestamp_us() <= timestamp_us) {
+    ++frame_index_;
+  }
+  const ExternalRenderFrame& frame = crop_path_.frame(frame_index_);
+
+  auto output_frame = absl::make_unique<ImageFrame>(
+      input_frame.Format(), crop_path_.target_width(),
+      crop_path_.target_height());
+  cv::Mat output_mat = formats::MatView(output_frame.get());
+  output_mat.setTo(cv::Scalar(frame.padding_color().r(),
+                              frame.padding_color().g(),
+                              frame.padding_color().b(), 255));
+
+  const cv::Rect crop_from = ToCvRect(frame.crop_from_location()) &
+                             cv::Rect(0, 0, input_mat.cols, input_mat.rows);
+  const cv::Rect render_to = ToCvRect(frame.render_to_location()) &
+                             cv::Rect(0, 0, output_mat.cols, output_mat.rows);
+  RET_CHECK(!crop_from.empty())
+      << "Crop from location is outside of the input frame.";
+  RET_CHECK(!render_to.empty())
+      << "Render to location is outside of the output frame.";
+
+  // Cubic is better quality for upscaling and area is good for downscaling.
+  const int interpolation_method =
+      render_to.area() > crop_from.area() ? cv::INTER_CUBIC : cv::INTER_AREA;
+  cv::Mat render_to_mat = output_mat(render_to);
+  cv::resize(input_mat(crop_from), render_to_mat, render_to.size(), 0, 0,
+             interpolation_method);
+
+  cc->Outputs()
+      .Tag(kOutputCroppedFramesTag)
+      .Add(output_frame.release(), cc->InputTimestamp());
+  return absl::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,132 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kConfig[] = R"(
+    calculator: "CropPathRenderingCalculator"
+    input_stream: "VIDEO_FRAMES:video_frames"
+    input_side_packet: "CROP_PATH_FILE_PATH:crop_path_file"
+    output_stream: "CROPPED_FRAMES:cropped_frames")";
+
+constexpr int kInputWidth = 40;
+constexpr int kInputHeight = 20;
+
+void SetRect(int x, int y, int width, int height,
+             ExternalRenderFrame::Rect* rect) {
+  rect->set_x(x);
+  rect->set_y(y);
+  rect->set_width(width);
+  rect->set_height(height);
+}
+
+// Writes a crop path with a 20x20 target, cropping the left half of the frame
+// at timestamp 0 and the right half, padded to 20x10 with blue, from
+// timestamp 2 on.
+std::string WriteCropPath(const std::string& name) {
+  CropPath crop_path;
+  crop_path.set_target_width(20);
+  crop_path.set_target_height(20);
+  auto* left = crop_path.add_frame();
+  left->set_timestamp_us(0);
+  SetRect(0, 0, 20, 20, left->mutable_crop_from_location());
+  SetRect(0, 0, 20, 20, left->mutable_render_to_location());
+  auto* right = crop_path.add_frame();
+  right->set_timestamp_us(2);
+  SetRect(20, 0, 20, 20, right->mutable_crop_from_location());
+  SetRect(0, 5, 20, 10, right->mutable_render_to_location());
+  right->mutable_padding_color()->set_b(255);
+
+  const std::string path = absl::StrCat(getenv("TEST_TMPDIR"), "/", name);
+  MP_EXPECT_OK(file::SetContents(path, crop_path.SerializeAsString()));
+  return path;
+}
+
+// Returns a frame with a red left half and a green right half.
+std::unique_ptr<ImageFrame> GetInputFrame() {
+  auto frame = absl::make_unique<ImageFrame>(ImageFormat::SRGB, kInputWidth,
+                                             kInputHeight);
+  cv::Mat mat = formats::MatView(frame.get());
+  mat(cv::Rect(0, 0, kInputWidth / 2, kInputHeight))
+      .setTo(cv::Scalar(255, 0, 0));
+  mat(cv::Rect(kInputWidth / 2, 0, kInputWidth / 2, kInputHeight))
+      .setTo(cv::Scalar(0, 255, 0));
+  return frame;
+}
+
+TEST(CropPathRenderingCalculatorTest, RendersCropPath) {
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  runner.MutableSidePackets()->Tag("CROP_PATH_FILE_PATH") =
+      MakePacket<std::string>(WriteCropPath("renders_crop_path"));
+  for (int t = 0; t < 4; ++t) {
+    runner.MutableInputs()
+        ->Tag("VIDEO_FRAMES")
+        .packets.push_back(Adopt(GetInputFrame().release()).At(Timestamp(t)));
+  }
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& outputs = runner.Outputs().Tag("CROPPED_FRAMES").packets;
+  ASSERT_EQ(4, outputs.size());
+  for (int t = 0; t < 4; ++t) {
+    const auto& frame = outputs[t].Get<ImageFrame>();
+    EXPECT_EQ(Timestamp(t), outputs[t].Timestamp());
+    ASSERT_EQ(20, frame.Width());
+    ASSERT_EQ(20, frame.Height());
+    const cv::Mat mat = formats::MatView(&frame);
+    if (t < 2) {
+      // Timestamp 1 has no crop path frame and uses the one of timestamp 0.
+      EXPECT_EQ(cv::Vec3b(255, 0, 0), mat.at<cv::Vec3b>(0, 0));
+      EXPECT_EQ(cv::Vec3b(255, 0, 0), mat.at<cv::Vec3b>(10, 10));
+    } else {
+      EXPECT_EQ(cv::Vec3b(0, 0, 255), mat.at<cv::Vec3b>(0, 0));
+      EXPECT_EQ(cv::Vec3b(0, 255, 0), mat.at<cv::Vec3b>(10, 10));
+      EXPECT_EQ(cv::Vec3b(0, 0, 255), mat.at<cv::Vec3b>(19, 10));
+    }
+  }
+}
+
+TEST(CropPathRenderingCalculatorTest, FailsOnMissingFile) {
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  runner.MutableSidePackets()->Tag("CROP_PATH_FILE_PATH") =
+      MakePacket<std::string>(
+          absl::StrCat(getenv("TEST_TMPDIR"), "/does_not_exist"));
+  runner.MutableInputs()
+      ->Tag("VIDEO_FRAMES")
+      .packets.push_back(Adopt(GetInputFrame().release()).At(Timestamp(0)));
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
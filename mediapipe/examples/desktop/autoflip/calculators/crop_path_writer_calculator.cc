@@ -0,0 +1,97 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+constexpr char kExternalRenderingPerFrameTag[] = "EXTERNAL_RENDERING_PER_FRAME";
+constexpr char kOutputFilePathTag[] = "OUTPUT_FILE_PATH";
+}  // namespace
+
+// This calculator collects the per frame crop decisions of a
+// SceneCroppingCalculator into a CropPath and writes it (binary serialized) to
+// a file when the graph closes. This is the first pass of two-pass AutoFlip:
+// the SceneCroppingCalculator is run with VIDEO_SIZE instead of VIDEO_FRAMES,
+// so no frames are buffered, and the cropped video is rendered from the file
+// in a second pass by the CropPathRenderingCalculator. Running multiple
+// SceneCroppingCalculators (one per target aspect ratio) in the first pass
+// shares the signal extraction between all of them.
+//
+// Input:
+//   EXTERNAL_RENDERING_PER_FRAME: ExternalRenderFrame for each video frame.
+// Input side packet:
+//   OUTPUT_FILE_PATH: Path of the crop path file (std::string).
+//
+// Example config:
+// node {
+//   calculator: "CropPathWriterCalculator"
+//   input_stream: "EXTERNAL_RENDERING_PER_FRAME:external_rendering_per_frame"
+//   input_side_packet: "OUTPUT_FILE_PATH:crop_path_file"
+// }
+class CropPathWriterCalculator : public CalculatorBase {
+ public:
+  CropPathWriterCalculator() = default;
+  ~CropPathWriterCalculator() override = default;
+
+  static absl::Status GetContract(CalculatorContract* cc);
+
+  absl::Status Process(CalculatorContext* cc) override;
+  absl::Status Close(CalculatorContext* cc) override;
+
+ private:
+  CropPath crop_path_;
+};
+REGISTER_CALCULATOR(CropPathWriterCalculator);
+
+absl::Status CropPathWriterCalculator::GetContract(CalculatorContract* cc) {
+  cc->Inputs().Tag(kExternalRenderingPerFrameTag).Set<ExternalRenderFrame>();
+  cc->InputSidePackets().Tag(kOutputFilePathTag).Set<std::string>();
+  return absl::OkStatus();
+}
+
+absl::Status CropPathWriterCalculator::Process(CalculatorContext* cc) {
+  const auto& frame = cc->Inputs()
+                          .Tag(kExternalRenderingPerFrameTag)
+                          .Get<ExternalRenderFrame>();
+  if (crop_path_.frame_size() == 0) {
+    crop_path_.set_target_width(frame.target_width());
+    crop_path_.set_target_height(frame.target_height());
+  }
+  RET_CHECK_EQ(frame.target_width(), crop_path_.target_width())
+      << "Target width changed within the video.";
+  RET_CHECK_EQ(frame.target_height(), crop_path_.target_height())
+      << "Target height changed within the video.";
+  *crop_path_.add_frame() = frame;
+  return absl::OkStatus();
+}
+
+absl::Status CropPathWriterCalculator::Close(CalculatorContext* cc) {
+  const auto& path =
+      cc->InputSidePackets().Tag(kOutputFilePathTag).Get<std::string>();
+  std::string serialized;
+  RET_CHECK(crop_path_.SerializeToString(&serialized))
+      << "Could not serialize crop path.";
+  return file::SetContents(path, serialized);
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
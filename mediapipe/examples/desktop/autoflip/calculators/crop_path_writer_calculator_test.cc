@@ -0,0 +1,90 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kConfig[] = R"(
+    calculator: "CropPathWriterCalculator"
+    input_stream: "EXTERNAL_RENDERING_PER_FRAME:external_rendering"
+    input_side_packet: "OUTPUT_FILE_PATH:crop_path_file")";
+
+ExternalRenderFrame GetFrame(int64 timestamp_us, int target_width) {
+  ExternalRenderFrame frame;
+  frame.set_timestamp_us(timestamp_us);
+  frame.set_target_width(target_width);
+  frame.set_target_height(100);
+  frame.mutable_crop_from_location()->set_x(timestamp_us);
+  return frame;
+}
+
+TEST(CropPathWriterCalculatorTest, WritesCropPath) {
+  const std::string path =
+      absl::StrCat(getenv("TEST_TMPDIR"), "/writes_crop_path");
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  runner.MutableSidePackets()->Tag("OUTPUT_FILE_PATH") =
+      MakePacket<std::string>(path);
+  for (int64 t = 0; t < 3; ++t) {
+    runner.MutableInputs()
+        ->Tag("EXTERNAL_RENDERING_PER_FRAME")
+        .packets.push_back(
+            MakePacket<ExternalRenderFrame>(GetFrame(t, 50)).At(Timestamp(t)));
+  }
+  MP_ASSERT_OK(runner.Run());
+
+  std::string serialized;
+  MP_ASSERT_OK(file::GetContents(path, &serialized));
+  CropPath crop_path;
+  ASSERT_TRUE(crop_path.ParseFromString(serialized));
+  EXPECT_EQ(50, crop_path.target_width());
+  EXPECT_EQ(100, crop_path.target_height());
+  ASSERT_EQ(3, crop_path.frame_size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(i, crop_path.frame(i).timestamp_us());
+    EXPECT_EQ(i, crop_path.frame(i).crop_from_location().x());
+  }
+}
+
+TEST(CropPathWriterCalculatorTest, FailsOnChangingTargetSize) {
+  const std::string path =
+      absl::StrCat(getenv("TEST_TMPDIR"), "/fails_on_changing_target_size");
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  runner.MutableSidePackets()->Tag("OUTPUT_FILE_PATH") =
+      MakePacket<std::string>(path);
+  auto& packets =
+      runner.MutableInputs()->Tag("EXTERNAL_RENDERING_PER_FRAME").packets;
+  packets.push_back(
+      MakePacket<ExternalRenderFrame>(GetFrame(0, 50)).At(Timestamp(0)));
+  packets.push_back(
+      MakePacket<ExternalRenderFrame>(GetFrame(1, 60)).At(Timestamp(1)));
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -14,6 +14,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/face_to_region_calculator.pb.h"
@@ -161,6 +162,9 @@ absl::Status FaceToRegionCalculator::Process(mediapipe::CalculatorContext* cc) {
   }
 
   auto region_set = ::absl::make_unique<DetectionSet>();
+  // Indices of the regions in region_set to be scored with image cues, which
+  // are scored together once all faces are converted.
+  std::vector<int> scored_region_indices;
   if (!cc->Inputs().Tag("FACES").Value().IsEmpty()) {
     const auto& input_faces =
         cc->Inputs().Tag("FACES").Get<std::vector<mediapipe::Detection>>();
@@ -196,12 +200,10 @@ absl::Status FaceToRegionCalculator::Process(mediapipe::CalculatorContext* cc) {
         region->mutable_signal_type()->set_standard(SignalType::FACE_FULL);
 
         // Score the face based on image cues.
-        float visual_score = 1.0f;
+        region->set_score(1.0f);
         if (options_.use_visual_scorer()) {
-          MP_RETURN_IF_ERROR(
-              scorer_->CalculateScore(frame, *region, &visual_score));
+          scored_region_indices.push_back(region_set->detections_size() - 1);
         }
-        region->set_score(visual_score);
       }
 
       // Generate two more output regions from important face landmarks. One
@@ -252,30 +254,42 @@ absl::Status FaceToRegionCalculator::Process(mediapipe::CalculatorContext* cc) {
       // Generate scores for the landmark bboxes and export them.
       if (options_.export_bbox_from_landmarks() &&
           core_landmark_region.has_location_normalized()) {  // Not empty.
-        float visual_score = 1.0f;
-        if (options_.use_visual_scorer()) {
-          MP_RETURN_IF_ERROR(scorer_->CalculateScore(
-              frame, core_landmark_region, &visual_score));
-        }
-        core_landmark_region.set_score(visual_score);
+        core_landmark_region.set_score(1.0f);
         core_landmark_region.mutable_signal_type()->set_standard(
             SignalType::FACE_CORE_LANDMARKS);
         *region_set->add_detections() = core_landmark_region;
+        if (options_.use_visual_scorer()) {
+          scored_region_indices.push_back(region_set->detections_size() - 1);
+        }
       }
       if (options_.export_bbox_from_landmarks() &&
           all_landmark_region.has_location_normalized()) {  // Not empty.
-        float visual_score = 1.0f;
-        if (options_.use_visual_scorer()) {
-          MP_RETURN_IF_ERROR(scorer_->CalculateScore(frame, all_landmark_region,
-                                                     &visual_score));
-        }
-        all_landmark_region.set_score(visual_score);
+        all_landmark_region.set_score(1.0f);
         all_landmark_region.mutable_signal_type()->set_standard(
             SignalType::FACE_ALL_LANDMARKS);
         *region_set->add_detections() = all_landmark_region;
+        if (options_.use_visual_scorer()) {
+          scored_region_indices.push_back(region_set->detections_size() - 1);
+        }
       }
     }
   }
+
+  // Score the regions based on image cues. Scoring all regions of the frame
+  // at once shares the per-pixel work between overlapping regions.
+  if (!scored_region_indices.empty()) {
+    std::vector<const SalientRegion*> scored_regions;
+    for (const int index : scored_region_indices) {
+      scored_regions.push_back(&region_set->detections(index));
+    }
+    std::vector<float> visual_scores;
+    MP_RETURN_IF_ERROR(
+        scorer_->CalculateScores(frame, scored_regions, &visual_scores));
+    for (int i = 0; i < scored_region_indices.size(); ++i) {
+      region_set->mutable_detections(scored_region_indices[i])
+          ->set_score(visual_scores[i]);
+    }
+  }
   cc->Outputs().Tag("REGIONS").Add(region_set.release(), cc->InputTimestamp());
 
   return absl::OkStatus();
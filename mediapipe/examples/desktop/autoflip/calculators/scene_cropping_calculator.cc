@@ -43,7 +43,8 @@ constexpr char kInputStaticFeatures[] = "STATIC_FEATURES";
 constexpr char kInputShotBoundaries[] = "SHOT_BOUNDARIES";
 constexpr char kInputExternalSettings[] = "EXTERNAL_SETTINGS";
 // This side packet must be used in conjunction with
-// TargetSizeType::MAXIMIZE_TARGET_DIMENSION
+// TargetSizeType::MAXIMIZE_TARGET_DIMENSION. There is one side packet per
+// target aspect ratio.
 constexpr char kAspectRatio[] = "EXTERNAL_ASPECT_RATIO";
 
 // Output the cropped frames, as well as visualization of crop regions and focus
@@ -73,8 +74,9 @@ absl::Status SceneCroppingCalculator::GetContract(
   if (cc->InputSidePackets().HasTag(kInputExternalSettings)) {
     cc->InputSidePackets().Tag(kInputExternalSettings).Set<std::string>();
   }
-  if (cc->InputSidePackets().HasTag(kAspectRatio)) {
-    cc->InputSidePackets().Tag(kAspectRatio).Set<std::string>();
+  const int num_aspect_ratios = cc->InputSidePackets().NumEntries(kAspectRatio);
+  for (int i = 0; i < num_aspect_ratios; ++i) {
+    cc->InputSidePackets().Get(kAspectRatio, i).Set<std::string>();
   }
   if (cc->Inputs().HasTag(kInputVideoFrames)) {
     cc->Inputs().Tag(kInputVideoFrames).Set<ImageFrame>();
@@ -93,8 +95,17 @@ absl::Status SceneCroppingCalculator::GetContract(
     cc->Inputs().Tag(kInputShotBoundaries).Set<bool>();
   }
 
-  if (cc->Outputs().HasTag(kOutputCroppedFrames)) {
-    cc->Outputs().Tag(kOutputCroppedFrames).Set<ImageFrame>();
+  // Per target outputs must have one stream per target aspect ratio.
+  const int num_targets = std::max(1, num_aspect_ratios);
+  for (const char* tag : {kOutputCroppedFrames, kExternalRenderingPerFrame,
+                          kExternalRenderingFullVid}) {
+    RET_CHECK(!cc->Outputs().HasTag(tag) ||
+              cc->Outputs().NumEntries(tag) == num_targets)
+        << tag << " must have one output stream per target aspect ratio ("
+        << num_targets << ").";
+  }
+  for (int i = 0; i < cc->Outputs().NumEntries(kOutputCroppedFrames); ++i) {
+    cc->Outputs().Get(kOutputCroppedFrames, i).Set<ImageFrame>();
   }
   if (cc->Outputs().HasTag(kOutputKeyFrameCropViz)) {
     RET_CHECK(cc->Outputs().HasTag(kOutputCroppedFrames))
@@ -117,12 +128,14 @@ absl::Status SceneCroppingCalculator::GetContract(
   if (cc->Outputs().HasTag(kOutputSummary)) {
     cc->Outputs().Tag(kOutputSummary).Set<VideoCroppingSummary>();
   }
-  if (cc->Outputs().HasTag(kExternalRenderingPerFrame)) {
-    cc->Outputs().Tag(kExternalRenderingPerFrame).Set<ExternalRenderFrame>();
+  for (int i = 0; i < cc->Outputs().NumEntries(kExternalRenderingPerFrame);
+       ++i) {
+    cc->Outputs().Get(kExternalRenderingPerFrame, i).Set<ExternalRenderFrame>();
   }
-  if (cc->Outputs().HasTag(kExternalRenderingFullVid)) {
+  for (int i = 0; i < cc->Outputs().NumEntries(kExternalRenderingFullVid);
+       ++i) {
     cc->Outputs()
-        .Tag(kExternalRenderingFullVid)
+        .Get(kExternalRenderingFullVid, i)
         .Set<std::vector<ExternalRenderFrame>>();
   }
   RET_CHECK(cc->Inputs().HasTag(kInputVideoFrames) ^
@@ -145,6 +158,8 @@ absl::Status SceneCroppingCalculator::Open(CalculatorContext* cc) {
       << "Maximum scene size is non-positive.";
   RET_CHECK_GE(options_.prior_frame_buffer_size(), 0)
       << "Prior frame buffer size is negative.";
+  RET_CHECK_GE(options_.num_cropping_threads(), 0)
+      << "Number of cropping threads is negative.";
 
   RET_CHECK(options_.solid_background_frames_padding_fraction() >= 0.0 &&
             options_.solid_background_frames_padding_fraction() <= 1.0)
@@ -158,6 +173,9 @@ absl::Status SceneCroppingCalculator::Open(CalculatorContext* cc) {
   overlay_opacity_ = padding_params.overlay_opacity();
   RET_CHECK(overlay_opacity_ >= 0.0 && overlay_opacity_ <= 1.0)
       << "Overlay opacity " << overlay_opacity_ << " is not in [0, 1].";
+  background_downscale_factor_ = padding_params.background_downscale_factor();
+  RET_CHECK_GT(background_downscale_factor_, 0)
+      << "Background downscale factor is non-positive.";
 
   // Set default camera model to polynomial_path_solver.
   if (!options_.camera_motion_options().has_kinematic_options()) {
@@ -168,13 +186,35 @@ absl::Status SceneCroppingCalculator::Open(CalculatorContext* cc) {
   if (cc->Outputs().HasTag(kOutputSummary)) {
     summary_ = absl::make_unique<VideoCroppingSummary>();
   }
-  if (cc->Outputs().HasTag(kExternalRenderingFullVid)) {
-    external_render_list_ =
-        absl::make_unique<std::vector<ExternalRenderFrame>>();
+  targets_.resize(std::max(1, cc->InputSidePackets().NumEntries(kAspectRatio)));
+  RET_CHECK(targets_.size() == 1 ||
+            options_.target_size_type() ==
+                SceneCroppingCalculatorOptions::MAXIMIZE_TARGET_DIMENSION)
+      << "Multiple target aspect ratios require MAXIMIZE_TARGET_DIMENSION.";
+  for (auto& target : targets_) {
+    target.scene_camera_motion_analyzer =
+        absl::make_unique<SceneCameraMotionAnalyzer>(
+            options_.scene_camera_motion_analyzer_options());
+    if (cc->Outputs().HasTag(kExternalRenderingFullVid)) {
+      target.external_render_list =
+          absl::make_unique<std::vector<ExternalRenderFrame>>();
+    }
   }
   should_perform_frame_cropping_ = cc->Outputs().HasTag(kOutputCroppedFrames);
-  scene_camera_motion_analyzer_ = absl::make_unique<SceneCameraMotionAnalyzer>(
-      options_.scene_camera_motion_analyzer_options());
+  const auto& buffer_options = options_.frame_buffer_options();
+  scene_frame_buffer_options_.max_frames_in_memory =
+      buffer_options.max_frames_in_memory();
+  scene_frame_buffer_options_.scratch_directory =
+      buffer_options.scratch_directory();
+  scene_frame_buffer_options_.compress_spilled_frames =
+      buffer_options.compress_spilled_frames();
+  scene_frame_buffer_ =
+      absl::make_unique<SceneFrameBuffer>(scene_frame_buffer_options_);
+  if (should_perform_frame_cropping_ && options_.num_cropping_threads() > 0) {
+    cropping_thread_pool_ = absl::make_unique<ThreadPool>(
+        "SceneCropping", options_.num_cropping_threads());
+    cropping_thread_pool_->StartWorkers();
+  }
   return absl::OkStatus();
 }
 
@@ -201,6 +241,7 @@ absl::Status ParseAspectRatioString(const std::string& aspect_ratio_string,
 void ConstructExternalRenderMessage(
     const cv::Rect& crop_from_location, const cv::Rect& render_to_location,
     const cv::Scalar& padding_color, const uint64 timestamp_us,
+    const int target_width, const int target_height,
     ExternalRenderFrame* external_render_message) {
   auto crop_from_message =
       external_render_message->mutable_crop_from_location();
@@ -219,6 +260,8 @@ void ConstructExternalRenderMessage(
   padding_color_message->set_g(padding_color[1]);
   padding_color_message->set_b(padding_color[2]);
   external_render_message->set_timestamp_us(timestamp_us);
+  external_render_message->set_target_width(target_width);
+  external_render_message->set_target_height(target_height);
 }
 
 double GetRatio(int width, int height) {
@@ -254,22 +297,48 @@ absl::Status SceneCroppingCalculator::InitializeSceneCroppingCalculator(
   RET_CHECK_GT(frame_height_, 0) << "Input frame height is non-positive.";
   RET_CHECK_GT(frame_width_, 0) << "Input frame width is non-positive.";
 
+  for (int i = 0; i < targets_.size(); ++i) {
+    MP_RETURN_IF_ERROR(ComputeTargetSize(i, cc, &targets_[i]));
+    targets_[i].scene_cropper = absl::make_unique<SceneCropper>(
+        options_.camera_motion_options(), frame_width_, frame_height_);
+  }
+
+  // Set keyframe width/height for feature upscaling.
+  RET_CHECK(!(cc->Inputs().HasTag(kInputKeyFrames) &&
+              (options_.has_video_features_width() ||
+               options_.has_video_features_height())))
+      << "Key frame size must be defined by either providing the input stream "
+         "KEY_FRAMES or setting video_features_width/video_features_height as "
+         "calculator options.  Both methods cannot be used together.";
+  if (options_.has_video_features_width() &&
+      options_.has_video_features_height()) {
+    key_frame_width_ = options_.video_features_width();
+    key_frame_height_ = options_.video_features_height();
+  } else if (!cc->Inputs().HasTag(kInputKeyFrames)) {
+    key_frame_width_ = frame_width_;
+    key_frame_height_ = frame_height_;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SceneCroppingCalculator::ComputeTargetSize(
+    int index, mediapipe::CalculatorContext* cc, Target* target) {
   // Calculate target width and height.
   switch (options_.target_size_type()) {
     case SceneCroppingCalculatorOptions::KEEP_ORIGINAL_HEIGHT:
       RET_CHECK(options_.has_target_width() && options_.has_target_height())
           << "Target width and height have to be specified.";
-      target_height_ = RoundToEven(frame_height_);
-      target_width_ =
-          RoundToEven(target_height_ * GetRatio(options_.target_width(),
+      target->height = RoundToEven(frame_height_);
+      target->width =
+          RoundToEven(target->height * GetRatio(options_.target_width(),
                                                 options_.target_height()));
       break;
     case SceneCroppingCalculatorOptions::KEEP_ORIGINAL_WIDTH:
       RET_CHECK(options_.has_target_width() && options_.has_target_height())
           << "Target width and height have to be specified.";
-      target_width_ = RoundToEven(frame_width_);
-      target_height_ =
-          RoundToEven(target_width_ / GetRatio(options_.target_width(),
+      target->width = RoundToEven(frame_width_);
+      target->height =
+          RoundToEven(target->width / GetRatio(options_.target_width(),
                                                options_.target_height()));
       break;
     case SceneCroppingCalculatorOptions::MAXIMIZE_TARGET_DIMENSION: {
@@ -278,64 +347,45 @@ absl::Status SceneCroppingCalculator::InitializeSceneCroppingCalculator(
              "external_aspect_ratio";
       double requested_aspect_ratio;
       MP_RETURN_IF_ERROR(ParseAspectRatioString(
-          cc->InputSidePackets().Tag(kAspectRatio).Get<std::string>(),
+          cc->InputSidePackets().Get(kAspectRatio, index).Get<std::string>(),
           &requested_aspect_ratio));
       const double original_aspect_ratio =
           GetRatio(frame_width_, frame_height_);
       if (original_aspect_ratio > requested_aspect_ratio) {
-        target_height_ = RoundToEven(frame_height_);
-        target_width_ = RoundToEven(target_height_ * requested_aspect_ratio);
+        target->height = RoundToEven(frame_height_);
+        target->width = RoundToEven(target->height * requested_aspect_ratio);
       } else {
-        target_width_ = RoundToEven(frame_width_);
-        target_height_ = RoundToEven(target_width_ / requested_aspect_ratio);
+        target->width = RoundToEven(frame_width_);
+        target->height = RoundToEven(target->width / requested_aspect_ratio);
       }
       break;
     }
     case SceneCroppingCalculatorOptions::USE_TARGET_DIMENSION:
       RET_CHECK(options_.has_target_width() && options_.has_target_height())
           << "Target width and height have to be specified.";
-      target_width_ = options_.target_width();
-      target_height_ = options_.target_height();
+      target->width = options_.target_width();
+      target->height = options_.target_height();
       break;
     case SceneCroppingCalculatorOptions::KEEP_ORIGINAL_DIMENSION:
-      target_width_ = frame_width_;
-      target_height_ = frame_height_;
+      target->width = frame_width_;
+      target->height = frame_height_;
       break;
     case SceneCroppingCalculatorOptions::UNKNOWN:
       return absl::InvalidArgumentError("target_size_type not set properly.");
   }
-  target_aspect_ratio_ = GetRatio(target_width_, target_height_);
+  target->aspect_ratio = GetRatio(target->width, target->height);
 
-  // Set keyframe width/height for feature upscaling.
-  RET_CHECK(!(cc->Inputs().HasTag(kInputKeyFrames) &&
-              (options_.has_video_features_width() ||
-               options_.has_video_features_height())))
-      << "Key frame size must be defined by either providing the input stream "
-         "KEY_FRAMES or setting video_features_width/video_features_height as "
-         "calculator options.  Both methods cannot be used together.";
-  if (options_.has_video_features_width() &&
-      options_.has_video_features_height()) {
-    key_frame_width_ = options_.video_features_width();
-    key_frame_height_ = options_.video_features_height();
-  } else if (!cc->Inputs().HasTag(kInputKeyFrames)) {
-    key_frame_width_ = frame_width_;
-    key_frame_height_ = frame_height_;
-  }
   // Check provided dimensions.
-  RET_CHECK_GT(target_width_, 0) << "Target width is non-positive.";
+  RET_CHECK_GT(target->width, 0) << "Target width is non-positive.";
   // TODO: it seems this check is too strict and maybe limiting,
   // considering the receiver of frames can be something other than encoder.
-  RET_CHECK_NE(target_width_ % 2, 1)
+  RET_CHECK_NE(target->width % 2, 1)
       << "Target width cannot be odd, because encoder expects dimension "
          "values to be even.";
-  RET_CHECK_GT(target_height_, 0) << "Target height is non-positive.";
-  RET_CHECK_NE(target_height_ % 2, 1)
+  RET_CHECK_GT(target->height, 0) << "Target height is non-positive.";
+  RET_CHECK_NE(target->height % 2, 1)
       << "Target height cannot be odd, because encoder expects dimension "
          "values to be even.";
-
-  scene_cropper_ = absl::make_unique<SceneCropper>(
-      options_.camera_motion_options(), frame_width_, frame_height_);
-
   return absl::OkStatus();
 }
 
@@ -354,6 +404,12 @@ absl::Status SceneCroppingCalculator::Process(
     MP_RETURN_IF_ERROR(InitializeSceneCroppingCalculator(cc));
   }
 
+  // Outputs scenes cropped on worker threads in the meantime.
+  if (cropping_thread_pool_) {
+    MP_RETURN_IF_ERROR(
+        OutputCroppedScenes(options_.num_cropping_threads(), cc));
+  }
+
   // Sets key frame dimension on first keyframe.
   if (cc->Inputs().HasTag(kInputKeyFrames) &&
       !cc->Inputs().Tag(kInputKeyFrames).Value().IsEmpty() &&
@@ -380,10 +436,7 @@ absl::Status SceneCroppingCalculator::Process(
     // Only buffer frames if |should_perform_frame_cropping_| is true.
     if (should_perform_frame_cropping_) {
       const auto& frame = cc->Inputs().Tag(kInputVideoFrames).Get<ImageFrame>();
-      const cv::Mat frame_mat = formats::MatView(&frame);
-      cv::Mat copy_mat;
-      frame_mat.copyTo(copy_mat);
-      scene_frames_or_empty_.push_back(copy_mat);
+      MP_RETURN_IF_ERROR(scene_frame_buffer_->Add(formats::MatView(&frame)));
     }
     scene_frame_timestamps_.push_back(cc->InputTimestamp().Value());
     is_key_frames_.push_back(
@@ -423,23 +476,25 @@ absl::Status SceneCroppingCalculator::Close(mediapipe::CalculatorContext* cc) {
   if (!scene_frame_timestamps_.empty()) {
     MP_RETURN_IF_ERROR(ProcessScene(/* is_end_of_scene = */ true, cc));
   }
+  MP_RETURN_IF_ERROR(OutputCroppedScenes(/* max_pending_scenes = */ 0, cc));
   if (cc->Outputs().HasTag(kOutputSummary)) {
     cc->Outputs()
         .Tag(kOutputSummary)
         .Add(summary_.release(), Timestamp::PostStream());
   }
   if (cc->Outputs().HasTag(kExternalRenderingFullVid)) {
-    cc->Outputs()
-        .Tag(kExternalRenderingFullVid)
-        .Add(external_render_list_.release(), Timestamp::PostStream());
+    for (int i = 0; i < targets_.size(); ++i) {
+      cc->Outputs()
+          .Get(kExternalRenderingFullVid, i)
+          .Add(targets_[i].external_render_list.release(),
+               Timestamp::PostStream());
+    }
   }
   return absl::OkStatus();
 }
 
-// TODO: split this function into two, one for calculating the border
-// sizes, the other for the actual removal of borders from the frames.
 absl::Status SceneCroppingCalculator::RemoveStaticBorders(
-    CalculatorContext* cc, int* top_border_size, int* bottom_border_size) {
+    int* top_border_size, int* bottom_border_size) {
   *top_border_size = 0;
   *bottom_border_size = 0;
   MP_RETURN_IF_ERROR(ComputeSceneStaticBordersSize(
@@ -450,24 +505,9 @@ absl::Status SceneCroppingCalculator::RemoveStaticBorders(
   effective_frame_height_ =
       frame_height_ - top_border_distance_ - bottom_border_distance;
 
-  // Store shallow copy of the original frames for debug display if required
-  // before static areas are removed.
-  if (cc->Outputs().HasTag(kOutputFramingAndDetections)) {
-    raw_scene_frames_or_empty_ = {scene_frames_or_empty_.begin(),
-                                  scene_frames_or_empty_.end()};
-  }
-
   if (top_border_distance_ > 0 || bottom_border_distance > 0) {
     VLOG(1) << "Remove top border " << top_border_distance_ << " bottom border "
             << bottom_border_distance;
-    // Remove borders from frames.
-    cv::Rect roi(0, top_border_distance_, frame_width_,
-                 effective_frame_height_);
-    for (int i = 0; i < scene_frames_or_empty_.size(); ++i) {
-      cv::Mat tmp;
-      scene_frames_or_empty_[i](roi).copyTo(tmp);
-      scene_frames_or_empty_[i] = tmp;
-    }
     // Adjust detection bounding boxes.
     for (int i = 0; i < key_frame_infos_.size(); ++i) {
       DetectionSet adjusted_detections;
@@ -493,15 +533,38 @@ absl::Status SceneCroppingCalculator::RemoveStaticBorders(
   return absl::OkStatus();
 }
 
-absl::Status SceneCroppingCalculator::InitializeFrameCropRegionComputer() {
-  key_frame_crop_options_ = options_.key_frame_crop_options();
-  MP_RETURN_IF_ERROR(
-      SetKeyFrameCropTarget(frame_width_, effective_frame_height_,
-                            target_aspect_ratio_, &key_frame_crop_options_));
-  VLOG(1) << "Target width " << key_frame_crop_options_.target_width();
-  VLOG(1) << "Target height " << key_frame_crop_options_.target_height();
-  frame_crop_region_computer_ =
-      absl::make_unique<FrameCropRegionComputer>(key_frame_crop_options_);
+absl::Status SceneCroppingCalculator::GetSceneFrame(int index,
+                                                    bool remove_borders,
+                                                    cv::Mat* frame) {
+  MP_RETURN_IF_ERROR(scene_frame_buffer_->Get(index, frame));
+  if (remove_borders && effective_frame_height_ != frame_height_) {
+    *frame = (*frame)(cv::Rect(0, top_border_distance_, frame_width_,
+                               effective_frame_height_));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SceneCroppingCalculator::GetSceneFrames(
+    bool remove_borders, std::vector<cv::Mat>* frames) {
+  frames->resize(scene_frame_buffer_->size());
+  for (int i = 0; i < frames->size(); ++i) {
+    MP_RETURN_IF_ERROR(GetSceneFrame(i, remove_borders, &(*frames)[i]));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SceneCroppingCalculator::InitializeFrameCropRegionComputer(
+    Target* target) {
+  target->key_frame_crop_options = options_.key_frame_crop_options();
+  MP_RETURN_IF_ERROR(SetKeyFrameCropTarget(
+      frame_width_, effective_frame_height_, target->aspect_ratio,
+      &target->key_frame_crop_options));
+  VLOG(1) << "Target width " << target->key_frame_crop_options.target_width();
+  VLOG(1) << "Target height "
+          << target->key_frame_crop_options.target_height();
+  target->frame_crop_region_computer =
+      absl::make_unique<FrameCropRegionComputer>(
+          target->key_frame_crop_options);
   return absl::OkStatus();
 }
 
@@ -535,7 +598,7 @@ absl::Status SceneCroppingCalculator::ProcessScene(const bool is_end_of_scene,
 
   // Removes any static borders.
   int top_static_border_size, bottom_static_border_size;
-  MP_RETURN_IF_ERROR(RemoveStaticBorders(cc, &top_static_border_size,
+  MP_RETURN_IF_ERROR(RemoveStaticBorders(&top_static_border_size,
                                          &bottom_static_border_size));
 
   // Decides if solid background color padding is possible and sets up color
@@ -546,66 +609,25 @@ absl::Status SceneCroppingCalculator::ProcessScene(const bool is_end_of_scene,
       &has_solid_background_, &background_color_l_function_,
       &background_color_a_function_, &background_color_b_function_));
 
-  // Computes key frame crop regions and moves information from raw
-  // key_frame_infos_ to key_frame_crop_results.
-  MP_RETURN_IF_ERROR(InitializeFrameCropRegionComputer());
-  const int num_key_frames = key_frame_infos_.size();
-  std::vector<KeyFrameCropResult> key_frame_crop_results(num_key_frames);
-  for (int i = 0; i < num_key_frames; ++i) {
-    MP_RETURN_IF_ERROR(frame_crop_region_computer_->ComputeFrameCropRegion(
-        key_frame_infos_[i], &key_frame_crop_results[i]));
+  // Crops the scene for all targets. Scene frames are cropped lazily when
+  // output.
+  std::vector<TargetSceneCrop> crops(targets_.size());
+  for (int i = 0; i < targets_.size(); ++i) {
+    MP_RETURN_IF_ERROR(CropSceneForTarget(
+        is_end_of_scene, top_static_border_size, &targets_[i], &crops[i]));
   }
 
-  SceneKeyFrameCropSummary scene_summary;
-  std::vector<FocusPointFrame> focus_point_frames;
-  SceneCameraMotion scene_camera_motion;
-  MP_RETURN_IF_ERROR(
-      scene_camera_motion_analyzer_->AnalyzeSceneAndPopulateFocusPointFrames(
-          key_frame_crop_options_, key_frame_crop_results, frame_width_,
-          effective_frame_height_, scene_frame_timestamps_,
-          has_solid_background_, &scene_summary, &focus_point_frames,
-          &scene_camera_motion));
-
-  // Crops scene frames.
-  std::vector<cv::Mat> cropped_frames;
-  std::vector<cv::Rect> crop_from_locations;
-
-  auto* cropped_frames_ptr =
-      should_perform_frame_cropping_ ? &cropped_frames : nullptr;
-
-  MP_RETURN_IF_ERROR(scene_cropper_->CropFrames(
-      scene_summary, scene_frame_timestamps_, is_key_frames_,
-      scene_frames_or_empty_, focus_point_frames, prior_focus_point_frames_,
-      top_static_border_size, bottom_static_border_size, continue_last_scene_,
-      &crop_from_locations, cropped_frames_ptr));
-
-  // Formats and outputs cropped frames.
-  bool apply_padding = false;
-  float vertical_fill_percent;
-  std::vector<cv::Rect> render_to_locations;
-  std::vector<cv::Scalar> padding_colors;
-  MP_RETURN_IF_ERROR(FormatAndOutputCroppedFrames(
-      scene_summary.crop_window_width(), scene_summary.crop_window_height(),
-      scene_frame_timestamps_.size(), &render_to_locations, &apply_padding,
-      &padding_colors, &vertical_fill_percent, cropped_frames_ptr, cc));
-  // Caches prior FocusPointFrames if this was not the end of a scene.
-  prior_focus_point_frames_.clear();
-  if (!is_end_of_scene) {
-    const int start =
-        std::max(0, static_cast<int>(scene_frame_timestamps_.size()) -
-                        options_.camera_motion_options()
-                            .polynomial_path_solver()
-                            .prior_frame_buffer_size());
-    for (int i = start; i < num_key_frames; ++i) {
-      prior_focus_point_frames_.push_back(focus_point_frames[i]);
-    }
+  if (should_perform_frame_cropping_) {
+    RET_CHECK_EQ(scene_frame_buffer_->size(), scene_frame_timestamps_.size())
+        << "Wrong number of buffered scene frames.";
   }
 
   // Optionally outputs visualization frames.
-  MP_RETURN_IF_ERROR(OutputVizFrames(key_frame_crop_results, focus_point_frames,
-                                     crop_from_locations,
-                                     scene_summary.crop_window_width(),
-                                     scene_summary.crop_window_height(), cc));
+  const TargetSceneCrop& first_crop = crops.front();
+  MP_RETURN_IF_ERROR(OutputVizFrames(
+      first_crop.key_frame_crop_results, first_crop.focus_point_frames,
+      first_crop.crop_from_locations, first_crop.crop_width,
+      first_crop.crop_height, cc));
 
   const double start_sec = Timestamp(scene_frame_timestamps_.front()).Seconds();
   const double end_sec = Timestamp(scene_frame_timestamps_.back()).Seconds();
@@ -617,36 +639,58 @@ absl::Status SceneCroppingCalculator::ProcessScene(const bool is_end_of_scene,
     auto* scene_summary = summary_->add_scene_summaries();
     scene_summary->set_start_sec(start_sec);
     scene_summary->set_end_sec(end_sec);
-    *(scene_summary->mutable_camera_motion()) = scene_camera_motion;
+    *(scene_summary->mutable_camera_motion()) = first_crop.scene_camera_motion;
     scene_summary->set_is_end_of_scene(is_end_of_scene);
-    scene_summary->set_is_padded(apply_padding);
-  }
+    scene_summary->set_is_padded(first_crop.apply_padding);
+  }
+
+  for (int t = 0; t < targets_.size(); ++t) {
+    const Target& target = targets_[t];
+    const TargetSceneCrop& crop = crops[t];
+    if (cc->Outputs().HasTag(kExternalRenderingPerFrame)) {
+      for (int i = 0; i < scene_frame_timestamps_.size(); i++) {
+        auto external_render_message = absl::make_unique<ExternalRenderFrame>();
+        ConstructExternalRenderMessage(
+            crop.crop_from_locations[i], crop.render_to_locations[i],
+            crop.padding_colors[i], scene_frame_timestamps_[i], target.width,
+            target.height, external_render_message.get());
+        cc->Outputs()
+            .Get(kExternalRenderingPerFrame, t)
+            .Add(external_render_message.release(),
+                 Timestamp(scene_frame_timestamps_[i]));
+      }
+    }
 
-  if (cc->Outputs().HasTag(kExternalRenderingPerFrame)) {
-    for (int i = 0; i < scene_frame_timestamps_.size(); i++) {
-      auto external_render_message = absl::make_unique<ExternalRenderFrame>();
-      ConstructExternalRenderMessage(
-          crop_from_locations[i], render_to_locations[i], padding_colors[i],
-          scene_frame_timestamps_[i], external_render_message.get());
-      cc->Outputs()
-          .Tag(kExternalRenderingPerFrame)
-          .Add(external_render_message.release(),
-               Timestamp(scene_frame_timestamps_[i]));
+    if (cc->Outputs().HasTag(kExternalRenderingFullVid)) {
+      for (int i = 0; i < scene_frame_timestamps_.size(); i++) {
+        ExternalRenderFrame render_frame;
+        ConstructExternalRenderMessage(
+            crop.crop_from_locations[i], crop.render_to_locations[i],
+            crop.padding_colors[i], scene_frame_timestamps_[i], target.width,
+            target.height, &render_frame);
+        target.external_render_list->push_back(render_frame);
+      }
     }
   }
 
-  if (cc->Outputs().HasTag(kExternalRenderingFullVid)) {
-    for (int i = 0; i < scene_frame_timestamps_.size(); i++) {
-      ExternalRenderFrame render_frame;
-      ConstructExternalRenderMessage(crop_from_locations[i],
-                                     render_to_locations[i], padding_colors[i],
-                                     scene_frame_timestamps_[i], &render_frame);
-      external_render_list_->push_back(render_frame);
-    }
+  // Formats and outputs cropped frames. The scene frames are handed over to
+  // the cropping job, and the next scene is buffered in a new buffer.
+  if (should_perform_frame_cropping_) {
+    auto job = absl::make_unique<SceneCroppingJob>();
+    job->scene_frames = std::move(scene_frame_buffer_);
+    scene_frame_buffer_ =
+        absl::make_unique<SceneFrameBuffer>(scene_frame_buffer_options_);
+    job->timestamps = scene_frame_timestamps_;
+    job->border_free_area =
+        cv::Rect(0, top_border_distance_, frame_width_,
+                 effective_frame_height_);
+    job->has_solid_background = has_solid_background_;
+    job->crops = std::move(crops);
+    MP_RETURN_IF_ERROR(CropAndOutputScene(std::move(job), cc));
   }
 
   key_frame_infos_.clear();
-  scene_frames_or_empty_.clear();
+  scene_frame_buffer_->Clear();
   scene_frame_timestamps_.clear();
   is_key_frames_.clear();
   static_features_.clear();
@@ -654,120 +698,241 @@ absl::Status SceneCroppingCalculator::ProcessScene(const bool is_end_of_scene,
   return absl::OkStatus();
 }
 
-absl::Status SceneCroppingCalculator::FormatAndOutputCroppedFrames(
-    const int crop_width, const int crop_height, const int num_frames,
-    std::vector<cv::Rect>* render_to_locations, bool* apply_padding,
-    std::vector<cv::Scalar>* padding_colors, float* vertical_fill_percent,
-    const std::vector<cv::Mat>* cropped_frames_ptr, CalculatorContext* cc) {
-  RET_CHECK(apply_padding) << "Has padding boolean is null.";
+absl::Status SceneCroppingCalculator::CropSceneForTarget(
+    const bool is_end_of_scene, const int top_static_border_size,
+    Target* target, TargetSceneCrop* crop) {
+  // Computes key frame crop regions and moves information from raw
+  // key_frame_infos_ to key_frame_crop_results.
+  MP_RETURN_IF_ERROR(InitializeFrameCropRegionComputer(target));
+  const int num_key_frames = key_frame_infos_.size();
+  crop->key_frame_crop_results.resize(num_key_frames);
+  for (int i = 0; i < num_key_frames; ++i) {
+    MP_RETURN_IF_ERROR(
+        target->frame_crop_region_computer->ComputeFrameCropRegion(
+            key_frame_infos_[i], &crop->key_frame_crop_results[i]));
+  }
+
+  SceneKeyFrameCropSummary scene_summary;
+  MP_RETURN_IF_ERROR(
+      target->scene_camera_motion_analyzer
+          ->AnalyzeSceneAndPopulateFocusPointFrames(
+              target->key_frame_crop_options, crop->key_frame_crop_results,
+              frame_width_, effective_frame_height_, scene_frame_timestamps_,
+              has_solid_background_, &scene_summary,
+              &crop->focus_point_frames, &crop->scene_camera_motion));
+
+  // Computes crop transforms.
+  MP_RETURN_IF_ERROR(target->scene_cropper->ComputeCropTransforms(
+      scene_summary, scene_frame_timestamps_, is_key_frames_,
+      crop->focus_point_frames, target->prior_focus_point_frames,
+      top_static_border_size, continue_last_scene_, &crop->xforms,
+      &crop->crop_from_locations));
+  crop->crop_width = scene_summary.crop_window_width();
+  crop->crop_height = scene_summary.crop_window_height();
+  MP_RETURN_IF_ERROR(ComputeOutputLayout(target, crop));
+
+  // Caches prior FocusPointFrames if this was not the end of a scene.
+  target->prior_focus_point_frames.clear();
+  if (!is_end_of_scene) {
+    const int start =
+        std::max(0, static_cast<int>(scene_frame_timestamps_.size()) -
+                        options_.camera_motion_options()
+                            .polynomial_path_solver()
+                            .prior_frame_buffer_size());
+    for (int i = start; i < num_key_frames; ++i) {
+      target->prior_focus_point_frames.push_back(crop->focus_point_frames[i]);
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SceneCroppingCalculator::ComputeOutputLayout(
+    Target* target, TargetSceneCrop* crop) {
+  const int crop_width = crop->crop_width;
+  const int crop_height = crop->crop_height;
+  const int num_frames = scene_frame_timestamps_.size();
 
   // Computes scaling factor and decides if padding is needed.
   VLOG(1) << "crop_width = " << crop_width << " crop_height = " << crop_height;
   const double scaling =
-      std::max(static_cast<double>(target_width_) / crop_width,
-               static_cast<double>(target_height_) / crop_height);
+      std::max(static_cast<double>(target->width) / crop_width,
+               static_cast<double>(target->height) / crop_height);
   int scaled_width = std::round(scaling * crop_width);
   int scaled_height = std::round(scaling * crop_height);
-  RET_CHECK_GE(scaled_width, target_width_)
+  RET_CHECK_GE(scaled_width, target->width)
       << "Scaled width is less than target width - something is wrong.";
-  RET_CHECK_GE(scaled_height, target_height_)
+  RET_CHECK_GE(scaled_height, target->height)
       << "Scaled height is less than target height - something is wrong.";
-  if (scaled_width - target_width_ <= 1) scaled_width = target_width_;
-  if (scaled_height - target_height_ <= 1) scaled_height = target_height_;
-  *apply_padding =
-      scaled_width != target_width_ || scaled_height != target_height_;
-  *vertical_fill_percent = scaled_height / static_cast<float>(target_height_);
-  if (*apply_padding) {
-    padder_ = absl::make_unique<PaddingEffectGenerator>(
-        scaled_width, scaled_height, target_aspect_ratio_);
+  if (scaled_width - target->width <= 1) scaled_width = target->width;
+  if (scaled_height - target->height <= 1) scaled_height = target->height;
+  crop->scaled_width = scaled_width;
+  crop->scaled_height = scaled_height;
+  crop->apply_padding =
+      scaled_width != target->width || scaled_height != target->height;
+  if (crop->apply_padding) {
+    crop->padder = absl::make_unique<PaddingEffectGenerator>(
+        scaled_width, scaled_height, target->aspect_ratio,
+        /* scale_to_multiple_of_two = */ false, background_downscale_factor_);
     VLOG(1) << "Scene is padded: scaled width = " << scaled_width
-            << " target width = " << target_width_
+            << " target width = " << target->width
             << " scaled height = " << scaled_height
-            << " target height = " << target_height_;
+            << " target height = " << target->height;
   }
 
   // Compute the "render to" location.  This is where the rect taken from the
   // input video gets pasted on the output frame.  For use with external
   // rendering solutions.
   for (int i = 0; i < num_frames; i++) {
-    if (*apply_padding) {
-      render_to_locations->push_back(padder_->ComputeOutputLocation());
+    if (crop->apply_padding) {
+      crop->render_to_locations.push_back(
+          crop->padder->ComputeOutputLocation());
     } else {
-      render_to_locations->push_back(
-          cv::Rect(0, 0, target_width_, target_height_));
+      crop->render_to_locations.push_back(
+          cv::Rect(0, 0, target->width, target->height));
     }
   }
 
   // Compute padding colors.
-  for (int i = 0; i < num_frames; ++i) {
+  if (!crop->apply_padding || !has_solid_background_) {
     // Set default padding color to white.
-    cv::Scalar padding_color_to_add = cv::Scalar(255, 255, 255);
-    const int64 time_ms = scene_frame_timestamps_[i];
-    if (*apply_padding) {
-      if (has_solid_background_) {
-        double lab[3];
-        lab[0] = background_color_l_function_.Evaluate(time_ms);
-        lab[1] = background_color_a_function_.Evaluate(time_ms);
-        lab[2] = background_color_b_function_.Evaluate(time_ms);
-        cv::Mat3f lab_mat(1, 1, cv::Vec3f(lab[0], lab[1], lab[2]));
-        cv::Mat3f rgb_mat(1, 1);
-        // Necessary scaling of the RGB values from [0, 1] to [0, 255] based on:
-        // https://docs.opencv.org/2.4/modules/imgproc/doc/miscellaneous_transformations.html#cvtcolor
-        cv::cvtColor(lab_mat, rgb_mat, cv::COLOR_Lab2RGB);
-        rgb_mat *= 255.0;
-        auto k = rgb_mat.at<cv::Vec3f>(0, 0);
-        k[0] = k[0] < 0.0 ? 0.0 : k[0] > 255.0 ? 255.0 : k[0];
-        k[1] = k[1] < 0.0 ? 0.0 : k[1] > 255.0 ? 255.0 : k[1];
-        k[2] = k[2] < 0.0 ? 0.0 : k[2] > 255.0 ? 255.0 : k[2];
-        cv::Scalar interpolated_color =
-            cv::Scalar(std::round(k[0]), std::round(k[1]), std::round(k[2]));
-        padding_color_to_add = interpolated_color;
+    crop->padding_colors.assign(num_frames, cv::Scalar(255, 255, 255));
+    return absl::OkStatus();
+  }
+  // Interpolates the background colors of all frames in batch and converts
+  // them to RGB at once.
+  const std::vector<double> times_ms(scene_frame_timestamps_.begin(),
+                                     scene_frame_timestamps_.end());
+  std::vector<double> lab[3];
+  background_color_l_function_.Evaluate(times_ms, &lab[0]);
+  background_color_a_function_.Evaluate(times_ms, &lab[1]);
+  background_color_b_function_.Evaluate(times_ms, &lab[2]);
+  cv::Mat3f lab_mat(1, num_frames);
+  for (int i = 0; i < num_frames; ++i) {
+    lab_mat(0, i) = cv::Vec3f(lab[0][i], lab[1][i], lab[2][i]);
+  }
+  cv::Mat3f rgb_mat(1, num_frames);
+  // Necessary scaling of the RGB values from [0, 1] to [0, 255] based on:
+  // https://docs.opencv.org/2.4/modules/imgproc/doc/miscellaneous_transformations.html#cvtcolor
+  cv::cvtColor(lab_mat, rgb_mat, cv::COLOR_Lab2RGB);
+  rgb_mat *= 255.0;
+  for (int i = 0; i < num_frames; ++i) {
+    auto k = rgb_mat(0, i);
+    k[0] = k[0] < 0.0 ? 0.0 : k[0] > 255.0 ? 255.0 : k[0];
+    k[1] = k[1] < 0.0 ? 0.0 : k[1] > 255.0 ? 255.0 : k[1];
+    k[2] = k[2] < 0.0 ? 0.0 : k[2] > 255.0 ? 255.0 : k[2];
+    crop->padding_colors.push_back(
+        cv::Scalar(std::round(k[0]), std::round(k[1]), std::round(k[2])));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SceneCroppingCalculator::CropAndOutputScene(
+    std::unique_ptr<SceneCroppingJob> job, CalculatorContext* cc) {
+  if (!cropping_thread_pool_) {
+    return CropSceneFrames(
+        job.get(), [cc, &job](int target_index, int frame_index,
+                              std::unique_ptr<ImageFrame> frame) {
+          cc->Outputs()
+              .Get(kOutputCroppedFrames, target_index)
+              .Add(frame.release(), Timestamp(job->timestamps[frame_index]));
+        });
+  }
+
+  SceneCroppingJob* job_ptr = job.get();
+  job_ptr->cropped_frames.resize(targets_.size());
+  for (auto& target_frames : job_ptr->cropped_frames) {
+    target_frames.resize(job_ptr->timestamps.size());
+  }
+  pending_scene_jobs_.push_back(std::move(job));
+  cropping_thread_pool_->Schedule([this, job_ptr] {
+    job_ptr->status = CropSceneFrames(
+        job_ptr, [job_ptr](int target_index, int frame_index,
+                           std::unique_ptr<ImageFrame> frame) {
+          job_ptr->cropped_frames[target_index][frame_index] = std::move(frame);
+        });
+    // Releases the scene frames (and any scratch file) right away.
+    job_ptr->scene_frames.reset();
+    job_ptr->done.Notify();
+  });
+  // Bounds the number of scenes in flight, and thereby memory usage.
+  return OutputCroppedScenes(options_.num_cropping_threads(), cc);
+}
+
+absl::Status SceneCroppingCalculator::OutputCroppedScenes(
+    int max_pending_scenes, CalculatorContext* cc) {
+  while (!pending_scene_jobs_.empty()) {
+    SceneCroppingJob* job = pending_scene_jobs_.front().get();
+    if (static_cast<int>(pending_scene_jobs_.size()) > max_pending_scenes) {
+      job->done.WaitForNotification();
+    } else if (!job->done.HasBeenNotified()) {
+      break;
+    }
+    MP_RETURN_IF_ERROR(job->status);
+    for (int t = 0; t < job->cropped_frames.size(); ++t) {
+      for (int i = 0; i < job->timestamps.size(); ++i) {
+        cc->Outputs()
+            .Get(kOutputCroppedFrames, t)
+            .Add(job->cropped_frames[t][i].release(),
+                 Timestamp(job->timestamps[i]));
       }
     }
-    padding_colors->push_back(padding_color_to_add);
-  }
-  if (!cropped_frames_ptr) {
-    return absl::OkStatus();
+    pending_scene_jobs_.pop_front();
   }
+  return absl::OkStatus();
+}
 
-  // Resizes cropped frames, pads frames, and output frames.
-  for (int i = 0; i < num_frames; ++i) {
-    const int64 time_ms = scene_frame_timestamps_[i];
-    const Timestamp timestamp(time_ms);
-    auto scaled_frame = absl::make_unique<ImageFrame>(
-        frame_format_, scaled_width, scaled_height);
-    auto destination = formats::MatView(scaled_frame.get());
-    if (scaled_width == crop_width && scaled_height == crop_height) {
-      cropped_frames_ptr->at(i).copyTo(destination);
-    } else {
-      // cubic is better quality for upscaling and area is good for
-      // downscaling
-      const int interpolation_method =
-          scaling > 1 ? cv::INTER_CUBIC : cv::INTER_AREA;
-      cv::resize(cropped_frames_ptr->at(i), destination, destination.size(), 0,
-                 0, interpolation_method);
+absl::Status SceneCroppingCalculator::CropSceneFrames(
+    SceneCroppingJob* job,
+    const std::function<void(int, int, std::unique_ptr<ImageFrame>)>& output)
+    const {
+  // Crops, resizes, pads, and outputs frames. Frames are read from the scene
+  // frame buffer one at a time, which bounds memory usage, and cropped for all
+  // targets.
+  cv::Mat scene_frame;
+  cv::Mat cropped_frame;
+  for (int i = 0; i < job->timestamps.size(); ++i) {
+    MP_RETURN_IF_ERROR(job->scene_frames->Get(i, &scene_frame));
+    if (job->border_free_area.size() != scene_frame.size()) {
+      scene_frame = scene_frame(job->border_free_area);
     }
-    if (*apply_padding) {
-      cv::Scalar* background_color = nullptr;
-      if (has_solid_background_) {
-        background_color = &padding_colors->at(i);
+    for (int t = 0; t < targets_.size(); ++t) {
+      const Target& target = targets_[t];
+      const TargetSceneCrop& crop = job->crops[t];
+      cv::warpAffine(scene_frame, cropped_frame, crop.xforms[i],
+                     cv::Size(crop.crop_width, crop.crop_height));
+      auto scaled_frame = absl::make_unique<ImageFrame>(
+          frame_format_, crop.scaled_width, crop.scaled_height);
+      auto destination = formats::MatView(scaled_frame.get());
+      if (crop.scaled_width == crop.crop_width &&
+          crop.scaled_height == crop.crop_height) {
+        cropped_frame.copyTo(destination);
+      } else {
+        // cubic is better quality for upscaling and area is good for
+        // downscaling
+        const int interpolation_method =
+            crop.scaled_width > crop.crop_width ? cv::INTER_CUBIC
+                                                : cv::INTER_AREA;
+        cv::resize(cropped_frame, destination, destination.size(), 0, 0,
+                   interpolation_method);
+      }
+      if (crop.apply_padding) {
+        const cv::Scalar* background_color = nullptr;
+        if (job->has_solid_background) {
+          background_color = &crop.padding_colors[i];
+        }
+        auto padded_frame = absl::make_unique<ImageFrame>();
+        MP_RETURN_IF_ERROR(crop.padder->Process(
+            *scaled_frame, background_contrast_,
+            std::min({blur_cv_size_, crop.scaled_width, crop.scaled_height}),
+            overlay_opacity_, padded_frame.get(), background_color));
+        RET_CHECK_EQ(padded_frame->Width(), target.width)
+            << "Padded frame width is off.";
+        RET_CHECK_EQ(padded_frame->Height(), target.height)
+            << "Padded frame height is off.";
+        output(t, i, std::move(padded_frame));
+      } else {
+        output(t, i, std::move(scaled_frame));
       }
-      auto padded_frame = absl::make_unique<ImageFrame>();
-      MP_RETURN_IF_ERROR(padder_->Process(
-          *scaled_frame, background_contrast_,
-          std::min({blur_cv_size_, scaled_width, scaled_height}),
-          overlay_opacity_, padded_frame.get(), background_color));
-      RET_CHECK_EQ(padded_frame->Width(), target_width_)
-          << "Padded frame width is off.";
-      RET_CHECK_EQ(padded_frame->Height(), target_height_)
-          << "Padded frame height is off.";
-      cc->Outputs()
-          .Tag(kOutputCroppedFrames)
-          .Add(padded_frame.release(), timestamp);
-    } else {
-      cc->Outputs()
-          .Tag(kOutputCroppedFrames)
-          .Add(scaled_frame.release(), timestamp);
     }
   }
   return absl::OkStatus();
@@ -778,13 +943,19 @@ absl::Status SceneCroppingCalculator::OutputVizFrames(
     const std::vector<FocusPointFrame>& focus_point_frames,
     const std::vector<cv::Rect>& crop_from_locations,
     const int crop_window_width, const int crop_window_height,
-    CalculatorContext* cc) const {
+    CalculatorContext* cc) {
+  std::vector<cv::Mat> scene_frames;
+  if (cc->Outputs().HasTag(kOutputKeyFrameCropViz) ||
+      cc->Outputs().HasTag(kOutputFocusPointFrameViz)) {
+    MP_RETURN_IF_ERROR(
+        GetSceneFrames(/* remove_borders = */ true, &scene_frames));
+  }
   if (cc->Outputs().HasTag(kOutputKeyFrameCropViz)) {
     std::vector<std::unique_ptr<ImageFrame>> viz_frames;
     MP_RETURN_IF_ERROR(DrawDetectionsAndCropRegions(
-        scene_frames_or_empty_, is_key_frames_, key_frame_infos_,
-        key_frame_crop_results, frame_format_, &viz_frames));
-    for (int i = 0; i < scene_frames_or_empty_.size(); ++i) {
+        scene_frames, is_key_frames_, key_frame_infos_, key_frame_crop_results,
+        frame_format_, &viz_frames));
+    for (int i = 0; i < scene_frames.size(); ++i) {
       cc->Outputs()
           .Tag(kOutputKeyFrameCropViz)
           .Add(viz_frames[i].release(), Timestamp(scene_frame_timestamps_[i]));
@@ -793,21 +964,24 @@ absl::Status SceneCroppingCalculator::OutputVizFrames(
   if (cc->Outputs().HasTag(kOutputFocusPointFrameViz)) {
     std::vector<std::unique_ptr<ImageFrame>> viz_frames;
     MP_RETURN_IF_ERROR(DrawFocusPointAndCropWindow(
-        scene_frames_or_empty_, focus_point_frames,
-        options_.viz_overlay_opacity(), crop_window_width, crop_window_height,
-        frame_format_, &viz_frames));
-    for (int i = 0; i < scene_frames_or_empty_.size(); ++i) {
+        scene_frames, focus_point_frames, options_.viz_overlay_opacity(),
+        crop_window_width, crop_window_height, frame_format_, &viz_frames));
+    for (int i = 0; i < scene_frames.size(); ++i) {
       cc->Outputs()
           .Tag(kOutputFocusPointFrameViz)
           .Add(viz_frames[i].release(), Timestamp(scene_frame_timestamps_[i]));
     }
   }
   if (cc->Outputs().HasTag(kOutputFramingAndDetections)) {
+    // Original frames, including any static borders.
+    std::vector<cv::Mat> raw_scene_frames;
+    MP_RETURN_IF_ERROR(
+        GetSceneFrames(/* remove_borders = */ false, &raw_scene_frames));
     std::vector<std::unique_ptr<ImageFrame>> viz_frames;
     MP_RETURN_IF_ERROR(DrawDetectionAndFramingWindow(
-        raw_scene_frames_or_empty_, crop_from_locations, frame_format_,
+        raw_scene_frames, crop_from_locations, frame_format_,
         options_.viz_overlay_opacity(), &viz_frames));
-    for (int i = 0; i < raw_scene_frames_or_empty_.size(); ++i) {
+    for (int i = 0; i < raw_scene_frames.size(); ++i) {
       cc->Outputs()
           .Tag(kOutputFramingAndDetections)
           .Add(viz_frames[i].release(), Timestamp(scene_frame_timestamps_[i]));
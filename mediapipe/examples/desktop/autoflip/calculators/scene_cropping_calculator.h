@@ -15,9 +15,12 @@
 #ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SCENE_CROPPING_CALCULATOR_H_
 #define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SCENE_CROPPING_CALCULATOR_H_
 
+#include <deque>
+#include <functional>
 #include <memory>
 #include <vector>
 
+#include "absl/synchronization/notification.h"
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/scene_cropping_calculator.pb.h"
 #include "mediapipe/examples/desktop/autoflip/quality/cropping.pb.h"
@@ -28,11 +31,13 @@
 #include "mediapipe/examples/desktop/autoflip/quality/polynomial_regression_path_solver.h"
 #include "mediapipe/examples/desktop/autoflip/quality/scene_camera_motion_analyzer.h"
 #include "mediapipe/examples/desktop/autoflip/quality/scene_cropper.h"
+#include "mediapipe/examples/desktop/autoflip/quality/scene_frame_buffer.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
 
 namespace mediapipe {
 namespace autoflip {
@@ -104,6 +109,18 @@ namespace autoflip {
 //     Provides an end-stream message that can be used to render autoflip using
 //     an external renderer.
 //
+// Multiple aspect ratios:
+// With target_size_type MAXIMIZE_TARGET_DIMENSION, the video can be cropped to
+// several aspect ratios at once by passing one EXTERNAL_ASPECT_RATIO side
+// packet per target (e.g. "EXTERNAL_ASPECT_RATIO:0:portrait" and
+// "EXTERNAL_ASPECT_RATIO:1:square"). The i'th CROPPED_FRAMES,
+// EXTERNAL_RENDERING_PER_FRAME and EXTERNAL_RENDERING_FULL_VID output streams
+// then belong to the i'th aspect ratio; each of these tags that is used must
+// have one stream per aspect ratio. All targets share the input signals, the
+// buffered scene frames and the static border and background color analysis,
+// and each buffered frame is loaded once to crop all targets. Visualization
+// and summary outputs describe the first target only.
+//
 // Example config:
 // node {
 //   calculator: "SceneCroppingCalculator"
@@ -123,6 +140,14 @@ namespace autoflip {
 // }
 // Note that only the target size is required in the options, and all other
 // fields are optional with default settings.
+//
+// Scene frames are buffered until the end of the scene. To bound memory usage
+// for long scenes, set frame_buffer_options.max_frames_in_memory, which spills
+// any further frames of a scene to a memory mapped scratch file.
+//
+// For offline processing, set num_cropping_threads to crop the frames of a
+// scene on worker threads while the next scene is buffered. Cropped frames are
+// then output with a delay of up to num_cropping_threads scenes.
 class SceneCroppingCalculator : public CalculatorBase {
  public:
   static absl::Status GetContract(CalculatorContract* cc);
@@ -142,44 +167,152 @@ class SceneCroppingCalculator : public CalculatorBase {
   absl::Status Close(mediapipe::CalculatorContext* cc) override;
 
  private:
-  // Removes any static borders from the scene frames before cropping. The
-  // arguments |top_border_size| and |bottom_border_size| report the size of the
+  // Computes the size of any static borders of the scene frames and removes
+  // them from the key frame detections. The borders are removed from the scene
+  // frames when they are read back through GetSceneFrame(). The arguments
+  // |top_border_size| and |bottom_border_size| report the size of the
   // removed borders.
-  absl::Status RemoveStaticBorders(CalculatorContext* cc, int* top_border_size,
+  absl::Status RemoveStaticBorders(int* top_border_size,
                                    int* bottom_border_size);
 
+  // Returns the |index|'th buffered scene frame, optionally with static
+  // borders removed (as a view into the buffered frame).
+  absl::Status GetSceneFrame(int index, bool remove_borders, cv::Mat* frame);
+
+  // Returns all buffered scene frames, see GetSceneFrame().
+  absl::Status GetSceneFrames(bool remove_borders,
+                              std::vector<cv::Mat>* frames);
+
   // Sets up autoflip after first frame is received and input size is known.
   absl::Status InitializeSceneCroppingCalculator(
       mediapipe::CalculatorContext* cc);
+  // Per target state. Key frame crop regions, camera motion and crop paths
+  // depend on the target aspect ratio, so each target has its own
+  // FrameCropRegionComputer, SceneCameraMotionAnalyzer and SceneCropper.
+  struct Target {
+    // Target frame size and aspect ratio passed in or computed from options.
+    int width = -1;
+    int height = -1;
+    double aspect_ratio = -1.0;
+
+    // KeyFrameCropOptions used by the FrameCropRegionComputer.
+    KeyFrameCropOptions key_frame_crop_options;
+
+    // Object for computing key frame crop regions from detection features.
+    std::unique_ptr<FrameCropRegionComputer> frame_crop_region_computer;
+
+    // Object for analyzing scene camera motion from key frame crop regions and
+    // generating FocusPointFrames.
+    std::unique_ptr<SceneCameraMotionAnalyzer> scene_camera_motion_analyzer;
+
+    // Object for cropping a scene given FocusPointFrames.
+    std::unique_ptr<SceneCropper> scene_cropper;
+
+    // Stored FocusPointFrames from prior scene when there was no actual scene
+    // change (due to forced flush when buffer is full).
+    std::vector<FocusPointFrame> prior_focus_point_frames;
+
+    // Optional list of external rendering messages for each processed frame.
+    std::unique_ptr<std::vector<ExternalRenderFrame>> external_render_list;
+  };
+
+  // Cropping of the current scene for one target.
+  struct TargetSceneCrop {
+    std::vector<KeyFrameCropResult> key_frame_crop_results;
+    std::vector<FocusPointFrame> focus_point_frames;
+    SceneCameraMotion scene_camera_motion;
+    // Crop window size and the size it is scaled to before padding.
+    int crop_width = -1;
+    int crop_height = -1;
+    int scaled_width = -1;
+    int scaled_height = -1;
+    bool apply_padding = false;
+    // Per frame crop transforms and external rendering information.
+    std::vector<cv::Mat> xforms;
+    std::vector<cv::Rect> crop_from_locations;
+    std::vector<cv::Rect> render_to_locations;
+    std::vector<cv::Scalar> padding_colors;
+    // Object for padding an image to the target aspect ratio.
+    std::unique_ptr<PaddingEffectGenerator> padder;
+  };
+
+  // A scene with its crop decisions made, whose frames are still to be
+  // cropped and output. Owns the buffered scene frames, such that the next
+  // scene can be buffered while this one is cropped on a worker thread.
+  struct SceneCroppingJob {
+    std::unique_ptr<SceneFrameBuffer> scene_frames;
+    std::vector<int64> timestamps;
+    // Area of the scene frames without static borders.
+    cv::Rect border_free_area;
+    bool has_solid_background = false;
+    std::vector<TargetSceneCrop> crops;
+    // Cropped frames per target and frame, when cropped on a worker thread.
+    std::vector<std::vector<std::unique_ptr<ImageFrame>>> cropped_frames;
+    // Set by the worker thread, status is valid once done is notified.
+    absl::Status status;
+    absl::Notification done;
+  };
+
+  // Computes the target frame size of the |index|'th target from the options
+  // and the EXTERNAL_ASPECT_RATIO side packets.
+  absl::Status ComputeTargetSize(int index, CalculatorContext* cc,
+                                 Target* target);
+
   // Initializes a FrameCropRegionComputer given input and target frame sizes.
-  absl::Status InitializeFrameCropRegionComputer();
+  absl::Status InitializeFrameCropRegionComputer(Target* target);
 
   // Processes a scene using buffered scene frames and KeyFrameInfos:
+  // 1. Removes static borders and finds any solid background color.
+  // 2. Crops the scene for each target, see CropSceneForTarget().
+  // 3. Crops, formats and outputs cropped frames of all targets.
+  // 4. Optionally outputs visualization frames.
+  // 5. Optionally updates cropping summary and outputs external rendering
+  //    messages.
+  absl::Status ProcessScene(const bool is_end_of_scene, CalculatorContext* cc);
+
+  // Crops the current scene for |target|:
   // 1. Computes key frame crop regions using a FrameCropRegionComputer.
   // 2. Analyzes scene camera motion and generates FocusPointFrames using a
   //    SceneCameraMotionAnalyzer.
-  // 3. Crops scene frames using a SceneCropper (wrapper around Retargeter).
-  // 4. Formats and outputs cropped frames .
+  // 3. Computes crop transforms using a SceneCropper (wrapper around
+  //    Retargeter).
+  // 4. Computes the output layout, see ComputeOutputLayout().
   // 5. Caches prior FocusPointFrames if this is not the end of a scene (due
   //    to force flush).
-  // 6. Optionally outputs visualization frames.
-  // 7. Optionally updates cropping summary.
-  absl::Status ProcessScene(const bool is_end_of_scene, CalculatorContext* cc);
+  absl::Status CropSceneForTarget(const bool is_end_of_scene,
+                                  const int top_static_border_size,
+                                  Target* target, TargetSceneCrop* crop);
 
-  // Formats and outputs the cropped frames passed in through
-  // |cropped_frames_ptr|. Scales them to be at least as big as the target
+  // Computes the scaled size of the crop window of |crop|, decides if padding
+  // is needed and computes the "render to" locations and padding colors of
+  // the scene frames. Scales crop windows to be at least as big as the target
   // size. If the aspect ratio is different, applies padding. Uses solid
   // background from static features if possible, otherwise uses blurred
-  // background. Sets |apply_padding| to true if the scene is padded. Set
-  // |cropped_frames_ptr| to nullptr, to bypass the actual output of the
-  // cropped frames. This is useful when the calculator is only used for
-  // computing the cropping metadata rather than doing the actual cropping
-  // operation.
-  absl::Status FormatAndOutputCroppedFrames(
-      const int crop_width, const int crop_height, const int num_frames,
-      std::vector<cv::Rect>* render_to_locations, bool* apply_padding,
-      std::vector<cv::Scalar>* padding_colors, float* vertical_fill_percent,
-      const std::vector<cv::Mat>* cropped_frames_ptr, CalculatorContext* cc);
+  // background.
+  absl::Status ComputeOutputLayout(Target* target, TargetSceneCrop* crop);
+
+  // Crops the frames of |job| and outputs them, either right away or on a
+  // worker thread (see num_cropping_threads). Not called when the calculator
+  // is only used for computing the cropping metadata rather than doing the
+  // actual cropping operation.
+  absl::Status CropAndOutputScene(std::unique_ptr<SceneCroppingJob> job,
+                                  CalculatorContext* cc);
+
+  // Crops the scene frames of |job| for all targets using the transforms of
+  // its crops, formats them and passes them to |output| (with the target and
+  // frame index). Frames are loaded one at a time and cropped for all
+  // targets. Only reads calculator state that is fixed after initialization,
+  // so it can run on a worker thread.
+  absl::Status CropSceneFrames(
+      SceneCroppingJob* job,
+      const std::function<void(int, int, std::unique_ptr<ImageFrame>)>&
+          output) const;
+
+  // Outputs the cropped frames of scenes cropped on worker threads in order.
+  // Waits for the oldest scenes while more than |max_pending_scenes| scenes
+  // are pending, and stops at the first scene that is not done otherwise.
+  absl::Status OutputCroppedScenes(int max_pending_scenes,
+                                   CalculatorContext* cc);
 
   // Draws and outputs visualization frames if those streams are present.
   absl::Status OutputVizFrames(
@@ -187,15 +320,13 @@ class SceneCroppingCalculator : public CalculatorBase {
       const std::vector<FocusPointFrame>& focus_point_frames,
       const std::vector<cv::Rect>& crop_from_locations,
       const int crop_window_width, const int crop_window_height,
-      CalculatorContext* cc) const;
+      CalculatorContext* cc);
 
   // Filters detections based on USER_HINT under specific flag conditions.
   void FilterKeyFrameInfo();
 
-  // Target frame size and aspect ratio passed in or computed from options.
-  int target_width_ = -1;
-  int target_height_ = -1;
-  double target_aspect_ratio_ = -1.0;
+  // Output targets (size = number of target aspect ratios).
+  std::vector<Target> targets_;
 
   // Input video frame size and format.
   int frame_width_ = -1;
@@ -215,15 +346,15 @@ class SceneCroppingCalculator : public CalculatorBase {
 
   // Buffered frames, timestamps, and indicators for key frames in the current
   // scene (size = number of input video frames).
-  // Note: scene_frames_or_empty_ may be empty if the actual cropping
+  // Note: scene_frame_buffer_ may be empty if the actual cropping
   // operation of frames is turned off, e.g. when
   // |should_perform_frame_cropping_| is false, so rely on
   // scene_frame_timestamps_.size() to query the number of accumulated
-  // timestamps rather than scene_frames_or_empty_.size().
+  // timestamps rather than scene_frame_buffer_->size().
   // TODO: all of the following vectors are expected to be the same
   // size. Add to struct and store together in one vector.
-  std::vector<cv::Mat> scene_frames_or_empty_;
-  std::vector<cv::Mat> raw_scene_frames_or_empty_;
+  std::unique_ptr<SceneFrameBuffer> scene_frame_buffer_;
+  SceneFrameBuffer::Options scene_frame_buffer_options_;
   std::vector<int64> scene_frame_timestamps_;
   std::vector<bool> is_key_frames_;
 
@@ -231,28 +362,10 @@ class SceneCroppingCalculator : public CalculatorBase {
   int top_border_distance_ = -1;
   int effective_frame_height_ = -1;
 
-  // Stored FocusPointFrames from prior scene when there was no actual scene
-  // change (due to forced flush when buffer is full).
-  std::vector<FocusPointFrame> prior_focus_point_frames_;
   // Indicates if this scene is a continuation of the last scene (due to
   // forced flush when buffer is full).
   bool continue_last_scene_ = false;
 
-  // KeyFrameCropOptions used by the FrameCropRegionComputer.
-  KeyFrameCropOptions key_frame_crop_options_;
-
-  // Object for computing key frame crop regions from detection features.
-  std::unique_ptr<FrameCropRegionComputer> frame_crop_region_computer_ =
-      nullptr;
-
-  // Object for analyzing scene camera motion from key frame crop regions and
-  // generating FocusPointFrames.
-  std::unique_ptr<SceneCameraMotionAnalyzer> scene_camera_motion_analyzer_ =
-      nullptr;
-
-  // Object for cropping a scene given FocusPointFrames.
-  std::unique_ptr<SceneCropper> scene_cropper_ = nullptr;
-
   // Buffered static features and their timestamps used in padding with solid
   // background color (size = number of frames with static features).
   std::vector<StaticFeatures> static_features_;
@@ -270,15 +383,11 @@ class SceneCroppingCalculator : public CalculatorBase {
   float background_contrast_ = -1.0;
   int blur_cv_size_ = -1;
   float overlay_opacity_ = -1.0;
-  // Object for padding an image to a target aspect ratio.
-  std::unique_ptr<PaddingEffectGenerator> padder_ = nullptr;
+  int background_downscale_factor_ = 1;
 
   // Optional diagnostic summary output emitted in Close().
   std::unique_ptr<VideoCroppingSummary> summary_ = nullptr;
 
-  // Optional list of external rendering messages for each processed frame.
-  std::unique_ptr<std::vector<ExternalRenderFrame>> external_render_list_;
-
   // Determines whether to perform real cropping on input frames. This flag is
   // useful when the user only needs to compute cropping windows, in which
   // case setting this flag to false can avoid buffering as well as cropping
@@ -286,6 +395,13 @@ class SceneCroppingCalculator : public CalculatorBase {
   // processing. Some debugging visualization inevitably will be disabled
   // because of this flag too.
   bool should_perform_frame_cropping_ = false;
+
+  // Scenes cropped on worker threads, in timestamp order.
+  std::deque<std::unique_ptr<SceneCroppingJob>> pending_scene_jobs_;
+  // Worker threads for cropping scenes, if num_cropping_threads is positive.
+  // Declared last, such that the workers are joined before any state they use
+  // is destroyed.
+  std::unique_ptr<ThreadPool> cropping_thread_pool_;
 };
 }  // namespace autoflip
 }  // namespace mediapipe
@@ -138,6 +138,26 @@ constexpr char kExternalRenderConfigNoVideo[] = R"(
     }
   })";
 
+constexpr char kMultiTargetConfig[] = R"(
+  calculator: "SceneCroppingCalculator"
+  input_side_packet: "EXTERNAL_ASPECT_RATIO:0:portrait_aspect_ratio"
+  input_side_packet: "EXTERNAL_ASPECT_RATIO:1:square_aspect_ratio"
+  input_stream: "VIDEO_FRAMES:camera_frames_org"
+  input_stream: "KEY_FRAMES:down_sampled_frames"
+  input_stream: "DETECTION_FEATURES:salient_regions"
+  input_stream: "STATIC_FEATURES:border_features"
+  input_stream: "SHOT_BOUNDARIES:shot_boundary_frames"
+  output_stream: "CROPPED_FRAMES:0:portrait_cropped_frames"
+  output_stream: "CROPPED_FRAMES:1:square_cropped_frames"
+  output_stream: "EXTERNAL_RENDERING_PER_FRAME:0:portrait_external_rendering"
+  output_stream: "EXTERNAL_RENDERING_PER_FRAME:1:square_external_rendering"
+  options: {
+    [mediapipe.autoflip.SceneCroppingCalculatorOptions.ext]: {
+      target_size_type: MAXIMIZE_TARGET_DIMENSION
+      max_scene_size: $0
+    }
+  })";
+
 constexpr int kInputFrameWidth = 1280;
 constexpr int kInputFrameHeight = 720;
 
@@ -380,6 +400,107 @@ TEST(SceneCroppingCalculatorTest, HandlesLongScene) {
   CheckCroppedFrames(*runner, 2 * kMaxSceneSize, kTargetWidth, kTargetHeight);
 }
 
+// Checks that spilling scene frames to a scratch file (raw or compressed)
+// produces the same output as buffering all frames in memory.
+TEST(SceneCroppingCalculatorTest, SpillsSceneFramesToScratchFile) {
+  CalculatorGraphConfig::Node config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+          kConfig, kTargetWidth, kTargetHeight, kTargetSizeType, kMaxSceneSize,
+          kPriorFrameBufferSize));
+  auto runner = absl::make_unique<CalculatorRunner>(config);
+  AddScene(0, kSceneSize, kInputFrameWidth, kInputFrameHeight, kKeyFrameWidth,
+           kKeyFrameHeight, kDownSampleRate, runner->MutableInputs());
+
+  // Runners with identical inputs that spill all but two frames per scene.
+  std::vector<std::unique_ptr<CalculatorRunner>> spill_runners;
+  for (const bool compress : {false, true}) {
+    auto* buffer_options =
+        config.mutable_options()
+            ->MutableExtension(SceneCroppingCalculatorOptions::ext)
+            ->mutable_frame_buffer_options();
+    buffer_options->set_max_frames_in_memory(2);
+    buffer_options->set_compress_spilled_frames(compress);
+    spill_runners.push_back(absl::make_unique<CalculatorRunner>(config));
+    for (const char* tag :
+         {"VIDEO_FRAMES", "KEY_FRAMES", "DETECTION_FEATURES", "STATIC_FEATURES",
+          "SHOT_BOUNDARIES"}) {
+      spill_runners.back()->MutableInputs()->Tag(tag).packets =
+          runner->MutableInputs()->Tag(tag).packets;
+    }
+  }
+
+  MP_EXPECT_OK(runner->Run());
+  CheckCroppedFrames(*runner, kSceneSize, kTargetWidth, kTargetHeight);
+  const auto& expected_frames = runner->Outputs().Tag("CROPPED_FRAMES").packets;
+  for (auto& spill_runner : spill_runners) {
+    MP_EXPECT_OK(spill_runner->Run());
+    CheckCroppedFrames(*spill_runner, kSceneSize, kTargetWidth, kTargetHeight);
+    const auto& frames = spill_runner->Outputs().Tag("CROPPED_FRAMES").packets;
+    for (int i = 0; i < kSceneSize; ++i) {
+      const auto expected =
+          formats::MatView(&expected_frames[i].Get<ImageFrame>());
+      const auto actual = formats::MatView(&frames[i].Get<ImageFrame>());
+      EXPECT_EQ(0, cv::norm(expected, actual, cv::NORM_INF));
+    }
+  }
+}
+
+// Checks that cropping scenes on worker threads produces the same frames, in
+// the same order, as cropping them on the calculator thread.
+TEST(SceneCroppingCalculatorTest, CropsScenesOnWorkerThreads) {
+  CalculatorGraphConfig::Node config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+          kConfig, kTargetWidth, kTargetHeight, kTargetSizeType, kMaxSceneSize,
+          kPriorFrameBufferSize));
+  auto runner = absl::make_unique<CalculatorRunner>(config);
+  for (int s = 0; s < kNumScenes; ++s) {
+    AddScene(s * kSceneSize, kSceneSize, kInputFrameWidth, kInputFrameHeight,
+             kKeyFrameWidth, kKeyFrameHeight, kDownSampleRate,
+             runner->MutableInputs());
+  }
+
+  config.mutable_options()
+      ->MutableExtension(SceneCroppingCalculatorOptions::ext)
+      ->set_num_cropping_threads(2);
+  auto threaded_runner = absl::make_unique<CalculatorRunner>(config);
+  for (const char* tag : {"VIDEO_FRAMES", "KEY_FRAMES", "DETECTION_FEATURES",
+                          "STATIC_FEATURES", "SHOT_BOUNDARIES"}) {
+    threaded_runner->MutableInputs()->Tag(tag).packets =
+        runner->MutableInputs()->Tag(tag).packets;
+  }
+
+  const int num_frames = kNumScenes * kSceneSize;
+  MP_EXPECT_OK(runner->Run());
+  MP_EXPECT_OK(threaded_runner->Run());
+  CheckCroppedFrames(*threaded_runner, num_frames, kTargetWidth, kTargetHeight);
+  const auto& expected_frames = runner->Outputs().Tag("CROPPED_FRAMES").packets;
+  const auto& frames = threaded_runner->Outputs().Tag("CROPPED_FRAMES").packets;
+  ASSERT_EQ(expected_frames.size(), frames.size());
+  for (int i = 0; i < num_frames; ++i) {
+    EXPECT_EQ(expected_frames[i].Timestamp(), frames[i].Timestamp());
+    const auto expected =
+        formats::MatView(&expected_frames[i].Get<ImageFrame>());
+    const auto actual = formats::MatView(&frames[i].Get<ImageFrame>());
+    EXPECT_EQ(0, cv::norm(expected, actual, cv::NORM_INF));
+  }
+}
+
+// Checks that the calculator rejects a negative number of cropping threads.
+TEST(SceneCroppingCalculatorTest, ChecksNumCroppingThreads) {
+  CalculatorGraphConfig::Node config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+          kConfig, kTargetWidth, kTargetHeight, kTargetSizeType, kMaxSceneSize,
+          kPriorFrameBufferSize));
+  config.mutable_options()
+      ->MutableExtension(SceneCroppingCalculatorOptions::ext)
+      ->set_num_cropping_threads(-1);
+  auto runner = absl::make_unique<CalculatorRunner>(config);
+  const auto status = runner->Run();
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.ToString(),
+              HasSubstr("Number of cropping threads is negative."));
+}
+
 // Checks that the calculator can optionally output debug streams.
 TEST(SceneCroppingCalculatorTest, OutputsDebugStreams) {
   const CalculatorGraphConfig::Node config =
@@ -903,6 +1024,65 @@ TEST(SceneCroppingCalculatorTest, OutputsCropMessageKinematicPathNoVideo) {
     EXPECT_EQ(ext_render_message.render_to_location().height(), 1124);
   }
 }
+
+// Checks that the calculator crops to multiple aspect ratios in one run.
+TEST(SceneCroppingCalculatorTest, CropsToMultipleAspectRatios) {
+  const CalculatorGraphConfig::Node config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+          absl::Substitute(kMultiTargetConfig, kMaxSceneSize));
+  auto runner = absl::make_unique<CalculatorRunner>(config);
+  runner->MutableSidePackets()->Get("EXTERNAL_ASPECT_RATIO", 0) =
+      MakePacket<std::string>("9:16");
+  runner->MutableSidePackets()->Get("EXTERNAL_ASPECT_RATIO", 1) =
+      MakePacket<std::string>("1:1");
+  for (int i = 0; i < kNumScenes; ++i) {
+    AddScene(i * kSceneSize, kSceneSize, kInputFrameWidth, kInputFrameHeight,
+             kKeyFrameWidth, kKeyFrameHeight, kDownSampleRate,
+             runner->MutableInputs());
+  }
+  const int num_frames = kSceneSize * kNumScenes;
+  MP_ASSERT_OK(runner->Run());
+
+  // Largest even sizes of the aspect ratios that fit into the input frame.
+  const int target_widths[] = {404, 720};
+  const int target_heights[] = {720, 720};
+  const auto& outputs = runner->Outputs();
+  for (int t = 0; t < 2; ++t) {
+    const auto& cropped_frames = outputs.Get("CROPPED_FRAMES", t).packets;
+    const auto& render_messages =
+        outputs.Get("EXTERNAL_RENDERING_PER_FRAME", t).packets;
+    ASSERT_EQ(cropped_frames.size(), num_frames);
+    ASSERT_EQ(render_messages.size(), num_frames);
+    for (int i = 0; i < num_frames; ++i) {
+      const auto& cropped_frame = cropped_frames[i].Get<ImageFrame>();
+      EXPECT_EQ(cropped_frame.Width(), target_widths[t]);
+      EXPECT_EQ(cropped_frame.Height(), target_heights[t]);
+      const auto& message = render_messages[i].Get<ExternalRenderFrame>();
+      EXPECT_EQ(message.target_width(), target_widths[t]);
+      EXPECT_EQ(message.target_height(), target_heights[t]);
+      EXPECT_EQ(message.timestamp_us(), cropped_frames[i].Timestamp().Value());
+    }
+  }
+}
+
+// Checks that the calculator checks that each per target output tag has one
+// stream per target aspect ratio.
+TEST(SceneCroppingCalculatorTest, ChecksNumberOfTargetOutputs) {
+  CalculatorGraphConfig::Node config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+          absl::Substitute(kMultiTargetConfig, kMaxSceneSize));
+  config.add_output_stream(
+      "EXTERNAL_RENDERING_FULL_VID:external_rendering_full_vid");
+  auto runner = absl::make_unique<CalculatorRunner>(config);
+  runner->MutableSidePackets()->Get("EXTERNAL_ASPECT_RATIO", 0) =
+      MakePacket<std::string>("9:16");
+  runner->MutableSidePackets()->Get("EXTERNAL_ASPECT_RATIO", 1) =
+      MakePacket<std::string>("1:1");
+  const auto status = runner->Run();
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.ToString(),
+              HasSubstr("must have one output stream per target"));
+}
 }  // namespace
 }  // namespace autoflip
 }  // namespace mediapipe
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <deque>
 #include <map>
 #include <memory>
 #include <string>
@@ -35,19 +37,22 @@ constexpr char kVideoInputTag[] = "VIDEO";
 constexpr char kShotChangeTag[] = "IS_SHOT_CHANGE";
 // Histogram settings.
 const int kSaturationBins = 8;
-const int kHistogramChannels[] = {0, 1, 2};
-const int kHistogramBinNum[] = {kSaturationBins, kSaturationBins,
-                                kSaturationBins};
-const float kRange[] = {0, 256};
-const float* kHistogramRange[] = {kRange, kRange, kRange};
+// Maps 8 bit channel values to kSaturationBins bins (256 / 8 = 1 << 5).
+const int kBinShift = 5;
 
 namespace mediapipe {
 namespace autoflip {
 
 // This calculator computes a shot (or scene) change within a video.  It works
-// by computing a 3d color histogram and comparing this frame-to-frame. Settings
+// by computing a 2d color histogram and comparing this frame-to-frame. Settings
 // to control the shot change logic are presented in the options proto.
 //
+// For speed, the histogram can be computed on a subsampled pixel grid
+// (histogram_sample_step) and frames can be skipped (frame_skip). Skipped
+// frames are only processed one by one if the motion across them could
+// indicate a shot boundary, and their outputs are delayed until the next
+// non-skipped frame.
+//
 // Example:
 //  node {
 //    calculator: "ShotBoundaryCalculator"
@@ -63,12 +68,25 @@ class ShotBoundaryCalculator : public mediapipe::CalculatorBase {
   static absl::Status GetContract(mediapipe::CalculatorContract* cc);
   absl::Status Open(mediapipe::CalculatorContext* cc) override;
   absl::Status Process(mediapipe::CalculatorContext* cc) override;
+  absl::Status Close(mediapipe::CalculatorContext* cc) override;
 
  private:
   // Computes the histogram of an image.
   void ComputeHistogram(const cv::Mat& image, cv::Mat* image_histogram);
+  // Computes the histogram of a frame and processes it.
+  void ProcessFrame(const Packet& frame_packet,
+                    mediapipe::CalculatorContext* cc);
+  // Compares a histogram to the last one and processes the motion.
+  void ProcessHistogram(const cv::Mat& histogram, const Timestamp& timestamp,
+                        mediapipe::CalculatorContext* cc);
+  // Runs the shot detection on the motion of a frame.
+  void ProcessMotion(double motion, const Timestamp& timestamp,
+                     mediapipe::CalculatorContext* cc);
+  // Processes all skipped frames one by one.
+  void ProcessSkippedFrames(mediapipe::CalculatorContext* cc);
   // Transmits signal to next calculator.
-  void Transmit(mediapipe::CalculatorContext* cc, bool is_shot_change);
+  void Transmit(mediapipe::CalculatorContext* cc, const Timestamp& timestamp,
+                bool is_shot_change);
   // Calculator options.
   ShotBoundaryCalculatorOptions options_;
   // Last time a shot was detected.
@@ -79,23 +97,29 @@ class ShotBoundaryCalculator : public mediapipe::CalculatorBase {
   cv::Mat last_histogram_;
   // History of histogram motion.
   std::deque<double> motion_history_;
+  // Frames skipped since the last processed frame.
+  std::vector<Packet> skipped_frames_;
 };
 REGISTER_CALCULATOR(ShotBoundaryCalculator);
 
 void ShotBoundaryCalculator::ComputeHistogram(const cv::Mat& image,
                                               cv::Mat* image_histogram) {
-  cv::Mat equalized_image;
-  cv::cvtColor(image.clone(), equalized_image, cv::COLOR_RGB2GRAY);
-
-  double min, max;
-  cv::minMaxLoc(equalized_image, &min, &max);
-
-  if (options_.equalize_histogram()) {
-    cv::equalizeHist(equalized_image, equalized_image);
+  // 2d histogram of the first two channels with integer bins. For a sample
+  // step of 1 this is the same as cv::calcHist with uniform bins over
+  // [0, 256), without its floating point binning.
+  const int step = std::max(1, options_.histogram_sample_step());
+  const int pixel_step = step * image.channels();
+  int counts[kSaturationBins * kSaturationBins] = {0};
+  for (int r = 0; r < image.rows; r += step) {
+    const uint8* pixel = image.ptr<uint8>(r);
+    const uint8* row_end = pixel + image.cols * image.channels();
+    for (; pixel < row_end; pixel += pixel_step) {
+      ++counts[(pixel[0] >> kBinShift) * kSaturationBins +
+               (pixel[1] >> kBinShift)];
+    }
   }
-
-  cv::calcHist(&image, 1, kHistogramChannels, cv::Mat(), *image_histogram, 2,
-               kHistogramBinNum, kHistogramRange, true, false);
+  cv::Mat(kSaturationBins, kSaturationBins, CV_32S, counts)
+      .convertTo(*image_histogram, CV_32F);
 }
 
 absl::Status ShotBoundaryCalculator::Open(mediapipe::CalculatorContext* cc) {
@@ -106,51 +130,111 @@ absl::Status ShotBoundaryCalculator::Open(mediapipe::CalculatorContext* cc) {
 }
 
 void ShotBoundaryCalculator::Transmit(mediapipe::CalculatorContext* cc,
+                                      const Timestamp& timestamp,
                                       bool is_shot_change) {
-  if ((cc->InputTimestamp() - last_shot_timestamp_).Seconds() <
-      options_.min_shot_span()) {
+  if ((timestamp - last_shot_timestamp_).Seconds() < options_.min_shot_span()) {
     is_shot_change = false;
   }
   if (is_shot_change) {
-    LOG(INFO) << "Shot change at: " << cc->InputTimestamp().Seconds()
-              << " seconds.";
+    LOG(INFO) << "Shot change at: " << timestamp.Seconds() << " seconds.";
     cc->Outputs()
         .Tag(kShotChangeTag)
-        .AddPacket(Adopt(std::make_unique<bool>(true).release())
-                       .At(cc->InputTimestamp()));
+        .AddPacket(Adopt(std::make_unique<bool>(true).release()).At(timestamp));
   } else if (!options_.output_only_on_change()) {
     cc->Outputs()
         .Tag(kShotChangeTag)
-        .AddPacket(Adopt(std::make_unique<bool>(false).release())
-                       .At(cc->InputTimestamp()));
+        .AddPacket(
+            Adopt(std::make_unique<bool>(false).release()).At(timestamp));
   }
 }
 
 absl::Status ShotBoundaryCalculator::Process(mediapipe::CalculatorContext* cc) {
-  // Connect to input frame and make a mutable copy.
-  cv::Mat frame_org = mediapipe::formats::MatView(
-      &cc->Inputs().Tag(kVideoInputTag).Get<ImageFrame>());
-  cv::Mat frame = frame_org.clone();
+  const Packet& frame_packet = cc->Inputs().Tag(kVideoInputTag).Value();
+  if (!init_ || options_.frame_skip() <= 0) {
+    ProcessFrame(frame_packet, cc);
+    return absl::OkStatus();
+  }
+
+  // Keeps a reference to skipped frames, they are output once the next frame
+  // is processed.
+  if (skipped_frames_.size() < options_.frame_skip()) {
+    skipped_frames_.push_back(frame_packet);
+    return absl::OkStatus();
+  }
 
-  // Extract histogram from the current frame.
   cv::Mat current_histogram;
-  ComputeHistogram(frame, &current_histogram);
+  ComputeHistogram(formats::MatView(&frame_packet.Get<ImageFrame>()),
+                   &current_histogram);
+  const double interval_motion =
+      1 - cv::compareHist(current_histogram, last_histogram_, CV_COMP_CORREL);
+  const double min_shot_motion =
+      std::min(options_.min_motion(), options_.min_motion_with_shot_measure());
+  if (interval_motion > min_shot_motion) {
+    // The interval may contain a shot boundary, backtracks to process the
+    // skipped frames one by one.
+    ProcessSkippedFrames(cc);
+    ProcessHistogram(current_histogram, frame_packet.Timestamp(), cc);
+    return absl::OkStatus();
+  }
 
+  // The motion of the interval is below the shot boundary thresholds, the
+  // skipped frames are assigned the motion of the interval.
+  for (const auto& skipped_frame : skipped_frames_) {
+    ProcessMotion(interval_motion, skipped_frame.Timestamp(), cc);
+  }
+  skipped_frames_.clear();
+  last_histogram_ = current_histogram;
+  ProcessMotion(interval_motion, frame_packet.Timestamp(), cc);
+  return absl::OkStatus();
+}
+
+absl::Status ShotBoundaryCalculator::Close(mediapipe::CalculatorContext* cc) {
+  ProcessSkippedFrames(cc);
+  return absl::OkStatus();
+}
+
+void ShotBoundaryCalculator::ProcessSkippedFrames(
+    mediapipe::CalculatorContext* cc) {
+  for (const auto& skipped_frame : skipped_frames_) {
+    ProcessFrame(skipped_frame, cc);
+  }
+  skipped_frames_.clear();
+}
+
+void ShotBoundaryCalculator::ProcessFrame(const Packet& frame_packet,
+                                          mediapipe::CalculatorContext* cc) {
+  // Extract histogram from the frame.
+  cv::Mat histogram;
+  ComputeHistogram(formats::MatView(&frame_packet.Get<ImageFrame>()),
+                   &histogram);
+  ProcessHistogram(histogram, frame_packet.Timestamp(), cc);
+}
+
+void ShotBoundaryCalculator::ProcessHistogram(
+    const cv::Mat& histogram, const Timestamp& timestamp,
+    mediapipe::CalculatorContext* cc) {
   if (!init_) {
-    last_histogram_ = current_histogram;
+    last_histogram_ = histogram;
     init_ = true;
-    Transmit(cc, false);
-    return absl::OkStatus();
+    Transmit(cc, timestamp, false);
+    return;
   }
 
-  double current_motion_estimate =
-      1 - cv::compareHist(current_histogram, last_histogram_, CV_COMP_CORREL);
-  last_histogram_ = current_histogram;
+  const double current_motion_estimate =
+      1 - cv::compareHist(histogram, last_histogram_, CV_COMP_CORREL);
+  // Store histogram for next frame.
+  last_histogram_ = histogram;
+  ProcessMotion(current_motion_estimate, timestamp, cc);
+}
+
+void ShotBoundaryCalculator::ProcessMotion(double current_motion_estimate,
+                                           const Timestamp& timestamp,
+                                           mediapipe::CalculatorContext* cc) {
   motion_history_.push_front(current_motion_estimate);
 
   if (motion_history_.size() != options_.window_size()) {
-    Transmit(cc, false);
-    return absl::OkStatus();
+    Transmit(cc, timestamp, false);
+    return;
   }
 
   // Shot detection algorithm is a mixture of adaptive (controlled with
@@ -165,16 +249,13 @@ absl::Status ShotBoundaryCalculator::Process(mediapipe::CalculatorContext* cc) {
   if ((shot_measure > options_.min_shot_measure() &&
        current_motion_estimate > options_.min_motion_with_shot_measure()) ||
       current_motion_estimate > options_.min_motion()) {
-    Transmit(cc, true);
-    last_shot_timestamp_ = cc->InputTimestamp();
+    Transmit(cc, timestamp, true);
+    last_shot_timestamp_ = timestamp;
   } else {
-    Transmit(cc, false);
+    Transmit(cc, timestamp, false);
   }
 
-  // Store histogram for next frame.
-  last_histogram_ = current_histogram;
   motion_history_.pop_back();
-  return absl::OkStatus();
 }
 
 absl::Status ShotBoundaryCalculator::GetContract(
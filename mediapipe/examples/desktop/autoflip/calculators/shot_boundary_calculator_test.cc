@@ -20,6 +20,7 @@
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
@@ -159,6 +160,61 @@ TEST(ShotBoundaryCalculatorTest, ShotChangeSingleOnOnChange) {
   ASSERT_EQ(output_packets[0].Timestamp().Value(), 15000000);
 }
 
+// Runs the calculator on frames with a persistent shot change at frame 11 and
+// returns the output packets.
+std::vector<Packet> RunPersistentShotChange(const int histogram_sample_step,
+                                            const int frame_skip) {
+  CalculatorGraphConfig::Node node =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig);
+  auto* options = node.mutable_options()->MutableExtension(
+      ShotBoundaryCalculatorOptions::ext);
+  options->set_output_only_on_change(false);
+  options->set_histogram_sample_step(histogram_sample_step);
+  options->set_frame_skip(frame_skip);
+  auto runner = ::absl::make_unique<CalculatorRunner>(node);
+
+  AddFrames(20, {11, 12, 13, 14, 15, 16, 17, 18, 19}, runner.get());
+  MP_EXPECT_OK(runner->Run());
+  return runner->Outputs().Tag("IS_SHOT_CHANGE").packets;
+}
+
+TEST(ShotBoundaryCalculatorTest, ShotChangeWithSampleStep) {
+  CheckOutput(20, {11}, RunPersistentShotChange(4, 0));
+}
+
+TEST(ShotBoundaryCalculatorTest, ShotChangeWithFrameSkip) {
+  // Frame 11 is skipped, the change is found by backtracking from frame 12.
+  const auto output_packets = RunPersistentShotChange(1, 2);
+  CheckOutput(20, {11}, output_packets);
+  for (int i = 0; i < output_packets.size(); ++i) {
+    EXPECT_EQ(Timestamp(i * 1000000), output_packets[i].Timestamp());
+  }
+}
+
+TEST(ShotBoundaryCalculatorTest, FrameSkipFlushesOnClose) {
+  // The last frames are skipped and processed when the calculator closes.
+  CheckOutput(20, {11}, RunPersistentShotChange(1, 6));
+}
+
+// Benchmarks the calculator on the test image, with the histogram sample step
+// and the number of skipped frames as arguments.
+void BM_ShotBoundary(benchmark::State& state) {
+  CalculatorGraphConfig::Node node =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig);
+  auto* options = node.mutable_options()->MutableExtension(
+      ShotBoundaryCalculatorOptions::ext);
+  options->set_histogram_sample_step(state.range(0));
+  options->set_frame_skip(state.range(1));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto runner = ::absl::make_unique<CalculatorRunner>(node);
+    AddFrames(60, {30, 31, 32, 33, 34, 35}, runner.get());
+    state.ResumeTiming();
+    MP_ASSERT_OK(runner->Run());
+  }
+}
+BENCHMARK(BM_ShotBoundary)->Args({1, 0})->Args({4, 0})->Args({4, 3});
+
 }  // namespace
 }  // namespace autoflip
 }  // namespace mediapipe
@@ -14,6 +14,8 @@
 
 #include "mediapipe/examples/desktop/autoflip/quality/padding_effect_generator.h"
 
+#include <algorithm>
+
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
@@ -23,11 +25,12 @@
 namespace mediapipe {
 namespace autoflip {
 
-PaddingEffectGenerator::PaddingEffectGenerator(const int input_width,
-                                               const int input_height,
-                                               const double target_aspect_ratio,
-                                               bool scale_to_multiple_of_two) {
+PaddingEffectGenerator::PaddingEffectGenerator(
+    const int input_width, const int input_height,
+    const double target_aspect_ratio, bool scale_to_multiple_of_two,
+    int background_downscale_factor) {
   target_aspect_ratio_ = target_aspect_ratio;
+  background_downscale_factor_ = std::max(1, background_downscale_factor);
   const double input_aspect_ratio =
       static_cast<double>(input_width) / static_cast<double>(input_height);
   input_width_ = input_width;
@@ -53,9 +56,20 @@ absl::Status PaddingEffectGenerator::Process(
   RET_CHECK_EQ(input_frame.Height(), input_height_);
   RET_CHECK(output_frame);
 
+  // Reuses the output frame if it has the right size and format.
+  if (output_frame->IsEmpty() ||
+      output_frame->Format() != input_frame.Format() ||
+      output_frame->Width() != output_width_ ||
+      output_frame->Height() != output_height_) {
+    output_frame->Reset(input_frame.Format(), output_width_, output_height_,
+                        ImageFrame::kDefaultAlignmentBoundary);
+  }
+  cv::Mat output_image = formats::MatView(output_frame);
+
   cv::Mat original_image = formats::MatView(&input_frame);
-  // This is the canvas that we are going to draw the padding effect on to.
-  cv::Mat canvas(output_height_, output_width_, original_image.type());
+  // This is the canvas that we are going to draw the padding effect on to. For
+  // vertical padding, this is the output frame itself.
+  cv::Mat canvas = output_image;
 
   const int effective_input_width =
       is_vertical_padding_ ? input_width_ : input_height_;
@@ -67,8 +81,11 @@ absl::Status PaddingEffectGenerator::Process(
       is_vertical_padding_ ? output_height_ : output_width_;
 
   if (!is_vertical_padding_) {
-    original_image = original_image.t();
-    canvas = canvas.t();
+    cv::transpose(original_image, transposed_input_);
+    original_image = transposed_input_;
+    canvas_.create(effective_output_height, effective_output_width,
+                   original_image.type());
+    canvas = canvas_;
   }
 
   const int foreground_height =
@@ -82,6 +99,13 @@ absl::Status PaddingEffectGenerator::Process(
   //     the final frame, and then we blur it and adjust contrast and opacity.
   if (background_color_in_rgb != nullptr) {
     canvas = *background_color_in_rgb;
+  } else if (background_downscale_factor_ > 1) {
+    x = 0.5 * (effective_input_width - effective_output_width);
+    const cv::Rect crop_window_for_background(x, 0, effective_output_width,
+                                              effective_output_height);
+    DrawDownscaledBackground(original_image(crop_window_for_background),
+                             foreground_height, background_contrast,
+                             blur_cv_size, overlay_opacity, &canvas);
   } else {
     // Copy the original image to the background.
     x = 0.5 * (effective_input_width - effective_output_width);
@@ -96,9 +120,8 @@ absl::Status PaddingEffectGenerator::Process(
         blur_cv_size % 2 == 1 ? blur_cv_size : (blur_cv_size + 1);
     const cv::Size kernel(cv_size, cv_size);
     // TODO: the larger the kernel size, the slower the blurring
-    // operation is. Consider running multiple sequential blurs with smaller
-    // sizes to simulate the effect of using a large size. This might be able to
-    // speed up the process.
+    // operation is. Set background_downscale_factor to blur a downscaled
+    // background instead.
     x = 0;
     width = effective_output_width;
     const cv::Rect canvas_rect(0, 0, canvas.cols, canvas.rows);
@@ -127,11 +150,9 @@ absl::Status PaddingEffectGenerator::Process(
       canvas *= background_contrast;
     }
 
-    // Alpha blend a translucent black layer.
+    // Alpha blend a translucent black layer, which is a plain scaling.
     if (std::abs(overlay_opacity - 0.0f) > kEqualThreshold) {
-      cv::Mat overlay = cv::Mat::zeros(canvas.size(), canvas.type());
-      cv::addWeighted(overlay, overlay_opacity, canvas, 1 - overlay_opacity, 0,
-                      canvas);
+      canvas.convertTo(canvas, -1, 1 - overlay_opacity);
     }
   }
 
@@ -164,15 +185,57 @@ absl::Status PaddingEffectGenerator::Process(
   cv::resize(original_image(crop_window_for_foreground), dst, dst.size());
 
   if (!is_vertical_padding_) {
-    canvas = canvas.t();
+    cv::transpose(canvas, output_image);
   }
-
-  output_frame->CopyPixelData(input_frame.Format(), canvas.cols, canvas.rows,
-                              canvas.data,
-                              ImageFrame::kDefaultAlignmentBoundary);
   return absl::OkStatus();
 }
 
+void PaddingEffectGenerator::DrawDownscaledBackground(
+    const cv::Mat& background, const int foreground_height,
+    const float background_contrast, const int blur_cv_size,
+    const float overlay_opacity, cv::Mat* canvas) {
+  const int small_width =
+      std::max(1, background.cols / background_downscale_factor_);
+  const int small_height =
+      std::max(1, background.rows / background_downscale_factor_);
+  cv::resize(background, small_background_,
+             cv::Size(small_width, small_height), 0, 0, cv::INTER_AREA);
+
+  // The blur kernel is scaled with the background, and stays odd.
+  const int cv_size = blur_cv_size / background_downscale_factor_ / 2 * 2 + 1;
+  if (cv_size > 1) {
+    cv::GaussianBlur(small_background_, small_background_,
+                     cv::Size(cv_size, cv_size), 0, 0);
+  }
+
+  // Contrast adjustment and the translucent black layer are both a scaling,
+  // applied at once on the small background.
+  const float kEqualThreshold = 0.0001f;
+  const float gain = background_contrast * (1 - overlay_opacity);
+  if (std::abs(gain - 1.0f) > kEqualThreshold) {
+    small_background_.convertTo(small_background_, -1, gain);
+  }
+
+  // Upscales the background into the regions above and below the foreground
+  // only, mapping pixel centers of the canvas to the small background.
+  const double scale_x = static_cast<double>(canvas->cols) / small_width;
+  const double scale_y = static_cast<double>(canvas->rows) / small_height;
+  const int foreground_y = (canvas->rows - foreground_height) / 2;
+  const int foreground_bottom = foreground_y + foreground_height;
+  for (const cv::Rect& region :
+       {cv::Rect(0, 0, canvas->cols, foreground_y),
+        cv::Rect(0, foreground_bottom, canvas->cols,
+                 canvas->rows - foreground_bottom)}) {
+    if (region.area() <= 0) continue;
+    const cv::Matx23d transform(scale_x, 0, 0.5 * scale_x - 0.5, 0, scale_y,
+                                0.5 * scale_y - 0.5 - region.y);
+    cv::Mat destination = (*canvas)(region);
+    cv::warpAffine(small_background_, destination, transform,
+                   destination.size(), cv::INTER_LINEAR,
+                   cv::BORDER_REPLICATE);
+  }
+}
+
 cv::Rect PaddingEffectGenerator::ComputeOutputLocation() {
   const int effective_input_width =
       is_vertical_padding_ ? input_width_ : input_height_;
@@ -30,15 +30,27 @@ namespace autoflip {
 // ScaleImageCalculator as an upstream node before calling this calculator in
 // your MediaPipe graph (not as a downstream node, because visual details may
 // lose after appling the padding effect).
+//
+// Intermediate buffers are kept across calls to Process(), so processing a
+// sequence of frames of the same size does not allocate per frame. A generator
+// must therefore not be used from multiple threads at the same time.
 class PaddingEffectGenerator {
  public:
   // Always outputs width and height that are divisible by 2 if
   // scale_to_multiple_of_two is set to true.
+  //
+  // If background_downscale_factor is larger than 1, the blurred background is
+  // computed on a copy of the input downscaled by this factor (with the blur
+  // kernel scaled accordingly) and upscaled into the padded regions only. This
+  // is much faster for large frames and blur kernels, and visually nearly
+  // identical since the background is heavily blurred anyway.
   PaddingEffectGenerator(const int input_width, const int input_height,
                          const double target_aspect_ratio,
-                         bool scale_to_multiple_of_two = false);
+                         bool scale_to_multiple_of_two = false,
+                         int background_downscale_factor = 1);
 
-  // Apply the padding effect on the input frame.
+  // Apply the padding effect on the input frame. If output_frame already has
+  // the output size and the input format, its pixel data is reused.
   // - blur_cv_size: The cv::Size() parameter used in creating blurry effects
   //   for padding backgrounds.
   // - background_contrast: Contrast adjustment for padding background. This
@@ -65,6 +77,22 @@ class PaddingEffectGenerator {
   int output_width_ = -1;
   int output_height_ = -1;
   bool is_vertical_padding_;
+  int background_downscale_factor_ = 1;
+
+  // Draws the blurred, contrast adjusted and darkened background above and
+  // below the foreground of height |foreground_height| on |canvas|, using a
+  // copy of |background| downscaled by background_downscale_factor_.
+  void DrawDownscaledBackground(const cv::Mat& background,
+                                int foreground_height,
+                                float background_contrast, int blur_cv_size,
+                                float overlay_opacity, cv::Mat* canvas);
+
+  // Buffers reused across frames. The canvas and input are only used for
+  // horizontal padding, where both are transposed, such that padding is
+  // always added above and below the foreground.
+  cv::Mat canvas_;
+  cv::Mat transposed_input_;
+  cv::Mat small_background_;
 };
 
 }  // namespace autoflip
@@ -19,6 +19,7 @@
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
@@ -195,6 +196,108 @@ TEST(PaddingEffectGeneratorTest, ComputeOutputLocation) {
   EXPECT_EQ(result_rect.width, 1080);
   EXPECT_EQ(result_rect.height, 607);
 }
+
+// Returns a frame with a smooth gradient and some noise.
+std::unique_ptr<ImageFrame> MakeGradientFrame(int width, int height) {
+  auto frame =
+      absl::make_unique<ImageFrame>(ImageFormat::SRGB, width, height);
+  cv::Mat mat = formats::MatView(frame.get());
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      mat.at<cv::Vec3b>(y, x) =
+          cv::Vec3b(255 * x / width, 255 * y / height, 128);
+    }
+  }
+  cv::Mat noise(mat.size(), mat.type());
+  cv::RNG(0).fill(noise, cv::RNG::UNIFORM, 0, 16);
+  mat += noise;
+  return frame;
+}
+
+void CheckDownscaledBackground(int width, int height, double aspect_ratio) {
+  const auto frame = MakeGradientFrame(width, height);
+  PaddingEffectGenerator generator(width, height, aspect_ratio);
+  PaddingEffectGenerator fast_generator(width, height, aspect_ratio,
+                                        /*scale_to_multiple_of_two=*/false,
+                                        /*background_downscale_factor=*/4);
+  ImageFrame expected_frame, result_frame;
+  MP_ASSERT_OK(generator.Process(*frame, 0.6, 40, 0.3, &expected_frame));
+  MP_ASSERT_OK(
+      fast_generator.Process(*frame, 0.6, 40, 0.3, &result_frame));
+  ASSERT_EQ(result_frame.Width(), expected_frame.Width());
+  ASSERT_EQ(result_frame.Height(), expected_frame.Height());
+
+  // The foreground is identical, the blurred background is close.
+  const cv::Mat expected = formats::MatView(&expected_frame);
+  const cv::Mat result = formats::MatView(&result_frame);
+  const cv::Rect foreground = generator.ComputeOutputLocation();
+  EXPECT_EQ(0, cv::norm(expected(foreground), result(foreground),
+                        cv::NORM_INF));
+  cv::Mat difference;
+  cv::absdiff(expected, result, difference);
+  const cv::Scalar mean_difference = cv::mean(difference);
+  for (int c = 0; c < 3; ++c) {
+    EXPECT_LT(mean_difference[c], 4.0);
+  }
+}
+
+TEST(PaddingEffectGeneratorTest, DownscaledBackgroundVerticalPadding) {
+  CheckDownscaledBackground(320, 180, 0.6);
+}
+
+TEST(PaddingEffectGeneratorTest, DownscaledBackgroundHorizontalPadding) {
+  CheckDownscaledBackground(180, 320, 1.6);
+}
+
+TEST(PaddingEffectGeneratorTest, ReusesOutputFrame) {
+  const auto first_frame = MakeGradientFrame(320, 180);
+  auto second_frame = MakeGradientFrame(320, 180);
+  cv::Mat second_mat = formats::MatView(second_frame.get());
+  second_mat = cv::Scalar(255, 255, 255) - second_mat;
+  for (const double aspect_ratio : {0.6, 2.5}) {
+    for (const int downscale_factor : {1, 4}) {
+      PaddingEffectGenerator generator(320, 180, aspect_ratio,
+                                       /*scale_to_multiple_of_two=*/false,
+                                       downscale_factor);
+      PaddingEffectGenerator fresh_generator(
+          320, 180, aspect_ratio, /*scale_to_multiple_of_two=*/false,
+          downscale_factor);
+      ImageFrame result_frame, expected_frame;
+      MP_ASSERT_OK(
+          generator.Process(*first_frame, 0.6, 40, 0.3, &result_frame));
+      const uint8* pixel_data = result_frame.PixelData();
+      MP_ASSERT_OK(
+          generator.Process(*second_frame, 0.6, 40, 0.3, &result_frame));
+      EXPECT_EQ(pixel_data, result_frame.PixelData());
+      MP_ASSERT_OK(fresh_generator.Process(*second_frame, 0.6, 40, 0.3,
+                                           &expected_frame));
+      EXPECT_EQ(0, cv::norm(formats::MatView(&expected_frame),
+                            formats::MatView(&result_frame), cv::NORM_INF));
+    }
+  }
+}
+
+// Measures the per frame latency of padding a 16:9 frame to 9:16, with the
+// default blur size of the SceneCroppingCalculator.
+// Args: input width, input height, background downscale factor.
+void BM_PaddingEffect(benchmark::State& state) {
+  const int width = state.range(0);
+  const int height = state.range(1);
+  const auto frame = MakeGradientFrame(width, height);
+  PaddingEffectGenerator generator(width, height, 9.0 / 16.0,
+                                   /*scale_to_multiple_of_two=*/false,
+                                   state.range(2));
+  ImageFrame result_frame;
+  for (auto _ : state) {
+    MP_ASSERT_OK(generator.Process(*frame, 1.0, 200, 0.6, &result_frame));
+  }
+}
+BENCHMARK(BM_PaddingEffect)
+    ->Args({1920, 1080, 1})
+    ->Args({1920, 1080, 4})
+    ->Args({3840, 2160, 1})
+    ->Args({3840, 2160, 8});
+
 }  // namespace
 }  // namespace autoflip
 }  // namespace mediapipe
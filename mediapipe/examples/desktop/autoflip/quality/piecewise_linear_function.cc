@@ -52,8 +52,32 @@ double PiecewiseLinearFunction::Interpolate(
 }
 
 double PiecewiseLinearFunction::Evaluate(double const input) const {
+  return EvaluateInterval(GetIntervalIterator(input), input);
+}
+
+void PiecewiseLinearFunction::Evaluate(const std::vector<double>& inputs,
+                                       std::vector<double>* outputs) const {
+  outputs->resize(inputs.size());
   std::vector<PiecewiseLinearFunction::Point>::const_iterator i =
-      GetIntervalIterator(input);
+      points_.begin();
+  for (size_t j = 0; j < inputs.size(); ++j) {
+    const double input = inputs[j];
+    if (j == 0 || input < inputs[j - 1]) {
+      i = GetIntervalIterator(input);
+    } else {
+      // All points before the interval of the previous input are smaller than
+      // this input, so its interval is found by walking forward from there.
+      while (i != points_.end() && i->x < input) {
+        ++i;
+      }
+    }
+    (*outputs)[j] = EvaluateInterval(i, input);
+  }
+}
+
+double PiecewiseLinearFunction::EvaluateInterval(
+    std::vector<PiecewiseLinearFunction::Point>::const_iterator i,
+    double input) const {
   if (i == points_.begin()) {
     return points_.front().y;
   }
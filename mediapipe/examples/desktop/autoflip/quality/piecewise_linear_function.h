@@ -35,6 +35,13 @@ class PiecewiseLinearFunction {
   // f(x) = (x-xj)/(xk-xj)*(yk-yj) + yk for xj < x <= xk and k = j+1
   double Evaluate(double input) const;
 
+  // Evaluates the function at each of the inputs into outputs. Same results as
+  // calling Evaluate on each input, but runs of non-decreasing inputs (e.g.
+  // frame timestamps) are evaluated in a single pass over the points instead
+  // of searching the points for every input.
+  void Evaluate(const std::vector<double>& inputs,
+                std::vector<double>* outputs) const;
+
   // Adds the given point to the function.  Points must be added in
   // non-decreasing x order.  Because the points are given in sorted
   // order, this function can be used to construct discontinuous
@@ -74,6 +81,11 @@ class PiecewiseLinearFunction {
   // returns the linear interpolation of the y value.
   double Interpolate(const Point& p1, const Point& p2, double input) const;
 
+  // Evaluates the function at the input given its interval iterator, as
+  // returned by GetIntervalIterator(input).
+  double EvaluateInterval(std::vector<Point>::const_iterator i,
+                          double input) const;
+
   std::vector<Point> points_;
 };
 
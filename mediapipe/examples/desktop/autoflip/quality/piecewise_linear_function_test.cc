@@ -17,7 +17,9 @@
 #include <stddef.h>
 
 #include <memory>
+#include <vector>
 
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/status.h"
 
@@ -70,4 +72,55 @@ TEST(PiecewiseLinearFunctionTest, AddPointsDiscontinuous) {
   EXPECT_DOUBLE_EQ(1.0, function.Evaluate(3.14));
 }
 
+TEST(PiecewiseLinearFunctionTest, EvaluatesBatch) {
+  PiecewiseLinearFunction function;
+  function.AddPoint(-1.0, 0.0);
+  function.AddPoint(0.0, 0.0);
+  function.AddPoint(0.0, 1.0);
+  function.AddPoint(1.0, 3.0);
+  function.AddPoint(4.0, -2.0);
+  // Sorted inputs, with repeated values, followed by unsorted inputs.
+  const std::vector<double> inputs = {-2.0, -1.0, -0.5, 0.0, 0.0, 1e-12,
+                                      0.5,  1.0,  2.5,  2.5, 5.0, 0.25,
+                                      3.0,  -3.0, 0.0,  4.0};
+  std::vector<double> outputs;
+  function.Evaluate(inputs, &outputs);
+  ASSERT_EQ(inputs.size(), outputs.size());
+  for (int i = 0; i < inputs.size(); ++i) {
+    EXPECT_EQ(function.Evaluate(inputs[i]), outputs[i]) << inputs[i];
+  }
+}
+
+// Measures evaluating a function at 1000 increasing inputs, one by one or in a
+// batch.
+// Args: number of points of the function, whether to evaluate in a batch.
+void BM_Evaluate(benchmark::State& state) {
+  const int num_points = state.range(0);
+  PiecewiseLinearFunction function;
+  for (int i = 0; i < num_points; ++i) {
+    function.AddPoint(i, i % 7);
+  }
+  std::vector<double> inputs(1000);
+  for (int i = 0; i < inputs.size(); ++i) {
+    inputs[i] = static_cast<double>(i) * num_points / inputs.size();
+  }
+  std::vector<double> outputs(inputs.size());
+  for (auto _ : state) {
+    if (state.range(1)) {
+      function.Evaluate(inputs, &outputs);
+    } else {
+      for (int i = 0; i < inputs.size(); ++i) {
+        outputs[i] = function.Evaluate(inputs[i]);
+      }
+    }
+    benchmark::DoNotOptimize(outputs.data());
+  }
+  state.SetItemsProcessed(state.iterations() * inputs.size());
+}
+BENCHMARK(BM_Evaluate)
+    ->Args({8, 0})
+    ->Args({8, 1})
+    ->Args({256, 0})
+    ->Args({256, 1});
+
 }  // namespace
@@ -408,15 +408,23 @@ absl::Status SceneCameraMotionAnalyzer::PopulateFocusPointFramesForTracking(
     score_function.AddPoint(relative_timestamp, score);
   }
 
+  // Scene frame timestamps are increasing, evaluates the functions in batch.
+  std::vector<double> relative_timestamps(num_scene_frames);
+  for (int i = 0; i < num_scene_frames; ++i) {
+    relative_timestamps[i] =
+        static_cast<double>(scene_frame_timestamps[i] - timestamp_offset);
+  }
+  std::vector<double> center_xs, center_ys, scores;
+  center_x_function.Evaluate(relative_timestamps, &center_xs);
+  center_y_function.Evaluate(relative_timestamps, &center_ys);
+  score_function.Evaluate(relative_timestamps, &scores);
+
   double max_score = 0.0;
   const double min_score = 1e-4;  // prevent constraints with 0 weight
   for (int i = 0; i < num_scene_frames; ++i) {
-    const double relative_timestamp =
-        static_cast<double>(scene_frame_timestamps[i] - timestamp_offset);
-    const double center_x = center_x_function.Evaluate(relative_timestamp);
-    const double center_y = center_y_function.Evaluate(relative_timestamp);
-    const double score =
-        std::max(min_score, score_function.Evaluate(relative_timestamp));
+    const double center_x = center_xs[i];
+    const double center_y = center_ys[i];
+    const double score = std::max(min_score, scores[i]);
     max_score = std::max(max_score, score);
     FocusPointFrame focus_point_frame;
     MP_RETURN_IF_ERROR(AddFocusPointsFromCenterTypeAndWeight(
@@ -56,10 +56,22 @@ class SceneCropper {
 
   // Computes transformation matrix given SceneKeyFrameCropSummary,
   // FocusPointFrames, and any prior FocusPointFrames (to ensure smoothness when
-  // there was no actual scene change). Optionally crops the input frames based
+  // there was no actual scene change). Outputs one 2x3 affine transform per
+  // scene frame, mapping the scene frame to the crop window, and the
+  // corresponding "crop from" location on the input frame.
+  absl::Status ComputeCropTransforms(
+      const SceneKeyFrameCropSummary& scene_summary,
+      const std::vector<int64>& scene_timestamps,
+      const std::vector<bool>& is_key_frames,
+      const std::vector<FocusPointFrame>& focus_point_frames,
+      const std::vector<FocusPointFrame>& prior_focus_point_frames,
+      int top_static_border_size, const bool continue_last_scene,
+      std::vector<cv::Mat>* scene_frame_xforms,
+      std::vector<cv::Rect>* crop_from_location);
+
+  // Same as ComputeCropTransforms. Optionally crops the input frames based
   // on the transform matrix if |cropped_frames| is not nullptr and
   // |scene_frames_or_empty| isn't empty.
-  // TODO: split this function into two separate functions.
   absl::Status CropFrames(
       const SceneKeyFrameCropSummary& scene_summary,
       const std::vector<int64>& scene_timestamps,
@@ -0,0 +1,210 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/quality/scene_frame_buffer.h"
+
+#include <cstdlib>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+// Favors speed over size, spilled frames are short lived.
+constexpr int kPngCompressionLevel = 1;
+
+bool SeekTo(std::FILE* file, uint64 offset) {
+#if defined(_WIN32)
+  return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+  return fseeko(file, offset, SEEK_SET) == 0;
+#endif
+}
+
+}  // namespace
+
+SceneFrameBuffer::SceneFrameBuffer(const Options& options)
+    : options_(options) {}
+
+SceneFrameBuffer::~SceneFrameBuffer() { Clear(); }
+
+absl::Status SceneFrameBuffer::Add(const cv::Mat& frame) {
+  RET_CHECK(!frame.empty()) << "Frame is empty.";
+  if (options_.max_frames_in_memory <= 0 ||
+      (spilled_frames_.empty() &&
+       frames_.size() < options_.max_frames_in_memory)) {
+    cv::Mat copy;
+    frame.copyTo(copy);
+    frames_.push_back(copy);
+    return absl::OkStatus();
+  }
+  return Spill(frame);
+}
+
+absl::Status SceneFrameBuffer::Get(int index, cv::Mat* frame) {
+  RET_CHECK(frame) << "Output frame is null.";
+  RET_CHECK(index >= 0 && index < size())
+      << "Frame index " << index << " out of range [0, " << size() << ").";
+  if (index < frames_.size()) {
+    *frame = frames_[index];
+    return absl::OkStatus();
+  }
+
+  const SpilledFrame& spilled = spilled_frames_[index - frames_.size()];
+#if !defined(_WIN32)
+  MP_RETURN_IF_ERROR(MapScratchFile());
+  uchar* data = static_cast<uchar*>(mapped_data_) + spilled.offset;
+  if (options_.compress_spilled_frames) {
+    *frame = cv::imdecode(cv::Mat(1, spilled.num_bytes, CV_8U, data),
+                          cv::IMREAD_UNCHANGED);
+  } else {
+    *frame = cv::Mat(spilled.rows, spilled.cols, spilled.type, data);
+  }
+#else
+  RET_CHECK(fflush(scratch_file_) == 0 &&
+            SeekTo(scratch_file_, spilled.offset))
+      << "Could not seek in scratch file.";
+  if (options_.compress_spilled_frames) {
+    read_buffer_.resize(spilled.num_bytes);
+    RET_CHECK_EQ(
+        fread(read_buffer_.data(), 1, spilled.num_bytes, scratch_file_),
+        spilled.num_bytes)
+        << "Could not read from scratch file.";
+    *frame = cv::imdecode(read_buffer_, cv::IMREAD_UNCHANGED);
+  } else {
+    frame->create(spilled.rows, spilled.cols, spilled.type);
+    RET_CHECK_EQ(fread(frame->data, 1, spilled.num_bytes, scratch_file_),
+                 spilled.num_bytes)
+        << "Could not read from scratch file.";
+  }
+#endif
+  RET_CHECK(!frame->empty() && frame->rows == spilled.rows &&
+            frame->cols == spilled.cols && frame->type() == spilled.type)
+      << "Could not restore spilled frame " << index << ".";
+  return absl::OkStatus();
+}
+
+void SceneFrameBuffer::Clear() {
+  frames_.clear();
+  spilled_frames_.clear();
+  UnmapScratchFile();
+  // Scratch file is anonymous, closing it releases its disk space.
+  if (scratch_file_ != nullptr) {
+    fclose(scratch_file_);
+    scratch_file_ = nullptr;
+  }
+  scratch_size_ = 0;
+  read_buffer_.clear();
+}
+
+absl::Status SceneFrameBuffer::OpenScratchFile() {
+#if !defined(_WIN32)
+  std::string directory = options_.scratch_directory;
+  if (directory.empty()) {
+    const char* tmp_dir = getenv("TMPDIR");
+    directory = tmp_dir != nullptr ? tmp_dir : "/tmp";
+  }
+  std::string path = absl::StrCat(directory, "/scene_frame_buffer_XXXXXX");
+  const int fd = mkstemp(&path[0]);
+  RET_CHECK_GE(fd, 0) << "Could not create scratch file in " << directory;
+  // Unlink right away, file is removed once closed (even on crash).
+  unlink(path.c_str());
+  scratch_file_ = fdopen(fd, "w+b");
+  if (scratch_file_ == nullptr) {
+    close(fd);
+  }
+#else
+  scratch_file_ = std::tmpfile();
+#endif
+  RET_CHECK(scratch_file_ != nullptr) << "Could not open scratch file.";
+  scratch_size_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status SceneFrameBuffer::Spill(const cv::Mat& frame) {
+  if (scratch_file_ == nullptr) {
+    MP_RETURN_IF_ERROR(OpenScratchFile());
+  }
+  RET_CHECK(SeekTo(scratch_file_, scratch_size_))
+      << "Could not seek in scratch file.";
+
+  SpilledFrame spilled;
+  spilled.offset = scratch_size_;
+  spilled.rows = frame.rows;
+  spilled.cols = frame.cols;
+  spilled.type = frame.type();
+
+  if (options_.compress_spilled_frames) {
+    std::vector<uchar> encoded;
+    RET_CHECK(cv::imencode(".png", frame, encoded,
+                           {cv::IMWRITE_PNG_COMPRESSION, kPngCompressionLevel}))
+        << "Could not encode frame.";
+    RET_CHECK_EQ(fwrite(encoded.data(), 1, encoded.size(), scratch_file_),
+                 encoded.size())
+        << "Could not write to scratch file.";
+    spilled.num_bytes = encoded.size();
+  } else {
+    const size_t row_bytes = frame.cols * frame.elemSize();
+    for (int r = 0; r < frame.rows; ++r) {
+      RET_CHECK_EQ(fwrite(frame.ptr(r), 1, row_bytes, scratch_file_),
+                   row_bytes)
+          << "Could not write to scratch file.";
+    }
+    spilled.num_bytes = row_bytes * frame.rows;
+  }
+
+  scratch_size_ += spilled.num_bytes;
+  spilled_frames_.push_back(spilled);
+  return absl::OkStatus();
+}
+
+absl::Status SceneFrameBuffer::MapScratchFile() {
+#if !defined(_WIN32)
+  if (mapped_data_ != nullptr && mapped_size_ == scratch_size_) {
+    return absl::OkStatus();
+  }
+  UnmapScratchFile();
+  RET_CHECK(scratch_file_ != nullptr && fflush(scratch_file_) == 0)
+      << "Could not flush scratch file.";
+  // Private writable mapping, such that frames can be handed out as regular
+  // (non-const) cv::Mat's without modifying the scratch file.
+  void* mapped = mmap(nullptr, scratch_size_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, fileno(scratch_file_), 0);
+  RET_CHECK(mapped != MAP_FAILED) << "Could not memory map scratch file.";
+  mapped_data_ = mapped;
+  mapped_size_ = scratch_size_;
+#endif
+  return absl::OkStatus();
+}
+
+void SceneFrameBuffer::UnmapScratchFile() {
+#if !defined(_WIN32)
+  if (mapped_data_ != nullptr) {
+    munmap(mapped_data_, mapped_size_);
+  }
+#endif
+  mapped_data_ = nullptr;
+  mapped_size_ = 0;
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
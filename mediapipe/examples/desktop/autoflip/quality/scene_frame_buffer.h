@@ -0,0 +1,116 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_QUALITY_SCENE_FRAME_BUFFER_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_QUALITY_SCENE_FRAME_BUFFER_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Buffers the frames of a scene with bounded memory usage. The first
+// |max_frames_in_memory| frames are held in memory, any further frames are
+// spilled (raw or PNG compressed) to an anonymous scratch file, which is
+// memory mapped when the frames are read back. Frames are expected to be read
+// back after the scene has been fully buffered, e.g. when the cropped frames
+// of the scene are output.
+//
+// Example usage:
+//   SceneFrameBuffer::Options options;
+//   options.max_frames_in_memory = 30;
+//   SceneFrameBuffer buffer(options);
+//   MP_RETURN_IF_ERROR(buffer.Add(frame));  // For each frame of the scene.
+//   ...
+//   for (int i = 0; i < buffer.size(); ++i) {
+//     cv::Mat frame;
+//     MP_RETURN_IF_ERROR(buffer.Get(i, &frame));
+//     ...
+//   }
+//   buffer.Clear();
+class SceneFrameBuffer {
+ public:
+  struct Options {
+    // Maximum number of frames held in memory. Non-positive values hold all
+    // frames in memory, i.e. disable spilling.
+    int max_frames_in_memory = 0;
+    // Directory of the scratch file. Defaults to $TMPDIR or /tmp.
+    std::string scratch_directory;
+    // If set, spilled frames are PNG compressed, which trades cpu time for
+    // disk space and bandwidth.
+    bool compress_spilled_frames = false;
+  };
+
+  explicit SceneFrameBuffer(const Options& options);
+  ~SceneFrameBuffer();
+  SceneFrameBuffer(const SceneFrameBuffer&) = delete;
+  SceneFrameBuffer& operator=(const SceneFrameBuffer&) = delete;
+
+  // Adds a deep copy of |frame| to the buffer.
+  absl::Status Add(const cv::Mat& frame);
+
+  // Returns the |index|'th frame. Spilled frames that are not compressed are
+  // returned without copy as a read-only view into the mapped scratch file
+  // (writes to it are not persisted), which is valid until the next call to
+  // Add() or Clear().
+  absl::Status Get(int index, cv::Mat* frame);
+
+  // Removes all frames and releases the disk space of the scratch file.
+  void Clear();
+
+  int size() const { return frames_.size() + spilled_frames_.size(); }
+  bool empty() const { return size() == 0; }
+  int num_spilled_frames() const { return spilled_frames_.size(); }
+
+ private:
+  // Location and format of a frame in the scratch file.
+  struct SpilledFrame {
+    uint64 offset = 0;
+    uint64 num_bytes = 0;
+    int rows = 0;
+    int cols = 0;
+    int type = 0;
+  };
+
+  absl::Status OpenScratchFile();
+  absl::Status Spill(const cv::Mat& frame);
+  // Maps the scratch file, if it grew since the last call.
+  absl::Status MapScratchFile();
+  void UnmapScratchFile();
+
+  const Options options_;
+
+  std::vector<cv::Mat> frames_;
+  std::vector<SpilledFrame> spilled_frames_;
+
+  std::FILE* scratch_file_ = nullptr;
+  // Number of bytes written to the scratch file.
+  uint64 scratch_size_ = 0;
+
+  void* mapped_data_ = nullptr;
+  uint64 mapped_size_ = 0;
+  // Used on platforms without mmap.
+  std::vector<uchar> read_buffer_;
+};
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_QUALITY_SCENE_FRAME_BUFFER_H_
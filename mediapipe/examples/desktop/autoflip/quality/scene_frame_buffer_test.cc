@@ -0,0 +1,113 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/quality/scene_frame_buffer.h"
+
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const int kFrameWidth = 64;
+const int kFrameHeight = 36;
+const int kNumFrames = 10;
+
+// Returns frames with random content, such that frames can be told apart.
+std::vector<cv::Mat> GetFrames() {
+  cv::RNG rng(0);
+  std::vector<cv::Mat> frames(kNumFrames);
+  for (auto& frame : frames) {
+    frame = cv::Mat(kFrameHeight, kFrameWidth, CV_8UC3);
+    rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+  }
+  return frames;
+}
+
+void ExpectEqualFrames(const cv::Mat& expected, const cv::Mat& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  ASSERT_EQ(expected.type(), actual.type());
+  EXPECT_EQ(0, cv::norm(expected, actual, cv::NORM_INF));
+}
+
+void CheckRoundTrip(const SceneFrameBuffer::Options& options,
+                    int expected_num_spilled) {
+  SceneFrameBuffer buffer(options);
+  const auto frames = GetFrames();
+  // Buffer is reused across scenes.
+  for (int scene = 0; scene < 2; ++scene) {
+    for (const auto& frame : frames) {
+      MP_ASSERT_OK(buffer.Add(frame));
+    }
+    EXPECT_EQ(kNumFrames, buffer.size());
+    EXPECT_EQ(expected_num_spilled, buffer.num_spilled_frames());
+    for (int i = 0; i < kNumFrames; ++i) {
+      cv::Mat frame;
+      MP_ASSERT_OK(buffer.Get(i, &frame));
+      ExpectEqualFrames(frames[i], frame);
+    }
+    buffer.Clear();
+    EXPECT_TRUE(buffer.empty());
+  }
+}
+
+TEST(SceneFrameBufferTest, KeepsAllFramesInMemoryByDefault) {
+  CheckRoundTrip(SceneFrameBuffer::Options(), 0);
+}
+
+TEST(SceneFrameBufferTest, SpillsRawFrames) {
+  SceneFrameBuffer::Options options;
+  options.max_frames_in_memory = 3;
+  CheckRoundTrip(options, kNumFrames - 3);
+}
+
+TEST(SceneFrameBufferTest, SpillsCompressedFrames) {
+  SceneFrameBuffer::Options options;
+  options.max_frames_in_memory = 3;
+  options.compress_spilled_frames = true;
+  CheckRoundTrip(options, kNumFrames - 3);
+}
+
+TEST(SceneFrameBufferTest, SpillsFrameViews) {
+  SceneFrameBuffer::Options options;
+  options.max_frames_in_memory = 1;
+  SceneFrameBuffer buffer(options);
+  const auto frames = GetFrames();
+  // Non-continuous region of interest.
+  const cv::Rect roi(2, 3, kFrameWidth / 2, kFrameHeight / 2);
+  for (const auto& frame : frames) {
+    MP_ASSERT_OK(buffer.Add(frame(roi)));
+  }
+  for (int i = 0; i < kNumFrames; ++i) {
+    cv::Mat frame;
+    MP_ASSERT_OK(buffer.Get(i, &frame));
+    ExpectEqualFrames(frames[i](roi), frame);
+  }
+}
+
+TEST(SceneFrameBufferTest, ChecksIndex) {
+  SceneFrameBuffer buffer(SceneFrameBuffer::Options());
+  MP_ASSERT_OK(buffer.Add(GetFrames()[0]));
+  cv::Mat frame;
+  EXPECT_FALSE(buffer.Get(1, &frame).ok());
+  EXPECT_FALSE(buffer.Get(-1, &frame).ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -34,6 +34,15 @@ namespace mediapipe {
 namespace autoflip {
 namespace {
 
+// Number of histogram bins for computing colorfulness.
+constexpr int kHueBins = 10;
+constexpr int kSaturationBins = 8;
+
+// Regions are scored from the statistics of their bounding box unless it is
+// this much larger than the regions combined, e.g. for a few small regions
+// far apart, in which case each region is scored from its own statistics.
+constexpr int kMaxBoundingBoxAreaRatio = 2;
+
 // Crop the given rectangle so that it fits in the given 2D matrix.
 void CropRectToMat(const cv::Mat& image, cv::Rect* rect) {
   int x = std::min(std::max(rect->x, 0), image.cols);
@@ -43,6 +52,27 @@ void CropRectToMat(const cv::Mat& image, cv::Rect* rect) {
   *rect = cv::Rect(x, y, w, h);
 }
 
+// Computes the rectangle of the region, cropped to fit in the image.
+absl::Status GetRegionRect(const cv::Mat& image, const SalientRegion& region,
+                           cv::Rect* region_rect) {
+  if (region.has_location()) {
+    *region_rect =
+        cv::Rect(region.location().x(), region.location().y(),
+                 region.location().width(), region.location().height());
+  } else if (region.has_location_normalized()) {
+    *region_rect =
+        cv::Rect(region.location_normalized().x() * image.cols,
+                 region.location_normalized().y() * image.rows,
+                 region.location_normalized().width() * image.cols,
+                 region.location_normalized().height() * image.rows);
+  } else {
+    return mediapipe::UnknownErrorBuilder(MEDIAPIPE_LOC)
+           << "Unset region location.";
+  }
+  CropRectToMat(image, region_rect);
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 VisualScorer::VisualScorer(const VisualScorerOptions& options)
@@ -51,41 +81,117 @@ VisualScorer::VisualScorer(const VisualScorerOptions& options)
 absl::Status VisualScorer::CalculateScore(const cv::Mat& image,
                                           const SalientRegion& region,
                                           float* score) const {
-  const float weight_sum = options_.area_weight() +
-                           options_.sharpness_weight() +
-                           options_.colorfulness_weight();
-
   // Crop the region to fit in the image.
   cv::Rect region_rect;
-  if (region.has_location()) {
-    region_rect =
-        cv::Rect(region.location().x(), region.location().y(),
-                 region.location().width(), region.location().height());
-  } else if (region.has_location_normalized()) {
-    region_rect = cv::Rect(region.location_normalized().x() * image.cols,
-                           region.location_normalized().y() * image.rows,
-                           region.location_normalized().width() * image.cols,
-                           region.location_normalized().height() * image.rows);
-  } else {
-    return mediapipe::UnknownErrorBuilder(MEDIAPIPE_LOC)
-           << "Unset region location.";
-  }
-
-  CropRectToMat(image, &region_rect);
+  MP_RETURN_IF_ERROR(GetRegionRect(image, region, &region_rect));
   if (region_rect.area() == 0) {
     *score = 0;
     return absl::OkStatus();
   }
 
-  // Compute a score based on area covered by this region.
-  const float area_score =
-      options_.area_weight() * region_rect.area() / (image.cols * image.rows);
+  ImageStatistics statistics;
+  MP_RETURN_IF_ERROR(ComputeImageStatistics(image, region_rect, &statistics));
+  return ScoreRect(statistics, region_rect, image.size(), score);
+}
 
-  // Convert the visible region to cv::Mat.
-  cv::Mat image_region_mat = image(region_rect);
+absl::Status VisualScorer::CalculateScores(
+    const cv::Mat& image, const std::vector<const SalientRegion*>& regions,
+    std::vector<float>* scores) const {
+  std::vector<cv::Rect> region_rects(regions.size());
+  cv::Rect bounding_box;
+  int64 regions_area = 0;
+  for (int i = 0; i < regions.size(); ++i) {
+    MP_RETURN_IF_ERROR(GetRegionRect(image, *regions[i], &region_rects[i]));
+    if (region_rects[i].area() > 0) {
+      bounding_box = bounding_box.area() > 0 ? bounding_box | region_rects[i]
+                                             : region_rects[i];
+      regions_area += region_rects[i].area();
+    }
+  }
 
-  // Compute a score from sharpness.
+  scores->assign(regions.size(), 0.0f);
+  if (bounding_box.area() == 0) {
+    return absl::OkStatus();
+  }
+  ImageStatistics statistics;
+  const bool score_separately =
+      bounding_box.area() > kMaxBoundingBoxAreaRatio * regions_area;
+  if (!score_separately) {
+    MP_RETURN_IF_ERROR(
+        ComputeImageStatistics(image, bounding_box, &statistics));
+  }
+  for (int i = 0; i < regions.size(); ++i) {
+    if (region_rects[i].area() > 0) {
+      if (score_separately) {
+        MP_RETURN_IF_ERROR(
+            ComputeImageStatistics(image, region_rects[i], &statistics));
+      }
+      MP_RETURN_IF_ERROR(ScoreRect(statistics, region_rects[i], image.size(),
+                                   &(*scores)[i]));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status VisualScorer::ComputeImageStatistics(
+    const cv::Mat& image, const cv::Rect& area,
+    ImageStatistics* statistics) const {
+  statistics->area = area;
+  statistics->hue_histogram_integral.clear();
+  if (options_.colorfulness_weight() <= kEpsilon) {
+    return absl::OkStatus();
+  }
+  RET_CHECK_EQ(image.type(), CV_8UC3) << "Expected an RGB image.";
+
+  // Convert the image to HSV.
+  cv::Mat image_hsv;
+  cv::cvtColor(image(area), image_hsv, CV_RGB2HSV);
+
+  // Accumulates the hue histogram of each pixel, weighing saturated pixels
+  // more, in a single pass over the area.
+  const int stride = (area.width + 1) * kHueBins;
+  auto& integral = statistics->hue_histogram_integral;
+  integral.assign((area.height + 1) * stride, 0);
+  for (int y = 0; y < area.height; ++y) {
+    const cv::Vec3b* rgb_row = image.ptr<cv::Vec3b>(area.y + y) + area.x;
+    const cv::Vec3b* hsv_row = image_hsv.ptr<cv::Vec3b>(y);
+    const uint32* integral_above = &integral[y * stride];
+    uint32* integral_row = &integral[(y + 1) * stride];
+    uint32 row_histogram[kHueBins] = {0};
+    for (int x = 0; x < area.width; ++x) {
+      // Mask out pixels that are too dark or too bright.
+      const cv::Vec3b& pixel = rgb_row[x];
+      const bool is_usable =
+          (std::min(pixel.val[0], std::min(pixel.val[1], pixel.val[2])) < 250 &&
+           std::max(pixel.val[0], std::max(pixel.val[1], pixel.val[2])) > 5);
+      if (is_usable) {
+        const int hue_bin = hsv_row[x].val[0] * kHueBins / 180;
+        const int saturation_bin = hsv_row[x].val[1] * kSaturationBins / 256;
+        row_histogram[hue_bin] += 1u << saturation_bin;
+      }
+      const int offset = (x + 1) * kHueBins;
+      for (int bin = 0; bin < kHueBins; ++bin) {
+        integral_row[offset + bin] =
+            integral_above[offset + bin] + row_histogram[bin];
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status VisualScorer::ScoreRect(const ImageStatistics& statistics,
+                                     const cv::Rect& rect,
+                                     const cv::Size& image_size,
+                                     float* score) const {
+  const float weight_sum = options_.area_weight() +
+                           options_.sharpness_weight() +
+                           options_.colorfulness_weight();
+
+  // Compute a score based on area covered by this region.
+  const float area_score = options_.area_weight() * rect.area() /
+                           (image_size.width * image_size.height);
 
+  // Compute a score from sharpness.
   float sharpness_score_result = 0.0;
   if (options_.sharpness_weight() > kEpsilon) {
     // TODO: implement a sharpness score or remove this code block.
@@ -99,9 +205,8 @@ absl::Status VisualScorer::CalculateScore(const cv::Mat& image,
   // Compute a colorfulness score.
   float colorfulness_score = 0;
   if (options_.colorfulness_weight() > kEpsilon) {
-    MP_RETURN_IF_ERROR(
-        CalculateColorfulness(image_region_mat, &colorfulness_score));
-    colorfulness_score *= options_.colorfulness_weight();
+    colorfulness_score = options_.colorfulness_weight() *
+                         CalculateColorfulness(statistics, rect);
   }
 
   *score = (area_score + sharpness_score + colorfulness_score) / weight_sum;
@@ -111,71 +216,36 @@ absl::Status VisualScorer::CalculateScore(const cv::Mat& image,
   return absl::OkStatus();
 }
 
-absl::Status VisualScorer::CalculateColorfulness(const cv::Mat& image,
-                                                 float* colorfulness) const {
-  // Convert the image to HSV.
-  cv::Mat image_hsv;
-  cv::cvtColor(image, image_hsv, CV_RGB2HSV);
-
-  // Mask out pixels that are too dark or too bright.
-  cv::Mat mask(image.rows, image.cols, CV_8UC1);
-  bool empty_mask = true;
-  for (int x = 0; x < image.cols; ++x) {
-    for (int y = 0; y < image.rows; ++y) {
-      const cv::Vec3b& pixel = image.at<cv::Vec3b>(x, y);
-      const bool is_usable =
-          (std::min(pixel.val[0], std::min(pixel.val[1], pixel.val[2])) < 250 &&
-           std::max(pixel.val[0], std::max(pixel.val[1], pixel.val[2])) > 5);
-      mask.at<unsigned char>(y, x) = is_usable ? 255 : 0;
-      if (is_usable) empty_mask = false;
-    }
-  }
-
-  // If the mask is empty, return.
-  if (empty_mask) {
-    *colorfulness = 0;
-    return absl::OkStatus();
-  }
-
-  // Generate a 2D histogram (hue/saturation).
-  cv::MatND hs_histogram;
-  const int kHueBins = 10, kSaturationBins = 8;
-  const int kHistogramChannels[] = {0, 1};
-  const int kHistogramBinNum[] = {kHueBins, kSaturationBins};
-  const float kHueRange[] = {0, 180};
-  const float kSaturationRange[] = {0, 256};
-  const float* kHistogramRange[] = {kHueRange, kSaturationRange};
-  cv::calcHist(&image_hsv, 1, kHistogramChannels, mask, hs_histogram,
-               2 /* histogram dims */, kHistogramBinNum, kHistogramRange,
-               true /* uniform */, false /* accumulate */);
-
-  // Convert to a hue histogram and weigh saturated pixels more.
-  std::vector<float> hue_histogram(kHueBins, 0.0f);
+float VisualScorer::CalculateColorfulness(const ImageStatistics& statistics,
+                                          const cv::Rect& rect) const {
+  // Look up the hue histogram of the rectangle in the integral image.
+  const int stride = (statistics.area.width + 1) * kHueBins;
+  const int left = (rect.x - statistics.area.x) * kHueBins;
+  const int right = left + rect.width * kHueBins;
+  const int top = (rect.y - statistics.area.y) * stride;
+  const int bottom = top + rect.height * stride;
+  const uint32* integral = statistics.hue_histogram_integral.data();
+  float hue_histogram[kHueBins];
   float hue_sum = 0.0f;
-  for (int bin_s = 0; bin_s < kSaturationBins; ++bin_s) {
-    const float weight = std::pow(2.0f, bin_s);
-    for (int bin_h = 0; bin_h < kHueBins; ++bin_h) {
-      float value = hs_histogram.at<float>(bin_h, bin_s) * weight;
-      hue_histogram[bin_h] += value;
-      hue_sum += value;
-    }
+  for (int bin = 0; bin < kHueBins; ++bin) {
+    hue_histogram[bin] =
+        integral[bottom + right + bin] - integral[bottom + left + bin] -
+        integral[top + right + bin] + integral[top + left + bin];
+    hue_sum += hue_histogram[bin];
   }
   if (hue_sum == 0.0f) {
-    *colorfulness = 0;
-    return absl::OkStatus();
+    return 0.0f;
   }
 
   // Compute the histogram entropy.
-  *colorfulness = 0;
+  float colorfulness = 0;
   for (int bin = 0; bin < kHueBins; ++bin) {
     float value = hue_histogram[bin] / hue_sum;
     if (value > 0.0f) {
-      *colorfulness -= value * std::log(value);
+      colorfulness -= value * std::log(value);
     }
   }
-  *colorfulness /= std::log(2.0f);
-
-  return absl::OkStatus();
+  return colorfulness / std::log(2.0f);
 }
 
 }  // namespace autoflip
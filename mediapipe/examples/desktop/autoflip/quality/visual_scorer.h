@@ -15,8 +15,11 @@
 #ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_QUALITY_VISUAL_SCORER_H_
 #define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_QUALITY_VISUAL_SCORER_H_
 
+#include <vector>
+
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/quality/visual_scorer.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/status.h"
 
@@ -24,7 +27,10 @@ namespace mediapipe {
 namespace autoflip {
 
 // This class scores a SalientRegion within an image based on weighted averages
-// of various signals computed on the patch.
+// of various signals computed on the patch. The signals are computed from
+// integral images of per-pixel statistics, such that scoring many (possibly
+// overlapping) regions of the same image with CalculateScores() only scans
+// each pixel once.
 class VisualScorer {
  public:
   explicit VisualScorer(const VisualScorerOptions& options);
@@ -33,9 +39,42 @@ class VisualScorer {
   absl::Status CalculateScore(const cv::Mat& image, const SalientRegion& region,
                               float* score) const;
 
+  // Computes the scores of all |regions| of the same image. The per-pixel
+  // statistics are computed once, over the bounding box of the regions, after
+  // which each region is scored in constant time. If the bounding box is much
+  // larger than the regions combined, each region is scored on its own.
+  absl::Status CalculateScores(const cv::Mat& image,
+                               const std::vector<const SalientRegion*>& regions,
+                               std::vector<float>* scores) const;
+
  private:
-  absl::Status CalculateColorfulness(const cv::Mat& image,
-                                     float* colorfulness) const;
+  // Integral images of the per-pixel statistics of a part of an image, from
+  // which the statistics of any rectangle within are computed in constant
+  // time.
+  struct ImageStatistics {
+    // Area of the image covered by the statistics.
+    cv::Rect area;
+    // Integral image of the hue histogram of usable pixels, weighted by
+    // saturation, with (area.width + 1) * kHueBins values per row and
+    // area.height + 1 rows. Only computed if colorfulness is scored.
+    std::vector<uint32> hue_histogram_integral;
+  };
+
+  // Computes the statistics of |area| of |image|.
+  absl::Status ComputeImageStatistics(const cv::Mat& image,
+                                      const cv::Rect& area,
+                                      ImageStatistics* statistics) const;
+
+  // Scores the non-empty |rect| within the area of |statistics|, computed on
+  // an image of size |image_size|.
+  absl::Status ScoreRect(const ImageStatistics& statistics,
+                         const cv::Rect& rect, const cv::Size& image_size,
+                         float* score) const;
+
+  // Computes the entropy of the hue histogram of |rect| within the area of
+  // |statistics|.
+  float CalculateColorfulness(const ImageStatistics& statistics,
+                              const cv::Rect& rect) const;
 
   VisualScorerOptions options_;
 };
@@ -14,9 +14,15 @@
 
 #include "mediapipe/examples/desktop/autoflip/quality/visual_scorer.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
 
@@ -75,6 +81,209 @@ TEST(VisualScorerTest, ScoresColorfulness) {
   EXPECT_LT(score_2c, score_3c);
 }
 
+// Returns an image with random colored rectangles.
+cv::Mat MakeColorfulImage(int width, int height) {
+  cv::RNG rng(0);
+  cv::Mat image_mat(height, width, CV_8UC3, cv::Scalar(0, 0, 0));
+  for (int i = 0; i < 50; ++i) {
+    const cv::Point corner(rng.uniform(0, width), rng.uniform(0, height));
+    const cv::Size size(rng.uniform(1, width / 4), rng.uniform(1, height / 4));
+    image_mat(cv::Rect(corner, size) & cv::Rect(0, 0, width, height))
+        .setTo(cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256),
+                          rng.uniform(0, 256)));
+  }
+  return image_mat;
+}
+
+// Returns overlapping regions, partly outside of the image.
+std::vector<SalientRegion> MakeRegions(int num_regions, int width,
+                                       int height) {
+  cv::RNG rng(1);
+  std::vector<SalientRegion> regions(num_regions);
+  for (int i = 0; i < num_regions; ++i) {
+    if (i % 2 == 0) {
+      auto* location = regions[i].mutable_location();
+      location->set_x(rng.uniform(-10, width));
+      location->set_y(rng.uniform(-10, height));
+      location->set_width(rng.uniform(1, width / 2));
+      location->set_height(rng.uniform(1, height / 2));
+    } else {
+      auto* location = regions[i].mutable_location_normalized();
+      location->set_x(rng.uniform(0.0f, 1.0f));
+      location->set_y(rng.uniform(0.0f, 1.0f));
+      location->set_width(rng.uniform(0.0f, 0.5f));
+      location->set_height(rng.uniform(0.0f, 0.5f));
+    }
+  }
+  return regions;
+}
+
+TEST(VisualScorerTest, ScoresRegionsInBatch) {
+  VisualScorerOptions options = ParseTextProtoOrDie<VisualScorerOptions>(
+      R"pb(area_weight: 1.0 sharpness_weight: 0 colorfulness_weight: 1.0)pb");
+  VisualScorer scorer(options);
+  const cv::Mat image_mat = MakeColorfulImage(320, 180);
+  const auto regions = MakeRegions(20, 320, 180);
+  std::vector<const SalientRegion*> region_ptrs;
+  for (const auto& region : regions) {
+    region_ptrs.push_back(&region);
+  }
+
+  std::vector<float> scores;
+  MP_ASSERT_OK(scorer.CalculateScores(image_mat, region_ptrs, &scores));
+  ASSERT_EQ(regions.size(), scores.size());
+  for (int i = 0; i < regions.size(); ++i) {
+    float score = 0;
+    MP_ASSERT_OK(scorer.CalculateScore(image_mat, regions[i], &score));
+    EXPECT_FLOAT_EQ(score, scores[i]) << "Region " << i;
+  }
+}
+
+// Regions far apart are scored from their own statistics instead of those of
+// their bounding box, with the same result.
+TEST(VisualScorerTest, ScoresDistantRegionsInBatch) {
+  VisualScorerOptions options = ParseTextProtoOrDie<VisualScorerOptions>(
+      R"pb(area_weight: 1.0 sharpness_weight: 0 colorfulness_weight: 1.0)pb");
+  VisualScorer scorer(options);
+  const cv::Mat image_mat = MakeColorfulImage(640, 360);
+  std::vector<SalientRegion> regions = {
+      ParseTextProtoOrDie<SalientRegion>(
+          R"pb(location { x: 0 y: 0 width: 20 height: 30 })pb"),
+      ParseTextProtoOrDie<SalientRegion>(
+          R"pb(location { x: 610 y: 320 width: 30 height: 40 })pb")};
+  std::vector<const SalientRegion*> region_ptrs = {&regions[0], &regions[1]};
+
+  std::vector<float> scores;
+  MP_ASSERT_OK(scorer.CalculateScores(image_mat, region_ptrs, &scores));
+  ASSERT_EQ(2, scores.size());
+  for (int i = 0; i < regions.size(); ++i) {
+    float score = 0;
+    MP_ASSERT_OK(scorer.CalculateScore(image_mat, regions[i], &score));
+    EXPECT_FLOAT_EQ(score, scores[i]) << "Region " << i;
+  }
+}
+
+// Colorfulness as computed before scoring from integral images, from a 2D
+// hue/saturation histogram of the usable pixels of the region.
+float ReferenceColorfulness(const cv::Mat& image) {
+  cv::Mat image_hsv;
+  cv::cvtColor(image, image_hsv, CV_RGB2HSV);
+  cv::Mat mask(image.rows, image.cols, CV_8UC1);
+  for (int y = 0; y < image.rows; ++y) {
+    for (int x = 0; x < image.cols; ++x) {
+      const cv::Vec3b& pixel = image.at<cv::Vec3b>(y, x);
+      const bool is_usable =
+          (std::min(pixel.val[0], std::min(pixel.val[1], pixel.val[2])) < 250 &&
+           std::max(pixel.val[0], std::max(pixel.val[1], pixel.val[2])) > 5);
+      mask.at<unsigned char>(y, x) = is_usable ? 255 : 0;
+    }
+  }
+
+  cv::MatND hs_histogram;
+  const int kHueBins = 10, kSaturationBins = 8;
+  const int kHistogramChannels[] = {0, 1};
+  const int kHistogramBinNum[] = {kHueBins, kSaturationBins};
+  const float kHueRange[] = {0, 180};
+  const float kSaturationRange[] = {0, 256};
+  const float* kHistogramRange[] = {kHueRange, kSaturationRange};
+  cv::calcHist(&image_hsv, 1, kHistogramChannels, mask, hs_histogram, 2,
+               kHistogramBinNum, kHistogramRange, true, false);
+
+  std::vector<float> hue_histogram(kHueBins, 0.0f);
+  float hue_sum = 0.0f;
+  for (int bin_s = 0; bin_s < kSaturationBins; ++bin_s) {
+    const float weight = std::pow(2.0f, bin_s);
+    for (int bin_h = 0; bin_h < kHueBins; ++bin_h) {
+      const float value = hs_histogram.at<float>(bin_h, bin_s) * weight;
+      hue_histogram[bin_h] += value;
+      hue_sum += value;
+    }
+  }
+  if (hue_sum == 0.0f) {
+    return 0.0f;
+  }
+
+  float colorfulness = 0.0f;
+  for (int bin = 0; bin < kHueBins; ++bin) {
+    const float value = hue_histogram[bin] / hue_sum;
+    if (value > 0.0f) {
+      colorfulness -= value * std::log(value);
+    }
+  }
+  return colorfulness / std::log(2.0f);
+}
+
+// Colorfulness from the integral image matches the histogram based
+// computation, also for regions with unusable (too dark or too bright) pixels.
+TEST(VisualScorerTest, ColorfulnessMatchesHistogram) {
+  VisualScorerOptions options = ParseTextProtoOrDie<VisualScorerOptions>(
+      R"pb(area_weight: 0 sharpness_weight: 0 colorfulness_weight: 1.0)pb");
+  VisualScorer scorer(options);
+  cv::Mat image_mat = MakeColorfulImage(320, 180);
+  image_mat(cv::Rect(100, 20, 60, 30)).setTo(cv::Scalar(255, 255, 255));
+  image_mat(cv::Rect(20, 100, 30, 60)).setTo(cv::Scalar(2, 2, 2));
+  const auto regions = MakeRegions(20, 320, 180);
+  for (int i = 0; i < regions.size(); ++i) {
+    float score = 0;
+    MP_ASSERT_OK(scorer.CalculateScore(image_mat, regions[i], &score));
+    cv::Rect rect;
+    if (regions[i].has_location()) {
+      const auto& location = regions[i].location();
+      rect = cv::Rect(location.x(), location.y(), location.width(),
+                      location.height());
+    } else {
+      const auto& location = regions[i].location_normalized();
+      rect = cv::Rect(location.x() * image_mat.cols,
+                      location.y() * image_mat.rows,
+                      location.width() * image_mat.cols,
+                      location.height() * image_mat.rows);
+    }
+    rect &= cv::Rect(0, 0, image_mat.cols, image_mat.rows);
+    const float expected =
+        rect.area() > 0 ? ReferenceColorfulness(image_mat(rect)) : 0.0f;
+    EXPECT_NEAR(expected, score, 1e-5) << "Region " << i;
+  }
+}
+
+TEST(VisualScorerTest, ScoresNoRegions) {
+  VisualScorerOptions options;
+  VisualScorer scorer(options);
+  cv::Mat image_mat(200, 200, CV_8UC3);
+  std::vector<float> scores = {1.0f};
+  MP_ASSERT_OK(scorer.CalculateScores(image_mat, {}, &scores));
+  EXPECT_TRUE(scores.empty());
+}
+
+// Measures scoring the colorfulness of many regions in a 640x360 image, either
+// one by one or in a batch.
+// Args: number of regions, whether to score in a batch.
+void BM_VisualScorer(benchmark::State& state) {
+  VisualScorerOptions options = ParseTextProtoOrDie<VisualScorerOptions>(
+      R"pb(area_weight: 1.0 sharpness_weight: 0 colorfulness_weight: 1.0)pb");
+  VisualScorer scorer(options);
+  const cv::Mat image_mat = MakeColorfulImage(640, 360);
+  const auto regions = MakeRegions(state.range(0), 640, 360);
+  std::vector<const SalientRegion*> region_ptrs;
+  for (const auto& region : regions) {
+    region_ptrs.push_back(&region);
+  }
+  std::vector<float> scores(regions.size());
+  for (auto _ : state) {
+    if (state.range(1)) {
+      MP_ASSERT_OK(scorer.CalculateScores(image_mat, region_ptrs, &scores));
+    } else {
+      for (int i = 0; i < regions.size(); ++i) {
+        MP_ASSERT_OK(scorer.CalculateScore(image_mat, regions[i], &scores[i]));
+      }
+    }
+  }
+}
+BENCHMARK(BM_VisualScorer)
+    ->Args({4, 0})
+    ->Args({4, 1})
+    ->Args({64, 0})
+    ->Args({64, 1});
+
 }  // namespace
 }  // namespace autoflip
 }  // namespace mediapipe
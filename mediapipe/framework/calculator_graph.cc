@@ -485,6 +485,46 @@ absl::StatusOr<OutputStreamPoller> CalculatorGraph::AddOutputStreamPoller(
   return std::move(poller);
 }
 
+absl::StatusOr<MultiOutputStreamPoller>
+CalculatorGraph::AddMultiOutputStreamPoller(
+    const std::vector<std::string>& stream_names) {
+  RET_CHECK(initialized_).SetNoLogging()
+      << "CalculatorGraph is not initialized.";
+  RET_CHECK(!stream_names.empty()).SetNoLogging()
+      << "A multi-stream poller needs at least one stream.";
+  // Resolves every stream before initializing any poller. An initialized
+  // poller is registered as a mirror of its output stream, so the graph must
+  // keep it even if a later stream fails.
+  std::vector<int> output_stream_indexes;
+  for (const std::string& stream_name : stream_names) {
+    int output_stream_index = validated_graph_->OutputStreamIndex(stream_name);
+    if (output_stream_index < 0) {
+      return mediapipe::NotFoundErrorBuilder(MEDIAPIPE_LOC)
+             << "Unable to attach poller to output stream \"" << stream_name
+             << "\" because it doesn't exist.";
+    }
+    output_stream_indexes.push_back(output_stream_index);
+  }
+  std::vector<std::shared_ptr<internal::OutputStreamPollerImpl>> pollers;
+  for (int i = 0; i < stream_names.size(); ++i) {
+    auto internal_poller =
+        std::make_shared<internal::OutputStreamPollerImpl>();
+    MP_RETURN_IF_ERROR(internal_poller->Initialize(
+        stream_names[i], &any_packet_type_,
+        std::bind(&CalculatorGraph::UpdateThrottledNodes, this,
+                  std::placeholders::_1, std::placeholders::_2),
+        &output_stream_managers_[output_stream_indexes[i]]));
+    graph_output_streams_.push_back(internal_poller);
+    pollers.push_back(std::move(internal_poller));
+  }
+  auto internal_multi_poller =
+      std::make_shared<internal::MultiOutputStreamPollerImpl>(
+          std::move(pollers));
+  MultiOutputStreamPoller multi_poller(internal_multi_poller);
+  multi_output_stream_pollers_.push_back(std::move(internal_multi_poller));
+  return std::move(multi_poller);
+}
+
 absl::StatusOr<Packet> CalculatorGraph::GetOutputSidePacket(
     const std::string& packet_name) {
   int side_packet_index = validated_graph_->OutputSidePacketIndex(packet_name);
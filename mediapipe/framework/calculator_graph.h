@@ -167,6 +167,12 @@ class CalculatorGraph {
   StatusOrPoller AddOutputStreamPoller(const std::string& stream_name,
                                        bool observe_timestamp_bounds = false);
 
+  // Adds a MultiOutputStreamPoller for several streams, which returns their
+  // packets bundled by timestamp. Should only be called before Run() or
+  // StartRun().
+  absl::StatusOr<MultiOutputStreamPoller> AddMultiOutputStreamPoller(
+      const std::vector<std::string>& stream_names);
+
   // Gets output side packet by name after the graph is done. However, base
   // packets (generated by PacketGenerators) can be retrieved before
   // graph is done. Returns error if the graph is still running (for non-base
@@ -566,6 +572,10 @@ class CalculatorGraph {
   std::vector<std::shared_ptr<internal::GraphOutputStream>>
       graph_output_streams_;
 
+  // The multi-stream pollers, whose streams are in graph_output_streams_.
+  std::vector<std::shared_ptr<internal::MultiOutputStreamPollerImpl>>
+      multi_output_stream_pollers_;
+
   // Maximum queue size for an input stream. This is used by the scheduler to
   // restrict memory usage.
   int max_queue_size_ = -1;
@@ -4348,5 +4348,123 @@ TEST(CalculatorGraph, GraphInputStreamWithTag) {
   ASSERT_EQ(5, packet_dump.size());
 }
 
+// Returns a graph which outputs the squares of its input numbers on "squared"
+// and every kDecimationRatio-th input number on "decimated".
+CalculatorGraphConfig SquareAndDecimateGraphConfig() {
+  return mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+    input_stream: "numbers"
+    node {
+      calculator: "SquareIntCalculator"
+      input_stream: "numbers"
+      output_stream: "squared"
+    }
+    node {
+      calculator: "DecimatorCalculator"
+      input_stream: "numbers"
+      output_stream: "decimated"
+    }
+  )pb");
+}
+
+TEST(CalculatorGraph, OutputStreamPollerNextBatch) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(SquareAndDecimateGraphConfig()));
+  auto poller_status = graph.AddOutputStreamPoller("squared");
+  MP_ASSERT_OK(poller_status.status());
+  OutputStreamPoller& poller = poller_status.value();
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < 5; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "numbers", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+
+  std::vector<Packet> packets;
+  ASSERT_TRUE(poller.NextBatch(&packets));
+  ASSERT_EQ(5, packets.size());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(Timestamp(i), packets[i].Timestamp());
+    EXPECT_EQ(i * i, packets[i].Get<int>());
+  }
+  // Returns immediately when there are no packets.
+  EXPECT_TRUE(poller.NextBatch(&packets));
+  EXPECT_EQ(5, packets.size());
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  EXPECT_FALSE(poller.NextBatch(&packets));
+}
+
+TEST(CalculatorGraph, MultiOutputStreamPollerBundlesPacketsByTimestamp) {
+  const int kDecimationRatio = DecimatorCalculator::kDecimationRatio;
+  const int kNumPackets = kDecimationRatio + 10;
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(SquareAndDecimateGraphConfig()));
+  auto poller_status =
+      graph.AddMultiOutputStreamPoller({"squared", "decimated"});
+  MP_ASSERT_OK(poller_status.status());
+  MultiOutputStreamPoller& poller = poller_status.value();
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < kNumPackets; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "numbers", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+
+  // The bundles are complete up to the last decimated packet, after which
+  // "decimated" may still output packets.
+  std::vector<std::vector<Packet>> bundles;
+  ASSERT_TRUE(poller.NextBatch(&bundles));
+  ASSERT_EQ(kDecimationRatio + 1, bundles.size());
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  std::vector<Packet> bundle;
+  while (poller.Next(&bundle)) {
+    bundles.push_back(bundle);
+  }
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  ASSERT_EQ(kNumPackets, bundles.size());
+  for (int i = 0; i < kNumPackets; ++i) {
+    ASSERT_EQ(2, bundles[i].size());
+    EXPECT_EQ(Timestamp(i), bundles[i][0].Timestamp());
+    EXPECT_EQ(i * i, bundles[i][0].Get<int>());
+    EXPECT_EQ(Timestamp(i), bundles[i][1].Timestamp());
+    if (i % kDecimationRatio == 0) {
+      EXPECT_EQ(i, bundles[i][1].Get<int>());
+    } else {
+      EXPECT_TRUE(bundles[i][1].IsEmpty());
+    }
+  }
+}
+
+TEST(CalculatorGraph, MultiOutputStreamPollerRejectsUnknownStream) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(SquareAndDecimateGraphConfig()));
+  EXPECT_EQ(graph.AddMultiOutputStreamPoller({"squared", "unknown"})
+                .status()
+                .code(),
+            absl::StatusCode::kNotFound);
+
+  // The failed call leaves no poller attached to "squared".
+  auto poller_status = graph.AddOutputStreamPoller("squared");
+  MP_ASSERT_OK(poller_status.status());
+  OutputStreamPoller& poller = poller_status.value();
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < 5; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "numbers", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  Packet packet;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(poller.Next(&packet));
+    EXPECT_EQ(Timestamp(i), packet.Timestamp());
+    EXPECT_EQ(i * i, packet.Get<int>());
+  }
+  EXPECT_FALSE(poller.Next(&packet));
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,84 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mediapipe/framework/formats/matrix_pool.h"
+
+#include "absl/memory/memory.h"
+
+namespace mediapipe {
+
+namespace {
+// Enough for the packets in flight between a few calculators.
+constexpr int kDefaultKeepCount = 16;
+constexpr int64 kDefaultMaxAvailableBytes = 64 << 20;
+
+int64 NumBytes(const Matrix& matrix) { return matrix.size() * sizeof(float); }
+}  // namespace
+
+MatrixPool::MatrixPool(int keep_count, int64 max_available_bytes)
+    : keep_count_(keep_count), max_available_bytes_(max_available_bytes) {}
+
+// static
+MatrixPool* MatrixPool::Default() {
+  static MatrixPool* pool =
+      new MatrixPool(kDefaultKeepCount, kDefaultMaxAvailableBytes);
+  return pool;
+}
+
+std::unique_ptr<Matrix> MatrixPool::Get(int rows, int cols) {
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = available_.find({rows, cols});
+    if (it != available_.end() && !it->second.empty()) {
+      std::unique_ptr<Matrix> matrix = std::move(it->second.back());
+      it->second.pop_back();
+      --available_count_;
+      available_bytes_ -= NumBytes(*matrix);
+      return matrix;
+    }
+  }
+  return absl::make_unique<Matrix>(rows, cols);
+}
+
+void MatrixPool::Return(std::unique_ptr<Matrix> matrix) {
+  if (!matrix || matrix->size() == 0) {
+    return;
+  }
+  absl::MutexLock lock(&mutex_);
+  auto& buffers = available_[{static_cast<int>(matrix->rows()),
+                              static_cast<int>(matrix->cols())}];
+  if (static_cast<int>(buffers.size()) >= keep_count_ ||
+      available_bytes_ + NumBytes(*matrix) > max_available_bytes_) {
+    // The pool is full, the matrix is deleted.
+    return;
+  }
+  ++available_count_;
+  available_bytes_ += NumBytes(*matrix);
+  buffers.push_back(std::move(matrix));
+}
+
+void MatrixPool::Recycle(Packet* packet) {
+  // Fails without changing the packet if it is empty, does not hold a Matrix
+  // or is not the only owner.
+  auto matrix = packet->Consume<Matrix>();
+  if (matrix.ok()) {
+    Return(std::move(matrix).value());
+  }
+}
+
+std::pair<int, int64> MatrixPool::GetAvailableCountAndBytes() {
+  absl::MutexLock lock(&mutex_);
+  return {available_count_, available_bytes_};
+}
+
+}  // namespace mediapipe
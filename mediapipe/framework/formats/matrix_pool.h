@@ -0,0 +1,80 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef MEDIAPIPE_FRAMEWORK_FORMATS_MATRIX_POOL_H_
+#define MEDIAPIPE_FRAMEWORK_FORMATS_MATRIX_POOL_H_
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// A pool of Matrix buffers keyed by shape, which lets a chain of calculators
+// run without allocating in steady state: a calculator takes the buffer of
+// its output packets from the pool, and the calculator downstream returns it
+// to the pool once it has processed the packet, if it is the only owner.
+// Thread-safe.
+//
+// Example usage in a calculator:
+//   auto output = MatrixPool::Default()->Get(rows, cols);
+//   ... Fill all the values of *output from the input ...
+//   cc->Outputs().Index(0).Add(output.release(), cc->InputTimestamp());
+//   MatrixPool::Default()->Recycle(&cc->Inputs().Index(0).Value());
+class MatrixPool {
+ public:
+  // Creates a pool which keeps up to keep_count available buffers of each
+  // shape, and up to max_available_bytes of available buffers in total.
+  MatrixPool(int keep_count, int64 max_available_bytes);
+  MatrixPool(const MatrixPool&) = delete;
+  MatrixPool& operator=(const MatrixPool&) = delete;
+
+  // Returns the pool shared by the calculators of the process.
+  static MatrixPool* Default();
+
+  // Returns a matrix of the given shape, which reuses an available buffer if
+  // there is one. The values of the matrix are unspecified.
+  std::unique_ptr<Matrix> Get(int rows, int cols);
+
+  // Makes the buffer of the matrix available, unless the pool is full, in
+  // which case the matrix is deleted.
+  void Return(std::unique_ptr<Matrix> matrix);
+
+  // Returns the Matrix of the packet to the pool and empties the packet if
+  // the packet is the only owner of the Matrix, otherwise leaves the packet
+  // unchanged. The Matrix must not be accessed through the packet afterwards.
+  void Recycle(Packet* packet);
+
+  // This method is meant for testing.
+  std::pair<int, int64> GetAvailableCountAndBytes();
+
+ private:
+  const int keep_count_;
+  const int64 max_available_bytes_;
+
+  absl::Mutex mutex_;
+  std::map<std::pair<int, int>, std::vector<std::unique_ptr<Matrix>>>
+      available_ ABSL_GUARDED_BY(mutex_);
+  int available_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64 available_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_FORMATS_MATRIX_POOL_H_
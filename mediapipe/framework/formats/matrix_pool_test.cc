@@ -0,0 +1,100 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "mediapipe/framework/formats/matrix_pool.h"
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+using Pair = std::pair<int, int64>;
+
+constexpr int kRows = 3;
+constexpr int kCols = 100;
+constexpr int64 kBytes = kRows * kCols * sizeof(float);
+constexpr int kKeepCount = 2;
+
+class MatrixPoolTest : public ::testing::Test {
+ protected:
+  MatrixPoolTest() : pool_(kKeepCount, 10 * kBytes) {}
+
+  MatrixPool pool_;
+};
+
+TEST_F(MatrixPoolTest, ReusesReturnedBuffers) {
+  EXPECT_EQ(Pair(0, 0), pool_.GetAvailableCountAndBytes());
+  auto matrix = pool_.Get(kRows, kCols);
+  EXPECT_EQ(kRows, matrix->rows());
+  EXPECT_EQ(kCols, matrix->cols());
+  const float* data = matrix->data();
+  pool_.Return(std::move(matrix));
+  EXPECT_EQ(Pair(1, kBytes), pool_.GetAvailableCountAndBytes());
+
+  // Another shape does not reuse the buffer.
+  matrix = pool_.Get(kCols, kRows);
+  EXPECT_EQ(Pair(1, kBytes), pool_.GetAvailableCountAndBytes());
+
+  matrix = pool_.Get(kRows, kCols);
+  EXPECT_EQ(data, matrix->data());
+  EXPECT_EQ(Pair(0, 0), pool_.GetAvailableCountAndBytes());
+}
+
+TEST_F(MatrixPoolTest, KeepsAtMostKeepCountBuffersPerShape) {
+  std::vector<std::unique_ptr<Matrix>> matrices;
+  for (int i = 0; i <= kKeepCount; ++i) {
+    matrices.push_back(pool_.Get(kRows, kCols));
+  }
+  for (auto& matrix : matrices) {
+    pool_.Return(std::move(matrix));
+  }
+  EXPECT_EQ(Pair(kKeepCount, kKeepCount * kBytes),
+            pool_.GetAvailableCountAndBytes());
+}
+
+TEST_F(MatrixPoolTest, KeepsAtMostMaxAvailableBytes) {
+  pool_.Return(pool_.Get(kRows, 9 * kCols));
+  pool_.Return(pool_.Get(kRows, 2 * kCols));
+  EXPECT_EQ(Pair(1, 9 * kBytes), pool_.GetAvailableCountAndBytes());
+}
+
+TEST_F(MatrixPoolTest, RecyclesUniquelyOwnedPackets) {
+  Packet packet = Adopt(pool_.Get(kRows, kCols).release());
+  Packet copy = packet;
+  // The matrix is still in use by the copy.
+  pool_.Recycle(&packet);
+  EXPECT_FALSE(packet.IsEmpty());
+  EXPECT_EQ(Pair(0, 0), pool_.GetAvailableCountAndBytes());
+
+  copy = Packet();
+  pool_.Recycle(&packet);
+  EXPECT_TRUE(packet.IsEmpty());
+  EXPECT_EQ(Pair(1, kBytes), pool_.GetAvailableCountAndBytes());
+}
+
+TEST_F(MatrixPoolTest, DoesNotRecycleOtherPackets) {
+  Packet packet = MakePacket<int>(1);
+  pool_.Recycle(&packet);
+  EXPECT_FALSE(packet.IsEmpty());
+
+  const Matrix matrix(kRows, kCols);
+  packet = PointToForeign(&matrix);
+  pool_.Recycle(&packet);
+  EXPECT_FALSE(packet.IsEmpty());
+  EXPECT_EQ(Pair(0, 0), pool_.GetAvailableCountAndBytes());
+}
+
+}  // namespace
+}  // namespace mediapipe
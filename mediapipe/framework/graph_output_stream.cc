@@ -14,6 +14,8 @@
 
 #include "mediapipe/framework/graph_output_stream.h"
 
+#include <algorithm>
+
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/port/status.h"
 
@@ -163,6 +165,9 @@ int OutputStreamPollerImpl::QueueSize() { return input_stream_->QueueSize(); }
 absl::Status OutputStreamPollerImpl::Notify() {
   mutex_.Lock();
   handler_condvar_.Signal();
+  if (notifier_) {
+    notifier_->Notify();
+  }
   mutex_.Unlock();
   return absl::OkStatus();
 }
@@ -171,9 +176,23 @@ void OutputStreamPollerImpl::NotifyError() {
   mutex_.Lock();
   graph_has_error_ = true;
   handler_condvar_.Signal();
+  if (notifier_) {
+    notifier_->Notify();
+  }
   mutex_.Unlock();
 }
 
+void OutputStreamPollerImpl::SetNotifier(
+    std::shared_ptr<PollerNotifier> notifier) {
+  absl::MutexLock lock(&mutex_);
+  notifier_ = std::move(notifier);
+}
+
+bool OutputStreamPollerImpl::HasError() {
+  absl::MutexLock lock(&mutex_);
+  return graph_has_error_;
+}
+
 bool OutputStreamPollerImpl::Next(Packet* packet) {
   CHECK(packet);
   bool empty_queue = true;
@@ -219,5 +238,136 @@ bool OutputStreamPollerImpl::Next(Packet* packet) {
   return true;
 }
 
+bool OutputStreamPollerImpl::NextBatch(std::vector<Packet>* packets) {
+  CHECK(packets);
+  bool empty_queue = false;
+  int num_packets = 0;
+  Timestamp min_timestamp = Timestamp::Unset();
+  absl::MutexLock lock(&mutex_);
+  while (true) {
+    min_timestamp = input_stream_->MinTimestampOrBound(&empty_queue);
+    if (empty_queue) {
+      break;
+    }
+    int num_packets_dropped = 0;
+    bool stream_is_done = false;
+    packets->push_back(input_stream_->PopPacketAtTimestamp(
+        min_timestamp, &num_packets_dropped, &stream_is_done));
+    CHECK_EQ(num_packets_dropped, 0)
+        << absl::Substitute("Dropped $0 packet(s) on input stream \"$1\".",
+                            num_packets_dropped, input_stream_->Name());
+    prev_output_ts_ = min_timestamp;
+    ++num_packets;
+  }
+  return num_packets > 0 ||
+         (!graph_has_error_ && min_timestamp != Timestamp::Done());
+}
+
+void PollerNotifier::Notify() {
+  absl::MutexLock lock(&mutex_);
+  ++notify_count_;
+  condvar_.SignalAll();
+}
+
+int64 PollerNotifier::NotifyCount() {
+  absl::MutexLock lock(&mutex_);
+  return notify_count_;
+}
+
+void PollerNotifier::WaitForNotifyCountAbove(int64 notify_count) {
+  absl::MutexLock lock(&mutex_);
+  while (notify_count_ <= notify_count) {
+    condvar_.Wait(&mutex_);
+  }
+}
+
+MultiOutputStreamPollerImpl::MultiOutputStreamPollerImpl(
+    std::vector<std::shared_ptr<OutputStreamPollerImpl>> pollers)
+    : pollers_(std::move(pollers)),
+      notifier_(std::make_shared<PollerNotifier>()) {
+  for (auto& poller : pollers_) {
+    poller->SetNotifier(notifier_);
+  }
+}
+
+bool MultiOutputStreamPollerImpl::Next(std::vector<Packet>* bundle) {
+  CHECK(bundle);
+  absl::MutexLock lock(&mutex_);
+  while (true) {
+    // Read the count first, so that no notification after PopBundle() checked
+    // the streams is missed.
+    const int64 notify_count = notifier_->NotifyCount();
+    switch (PopBundle(bundle)) {
+      case BundleState::kComplete:
+        return true;
+      case BundleState::kDone:
+        return false;
+      case BundleState::kIncomplete:
+        notifier_->WaitForNotifyCountAbove(notify_count);
+        break;
+    }
+  }
+}
+
+bool MultiOutputStreamPollerImpl::NextBatch(
+    std::vector<std::vector<Packet>>* bundles) {
+  CHECK(bundles);
+  absl::MutexLock lock(&mutex_);
+  int num_bundles = 0;
+  std::vector<Packet> bundle;
+  BundleState state;
+  while ((state = PopBundle(&bundle)) == BundleState::kComplete) {
+    bundles->push_back(std::move(bundle));
+    ++num_bundles;
+  }
+  return num_bundles > 0 || state != BundleState::kDone;
+}
+
+MultiOutputStreamPollerImpl::BundleState
+MultiOutputStreamPollerImpl::PopBundle(std::vector<Packet>* bundle) {
+  std::vector<Timestamp> min_timestamps(pollers_.size());
+  std::vector<char> empty_queues(pollers_.size());
+  Timestamp bundle_timestamp = Timestamp::Done();
+  for (int i = 0; i < pollers_.size(); ++i) {
+    bool empty_queue = true;
+    min_timestamps[i] =
+        pollers_[i]->input_stream()->MinTimestampOrBound(&empty_queue);
+    empty_queues[i] = empty_queue;
+    bundle_timestamp = std::min(bundle_timestamp, min_timestamps[i]);
+  }
+  if (bundle_timestamp == Timestamp::Done()) {
+    return BundleState::kDone;
+  }
+  // A stream whose bound is the bundle timestamp may still receive a packet
+  // at that timestamp. Timestamp bounds only increase, so the other streams
+  // will not.
+  for (int i = 0; i < pollers_.size(); ++i) {
+    if (min_timestamps[i] == bundle_timestamp && empty_queues[i]) {
+      for (auto& poller : pollers_) {
+        if (poller->HasError()) {
+          return BundleState::kDone;
+        }
+      }
+      return BundleState::kIncomplete;
+    }
+  }
+  bundle->clear();
+  for (int i = 0; i < pollers_.size(); ++i) {
+    if (min_timestamps[i] != bundle_timestamp) {
+      bundle->push_back(Packet().At(bundle_timestamp));
+      continue;
+    }
+    int num_packets_dropped = 0;
+    bool stream_is_done = false;
+    InputStreamManager* input_stream = pollers_[i]->input_stream();
+    bundle->push_back(input_stream->PopPacketAtTimestamp(
+        bundle_timestamp, &num_packets_dropped, &stream_is_done));
+    CHECK_EQ(num_packets_dropped, 0)
+        << absl::Substitute("Dropped $0 packet(s) on input stream \"$1\".",
+                            num_packets_dropped, input_stream->Name());
+  }
+  return BundleState::kComplete;
+}
+
 }  // namespace internal
 }  // namespace mediapipe
@@ -30,6 +30,7 @@
 #include "mediapipe/framework/packet.h"
 #include "mediapipe/framework/packet_set.h"
 #include "mediapipe/framework/packet_type.h"
+#include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
@@ -132,6 +133,24 @@ class OutputStreamObserver : public GraphOutputStream {
   std::function<absl::Status(const Packet&)> packet_callback_;
 };
 
+// Wakes up the consumer of a MultiOutputStreamPollerImpl when any of its
+// streams receives packets or timestamp bounds, or the graph has an error.
+class PollerNotifier {
+ public:
+  void Notify();
+
+  // Returns the number of Notify() calls so far.
+  int64 NotifyCount();
+
+  // Blocks until the number of Notify() calls exceeds notify_count.
+  void WaitForNotifyCountAbove(int64 notify_count);
+
+ private:
+  absl::Mutex mutex_;
+  absl::CondVar condvar_ ABSL_GUARDED_BY(mutex_);
+  int64 notify_count_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
 // OutputStreamPollerImpl that returns packets to the caller via
 // Next()/NextBatch().
 // TODO: Support observe_timestamp_bounds.
@@ -167,11 +186,58 @@ class OutputStreamPollerImpl : public GraphOutputStream {
   // done).  Returns true if successful.
   ABSL_MUST_USE_RESULT bool Next(Packet* packet);
 
+  // Appends all the packets in the queue to packets without blocking. Returns
+  // false if there were no packets and the stream is done or the graph has an
+  // error.
+  ABSL_MUST_USE_RESULT bool NextBatch(std::vector<Packet>* packets);
+
+  // Makes Notify() and NotifyError() also notify notifier.
+  void SetNotifier(std::shared_ptr<PollerNotifier> notifier);
+
+  // Returns true if the graph has an error.
+  bool HasError();
+
  private:
   absl::Mutex mutex_;
   absl::CondVar handler_condvar_ ABSL_GUARDED_BY(mutex_);
   bool graph_has_error_ ABSL_GUARDED_BY(mutex_);
   Timestamp prev_output_ts_ ABSL_GUARDED_BY(mutex_) = Timestamp::Min();
+  std::shared_ptr<PollerNotifier> notifier_ ABSL_GUARDED_BY(mutex_);
+};
+
+// MultiOutputStreamPollerImpl returns the packets of several output streams
+// bundled by timestamp. The bundle for the smallest pending timestamp is
+// complete once every stream has either a packet at that timestamp or a
+// timestamp bound past it. The consumer waits for complete bundles, so it
+// wakes up about once per bundle rather than once per stream.
+class MultiOutputStreamPollerImpl {
+ public:
+  explicit MultiOutputStreamPollerImpl(
+      std::vector<std::shared_ptr<OutputStreamPollerImpl>> pollers);
+
+  // Gets the next bundle (block until it is complete or all the streams are
+  // done). (*bundle)[i] is the packet of the i-th stream, or an empty packet
+  // at the bundle timestamp if the stream has no packet at that timestamp.
+  // Returns true if successful.
+  ABSL_MUST_USE_RESULT bool Next(std::vector<Packet>* bundle);
+
+  // Appends all the complete bundles to bundles without blocking. Returns
+  // false if there were no complete bundles and all the streams are done or
+  // the graph has an error.
+  ABSL_MUST_USE_RESULT bool NextBatch(
+      std::vector<std::vector<Packet>>* bundles);
+
+ private:
+  enum class BundleState { kComplete, kIncomplete, kDone };
+
+  // Pops the next bundle into bundle if it is complete.
+  BundleState PopBundle(std::vector<Packet>* bundle)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::vector<std::shared_ptr<OutputStreamPollerImpl>> pollers_;
+  const std::shared_ptr<PollerNotifier> notifier_;
+  // Serializes Next() and NextBatch() calls.
+  absl::Mutex mutex_;
 };
 
 }  // namespace internal
@@ -16,6 +16,7 @@
 #define MEDIAPIPE_FRAMEWORK_OUTPUT_STREAM_POLLER_H_
 
 #include <memory>
+#include <vector>
 
 #include "mediapipe/framework/graph_output_stream.h"
 
@@ -48,6 +49,17 @@ class OutputStreamPoller {
     return poller->Next(packet);
   }
 
+  // Appends all the queued packets to packets without blocking. Returns false
+  // if there were no packets and the stream is done or the graph has an
+  // error.
+  ABSL_MUST_USE_RESULT bool NextBatch(std::vector<Packet>* packets) {
+    auto poller = internal_poller_impl_.lock();
+    if (!poller) {
+      return false;
+    }
+    return poller->NextBatch(packets);
+  }
+
   void SetMaxQueueSize(int queue_size) {
     auto poller = internal_poller_impl_.lock();
     CHECK(poller) << "OutputStreamPollerImpl is already destroyed.";
@@ -73,6 +85,53 @@ class OutputStreamPoller {
   friend class CalculatorGraph;
 };
 
+// Polls several output streams at once, returning their packets bundled by
+// timestamp, e.g. the landmarks and the rendered frame of the same input
+// frame. Waiting for a bundle takes one wake-up instead of one per stream.
+class MultiOutputStreamPoller {
+ public:
+  MultiOutputStreamPoller(const MultiOutputStreamPoller&) = delete;
+  MultiOutputStreamPoller& operator=(const MultiOutputStreamPoller&) = delete;
+  MultiOutputStreamPoller(MultiOutputStreamPoller&&) = default;
+  MultiOutputStreamPoller& operator=(MultiOutputStreamPoller&&) = default;
+
+  // Gets the packets of all the streams for the next timestamp (block until
+  // every stream has a packet at or a timestamp bound past that timestamp, or
+  // all the streams are done). (*bundle)[i] is the packet of the i-th stream
+  // given to CalculatorGraph::AddMultiOutputStreamPoller(), or an empty packet
+  // at the bundle timestamp if the stream has no packet at that timestamp.
+  // Returns true if successful.
+  ABSL_MUST_USE_RESULT bool Next(std::vector<Packet>* bundle) {
+    auto poller = internal_poller_impl_.lock();
+    if (!poller) {
+      return false;
+    }
+    return poller->Next(bundle);
+  }
+
+  // Appends all the complete bundles to bundles without blocking. Returns
+  // false if there were no complete bundles and all the streams are done or
+  // the graph has an error.
+  ABSL_MUST_USE_RESULT bool NextBatch(
+      std::vector<std::vector<Packet>>* bundles) {
+    auto poller = internal_poller_impl_.lock();
+    if (!poller) {
+      return false;
+    }
+    return poller->NextBatch(bundles);
+  }
+
+ private:
+  MultiOutputStreamPoller(
+      std::shared_ptr<internal::MultiOutputStreamPollerImpl>
+          internal_poller_impl)
+      : internal_poller_impl_(internal_poller_impl) {}
+
+  std::weak_ptr<internal::MultiOutputStreamPollerImpl> internal_poller_impl_;
+
+  friend class CalculatorGraph;
+};
+
 }  // namespace mediapipe
 
 #endif  // MEDIAPIPE_FRAMEWORK_OUTPUT_STREAM_POLLER_H_
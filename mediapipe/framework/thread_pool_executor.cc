@@ -70,6 +70,15 @@ absl::StatusOr<Executor*> ThreadPoolExecutor::Create(
     default:
       break;
   }
+  if (options.has_numa_node()) {
+    auto cpu_ids_or_status = GetNumaNodeCpuIds(options.numa_node());
+    if (!cpu_ids_or_status.ok()) {
+      return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "The numa_node field in ThreadPoolExecutorOptions is invalid: "
+             << cpu_ids_or_status.status().message();
+    }
+    thread_options.set_cpu_set(cpu_ids_or_status.value());
+  }
 #endif
   return new ThreadPoolExecutor(thread_options, options.num_threads());
 }
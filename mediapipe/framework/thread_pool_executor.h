@@ -15,6 +15,8 @@
 #ifndef MEDIAPIPE_FRAMEWORK_THREAD_POOL_EXECUTOR_H_
 #define MEDIAPIPE_FRAMEWORK_THREAD_POOL_EXECUTOR_H_
 
+#include <set>
+
 #include "mediapipe/framework/deps/thread_options.h"
 #include "mediapipe/framework/executor.h"
 #include "mediapipe/framework/port/statusor.h"
@@ -36,6 +38,10 @@ class ThreadPoolExecutor : public Executor {
   int num_threads() const { return thread_pool_.num_threads(); }
   // Returns the thread stack size (in bytes).
   size_t stack_size() const { return stack_size_; }
+  // Returns the processors the worker threads are bound to, or an empty set.
+  const std::set<int>& cpu_set() const {
+    return thread_pool_.thread_options().cpu_set();
+  }
 
  private:
   ThreadPoolExecutor(const ThreadOptions& thread_options, int num_threads);
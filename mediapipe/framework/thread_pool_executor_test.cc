@@ -0,0 +1,160 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/thread_pool_executor.h"
+
+#include <sched.h>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+#include "mediapipe/framework/mediapipe_options.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/thread_pool_executor.pb.h"
+#include "mediapipe/util/cpu_util.h"
+
+ABSL_DECLARE_FLAG(std::string, system_numa_node_cpulist_file);
+
+namespace mediapipe {
+namespace {
+
+MediaPipeOptions NumaNodeExecutorOptions(int num_threads, int numa_node) {
+  MediaPipeOptions options;
+  auto* executor_options =
+      options.MutableExtension(ThreadPoolExecutorOptions::ext);
+  executor_options->set_num_threads(num_threads);
+  if (numa_node >= 0) {
+    executor_options->set_numa_node(numa_node);
+  }
+  return options;
+}
+
+#if defined(__linux__)
+class ThreadPoolExecutorNumaTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    saved_cpulist_file_ = absl::GetFlag(FLAGS_system_numa_node_cpulist_file);
+    const std::string pattern =
+        absl::StrCat(getenv("TEST_TMPDIR"), "/node$0_cpulist");
+    absl::SetFlag(&FLAGS_system_numa_node_cpulist_file, pattern);
+    // A fake NUMA node 0 with CPU 0 only, which every machine has.
+    MP_ASSERT_OK(file::SetContents(
+        absl::StrCat(getenv("TEST_TMPDIR"), "/node0_cpulist"), "0\n"));
+  }
+
+  void TearDown() override {
+    absl::SetFlag(&FLAGS_system_numa_node_cpulist_file, saved_cpulist_file_);
+  }
+
+  std::string saved_cpulist_file_;
+};
+
+TEST_F(ThreadPoolExecutorNumaTest, BindsWorkerThreadsToNumaNode) {
+  auto executor_or = ThreadPoolExecutor::Create(NumaNodeExecutorOptions(2, 0));
+  MP_ASSERT_OK(executor_or);
+  std::unique_ptr<ThreadPoolExecutor> executor(
+      static_cast<ThreadPoolExecutor*>(executor_or.value()));
+  EXPECT_THAT(executor->cpu_set(), testing::ElementsAre(0));
+
+  absl::Notification done;
+  int cpu = -1;
+  executor->Schedule([&cpu, &done] {
+    cpu = sched_getcpu();
+    done.Notify();
+  });
+  done.WaitForNotification();
+  EXPECT_EQ(0, cpu);
+}
+
+TEST_F(ThreadPoolExecutorNumaTest, RejectsUnknownNumaNode) {
+  auto executor_or = ThreadPoolExecutor::Create(NumaNodeExecutorOptions(2, 1));
+  EXPECT_EQ(absl::StatusCode::kInvalidArgument,
+            executor_or.status().code());
+}
+#endif  // defined(__linux__)
+
+void HandOffBuffer(Executor* executor, int remaining,
+                   std::vector<float> buffer, absl::BlockingCounter* done) {
+  for (float& value : buffer) {
+    value = value * 0.5f + 1.0f;
+  }
+  benchmark::DoNotOptimize(buffer.data());
+  if (remaining == 0) {
+    done->DecrementCount();
+    return;
+  }
+  // Like an output packet, the next buffer is allocated and first written by
+  // this worker thread, and read by the next one.
+  std::vector<float> next(buffer);
+  executor->Schedule(
+      [executor, remaining, next = std::move(next), done]() mutable {
+        HandOffBuffer(executor, remaining - 1, std::move(next), done);
+      });
+}
+
+// Measures chains of tasks each handing a 4 MB buffer to the next, the way
+// calculators hand packets downstream. On a multi-socket machine, compare an
+// executor bound to one NUMA node with an unbound one, whose buffers move
+// across sockets, using the real cpulist files.
+// Arg: NUMA node, or -1 for an unbound executor.
+void BM_HandOffBuffers(benchmark::State& state) {
+  constexpr int kNumChains = 16;
+  constexpr int kChainLength = 16;
+  constexpr int kBufferSize = 1 << 20;
+  const int numa_node = state.range(0);
+  int num_threads = NumCPUCores();
+  if (numa_node >= 0) {
+    auto cpu_ids_or = GetNumaNodeCpuIds(numa_node);
+    if (!cpu_ids_or.ok()) {
+      state.SkipWithError(cpu_ids_or.status().ToString().c_str());
+      return;
+    }
+    num_threads = cpu_ids_or.value().size();
+  }
+  auto executor_or = ThreadPoolExecutor::Create(
+      NumaNodeExecutorOptions(num_threads, numa_node));
+  if (!executor_or.ok()) {
+    state.SkipWithError(executor_or.status().ToString().c_str());
+    return;
+  }
+  std::unique_ptr<Executor> executor(executor_or.value());
+
+  for (auto _ : state) {
+    absl::BlockingCounter done(kNumChains);
+    for (int chain = 0; chain < kNumChains; ++chain) {
+      executor->Schedule([&executor, &done] {
+        HandOffBuffer(executor.get(), kChainLength,
+                      std::vector<float>(kBufferSize, 1.0f), &done);
+      });
+    }
+    done.Wait();
+  }
+  state.SetBytesProcessed(state.iterations() * kNumChains *
+                          (kChainLength + 1) * kBufferSize * sizeof(float));
+}
+BENCHMARK(BM_HandOffBuffers)->Arg(-1)->Arg(0)->Arg(1)->UseRealTime();
+
+}  // namespace
+}  // namespace mediapipe
@@ -16,7 +16,9 @@
 
 #include <algorithm>
 #include <cstdint>  // required by avutil.h
+#include <cmath>
 #include <cstdlib>
+#include <limits>
 #include <memory>
 #include <string>
 
@@ -57,6 +59,9 @@ const int64 kMpegPtsEpoch = 1LL << 33;
 // Maximum PTS change between frames. Larger changes are considered to indicate
 // the MPEG PTS has rolled over. Unit is PTS ticks.
 const int64 kMpegPtsMaxDelta = kMpegPtsEpoch / 2;
+// Seeks start this long before the requested time, so that codecs which need
+// the preceding packets to decode a frame (e.g. AAC, Opus) receive them.
+const int64 kSeekPrerollMicroseconds = 100000;
 
 // BasePacketProcessor
 namespace {
@@ -255,6 +260,17 @@ absl::Status BasePacketProcessor::Flush() {
   return absl::OkStatus();
 }
 
+void BasePacketProcessor::Reset() {
+  if (avcodec_ctx_) {
+    avcodec_flush_buffers(avcodec_ctx_);
+  }
+  buffer_.clear();
+  flushed_ = false;
+  num_frames_processed_ = 0;
+  last_frame_time_regression_detected_ = false;
+  rollover_corrected_last_pts_ = AV_NOPTS_VALUE;
+}
+
 void BasePacketProcessor::Close() {
   if (avcodec_ctx_) {
     if (avcodec_ctx_->codec) {
@@ -576,6 +592,12 @@ absl::Status AudioPacketProcessor::FillHeader(TimeSeriesHeader* header) const {
   return absl::OkStatus();
 }
 
+void AudioPacketProcessor::Reset() {
+  BasePacketProcessor::Reset();
+  last_timestamp_ = Timestamp::Unset();
+  expected_sample_number_ = 0;
+}
+
 int64 AudioPacketProcessor::MaybeCorrectPtsForRollover(int64 media_pts) {
   return options_.correct_pts_for_rollover() ? CorrectPtsForRollover(media_pts)
                                              : media_pts;
@@ -676,6 +698,13 @@ absl::Status AudioDecoder::Initialize(
 
   if (options.has_start_time()) {
     start_time_ = Timestamp::FromSeconds(options.start_time());
+    // Rather than decoding and dropping everything before the start time,
+    // seek close to it.  If the input is not seekable, decode from the start.
+    const absl::Status status = Seek(start_time_);
+    if (!status.ok()) {
+      LOG(WARNING) << "Decoding from the start of " << input_file << ": "
+                   << status.message();
+    }
   }
   if (options.has_end_time()) {
     end_time_ = Timestamp::FromSeconds(options.end_time());
@@ -687,6 +716,9 @@ absl::Status AudioDecoder::Initialize(
 }
 
 absl::Status AudioDecoder::GetData(int* options_index, Packet* data) {
+  // Interleaved calls to ReadSamples() must seek.
+  pending_packet_ = Packet();
+  next_sample_ = -1;
   while (true) {
     for (auto& item : audio_processor_) {
       while (item.second && item.second->HasData()) {
@@ -735,6 +767,109 @@ absl::Status AudioDecoder::GetData(int* options_index, Packet* data) {
   return absl::OkStatus();
 }
 
+absl::Status AudioDecoder::Seek(Timestamp time) {
+  RET_CHECK(avformat_ctx_) << "The media file is not open.";
+  const int64 target_microseconds =
+      std::max<int64>(0, time.Microseconds() - kSeekPrerollMicroseconds);
+  const int64 target = av_rescale(target_microseconds, AV_TIME_BASE, 1000000);
+  // Seek to the last position at or before the target in any stream.
+  const int ret =
+      avformat_seek_file(avformat_ctx_, /*stream_index=*/-1,
+                         std::numeric_limits<int64>::min(), target, target, 0);
+  if (ret < 0) {
+    return UnknownError(absl::StrCat("Failed to seek to ", time.DebugString(),
+                                     ": ", AvErrorToString(ret)));
+  }
+  for (auto& item : audio_processor_) {
+    if (item.second) {
+      item.second->Reset();
+    }
+  }
+  flushed_ = false;
+  pending_packet_ = Packet();
+  next_sample_ = -1;
+  return absl::OkStatus();
+}
+
+absl::Status AudioDecoder::ReadSamples(int options_index, int64 start_sample,
+                                       Matrix* output,
+                                       int64* num_samples_read) {
+  RET_CHECK(output);
+  RET_CHECK(num_samples_read);
+  AudioPacketProcessor* processor;
+  MP_RETURN_IF_ERROR(GetAudioProcessor(options_index, &processor));
+  TimeSeriesHeader header;
+  MP_RETURN_IF_ERROR(processor->FillHeader(&header));
+  RET_CHECK_EQ(output->rows(), header.num_channels());
+  const double sample_rate = header.sample_rate();
+
+  if (options_index != pending_options_index_ || start_sample != next_sample_) {
+    MP_RETURN_IF_ERROR(
+        Seek(Timestamp::FromSeconds(start_sample / sample_rate)));
+    pending_options_index_ = options_index;
+  }
+
+  int64 num_read = 0;
+  while (num_read < output->cols()) {
+    if (pending_packet_.IsEmpty()) {
+      if (processor->HasData()) {
+        MP_RETURN_IF_ERROR(processor->GetData(&pending_packet_));
+      } else if (flushed_) {
+        break;
+      } else {
+        MP_RETURN_IF_ERROR(ProcessPacket());
+        // Drop what was decoded for the other streams.
+        for (auto& item : audio_processor_) {
+          while (item.second && item.second.get() != processor &&
+                 item.second->HasData()) {
+            Packet dropped;
+            MP_RETURN_IF_ERROR(item.second->GetData(&dropped));
+          }
+        }
+      }
+      continue;
+    }
+    const Matrix& samples = pending_packet_.Get<Matrix>();
+    const int64 packet_start_sample =
+        std::llround(pending_packet_.Timestamp().Seconds() * sample_rate);
+    const int64 offset = start_sample + num_read - packet_start_sample;
+    if (offset < 0) {
+      // The stream has a gap before this packet.
+      const int64 num_zeros =
+          std::min<int64>(-offset, output->cols() - num_read);
+      output->middleCols(num_read, num_zeros).setZero();
+      num_read += num_zeros;
+      continue;
+    }
+    const int64 num_copied =
+        std::min<int64>(std::max<int64>(0, samples.cols() - offset),
+                 output->cols() - num_read);
+    output->middleCols(num_read, num_copied) =
+        samples.middleCols(offset, num_copied);
+    num_read += num_copied;
+    if (offset + num_copied >= samples.cols()) {
+      pending_packet_ = Packet();
+    }
+  }
+  *num_samples_read = num_read;
+  next_sample_ = start_sample + num_read;
+  return absl::OkStatus();
+}
+
+absl::Status AudioDecoder::GetAudioProcessor(
+    int options_index, AudioPacketProcessor** processor) {
+  for (const auto& item : stream_id_to_audio_options_index_) {
+    if (item.second == options_index) {
+      const auto& processor_ptr = audio_processor_[item.first];
+      RET_CHECK(processor_ptr) << "audio stream is not open.";
+      *processor = processor_ptr.get();
+      return absl::OkStatus();
+    }
+  }
+  return absl::NotFoundError(
+      absl::StrCat("No audio stream with options index ", options_index));
+}
+
 absl::Status AudioDecoder::Close() {
   for (auto& item : audio_processor_) {
     if (item.second) {
@@ -22,6 +22,7 @@
 
 #include "absl/flags/flag.h"
 #include "absl/time/time.h"
+#include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
 #include "mediapipe/framework/packet.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -67,6 +68,11 @@ class BasePacketProcessor {
   // be flushed to get any remaining frames which the codec is buffering.
   absl::Status Flush();
 
+  // Discards the buffered frames and the codec state, so that packets from a
+  // new position in the file can be processed after seeking.  Timestamps are
+  // resynchronized to the first decoded frame.
+  virtual void Reset();
+
   // Closes the Processor, this does not close the file.  You may not
   // call ProcessPacket() after calling Close().  Close() may be called
   // repeatedly.
@@ -138,6 +144,8 @@ class AudioPacketProcessor : public BasePacketProcessor {
 
   absl::Status FillHeader(TimeSeriesHeader* header) const;
 
+  void Reset() override;
+
  private:
   // Appends audio in buffer(s) to the output buffer (buffer_).
   absl::Status AddAudioDataToBuffer(const Timestamp output_timestamp,
@@ -189,6 +197,12 @@ class AudioPacketProcessor : public BasePacketProcessor {
 // Decode the audio streams of a media file.  The AudioDecoder is responsible
 // for demuxing the audio streams in the container format, whereas decoding of
 // the content is delegated to AudioPacketProcessor.
+//
+// Besides decoding the whole file forward with GetData(), ranges of samples
+// can be read with ReadSamples(), which seeks in the file and decodes only the
+// packets around the range.  An AudioDecoder is not thread-safe; to decode
+// disjoint ranges of the same file in parallel, use one AudioDecoder per
+// thread.
 class AudioDecoder {
  public:
   AudioDecoder();
@@ -199,6 +213,22 @@ class AudioDecoder {
 
   absl::Status GetData(int* options_index, Packet* data);
 
+  // Seeks all the audio streams to the given time, such that the next packets
+  // returned by GetData() start at or before it.
+  absl::Status Seek(Timestamp time);
+
+  // Reads the samples of the audio stream with the given options index,
+  // starting at sample number start_sample (counted from timestamp zero at the
+  // stream sample rate), into the preallocated output matrix.  Reads as many
+  // samples as output has columns, and output must have as many rows as the
+  // stream has channels.  Only seeks if the range does not continue the
+  // previous call.  Gaps in the stream are filled with zeros.  Sets
+  // num_samples_read to the number of samples read, which is less than
+  // requested only at the end of the file.  The start_time and end_time
+  // options only apply to GetData().
+  absl::Status ReadSamples(int options_index, int64 start_sample,
+                           Matrix* output, int64* num_samples_read);
+
   absl::Status Close();
 
   absl::Status FillAudioHeader(const AudioStreamOptions& stream_option,
@@ -208,6 +238,10 @@ class AudioDecoder {
   absl::Status ProcessPacket();
   absl::Status Flush();
 
+  // Returns the processor of the audio stream with the given options index.
+  absl::Status GetAudioProcessor(int options_index,
+                                 AudioPacketProcessor** processor);
+
   std::map<int, int> stream_id_to_audio_options_index_;
   std::map<int, int> stream_index_to_stream_id_;
   std::map<int, std::unique_ptr<AudioPacketProcessor>> audio_processor_;
@@ -220,6 +254,12 @@ class AudioDecoder {
   Timestamp start_time_ = Timestamp::Unset();
   Timestamp end_time_ = Timestamp::Unset();
 
+  // The packet that ReadSamples() took from the processor but did not read
+  // completely, and the sample number following the last read range.
+  Packet pending_packet_;
+  int pending_options_index_ = -1;
+  int64 next_sample_ = -1;
+
   AVFormatContext* avformat_ctx_ = nullptr;
 };
 
@@ -0,0 +1,234 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/audio_decoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// 2 seconds of a 1 kHz sine wave, 44.1 kHz mono.
+const char kWavFile[] = "sine_wave_1k_44100_mono_2_sec_wav.audio";
+const char kAacFile[] = "sine_wave_1k_44100_stereo_2_sec_aac.audio";
+const char kMp3File[] = "sine_wave_1k_44100_stereo_2_sec_mp3.audio";
+const int kNumSamples = 88200;
+// Threads and samples per thread for parallel decoding.
+const int kNumThreads = 4;
+const int kRangeSize = kNumSamples / kNumThreads;
+
+std::string GetTestFilePath(const std::string& file_name) {
+  return file::JoinPath("./", "/mediapipe/calculators/audio/testdata/",
+                        file_name);
+}
+
+void InitializeDecoder(AudioDecoder* decoder,
+                       const std::string& file_name = kWavFile,
+                       const std::string& extra_options = "") {
+  MP_ASSERT_OK(decoder->Initialize(
+      GetTestFilePath(file_name),
+      ParseTextProtoOrDie<AudioDecoderOptions>(absl::StrCat(
+          "audio_stream { stream_index: 0 } ", extra_options))));
+}
+
+// Returns the packets of the test file decoded with GetData(), from the
+// first one at or after start_seconds on.  Like AudioDecoder did before it
+// could seek, decodes the file from the start and drops the earlier packets.
+std::vector<Packet> DecodeAndDrop(const std::string& file_name,
+                                  double start_seconds) {
+  AudioDecoder decoder;
+  InitializeDecoder(&decoder, file_name);
+  std::vector<Packet> packets;
+  int options_index;
+  Packet packet;
+  while (decoder.GetData(&options_index, &packet).ok()) {
+    if (packet.Timestamp() >= Timestamp::FromSeconds(start_seconds)) {
+      packets.push_back(packet);
+    }
+  }
+  return packets;
+}
+
+// Returns all the samples of the test file, decoded with GetData(), such
+// that column n holds sample number n.  Gaps in the stream are zeros.
+Matrix DecodeAll(const std::string& file_name = kWavFile) {
+  AudioDecoder decoder;
+  InitializeDecoder(&decoder, file_name);
+  TimeSeriesHeader header;
+  MP_EXPECT_OK(decoder.FillAudioHeader(
+      ParseTextProtoOrDie<AudioStreamOptions>("stream_index: 0"), &header));
+  Matrix all_samples(header.num_channels(), 0);
+  int options_index;
+  Packet packet;
+  while (decoder.GetData(&options_index, &packet).ok()) {
+    const Matrix& samples = packet.Get<Matrix>();
+    const int64 start_sample =
+        std::llround(packet.Timestamp().Seconds() * header.sample_rate());
+    const int64 skipped = std::max<int64>(0, -start_sample);
+    if (skipped >= samples.cols()) {
+      continue;
+    }
+    const int64 end_sample = start_sample + samples.cols();
+    if (end_sample > all_samples.cols()) {
+      const int64 num_cols = all_samples.cols();
+      all_samples.conservativeResize(Eigen::NoChange, end_sample);
+      all_samples.rightCols(end_sample - num_cols).setZero();
+    }
+    all_samples.middleCols(start_sample + skipped, samples.cols() - skipped) =
+        samples.rightCols(samples.cols() - skipped);
+  }
+  return all_samples;
+}
+
+// Reads out of order ranges, which require seeking, starting in the middle
+// of packets, and compares them with the samples decoded without seeking.
+void CheckSampleAccurateRanges(const std::string& file_name) {
+  const Matrix expected = DecodeAll(file_name);
+  ASSERT_GE(expected.cols(), kNumSamples);
+
+  AudioDecoder decoder;
+  InitializeDecoder(&decoder, file_name);
+  for (const int start_sample : {44117, 1234, 70001, 0}) {
+    Matrix output(expected.rows(), 1000);
+    int64 num_samples_read;
+    MP_ASSERT_OK(
+        decoder.ReadSamples(0, start_sample, &output, &num_samples_read));
+    ASSERT_EQ(1000, num_samples_read);
+    EXPECT_TRUE(expected.middleCols(start_sample, 1000).isApprox(output))
+        << "start_sample=" << start_sample;
+  }
+}
+
+TEST(AudioDecoderTest, ReadsSampleAccurateRanges) {
+  const Matrix expected = DecodeAll();
+  ASSERT_EQ(kNumSamples, expected.cols());
+
+  AudioDecoder decoder;
+  InitializeDecoder(&decoder);
+  // Out of order ranges, which require seeking, starting in the middle of
+  // packets.
+  for (const int start_sample : {44117, 1234, 70001, 0}) {
+    Matrix output(1, 1000);
+    int64 num_samples_read;
+    MP_ASSERT_OK(
+        decoder.ReadSamples(0, start_sample, &output, &num_samples_read));
+    ASSERT_EQ(1000, num_samples_read);
+    EXPECT_EQ(expected.middleCols(start_sample, 1000), output)
+        << "start_sample=" << start_sample;
+  }
+}
+
+// AAC frames depend on the preceding frame, so ranges are only sample
+// accurate if the seek preroll decodes it.
+TEST(AudioDecoderTest, ReadsSampleAccurateRangesFromAac) {
+  CheckSampleAccurateRanges(kAacFile);
+}
+
+// With start_time, Initialize() seeks, which must output the same packets
+// as decoding from the start and dropping the packets before start_time.
+TEST(AudioDecoderTest, StartTimeMatchesDecodeAndDrop) {
+  for (const char* file_name : {kAacFile, kMp3File}) {
+    for (const double start_seconds : {0.05, 0.5, 1.2345}) {
+      const std::vector<Packet> expected =
+          DecodeAndDrop(file_name, start_seconds);
+      ASSERT_FALSE(expected.empty());
+
+      AudioDecoder decoder;
+      InitializeDecoder(&decoder, file_name,
+                        absl::StrCat("start_time: ", start_seconds));
+      std::vector<Packet> packets;
+      int options_index;
+      Packet packet;
+      while (decoder.GetData(&options_index, &packet).ok()) {
+        packets.push_back(packet);
+      }
+
+      ASSERT_EQ(expected.size(), packets.size())
+          << file_name << " start_seconds=" << start_seconds;
+      EXPECT_EQ(expected[0].Timestamp(), packets[0].Timestamp())
+          << file_name << " start_seconds=" << start_seconds;
+      for (int i = 0; i < packets.size(); ++i) {
+        EXPECT_TRUE(
+            expected[i].Get<Matrix>().isApprox(packets[i].Get<Matrix>()))
+            << file_name << " start_seconds=" << start_seconds
+            << " packet " << i;
+      }
+    }
+  }
+}
+
+TEST(AudioDecoderTest, ReadsContiguousRanges) {
+  const Matrix expected = DecodeAll();
+
+  AudioDecoder decoder;
+  InitializeDecoder(&decoder);
+  Matrix output(1, 999);
+  int64 start_sample = 0;
+  int64 num_samples_read;
+  do {
+    MP_ASSERT_OK(
+        decoder.ReadSamples(0, start_sample, &output, &num_samples_read));
+    EXPECT_EQ(expected.middleCols(start_sample, num_samples_read),
+              output.leftCols(num_samples_read));
+    start_sample += num_samples_read;
+  } while (num_samples_read == output.cols());
+  // The last range is truncated at the end of the file.
+  EXPECT_EQ(kNumSamples, start_sample);
+}
+
+TEST(AudioDecoderTest, ReadsDisjointRangesInParallel) {
+  const Matrix expected = DecodeAll();
+  std::vector<Matrix> outputs(kNumThreads, Matrix(1, kRangeSize));
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([i, &outputs] {
+      // Each thread has its own decoder of the same file.
+      AudioDecoder decoder;
+      InitializeDecoder(&decoder);
+      int64 num_samples_read;
+      MP_EXPECT_OK(decoder.ReadSamples(0, i * kRangeSize, &outputs[i],
+                                       &num_samples_read));
+      EXPECT_EQ(kRangeSize, num_samples_read);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_EQ(expected.middleCols(i * kRangeSize, kRangeSize), outputs[i]);
+  }
+}
+
+TEST(AudioDecoderTest, ChecksNumChannels) {
+  AudioDecoder decoder;
+  InitializeDecoder(&decoder);
+  Matrix output(2, 100);
+  int64 num_samples_read;
+  EXPECT_FALSE(decoder.ReadSamples(0, 0, &output, &num_samples_read).ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
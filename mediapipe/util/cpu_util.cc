@@ -28,6 +28,7 @@
 #include "absl/algorithm/container.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "mediapipe/framework/port/canonical_errors.h"
@@ -38,6 +39,10 @@ ABSL_FLAG(std::string, system_cpu_max_freq_file,
           "/sys/devices/system/cpu/cpu$0/cpufreq/cpuinfo_max_freq",
           "The file pattern for CPU max frequencies, where $0 will be replaced "
           "with the CPU id.");
+ABSL_FLAG(std::string, system_numa_node_cpulist_file,
+          "/sys/devices/system/node/node$0/cpulist",
+          "The file pattern for the CPU lists of NUMA nodes, where $0 will be "
+          "replaced with the NUMA node id.");
 
 namespace mediapipe {
 namespace {
@@ -136,4 +141,49 @@ std::set<int> InferHigherCoreIds() {
   return InferLowerOrHigherCoreIds(/* lower= */ false);
 }
 
+absl::StatusOr<std::set<int>> GetNumaNodeCpuIds(int numa_node) {
+  const std::string pattern =
+      absl::GetFlag(FLAGS_system_numa_node_cpulist_file);
+  if (pattern.find("$0") == std::string::npos) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid NUMA node cpulist file: ", pattern));
+  }
+  if (numa_node < 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid NUMA node: ", numa_node));
+  }
+  const std::string path = absl::Substitute(pattern, numa_node);
+  std::ifstream file(path);
+  std::string cpulist;
+  if (!file.is_open() || !std::getline(file, cpulist)) {
+    return absl::NotFoundError(absl::StrCat("Couldn't read ", path));
+  }
+  // The cpulist is a comma separated list of CPU ids and ranges of CPU ids,
+  // e.g. "0-3,8-11".
+  std::set<int> cpu_ids;
+  for (absl::string_view range :
+       absl::StrSplit(cpulist, ',', absl::SkipWhitespace())) {
+    std::pair<absl::string_view, absl::string_view> bounds =
+        absl::StrSplit(range, absl::MaxSplits('-', 1));
+    int first;
+    if (!absl::SimpleAtoi(bounds.first, &first)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Invalid cpulist in ", path, ": ", cpulist));
+    }
+    int last = first;
+    if (!bounds.second.empty() && !absl::SimpleAtoi(bounds.second, &last)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Invalid cpulist in ", path, ": ", cpulist));
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpu_ids.insert(cpu);
+    }
+  }
+  if (cpu_ids.empty()) {
+    return absl::NotFoundError(
+        absl::StrCat("NUMA node ", numa_node, " has no CPUs."));
+  }
+  return cpu_ids;
+}
+
 }  // namespace mediapipe.
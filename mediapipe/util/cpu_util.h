@@ -17,6 +17,8 @@
 
 #include <set>
 
+#include "mediapipe/framework/port/statusor.h"
+
 namespace mediapipe {
 // Returns the number of CPU cores. Compatible with Android.
 int NumCPUCores();
@@ -24,6 +26,8 @@ int NumCPUCores();
 std::set<int> InferLowerCoreIds();
 // Returns a set of inferred CPU ids of higher cores.
 std::set<int> InferHigherCoreIds();
+// Returns the set of CPU ids of a NUMA node. Linux only.
+absl::StatusOr<std::set<int>> GetNumaNodeCpuIds(int numa_node);
 }  // namespace mediapipe
 
 #endif  // MEDIAPIPE_UTIL_CPU_UTIL_H_
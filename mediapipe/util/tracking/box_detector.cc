@@ -14,6 +14,9 @@
 
 #include "mediapipe/util/tracking/box_detector.h"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <vector>
 
 #include "absl/memory/memory.h"
@@ -22,7 +25,9 @@
 #include "mediapipe/framework/port/opencv_video_inc.h"
 #include "mediapipe/util/tracking/box_detector.pb.h"
 #include "mediapipe/util/tracking/box_tracker.h"
+#include "mediapipe/util/tracking/descriptor_lsh_index.h"
 #include "mediapipe/util/tracking/measure_time.h"
+#include "mediapipe/util/tracking/parallel_invoker.h"
 
 namespace mediapipe {
 
@@ -92,10 +97,51 @@ class BoxDetectorOpencvBfImpl : public BoxDetectorInterface {
   cv::BFMatcher bf_matcher_;
 };
 
+// Matches features of all boxes at once against a multi-probe LSH index
+// (see descriptor_lsh_index.h) over all features in the index. Query features
+// are processed in parallel. Cross validation is approximated by keeping
+// for each box feature only the closest of all query features matched to it.
+class BoxDetectorLshImpl : public BoxDetectorInterface {
+ public:
+  explicit BoxDetectorLshImpl(const BoxDetectorOptions &options);
+
+ private:
+  struct DescriptorMatch {
+    int box_idx;
+    int query_idx;
+    int index_row;  // Row within feature_descriptors_[box_idx].
+    float distance;
+  };
+
+  std::vector<FeatureCorrespondence> MatchFeatureDescriptors(
+      const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
+      int box_idx) override;
+
+  void PrepareFeatureMatching(const std::vector<Vector2_f> &features,
+                              const cv::Mat &descriptors,
+                              const std::vector<int> &box_indices) override;
+
+  void OnIndexChanged() override { search_index_outdated_ = true; }
+
+  // Rebuilds (or loads) search index over all features if outdated.
+  void UpdateSearchIndex();
+
+  std::unique_ptr<DescriptorLshIndex> search_index_;
+  bool search_index_outdated_ = true;
+  // Maps ids of the search index to box index and row in
+  // feature_descriptors_.
+  std::vector<int> search_id_to_box_;
+  std::vector<int> search_id_to_row_;
+  // Matches of the current frame per box, set by PrepareFeatureMatching.
+  std::vector<std::vector<DescriptorMatch>> box_matches_;
+};
+
 std::unique_ptr<BoxDetectorInterface> BoxDetectorInterface::Create(
     const BoxDetectorOptions &options) {
   if (options.index_type() == BoxDetectorOptions::OPENCV_BF) {
     return absl::make_unique<BoxDetectorOpencvBfImpl>(options);
+  } else if (options.index_type() == BoxDetectorOptions::LSH_MULTI_PROBE) {
+    return absl::make_unique<BoxDetectorLshImpl>(options);
   } else {
     LOG(FATAL) << "index type undefined.";
   }
@@ -153,21 +199,30 @@ void BoxDetectorInterface::DetectAndAddBoxFromFeatures(
     }
   }
 
+  std::vector<int> boxes_to_detect;
   for (int idx = 0; idx < size_before_add; ++idx) {
     if ((options_.has_detect_every_n_frame() > 0 &&
          cnt_detect_called_ % options_.detect_every_n_frame() == 0) ||
         !tracked[idx] ||
         (options_.detect_out_of_fov() && has_been_out_of_fov_[idx])) {
-      TimedBoxProtoList det = DetectBox(features, descriptors, idx);
-      if (det.box_size() > 0) {
-        det.mutable_box(0)->set_time_msec(timestamp_msec);
+      boxes_to_detect.push_back(idx);
+    }
+  }
 
-        // Convert the result box to normalized space.
-        ScaleBox(1.0f / scale_x, 1.0f / scale_y, det.mutable_box(0));
-        *detected_boxes->add_box() = det.box(0);
+  if (!boxes_to_detect.empty()) {
+    PrepareFeatureMatching(features, descriptors, boxes_to_detect);
+  }
 
-        has_been_out_of_fov_[idx] = false;
-      }
+  for (int idx : boxes_to_detect) {
+    TimedBoxProtoList det = DetectBox(features, descriptors, idx);
+    if (det.box_size() > 0) {
+      det.mutable_box(0)->set_time_msec(timestamp_msec);
+
+      // Convert the result box to normalized space.
+      ScaleBox(1.0f / scale_x, 1.0f / scale_y, det.mutable_box(0));
+      *detected_boxes->add_box() = det.box(0);
+
+      has_been_out_of_fov_[idx] = false;
     }
   }
 
@@ -619,6 +674,8 @@ void BoxDetectorInterface::AddBoxFeaturesToIndex(
     for (int j = 0; j < insider_idx.size(); ++j) {
       feature_to_frame_[box_idx].push_back(frame_id);
     }
+
+    OnIndexChanged();
   }
 }
 
@@ -640,6 +697,8 @@ void BoxDetectorInterface::CancelBoxDetection(int box_id) {
     for (int j = erase_idx; j < box_idx_to_id_.size(); ++j) {
       box_id_to_idx_[box_idx_to_id_[j]] = j;
     }
+
+    OnIndexChanged();
   }
 }
 
@@ -746,4 +805,188 @@ BoxDetectorOpencvBfImpl::MatchFeatureDescriptors(
   return correspondence_result;
 }
 
+BoxDetectorLshImpl::BoxDetectorLshImpl(const BoxDetectorOptions &options)
+    : BoxDetectorInterface(options) {}
+
+void BoxDetectorLshImpl::UpdateSearchIndex() {
+  if (!search_index_outdated_) {
+    return;
+  }
+  search_index_outdated_ = false;
+  search_index_.reset();
+  search_id_to_box_.clear();
+  search_id_to_row_.clear();
+
+  std::vector<const float *> index_descriptors;
+  for (int box_idx = 0; box_idx < feature_descriptors_.size(); ++box_idx) {
+    const cv::Mat &box_descriptors = feature_descriptors_[box_idx];
+    CHECK_EQ(box_descriptors.type(), CV_32F);
+    for (int row = 0; row < box_descriptors.rows; ++row) {
+      index_descriptors.push_back(box_descriptors.ptr<float>(row));
+      search_id_to_box_.push_back(box_idx);
+      search_id_to_row_.push_back(row);
+    }
+  }
+
+  if (index_descriptors.empty()) {
+    return;
+  }
+
+  const int dims = feature_descriptors_[search_id_to_box_[0]].cols;
+  const auto &settings = options_.lsh_index_settings();
+  const std::string &filename = settings.index_filename();
+  if (!filename.empty() && std::ifstream(filename).good()) {
+    std::unique_ptr<DescriptorLshIndex> mapped_index =
+        DescriptorLshIndex::Open(filename);
+    if (mapped_index != nullptr && mapped_index->dims() == dims &&
+        mapped_index->num_descriptors() == index_descriptors.size() &&
+        mapped_index->num_tables() == settings.num_tables() &&
+        mapped_index->fingerprint() ==
+            DescriptorLshIndex::Fingerprint(index_descriptors, dims)) {
+      search_index_ = std::move(mapped_index);
+      return;
+    }
+    LOG(INFO) << "Search index file " << filename
+              << " does not match index, rebuilding.";
+  }
+
+  MEASURE_TIME << "Build search index";
+  DescriptorLshIndex::Options index_options;
+  index_options.num_tables = settings.num_tables();
+  index_options.num_bits = settings.num_bits();
+  index_options.seed = settings.seed();
+  search_index_ =
+      DescriptorLshIndex::Build(index_options, index_descriptors, dims);
+
+  if (!filename.empty()) {
+    search_index_->WriteToFile(filename);
+  }
+}
+
+void BoxDetectorLshImpl::PrepareFeatureMatching(
+    const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
+    const std::vector<int> &box_indices) {
+  CHECK_EQ(features.size(), descriptors.rows);
+  UpdateSearchIndex();
+
+  box_matches_.assign(frame_box_.size(), std::vector<DescriptorMatch>());
+  if (search_index_ == nullptr || descriptors.rows == 0) {
+    return;
+  }
+
+  if (descriptors.cols != search_index_->dims()) {
+    LOG(ERROR) << "Descriptor dimensions " << descriptors.cols
+               << " do not match index dimensions " << search_index_->dims();
+    return;
+  }
+
+  cv::Mat query_descriptors;
+  if (descriptors.type() == CV_32F) {
+    query_descriptors = descriptors;
+  } else {
+    descriptors.convertTo(query_descriptors, CV_32F);
+  }
+
+  std::vector<bool> detect_box(frame_box_.size(), false);
+  for (int box_idx : box_indices) {
+    detect_box[box_idx] = true;
+  }
+
+  // For each query feature, determine closest match within each box.
+  const int num_probes = options_.lsh_index_settings().num_probes();
+  const float max_match_distance = options_.max_match_distance();
+  std::vector<std::vector<DescriptorMatch>> query_matches(
+      query_descriptors.rows);
+  constexpr int kQueriesPerTask = 16;
+  ParallelFor(
+      0, query_descriptors.rows, kQueriesPerTask,
+      [this, &query_descriptors, &detect_box, &query_matches, num_probes,
+       max_match_distance](const BlockedRange &range) {
+        std::vector<int> candidates;
+        for (int query_idx = range.begin(); query_idx < range.end();
+             ++query_idx) {
+          const float *query = query_descriptors.ptr<float>(query_idx);
+          search_index_->FindCandidates(query, num_probes, &candidates);
+
+          std::vector<DescriptorMatch> &matches = query_matches[query_idx];
+          for (int id : candidates) {
+            const int box_idx = search_id_to_box_[id];
+            if (!detect_box[box_idx]) {
+              continue;
+            }
+            const float distance =
+                std::sqrt(DescriptorLshIndex::SquaredDistance(
+                    query, search_index_->descriptor(id),
+                    search_index_->dims()));
+            if (distance > max_match_distance) {
+              continue;
+            }
+            matches.push_back(
+                {box_idx, query_idx, search_id_to_row_[id], distance});
+          }
+
+          std::sort(matches.begin(), matches.end(),
+                    [](const DescriptorMatch &lhs,
+                       const DescriptorMatch &rhs) {
+                      return lhs.box_idx < rhs.box_idx ||
+                             (lhs.box_idx == rhs.box_idx &&
+                              lhs.distance < rhs.distance);
+                    });
+          matches.erase(std::unique(matches.begin(), matches.end(),
+                                    [](const DescriptorMatch &lhs,
+                                       const DescriptorMatch &rhs) {
+                                      return lhs.box_idx == rhs.box_idx;
+                                    }),
+                        matches.end());
+        }
+      });
+
+  for (const auto &matches : query_matches) {
+    for (const DescriptorMatch &match : matches) {
+      box_matches_[match.box_idx].push_back(match);
+    }
+  }
+
+  // Keep only closest query feature for each box feature.
+  for (int box_idx : box_indices) {
+    std::vector<DescriptorMatch> &matches = box_matches_[box_idx];
+    std::sort(matches.begin(), matches.end(),
+              [](const DescriptorMatch &lhs, const DescriptorMatch &rhs) {
+                return lhs.index_row < rhs.index_row ||
+                       (lhs.index_row == rhs.index_row &&
+                        lhs.distance < rhs.distance);
+              });
+    matches.erase(std::unique(matches.begin(), matches.end(),
+                              [](const DescriptorMatch &lhs,
+                                 const DescriptorMatch &rhs) {
+                                return lhs.index_row == rhs.index_row;
+                              }),
+                  matches.end());
+  }
+}
+
+std::vector<FeatureCorrespondence> BoxDetectorLshImpl::MatchFeatureDescriptors(
+    const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
+    int box_idx) {
+  CHECK_EQ(features.size(), descriptors.rows);
+
+  std::vector<FeatureCorrespondence> correspondence_result(
+      frame_box_[box_idx].size());
+  if (box_idx >= box_matches_.size()) {
+    return correspondence_result;
+  }
+
+  for (const DescriptorMatch &match : box_matches_[box_idx]) {
+    const int match_idx = feature_to_frame_[box_idx][match.index_row];
+    const Vector2_f &frame_point = features[match.query_idx];
+    const Vector2_f &index_point = feature_keypoints_[box_idx][match.index_row];
+    correspondence_result[match_idx].points_frame.push_back(
+        cv::Point2f(frame_point.x(), frame_point.y()));
+    correspondence_result[match_idx].points_index.push_back(
+        cv::Point2f(index_point.x(), index_point.y()));
+  }
+
+  return correspondence_result;
+}
+
 }  // namespace mediapipe
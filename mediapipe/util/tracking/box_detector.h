@@ -136,6 +136,16 @@ class BoxDetectorInterface {
       const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
       int box_idx) = 0;
 
+  // Called once per frame before MatchFeatureDescriptors is called for each
+  // box in `box_indices`. Allows implementations to match against all boxes
+  // at once.
+  virtual void PrepareFeatureMatching(const std::vector<Vector2_f> &features,
+                                      const cv::Mat &descriptors,
+                                      const std::vector<int> &box_indices) {}
+
+  // Called whenever features are added to or boxes removed from the index.
+  virtual void OnIndexChanged() {}
+
   // Specifies which box the correspondences come from with `box_id`, so that we
   // can figure out the transformation accordingly.
   TimedBoxProtoList FindBoxesFromFeatureCorrespondence(
@@ -0,0 +1,202 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/box_detector.h"
+
+#include <sys/stat.h>
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/util/tracking/box_detector.pb.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kDims = 40;
+constexpr int kFeaturesPerBox = 40;
+
+// Returns random descriptor of unit length, such that unrelated descriptors
+// are far apart w.r.t. BoxDetectorOptions::max_match_distance.
+std::vector<float> RandomDescriptor(std::mt19937* rng) {
+  std::normal_distribution<float> normal;
+  std::vector<float> descriptor(kDims);
+  float norm = 0;
+  for (float& value : descriptor) {
+    value = normal(*rng);
+    norm += value * value;
+  }
+  for (float& value : descriptor) {
+    value /= std::sqrt(norm);
+  }
+  return descriptor;
+}
+
+struct Features {
+  std::vector<Vector2_f> positions;
+  std::vector<std::vector<float>> descriptors;
+
+  cv::Mat DescriptorMat() const {
+    cv::Mat mat(descriptors.size(), kDims, CV_32F);
+    for (int k = 0; k < descriptors.size(); ++k) {
+      memcpy(mat.ptr<float>(k), descriptors[k].data(), kDims * sizeof(float));
+    }
+    return mat;
+  }
+};
+
+// Index with num_boxes boxes of size 0.2 x 0.2 next to each other, each
+// holding kFeaturesPerBox random features.
+BoxDetectorIndex MakeIndex(int num_boxes, std::mt19937* rng,
+                           Features* features) {
+  std::uniform_real_distribution<float> uniform(0.02f, 0.18f);
+  BoxDetectorIndex index;
+  for (int b = 0; b < num_boxes; ++b) {
+    auto* frame_entry = index.add_box_entry()->add_frame_entry();
+    TimedBoxProto* box = frame_entry->mutable_box();
+    box->set_id(b);
+    box->set_left(0.2f * (b % 4));
+    box->set_right(box->left() + 0.2f);
+    box->set_top(0.2f * (b / 4));
+    box->set_bottom(box->top() + 0.2f);
+    for (int k = 0; k < kFeaturesPerBox; ++k) {
+      const Vector2_f position(box->left() + uniform(*rng),
+                               box->top() + uniform(*rng));
+      const std::vector<float> descriptor = RandomDescriptor(rng);
+      frame_entry->add_keypoints(position.x());
+      frame_entry->add_keypoints(position.y());
+      frame_entry->add_descriptors()->set_data(
+          reinterpret_cast<const char*>(descriptor.data()),
+          kDims * sizeof(float));
+      features->positions.push_back(position);
+      features->descriptors.push_back(descriptor);
+    }
+  }
+  return index;
+}
+
+// Returns the features of box box_id, translated by offset and with slightly
+// perturbed descriptors, mixed with unrelated features.
+Features MakeQuery(const Features& index_features, int box_id,
+                   const Vector2_f& offset, std::mt19937* rng) {
+  std::normal_distribution<float> noise(0.0f, 0.005f);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  Features query;
+  for (int k = 0; k < kFeaturesPerBox; ++k) {
+    const int idx = box_id * kFeaturesPerBox + k;
+    query.positions.push_back(index_features.positions[idx] + offset);
+    std::vector<float> descriptor = index_features.descriptors[idx];
+    for (float& value : descriptor) {
+      value += noise(*rng);
+    }
+    query.descriptors.push_back(descriptor);
+
+    query.positions.push_back(Vector2_f(uniform(*rng), uniform(*rng)));
+    query.descriptors.push_back(RandomDescriptor(rng));
+  }
+  return query;
+}
+
+TimedBoxProtoList Detect(BoxDetectorInterface* detector,
+                         const Features& query) {
+  TimedBoxProtoList detected_boxes;
+  detector->DetectAndAddBoxFromFeatures(
+      query.positions, query.DescriptorMat(), TimedBoxProtoList(),
+      /*timestamp_msec=*/0, /*scale_x=*/1.0f, /*scale_y=*/1.0f,
+      &detected_boxes);
+  return detected_boxes;
+}
+
+ino_t FileInode(const std::string& filename) {
+  struct stat file_stat;
+  return stat(filename.c_str(), &file_stat) == 0 ? file_stat.st_ino : 0;
+}
+
+// Builds the LSH index, memory maps it in a second detector, and checks both
+// against brute force matching (OPENCV_BF).
+TEST(BoxDetectorTest, LshIndexMatchesBruteForce) {
+  std::mt19937 rng(7);
+  Features index_features;
+  const BoxDetectorIndex index = MakeIndex(8, &rng, &index_features);
+  const Vector2_f offset(0.05f, 0.03f);
+  const int kBoxId = 5;
+  const Features query = MakeQuery(index_features, kBoxId, offset, &rng);
+
+  BoxDetectorOptions bf_options;
+  bf_options.set_index_type(BoxDetectorOptions::OPENCV_BF);
+  auto bf_detector = BoxDetectorInterface::Create(bf_options);
+  bf_detector->AddBoxDetectorIndex(index);
+  const TimedBoxProtoList bf_boxes = Detect(bf_detector.get(), query);
+  ASSERT_EQ(1, bf_boxes.box_size());
+  EXPECT_EQ(kBoxId, bf_boxes.box(0).id());
+
+  const std::string index_filename =
+      absl::StrCat(getenv("TEST_TMPDIR"), "/box_detector_lsh.idx");
+  remove(index_filename.c_str());
+  BoxDetectorOptions lsh_options;
+  lsh_options.set_index_type(BoxDetectorOptions::LSH_MULTI_PROBE);
+  lsh_options.mutable_lsh_index_settings()->set_index_filename(index_filename);
+
+  // Builds index and writes it to file.
+  auto lsh_detector = BoxDetectorInterface::Create(lsh_options);
+  lsh_detector->AddBoxDetectorIndex(index);
+  const TimedBoxProtoList lsh_boxes = Detect(lsh_detector.get(), query);
+  const ino_t built_inode = FileInode(index_filename);
+  ASSERT_NE(0, built_inode);
+
+  // Memory maps the matching index file instead of rebuilding.
+  auto mapped_detector = BoxDetectorInterface::Create(lsh_options);
+  mapped_detector->AddBoxDetectorIndex(index);
+  const TimedBoxProtoList mapped_boxes = Detect(mapped_detector.get(), query);
+  EXPECT_EQ(built_inode, FileInode(index_filename));
+
+  for (const TimedBoxProtoList& boxes : {lsh_boxes, mapped_boxes}) {
+    ASSERT_EQ(1, boxes.box_size());
+    const TimedBoxProto& box = boxes.box(0);
+    const TimedBoxProto& expected = bf_boxes.box(0);
+    EXPECT_EQ(expected.id(), box.id());
+    EXPECT_NEAR(expected.left(), box.left(), 1e-3f);
+    EXPECT_NEAR(expected.right(), box.right(), 1e-3f);
+    EXPECT_NEAR(expected.top(), box.top(), 1e-3f);
+    EXPECT_NEAR(expected.bottom(), box.bottom(), 1e-3f);
+    // Box was translated by offset.
+    EXPECT_NEAR(index.box_entry(kBoxId).frame_entry(0).box().left() +
+                    offset.x(),
+                box.left(), 1e-3f);
+    EXPECT_NEAR(index.box_entry(kBoxId).frame_entry(0).box().top() +
+                    offset.y(),
+                box.top(), 1e-3f);
+  }
+
+  // A detector with different templates replaces the index file, while the
+  // previous file stays valid for the detector that mapped it.
+  Features other_features;
+  auto other_detector = BoxDetectorInterface::Create(lsh_options);
+  other_detector->AddBoxDetectorIndex(MakeIndex(4, &rng, &other_features));
+  Detect(other_detector.get(),
+         MakeQuery(other_features, 0, Vector2_f(0.0f, 0.0f), &rng));
+  EXPECT_NE(built_inode, FileInode(index_filename));
+
+  const TimedBoxProtoList remapped_boxes =
+      Detect(mapped_detector.get(), query);
+  ASSERT_EQ(1, remapped_boxes.box_size());
+  EXPECT_NEAR(mapped_boxes.box(0).left(), remapped_boxes.box(0).left(), 1e-6f);
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -16,7 +16,6 @@
 
 #include <sys/stat.h>
 
-#include <fstream>
 #include <limits>
 
 #include "absl/strings/str_cat.h"
@@ -25,6 +24,8 @@
 #include "absl/time/time.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
+#include "mediapipe/util/tracking/flat_tracking_data.h"
+#include "mediapipe/util/tracking/mapped_file.h"
 #include "mediapipe/util/tracking/measure_time.h"
 #include "mediapipe/util/tracking/tracking.pb.h"
 
@@ -314,9 +315,9 @@ void BoxTracker::NewBoxTrackAsync(const TimedBox& initial_pos, int id,
 
   VLOG(1) << "Starting at chunk " << chunk_idx;
 
-  AugmentedChunkPtr tracking_chunk(ReadChunk(id, kInitCheckpoint, chunk_idx));
+  const ChunkData tracking_chunk = ReadChunk(id, kInitCheckpoint, chunk_idx);
 
-  if (!tracking_chunk.first) {
+  if (!tracking_chunk.IsValid()) {
     absl::MutexLock lock(&status_mutex_);
     --track_status_[id][kInitCheckpoint].tracks_ongoing;
     LOG(ERROR) << "Could not read tracking chunk from file: " << chunk_idx
@@ -324,21 +325,14 @@ void BoxTracker::NewBoxTrackAsync(const TimedBox& initial_pos, int id,
     return;
   }
 
-  // Grab ownership here, to avoid any memory leaks due to early return.
-  std::unique_ptr<const TrackingDataChunk> chunk_owned;
-  if (tracking_chunk.second) {
-    chunk_owned.reset(tracking_chunk.first);
-  }
-
   const int start_frame =
-      ClosestFrameIndex(initial_pos.time_msec, *tracking_chunk.first);
+      ClosestFrameIndex(initial_pos.time_msec, tracking_chunk);
 
   VLOG(1) << "Local start frame: " << start_frame;
 
   // Update starting position to coincide with a frame.
   TimedBox start_pos = initial_pos;
-  start_pos.time_msec =
-      tracking_chunk.first->item(start_frame).timestamp_usec() / 1000;
+  start_pos.time_msec = tracking_chunk.timestamp_usec(start_frame) / 1000;
 
   VLOG(1) << "Request at " << initial_pos.time_msec << " revised to "
           << start_pos.time_msec;
@@ -375,27 +369,20 @@ void BoxTracker::NewBoxTrackAsync(const TimedBox& initial_pos, int id,
 
   VLOG(1) << "Starting tracking workers ... ";
 
-  AugmentedChunkPtr forward_chunk = tracking_chunk;
-  AugmentedChunkPtr backward_chunk = tracking_chunk;
-
-  if (tracking_chunk.second) {  // We have ownership, need a copy here.
-    forward_chunk = std::make_pair(new TrackingDataChunk(*chunk_owned), true);
-    backward_chunk = std::make_pair(chunk_owned.release(), true);
-  }
-
-  auto forward_operation = [this, forward_chunk, start_state, start_frame,
+  // Chunk data is read-only, forward and backward tracking share it.
+  auto forward_operation = [this, tracking_chunk, start_state, start_frame,
                             chunk_idx, id, checkpoint, min_msec, max_msec]() {
-    this->TrackingImpl(TrackingImplArgs(forward_chunk, start_state, start_frame,
-                                        chunk_idx, id, checkpoint, true, true,
-                                        min_msec, max_msec));
+    this->TrackingImpl(TrackingImplArgs(tracking_chunk, start_state,
+                                        start_frame, chunk_idx, id, checkpoint,
+                                        true, true, min_msec, max_msec));
   };
 
   tracking_workers_->Schedule(forward_operation);
 
   // Track backward.
-  auto backward_operation = [this, backward_chunk, start_state, start_frame,
+  auto backward_operation = [this, tracking_chunk, start_state, start_frame,
                              chunk_idx, id, checkpoint, min_msec, max_msec]() {
-    this->TrackingImpl(TrackingImplArgs(backward_chunk, start_state,
+    this->TrackingImpl(TrackingImplArgs(tracking_chunk, start_state,
                                         start_frame, chunk_idx, id, checkpoint,
                                         false, true, min_msec, max_msec));
   };
@@ -579,25 +566,83 @@ bool BoxTracker::IsTrackingOngoingMutexHeld() {
   return false;
 }
 
-BoxTracker::AugmentedChunkPtr BoxTracker::ReadChunk(int id, int checkpoint,
-                                                    int chunk_idx) {
+int BoxTracker::ChunkData::num_items() const {
+  return proto_ ? proto_->item_size() : flat_chunk_->view().num_items();
+}
+
+bool BoxTracker::ChunkData::first_chunk() const {
+  return proto_ ? proto_->first_chunk() : flat_chunk_->view().first_chunk();
+}
+
+bool BoxTracker::ChunkData::last_chunk() const {
+  return proto_ ? proto_->last_chunk() : flat_chunk_->view().last_chunk();
+}
+
+int64 BoxTracker::ChunkData::timestamp_usec(int idx) const {
+  return proto_ ? proto_->item(idx).timestamp_usec()
+                : flat_chunk_->view().item(idx).timestamp_usec;
+}
+
+int64 BoxTracker::ChunkData::prev_timestamp_usec(int idx) const {
+  return proto_ ? proto_->item(idx).prev_timestamp_usec()
+                : flat_chunk_->view().item(idx).prev_timestamp_usec;
+}
+
+int BoxTracker::ChunkData::frame_flags(int idx) const {
+  if (proto_) {
+    return proto_->item(idx).tracking_data().frame_flags();
+  }
+  const FlatTrackingDataView data = flat_chunk_->view().item_data(idx);
+  CHECK(data.IsValid()) << "Corrupted flat chunk item " << idx;
+  return data.frame_flags();
+}
+
+float BoxTracker::ChunkData::DurationMs(int idx) const {
+  if (proto_) {
+    return TrackingDataDurationMs(proto_->item(idx));
+  }
+  return (timestamp_usec(idx) - prev_timestamp_usec(idx)) * 1e-3f;
+}
+
+void BoxTracker::ChunkData::GetMotionVectorFrame(
+    int idx, MotionVectorFrame* mvf) const {
+  if (proto_) {
+    MotionVectorFrameFromTrackingData(proto_->item(idx).tracking_data(), mvf);
+    return;
+  }
+  const FlatTrackingDataView data = flat_chunk_->view().item_data(idx);
+  CHECK(data.IsValid()) << "Corrupted flat chunk item " << idx;
+  MotionVectorFrameFromFlatTrackingData(data, mvf);
+}
+
+void BoxTracker::ChunkData::GetTrackingData(
+    int idx, TrackingData* tracking_data) const {
+  if (proto_) {
+    *tracking_data = proto_->item(idx).tracking_data();
+    return;
+  }
+  const FlatTrackingDataView data = flat_chunk_->view().item_data(idx);
+  CHECK(data.IsValid()) << "Corrupted flat chunk item " << idx;
+  data.ToTrackingData(tracking_data);
+}
+
+BoxTracker::ChunkData BoxTracker::ReadChunk(int id, int checkpoint,
+                                            int chunk_idx) {
   VLOG(1) << __FUNCTION__ << " id=" << id << " chunk_idx=" << chunk_idx;
   if (cache_dir_.empty() && !tracking_data_.empty()) {
     if (chunk_idx < tracking_data_.size()) {
-      return std::make_pair(tracking_data_[chunk_idx], false);
+      return ChunkData(tracking_data_[chunk_idx]);
     } else {
       LOG(ERROR) << "chunk_idx >= tracking_data_.size()";
-      return std::make_pair(nullptr, false);
+      return ChunkData();
     }
   } else {
-    std::unique_ptr<TrackingDataChunk> chunk_data(
-        ReadChunkFromCache(id, checkpoint, chunk_idx));
-    return std::make_pair(chunk_data.release(), true);
+    return ReadChunkFromCache(id, checkpoint, chunk_idx);
   }
 }
 
-std::unique_ptr<TrackingDataChunk> BoxTracker::ReadChunkFromCache(
-    int id, int checkpoint, int chunk_idx) {
+BoxTracker::ChunkData BoxTracker::ReadChunkFromCache(int id, int checkpoint,
+                                                     int chunk_idx) {
   VLOG(1) << __FUNCTION__ << " id=" << id << " chunk_idx=" << chunk_idx;
 
   auto format_runtime =
@@ -612,34 +657,46 @@ std::unique_ptr<TrackingDataChunk> BoxTracker::ReadChunkFromCache(
   }
 
   VLOG(1) << "Reading chunk from cache: " << chunk_file;
-  std::unique_ptr<TrackingDataChunk> chunk_data(new TrackingDataChunk());
 
   struct stat tmp;
   if (stat(chunk_file.c_str(), &tmp)) {
     if (!WaitForChunkFile(id, checkpoint, chunk_file)) {
-      return nullptr;
+      return ChunkData();
     }
   }
 
   VLOG(1) << "File exists, reading ...";
 
-  std::ifstream in(chunk_file, std::ios::in | std::ios::binary);
-  if (!in) {
+  // Chunk files are written to a temporary file and renamed, therefore
+  // mapping them is safe.
+  std::unique_ptr<MappedFile> file = MappedFile::Open(chunk_file);
+  if (file == nullptr) {
     LOG(ERROR) << "Could not read chunk file: " << chunk_file;
-    return nullptr;
+    return ChunkData();
   }
 
-  std::string data;
-  in.seekg(0, std::ios::end);
-  data.resize(in.tellg());
-  in.seekg(0, std::ios::beg);
-  in.read(&data[0], data.size());
-  in.close();
+  if (IsFlatTrackingDataChunk(file->data())) {
+    // Chunk written in flat layout (FlowPackagerCalculatorOptions::
+    // cache_flat_format), used in place.
+    std::shared_ptr<const MappedFlatTrackingDataChunk> flat_chunk =
+        MappedFlatTrackingDataChunk::FromMappedFile(std::move(file));
+    if (flat_chunk == nullptr || flat_chunk->view().num_items() == 0) {
+      LOG(ERROR) << "Invalid flat chunk file: " << chunk_file;
+      return ChunkData();
+    }
+    VLOG(1) << "Read success";
+    return ChunkData(std::move(flat_chunk));
+  }
 
-  chunk_data->ParseFromString(data);
+  auto chunk_data = std::make_shared<TrackingDataChunk>();
+  if (!chunk_data->ParseFromArray(file->data().data(), file->data().size())) {
+    LOG(ERROR) << "Could not parse chunk file: " << chunk_file;
+    return ChunkData();
+  }
 
   VLOG(1) << "Read success";
-  return chunk_data;
+  return ChunkData(std::shared_ptr<const TrackingDataChunk>(
+      std::move(chunk_data)));
 }
 
 bool BoxTracker::WaitForChunkFile(int id, int checkpoint,
@@ -686,21 +743,22 @@ bool BoxTracker::WaitForChunkFile(int id, int checkpoint,
   return file_exists;
 }
 
-int BoxTracker::ClosestFrameIndex(int64 msec,
-                                  const TrackingDataChunk& chunk) const {
-  CHECK_GT(chunk.item_size(), 0);
-  typedef TrackingDataChunk::Item Item;
-  Item item_to_find;
-  item_to_find.set_timestamp_usec(msec * 1000);
-  int pos =
-      std::lower_bound(chunk.item().begin(), chunk.item().end(), item_to_find,
-                       [](const Item& lhs, const Item& rhs) -> bool {
-                         return lhs.timestamp_usec() < rhs.timestamp_usec();
-                       }) -
-      chunk.item().begin();
+int BoxTracker::ClosestFrameIndex(int64 msec, const ChunkData& chunk) const {
+  CHECK_GT(chunk.num_items(), 0);
+  // Binary search for first item with timestamp >= msec.
+  int pos = 0;
+  for (int count = chunk.num_items(); count > 0;) {
+    const int step = count / 2;
+    if (chunk.timestamp_usec(pos + step) < msec * 1000) {
+      pos += step + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
 
   // Skip end.
-  if (pos == chunk.item_size()) {
+  if (pos == chunk.num_items()) {
     return pos - 1;
   } else if (pos == 0) {
     // Nothing smaller exists.
@@ -708,8 +766,8 @@ int BoxTracker::ClosestFrameIndex(int64 msec,
   }
 
   // Determine closest timestamp.
-  const int64 lhs_diff = msec - chunk.item(pos - 1).timestamp_usec() / 1000;
-  const int64 rhs_diff = chunk.item(pos).timestamp_usec() / 1000 - msec;
+  const int64 lhs_diff = msec - chunk.timestamp_usec(pos - 1) / 1000;
+  const int64 rhs_diff = chunk.timestamp_usec(pos) / 1000 - msec;
 
   if (std::min(lhs_diff, rhs_diff) >= 67) {
     LOG(ERROR) << "No frame found within 67ms, probably using wrong chunk.";
@@ -747,13 +805,13 @@ void BoxTracker::TrackingImpl(const TrackingImplArgs& a) {
   TrackStepOptions track_step_options = options_.track_step_options();
   ChangeTrackingDegreesBasedOnStartPos(a.start_state, &track_step_options);
   MotionBox motion_box(track_step_options);
-  const int chunk_data_size = a.chunk_data->item_size();
+  const int chunk_data_size = a.chunk_data.num_items();
 
   CHECK_GE(a.start_frame, 0);
   CHECK_LT(a.start_frame, chunk_data_size);
 
   VLOG(1) << " a.start_frame = " << a.start_frame << " @"
-          << a.chunk_data->item(a.start_frame).timestamp_usec() << " with "
+          << a.chunk_data.timestamp_usec(a.start_frame) << " with "
           << chunk_data_size << " items";
   motion_box.ResetAtFrame(a.start_frame, a.start_state);
 
@@ -772,24 +830,22 @@ void BoxTracker::TrackingImpl(const TrackingImplArgs& a) {
     // Tracking from f to f + 1.
     for (int f = a.start_frame; f + 1 < chunk_data_size; ++f) {
       // Note: we use / 1000 instead of * 1000 to avoid overflow.
-      if (a.chunk_data->item(f + 1).timestamp_usec() / 1000 > a.max_msec) {
+      if (a.chunk_data.timestamp_usec(f + 1) / 1000 > a.max_msec) {
         VLOG(2) << "Reached maximum tracking timestamp @" << a.max_msec;
         break;
       }
       VLOG(1) << "Track forward from " << f;
       MotionVectorFrame mvf;
-      MotionVectorFrameFromTrackingData(
-          a.chunk_data->item(f + 1).tracking_data(), &mvf);
-      const int track_duration_ms =
-          TrackingDataDurationMs(a.chunk_data->item(f + 1));
+      a.chunk_data.GetMotionVectorFrame(f + 1, &mvf);
+      const int track_duration_ms = a.chunk_data.DurationMs(f + 1);
       if (track_duration_ms > 0) {
         mvf.duration_ms = track_duration_ms;
       }
 
       // If this is the first frame in a chunk, there might be an unobserved
       // chunk boundary at the first frame.
-      if (f == 0 && a.chunk_data->item(0).tracking_data().frame_flags() &
-                        TrackingData::FLAG_CHUNK_BOUNDARY) {
+      if (f == 0 &&
+          a.chunk_data.frame_flags(0) & TrackingData::FLAG_CHUNK_BOUNDARY) {
         mvf.is_chunk_boundary = true;
       }
 
@@ -814,16 +870,16 @@ void BoxTracker::TrackingImpl(const TrackingImplArgs& a) {
         TimedBox result;
         const MotionBoxState& result_state = motion_box.StateAtFrame(f + 1);
         TimedBoxFromMotionBoxState(result_state, &result);
-        result.time_msec = a.chunk_data->item(f + 1).timestamp_usec() / 1000;
+        result.time_msec = a.chunk_data.timestamp_usec(f + 1) / 1000;
         AddBoxResult(result, a.id, a.checkpoint, result_state);
       }
 
-      if (f + 2 == chunk_data_size && !a.chunk_data->last_chunk()) {
+      if (f + 2 == chunk_data_size && !a.chunk_data.last_chunk()) {
         // Last frame, successful track, continue;
-        AugmentedChunkPtr next_chunk(
-            ReadChunk(a.id, a.checkpoint, a.chunk_idx + 1));
+        const ChunkData next_chunk =
+            ReadChunk(a.id, a.checkpoint, a.chunk_idx + 1);
 
-        if (next_chunk.first != nullptr) {
+        if (next_chunk.IsValid()) {
           TrackingImplArgs next_args(next_chunk, motion_box.StateAtFrame(f + 1),
                                      0, a.chunk_idx + 1, a.id, a.checkpoint,
                                      a.forward, false, a.min_msec, a.max_msec);
@@ -838,19 +894,17 @@ void BoxTracker::TrackingImpl(const TrackingImplArgs& a) {
   } else {
     // Backward tracking.
     // Don't attempt to track from the very first frame backwards.
-    const int first_frame = a.chunk_data->first_chunk() ? 1 : 0;
+    const int first_frame = a.chunk_data.first_chunk() ? 1 : 0;
 
     for (int f = a.start_frame; f >= first_frame; --f) {
-      if (a.chunk_data->item(f).timestamp_usec() / 1000 < a.min_msec) {
+      if (a.chunk_data.timestamp_usec(f) / 1000 < a.min_msec) {
         VLOG(2) << "Reached minimum tracking timestamp @" << a.min_msec;
         break;
       }
       VLOG(1) << "Track backward from " << f;
       MotionVectorFrame mvf;
-      MotionVectorFrameFromTrackingData(a.chunk_data->item(f).tracking_data(),
-                                        &mvf);
-      const int64 track_duration_ms =
-          TrackingDataDurationMs(a.chunk_data->item(f));
+      a.chunk_data.GetMotionVectorFrame(f, &mvf);
+      const int64 track_duration_ms = a.chunk_data.DurationMs(f);
       if (track_duration_ms > 0) {
         mvf.duration_ms = track_duration_ms;
       }
@@ -872,18 +926,18 @@ void BoxTracker::TrackingImpl(const TrackingImplArgs& a) {
         TimedBox result;
         const MotionBoxState& result_state = motion_box.StateAtFrame(f - 1);
         TimedBoxFromMotionBoxState(result_state, &result);
-        result.time_msec = a.chunk_data->item(f).prev_timestamp_usec() / 1000;
+        result.time_msec = a.chunk_data.prev_timestamp_usec(f) / 1000;
         AddBoxResult(result, a.id, a.checkpoint, result_state);
       }
 
-      if (f == first_frame && !a.chunk_data->first_chunk()) {
+      if (f == first_frame && !a.chunk_data.first_chunk()) {
         VLOG(1) << "Read next chunk: " << f << "==" << first_frame << " in "
                 << a.chunk_idx;
         // First frame, successful track, continue.
-        AugmentedChunkPtr prev_chunk(
-            ReadChunk(a.id, a.checkpoint, a.chunk_idx - 1));
-        if (prev_chunk.first != nullptr) {
-          const int last_frame = prev_chunk.first->item_size() - 1;
+        const ChunkData prev_chunk =
+            ReadChunk(a.id, a.checkpoint, a.chunk_idx - 1);
+        if (prev_chunk.IsValid()) {
+          const int last_frame = prev_chunk.num_items() - 1;
           TrackingImplArgs prev_args(prev_chunk, motion_box.StateAtFrame(f - 1),
                                      last_frame, a.chunk_idx - 1, a.id,
                                      a.checkpoint, a.forward, false, a.min_msec,
@@ -894,7 +948,7 @@ void BoxTracker::TrackingImpl(const TrackingImplArgs& a) {
           cleanup_func();
           LOG(ERROR) << "Can't read expected chunk file! " << a.chunk_idx - 1
                      << " while tracking @"
-                     << a.chunk_data->item(f).timestamp_usec() / 1000
+                     << a.chunk_data.timestamp_usec(f) / 1000
                      << " with cutoff " << a.min_msec;
           return;
         }
@@ -1035,26 +1089,20 @@ bool BoxTracker::GetTrackingData(int id, int64 request_time_msec,
 
   int chunk_idx = ChunkIdxFromTime(request_time_msec);
 
-  AugmentedChunkPtr tracking_chunk(ReadChunk(id, kInitCheckpoint, chunk_idx));
-  if (!tracking_chunk.first) {
+  const ChunkData tracking_chunk = ReadChunk(id, kInitCheckpoint, chunk_idx);
+  if (!tracking_chunk.IsValid()) {
     absl::MutexLock lock(&status_mutex_);
     --track_status_[id][kInitCheckpoint].tracks_ongoing;
     LOG(ERROR) << "Could not read tracking chunk from file.";
     return false;
   }
 
-  std::unique_ptr<const TrackingDataChunk> owned_chunk;
-  if (tracking_chunk.second) {
-    owned_chunk.reset(tracking_chunk.first);
-  }
-
   const int closest_frame =
-      ClosestFrameIndex(request_time_msec, *tracking_chunk.first);
+      ClosestFrameIndex(request_time_msec, tracking_chunk);
 
-  *tracking_data = tracking_chunk.first->item(closest_frame).tracking_data();
+  tracking_chunk.GetTrackingData(closest_frame, tracking_data);
   if (tracking_data_msec) {
-    *tracking_data_msec =
-        tracking_chunk.first->item(closest_frame).timestamp_usec() / 1000;
+    *tracking_data_msec = tracking_chunk.timestamp_usec(closest_frame) / 1000;
   }
   return true;
 }
@@ -18,6 +18,7 @@
 #include <inttypes.h>
 
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -25,6 +26,7 @@
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/util/tracking/box_tracker.pb.h"
+#include "mediapipe/util/tracking/flat_tracking_data.h"
 #include "mediapipe/util/tracking/flow_packager.pb.h"
 #include "mediapipe/util/tracking/tracking.h"
 #include "mediapipe/util/tracking/tracking.pb.h"
@@ -230,40 +232,74 @@ class BoxTracker {
   void NewBoxTrackAsync(const TimedBox& initial_pos, int id, int64 min_msec,
                         int64 max_msec);
 
-  typedef std::pair<const TrackingDataChunk*, bool> AugmentedChunkPtr;
+  // Read access to the tracking data of a chunk, which is either a
+  // TrackingDataChunk or a memory mapped flat chunk (see
+  // flat_tracking_data.h) that is used in place, without parsing. Shares
+  // ownership of the underlying data, copies are cheap.
+  class ChunkData {
+   public:
+    ChunkData() = default;
+    // Does not take ownership, chunk has to outlive this object.
+    explicit ChunkData(const TrackingDataChunk* chunk) : proto_(chunk) {}
+    explicit ChunkData(std::shared_ptr<const TrackingDataChunk> chunk)
+        : proto_buffer_(std::move(chunk)), proto_(proto_buffer_.get()) {}
+    explicit ChunkData(
+        std::shared_ptr<const MappedFlatTrackingDataChunk> flat_chunk)
+        : flat_chunk_(std::move(flat_chunk)) {}
+
+    bool IsValid() const {
+      return proto_ != nullptr || flat_chunk_ != nullptr;
+    }
+
+    int num_items() const;
+    bool first_chunk() const;
+    bool last_chunk() const;
+    int64 timestamp_usec(int idx) const;
+    int64 prev_timestamp_usec(int idx) const;
+    int frame_flags(int idx) const;
+
+    // Duration of the idx'th item, see TrackingDataDurationMs.
+    float DurationMs(int idx) const;
+
+    void GetMotionVectorFrame(int idx, MotionVectorFrame* mvf) const;
+    void GetTrackingData(int idx, TrackingData* tracking_data) const;
+
+   private:
+    std::shared_ptr<const TrackingDataChunk> proto_buffer_;
+    const TrackingDataChunk* proto_ = nullptr;
+    std::shared_ptr<const MappedFlatTrackingDataChunk> flat_chunk_;
+  };
+
   // Attempts to read chunk at chunk_idx if it exists. Reads from cache
-  // directory or from in memory cache.
-  // Important: 2nd part of return value indicates if returned tracking data
-  // will be owned by the caller (if true). In that case caller is responsible
-  // for releasing the returned chunk.
-  AugmentedChunkPtr ReadChunk(int id, int checkpoint, int chunk_idx);
+  // directory or from in memory cache. Returns invalid ChunkData on failure.
+  ChunkData ReadChunk(int id, int checkpoint, int chunk_idx);
 
   // Attempts to read specified chunk from caching directory. Blocks and waits
-  // until chunk is available or internal time out is reached.
-  // Returns nullptr if data could not be read.
-  std::unique_ptr<TrackingDataChunk> ReadChunkFromCache(int id, int checkpoint,
-                                                        int chunk_idx);
+  // until chunk is available or internal time out is reached. Flat chunks are
+  // memory mapped.
+  // Returns invalid ChunkData if data could not be read.
+  ChunkData ReadChunkFromCache(int id, int checkpoint, int chunk_idx);
 
   // Waits with timeout for chunkfile to become available. Returns true on
   // success, false if waited till timeout or when canceled.
   bool WaitForChunkFile(int id, int checkpoint, const std::string& chunk_file)
       ABSL_LOCKS_EXCLUDED(status_mutex_);
 
-  // Determines closest index in passed TrackingDataChunk
-  int ClosestFrameIndex(int64 msec, const TrackingDataChunk& chunk) const;
+  // Determines closest index in passed chunk.
+  int ClosestFrameIndex(int64 msec, const ChunkData& chunk) const;
 
   // Adds new TimedBox to specified checkpoint with state.
   void AddBoxResult(const TimedBox& box, int id, int checkpoint,
                     const MotionBoxState& state);
 
   // Callback can only handle 5 args max.
-  // Set own_data to true for args to assume ownership.
   struct TrackingImplArgs {
-    TrackingImplArgs(AugmentedChunkPtr chunk_ptr,
+    TrackingImplArgs(const ChunkData& chunk_data_,
                      const MotionBoxState& start_state_, int start_frame_,
                      int chunk_idx_, int id_, int checkpoint_, bool forward_,
                      bool first_call_, int64 min_msec_, int64 max_msec_)
-        : start_state(start_state_),
+        : chunk_data(chunk_data_),
+          start_state(start_state_),
           start_frame(start_frame_),
           chunk_idx(chunk_idx_),
           id(id_),
@@ -271,22 +307,13 @@ class BoxTracker {
           forward(forward_),
           first_call(first_call_),
           min_msec(min_msec_),
-          max_msec(max_msec_) {
-      if (chunk_ptr.second) {
-        chunk_data_buffer.reset(chunk_ptr.first);
-      }
-
-      chunk_data = chunk_ptr.first;
-    }
+          max_msec(max_msec_) {}
 
     TrackingImplArgs(const TrackingImplArgs&) = default;
 
-    // Storage for tracking data.
-    std::shared_ptr<const TrackingDataChunk> chunk_data_buffer;
-
-    // Pointer to the actual tracking data. Usually points to the buffer
-    // but can also point to external data for performance reasons.
-    const TrackingDataChunk* chunk_data;
+    // Tracking data, owned or pointing to external data for performance
+    // reasons.
+    ChunkData chunk_data;
 
     MotionBoxState start_state;
     int start_frame;
@@ -14,8 +14,12 @@
 
 #include "mediapipe/util/tracking/box_tracker.h"
 
+#include "absl/strings/str_cat.h"
 #include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/util/tracking/flat_tracking_data.h"
 
 namespace mediapipe {
 namespace {
@@ -112,6 +116,67 @@ TEST(BoxTrackerTest, MovingBoxTest) {
   }
 }
 
+// Tracking from a cache of flat chunks, which are used in place, yields the
+// same results as tracking from serialized TrackingDataChunks.
+TEST(BoxTrackerTest, FlatCacheMatchesProtoCache) {
+  const std::string cache_dir =
+      file::JoinPath("./", "/mediapipe/util/tracking/testdata/box_tracker");
+  const std::string flat_cache_dir =
+      file::JoinPath(getenv("TEST_TMPDIR"), "flat_box_tracker");
+  MP_ASSERT_OK(file::RecursivelyCreateDir(flat_cache_dir));
+  for (int k = 0; k < 7; ++k) {
+    const std::string chunk_file = absl::StrCat("chunk_000", k);
+    std::string data;
+    MP_ASSERT_OK(
+        file::GetContents(file::JoinPath(cache_dir, chunk_file), &data));
+    TrackingDataChunk chunk;
+    ASSERT_TRUE(chunk.ParseFromString(data));
+    EncodeFlatTrackingDataChunk(chunk, &data);
+    MP_ASSERT_OK(
+        file::SetContents(file::JoinPath(flat_cache_dir, chunk_file), data));
+  }
+
+  BoxTracker proto_tracker(cache_dir, BoxTrackerOptions());
+  BoxTracker flat_tracker(flat_cache_dir, BoxTrackerOptions());
+
+  TimedBox initial_pos;
+  initial_pos.left = 50.0 / kWidth;
+  initial_pos.top = 400.0 / kHeight;
+  initial_pos.right = initial_pos.left + 220.0 / kWidth;
+  initial_pos.bottom = initial_pos.top + 252.0 / kHeight;
+  initial_pos.time_msec = 3000;
+
+  proto_tracker.NewBoxTrack(initial_pos, 0);
+  flat_tracker.NewBoxTrack(initial_pos, 0);
+  proto_tracker.WaitForAllOngoingTracks();
+  flat_tracker.WaitForAllOngoingTracks();
+
+  EXPECT_EQ(proto_tracker.TrackInterval(0), flat_tracker.TrackInterval(0));
+  for (int k = 0; k < 15000; k += 33) {
+    TimedBox proto_box;
+    TimedBox flat_box;
+    ASSERT_TRUE(proto_tracker.GetTimedPosition(0, k, &proto_box));
+    ASSERT_TRUE(flat_tracker.GetTimedPosition(0, k, &flat_box));
+    EXPECT_EQ(proto_box.time_msec, flat_box.time_msec);
+    EXPECT_FLOAT_EQ(proto_box.top, flat_box.top);
+    EXPECT_FLOAT_EQ(proto_box.left, flat_box.left);
+    EXPECT_FLOAT_EQ(proto_box.bottom, flat_box.bottom);
+    EXPECT_FLOAT_EQ(proto_box.right, flat_box.right);
+  }
+
+  TrackingData proto_data;
+  TrackingData flat_data;
+  int proto_msec = 0;
+  int flat_msec = 0;
+  ASSERT_TRUE(proto_tracker.GetTrackingData(0, 4000, &proto_data, &proto_msec));
+  ASSERT_TRUE(flat_tracker.GetTrackingData(0, 4000, &flat_data, &flat_msec));
+  EXPECT_EQ(proto_msec, flat_msec);
+  EXPECT_EQ(proto_data.motion_data().row_indices_size(),
+            flat_data.motion_data().row_indices_size());
+  EXPECT_EQ(proto_data.motion_data().feature_descriptors_size(),
+            flat_data.motion_data().feature_descriptors_size());
+}
+
 }  // namespace
 
 }  // namespace mediapipe
@@ -0,0 +1,392 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/descriptor_lsh_index.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kIndexMagic[4] = {'D', 'L', 'S', 'H'};
+
+uint64 AlignTo8(uint64 offset) {
+  return (offset + 7) & ~static_cast<uint64>(7);
+}
+
+// Section offsets of the flat layout, fully determined by the dimensions of
+// the index.
+struct IndexLayout {
+  IndexLayout(int dims, int num_descriptors, int num_tables, int num_bits) {
+    const uint64 num_buckets = (1ull << num_bits) + 1;
+    mean_offset = AlignTo8(sizeof(DescriptorLshIndexHeader));
+    hyperplanes_offset = AlignTo8(mean_offset + sizeof(float) * dims);
+    bucket_starts_offset = AlignTo8(
+        hyperplanes_offset +
+        sizeof(float) * static_cast<uint64>(num_tables) * num_bits * dims);
+    bucket_ids_offset = AlignTo8(bucket_starts_offset +
+                                 sizeof(int32) * num_tables * num_buckets);
+    descriptors_offset =
+        AlignTo8(bucket_ids_offset +
+                 sizeof(int32) * static_cast<uint64>(num_tables) *
+                     num_descriptors);
+    size = AlignTo8(descriptors_offset +
+                    sizeof(float) * static_cast<uint64>(num_descriptors) *
+                        dims);
+  }
+
+  uint64 mean_offset;
+  uint64 hyperplanes_offset;
+  uint64 bucket_starts_offset;
+  uint64 bucket_ids_offset;
+  uint64 descriptors_offset;
+  uint64 size;
+};
+
+// Computes projections of centered descriptor onto each hyperplane of a
+// table and returns resulting key.
+int ComputeKey(const float* centered, const float* hyperplanes, int num_bits,
+               int dims, float* projections) {
+  int key = 0;
+  for (int b = 0; b < num_bits; ++b) {
+    const float* plane = hyperplanes + b * dims;
+    float dot = 0;
+    for (int d = 0; d < dims; ++d) {
+      dot += plane[d] * centered[d];
+    }
+    projections[b] = dot;
+    if (dot > 0) {
+      key |= 1 << b;
+    }
+  }
+  return key;
+}
+
+int NumBitsForDescriptors(int num_descriptors) {
+  constexpr int kDescriptorsPerBucket = 8;
+  constexpr int kMinNumBits = 4;
+  int num_bits = kMinNumBits;
+  while (num_bits < DescriptorLshIndex::kMaxNumBits &&
+         (num_descriptors >> num_bits) > kDescriptorsPerBucket) {
+    ++num_bits;
+  }
+  return num_bits;
+}
+
+}  // namespace
+
+std::unique_ptr<DescriptorLshIndex> DescriptorLshIndex::Build(
+    const Options& options, const std::vector<const float*>& descriptors,
+    int dims) {
+  CHECK_GT(dims, 0);
+  CHECK_GT(options.num_tables, 0);
+  const int num_descriptors = descriptors.size();
+  const int num_tables = options.num_tables;
+  const int num_bits = options.num_bits > 0
+                           ? options.num_bits
+                           : NumBitsForDescriptors(num_descriptors);
+  CHECK_LE(num_bits, kMaxNumBits);
+
+  const IndexLayout layout(dims, num_descriptors, num_tables, num_bits);
+  std::unique_ptr<DescriptorLshIndex> index(new DescriptorLshIndex());
+  index->buffer_.assign(layout.size, 0);
+  char* data = &index->buffer_[0];
+
+  DescriptorLshIndexHeader* header =
+      reinterpret_cast<DescriptorLshIndexHeader*>(data);
+  memcpy(header->magic, kIndexMagic, sizeof(kIndexMagic));
+  header->version = kDescriptorLshIndexVersion;
+  header->size = layout.size;
+  header->fingerprint = Fingerprint(descriptors, dims);
+  header->dims = dims;
+  header->num_descriptors = num_descriptors;
+  header->num_tables = num_tables;
+  header->num_bits = num_bits;
+  header->mean_offset = layout.mean_offset;
+  header->hyperplanes_offset = layout.hyperplanes_offset;
+  header->bucket_starts_offset = layout.bucket_starts_offset;
+  header->bucket_ids_offset = layout.bucket_ids_offset;
+  header->descriptors_offset = layout.descriptors_offset;
+
+  float* all_descriptors =
+      reinterpret_cast<float*>(data + layout.descriptors_offset);
+  for (int k = 0; k < num_descriptors; ++k) {
+    memcpy(all_descriptors + static_cast<size_t>(k) * dims, descriptors[k],
+           sizeof(float) * dims);
+  }
+
+  // Center descriptors w.r.t. mean, so that hyperplanes through the origin
+  // split the data evenly.
+  float* mean = reinterpret_cast<float*>(data + layout.mean_offset);
+  if (num_descriptors > 0) {
+    std::vector<double> sum(dims, 0.0);
+    for (int k = 0; k < num_descriptors; ++k) {
+      for (int d = 0; d < dims; ++d) {
+        sum[d] += descriptors[k][d];
+      }
+    }
+    for (int d = 0; d < dims; ++d) {
+      mean[d] = sum[d] / num_descriptors;
+    }
+  }
+
+  float* hyperplanes =
+      reinterpret_cast<float*>(data + layout.hyperplanes_offset);
+  std::mt19937 random(options.seed);
+  std::normal_distribution<float> normal;
+  for (int k = 0, num_values = num_tables * num_bits * dims; k < num_values;
+       ++k) {
+    hyperplanes[k] = normal(random);
+  }
+
+  // Distribute descriptor ids into buckets via counting sort.
+  const int num_buckets = 1 << num_bits;
+  int32* bucket_starts =
+      reinterpret_cast<int32*>(data + layout.bucket_starts_offset);
+  int32* bucket_ids = reinterpret_cast<int32*>(data + layout.bucket_ids_offset);
+  std::vector<int> keys(num_descriptors);
+  std::vector<float> centered(dims);
+  std::vector<float> projections(num_bits);
+  for (int t = 0; t < num_tables; ++t) {
+    const float* table_planes = hyperplanes + t * num_bits * dims;
+    int32* starts = bucket_starts + t * (num_buckets + 1);
+    int32* ids = bucket_ids + static_cast<size_t>(t) * num_descriptors;
+
+    for (int k = 0; k < num_descriptors; ++k) {
+      for (int d = 0; d < dims; ++d) {
+        centered[d] = descriptors[k][d] - mean[d];
+      }
+      keys[k] = ComputeKey(centered.data(), table_planes, num_bits, dims,
+                           projections.data());
+      ++starts[keys[k] + 1];
+    }
+
+    for (int b = 0; b < num_buckets; ++b) {
+      starts[b + 1] += starts[b];
+    }
+
+    std::vector<int> fill(starts, starts + num_buckets);
+    for (int k = 0; k < num_descriptors; ++k) {
+      ids[fill[keys[k]]++] = k;
+    }
+  }
+
+  CHECK(index->Init(index->buffer_));
+  return index;
+}
+
+std::unique_ptr<DescriptorLshIndex> DescriptorLshIndex::Open(
+    const std::string& filename) {
+  std::unique_ptr<DescriptorLshIndex> index(new DescriptorLshIndex());
+  index->file_ = MappedFile::Open(filename);
+  if (index->file_ == nullptr || !index->Init(index->file_->data())) {
+    LOG(ERROR) << "Invalid descriptor index file: " << filename;
+    return nullptr;
+  }
+  return index;
+}
+
+std::unique_ptr<DescriptorLshIndex> DescriptorLshIndex::FromData(
+    absl::string_view data) {
+  std::unique_ptr<DescriptorLshIndex> index(new DescriptorLshIndex());
+  index->buffer_ = std::string(data);
+  if (!index->Init(index->buffer_)) {
+    return nullptr;
+  }
+  return index;
+}
+
+DescriptorLshIndex::~DescriptorLshIndex() = default;
+
+bool DescriptorLshIndex::Init(absl::string_view data) {
+  header_ = nullptr;
+  if (data.size() < sizeof(DescriptorLshIndexHeader) ||
+      reinterpret_cast<uintptr_t>(data.data()) % 8 != 0) {
+    return false;
+  }
+
+  const DescriptorLshIndexHeader* header =
+      reinterpret_cast<const DescriptorLshIndexHeader*>(data.data());
+  if (memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+      header->version != kDescriptorLshIndexVersion ||
+      header->size != data.size() || header->dims <= 0 ||
+      header->num_descriptors < 0 || header->num_tables <= 0 ||
+      header->num_bits <= 0 || header->num_bits > kMaxNumBits) {
+    return false;
+  }
+
+  const IndexLayout layout(header->dims, header->num_descriptors,
+                           header->num_tables, header->num_bits);
+  if (layout.size != header->size ||
+      layout.mean_offset != header->mean_offset ||
+      layout.hyperplanes_offset != header->hyperplanes_offset ||
+      layout.bucket_starts_offset != header->bucket_starts_offset ||
+      layout.bucket_ids_offset != header->bucket_ids_offset ||
+      layout.descriptors_offset != header->descriptors_offset) {
+    return false;
+  }
+
+  const char* base = data.data();
+  const int32* bucket_starts =
+      reinterpret_cast<const int32*>(base + header->bucket_starts_offset);
+  const int32* bucket_ids =
+      reinterpret_cast<const int32*>(base + header->bucket_ids_offset);
+
+  // Bucket tables are used to index into other sections; reject any out of
+  // bounds values.
+  const int num_buckets = 1 << header->num_bits;
+  const int num_descriptors = header->num_descriptors;
+  for (int t = 0; t < header->num_tables; ++t) {
+    const int32* starts = bucket_starts + t * (num_buckets + 1);
+    if (starts[0] != 0 || starts[num_buckets] != num_descriptors) {
+      return false;
+    }
+    for (int b = 0; b < num_buckets; ++b) {
+      if (starts[b] > starts[b + 1]) {
+        return false;
+      }
+    }
+  }
+  for (size_t k = 0,
+              num_ids = static_cast<size_t>(header->num_tables) *
+                        num_descriptors;
+       k < num_ids; ++k) {
+    if (bucket_ids[k] < 0 || bucket_ids[k] >= num_descriptors) {
+      return false;
+    }
+  }
+
+  data_ = data;
+  header_ = header;
+  mean_ = reinterpret_cast<const float*>(base + header->mean_offset);
+  hyperplanes_ =
+      reinterpret_cast<const float*>(base + header->hyperplanes_offset);
+  bucket_starts_ = bucket_starts;
+  bucket_ids_ = bucket_ids;
+  descriptors_ =
+      reinterpret_cast<const float*>(base + header->descriptors_offset);
+  return true;
+}
+
+uint64 DescriptorLshIndex::Fingerprint(
+    const std::vector<const float*>& descriptors, int dims) {
+  constexpr uint64 kFnvPrime = 1099511628211ull;
+  uint64 hash = 14695981039346656037ull;
+  auto hash_bytes = [&hash](const void* bytes, size_t size) {
+    const uint8* ptr = static_cast<const uint8*>(bytes);
+    for (size_t k = 0; k < size; ++k) {
+      hash = (hash ^ ptr[k]) * kFnvPrime;
+    }
+  };
+
+  hash_bytes(&dims, sizeof(dims));
+  for (const float* descriptor : descriptors) {
+    hash_bytes(descriptor, sizeof(float) * dims);
+  }
+  return hash;
+}
+
+float DescriptorLshIndex::SquaredDistance(const float* lhs, const float* rhs,
+                                          int dims) {
+  float sum = 0;
+  for (int d = 0; d < dims; ++d) {
+    const float diff = lhs[d] - rhs[d];
+    sum += diff * diff;
+  }
+  return sum;
+}
+
+void DescriptorLshIndex::FindCandidates(const float* query, int num_probes,
+                                        std::vector<int>* candidates) const {
+  CHECK(candidates != nullptr);
+  candidates->clear();
+
+  const int dims = header_->dims;
+  const int num_bits = header_->num_bits;
+  const int num_buckets = 1 << num_bits;
+  num_probes = std::max(0, std::min(num_probes, num_bits));
+
+  std::vector<float> centered(dims);
+  for (int d = 0; d < dims; ++d) {
+    centered[d] = query[d] - mean_[d];
+  }
+
+  float projections[kMaxNumBits];
+  int bit_order[kMaxNumBits];
+  for (int t = 0; t < header_->num_tables; ++t) {
+    const int key =
+        ComputeKey(centered.data(), hyperplanes_ + t * num_bits * dims,
+                   num_bits, dims, projections);
+    const int32* starts = bucket_starts_ + t * (num_buckets + 1);
+    const int32* ids =
+        bucket_ids_ + static_cast<size_t>(t) * header_->num_descriptors;
+
+    // Probe sequence: key itself, followed by keys with one of the
+    // num_probes least confident bits flipped.
+    for (int b = 0; b < num_bits; ++b) {
+      bit_order[b] = b;
+    }
+    std::partial_sort(bit_order, bit_order + num_probes, bit_order + num_bits,
+                      [&projections](int lhs, int rhs) {
+                        return std::abs(projections[lhs]) <
+                               std::abs(projections[rhs]);
+                      });
+
+    for (int p = 0; p <= num_probes; ++p) {
+      const int probe_key = p == 0 ? key : key ^ (1 << bit_order[p - 1]);
+      candidates->insert(candidates->end(), ids + starts[probe_key],
+                         ids + starts[probe_key + 1]);
+    }
+  }
+
+  std::sort(candidates->begin(), candidates->end());
+  candidates->erase(std::unique(candidates->begin(), candidates->end()),
+                    candidates->end());
+}
+
+int DescriptorLshIndex::FindNearest(const float* query, int num_probes,
+                                    float* squared_distance) const {
+  std::vector<int> candidates;
+  FindCandidates(query, num_probes, &candidates);
+
+  int best_id = -1;
+  float best_distance = std::numeric_limits<float>::max();
+  for (int id : candidates) {
+    const float distance = SquaredDistance(query, descriptor(id), dims());
+    if (distance < best_distance) {
+      best_distance = distance;
+      best_id = id;
+    }
+  }
+
+  if (squared_distance != nullptr) {
+    *squared_distance = best_distance;
+  }
+  return best_id;
+}
+
+bool DescriptorLshIndex::WriteToFile(const std::string& filename) const {
+  return ReplaceFileContents(filename, data_);
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,170 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Approximate nearest neighbor index for float feature descriptors (as used by
+// BoxDetector) based on multi-probe locality sensitive hashing.
+//
+// Each of num_tables hash tables assigns a descriptor a num_bits key, bit b
+// being the sign of the projection of the (mean centered) descriptor onto a
+// random hyperplane. Descriptors close in L2 are likely to share a key in at
+// least one table. Queries additionally probe the buckets obtained by flipping
+// the num_probes least confident bits (smallest projection magnitude), which
+// allows for fewer tables at the same recall.
+//
+// The index is stored in a flat, versioned layout that is used in place, both
+// for indices built in memory and for indices memory mapped from file.
+//
+// Usage:
+// std::vector<const float*> descriptors;      // Externally supplied.
+// auto index = DescriptorLshIndex::Build(DescriptorLshIndex::Options(),
+//                                        descriptors, dims);
+// index->WriteToFile(filename);
+// ...
+// auto mapped = DescriptorLshIndex::Open(filename);
+// std::vector<int> candidates;
+// mapped->FindCandidates(query, num_probes, &candidates);
+//
+// All values are stored LITTLE ENDIAN. Layout of the flat index:
+// {  DescriptorLshIndexHeader (see below)
+//    mean                   : dims * 32 bit float
+//    hyperplanes            : num_tables * num_bits * dims * 32 bit float
+//    bucket_starts          : num_tables * (2^num_bits + 1) * 32 bit int
+//    bucket_ids             : num_tables * num_descriptors * 32 bit int
+//    descriptors            : num_descriptors * dims * 32 bit float
+// }
+
+#ifndef MEDIAPIPE_UTIL_TRACKING_DESCRIPTOR_LSH_INDEX_H_
+#define MEDIAPIPE_UTIL_TRACKING_DESCRIPTOR_LSH_INDEX_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/util/tracking/mapped_file.h"
+
+namespace mediapipe {
+
+// Increase on any change of the layout below.
+constexpr uint32 kDescriptorLshIndexVersion = 1;
+
+struct DescriptorLshIndexHeader {
+  char magic[4];  // "DLSH"
+  uint32 version;
+  uint64 size;         // Total size of index in bytes, including header.
+  uint64 fingerprint;  // See DescriptorLshIndex::Fingerprint.
+  int32 dims;
+  int32 num_descriptors;
+  int32 num_tables;
+  int32 num_bits;
+  // Offsets in bytes w.r.t. beginning of the header.
+  uint64 mean_offset;
+  uint64 hyperplanes_offset;
+  uint64 bucket_starts_offset;
+  uint64 bucket_ids_offset;
+  uint64 descriptors_offset;
+};
+
+static_assert(sizeof(DescriptorLshIndexHeader) == 80,
+              "Do not alter layout of DescriptorLshIndexHeader, use version.");
+
+class DescriptorLshIndex {
+ public:
+  struct Options {
+    int num_tables = 8;
+    // Number of bits per key. Zero selects the number of bits based on the
+    // number of descriptors, such that buckets hold ~8 descriptors on average.
+    int num_bits = 0;
+    uint32 seed = 1;
+  };
+
+  // Upper bound for num_bits, limits size of the bucket tables to 1 MB each.
+  static constexpr int kMaxNumBits = 18;
+
+  // Builds index over the descriptors, each of which points to dims floats.
+  // Descriptors are copied into the index.
+  static std::unique_ptr<DescriptorLshIndex> Build(
+      const Options& options, const std::vector<const float*>& descriptors,
+      int dims);
+
+  // Returns nullptr if file can not be opened or is not a valid index. The
+  // file is memory mapped (read into memory on platforms without mmap).
+  static std::unique_ptr<DescriptorLshIndex> Open(const std::string& filename);
+
+  // Copies data into a new index. Returns nullptr for invalid data.
+  static std::unique_ptr<DescriptorLshIndex> FromData(absl::string_view data);
+
+  // Returns 64 bit FNV-1a hash of dimensions and descriptor values. Used to
+  // check that a stored index matches a specific set of descriptors.
+  static uint64 Fingerprint(const std::vector<const float*>& descriptors,
+                            int dims);
+
+  static float SquaredDistance(const float* lhs, const float* rhs, int dims);
+
+  ~DescriptorLshIndex();
+  DescriptorLshIndex(const DescriptorLshIndex&) = delete;
+  DescriptorLshIndex& operator=(const DescriptorLshIndex&) = delete;
+
+  int dims() const { return header_->dims; }
+  int num_descriptors() const { return header_->num_descriptors; }
+  int num_tables() const { return header_->num_tables; }
+  int num_bits() const { return header_->num_bits; }
+  uint64 fingerprint() const { return header_->fingerprint; }
+
+  // Returns copy of the idx'th descriptor used to build the index.
+  const float* descriptor(int idx) const {
+    return descriptors_ + static_cast<size_t>(idx) * header_->dims;
+  }
+
+  // Returns ids of all descriptors sharing a bucket with query in any table,
+  // probing num_probes additional buckets per table. Output is sorted and
+  // free of duplicates. Thread-safe.
+  void FindCandidates(const float* query, int num_probes,
+                      std::vector<int>* candidates) const;
+
+  // Returns id of the candidate closest to query in L2, or -1 if there are no
+  // candidates. Optionally returns the squared distance.
+  int FindNearest(const float* query, int num_probes,
+                  float* squared_distance = nullptr) const;
+
+  // Flat representation of the index.
+  absl::string_view data() const { return data_; }
+
+  // Atomically replaces filename with the index, see ReplaceFileContents.
+  // Safe to call while the file is mapped by other indices.
+  bool WriteToFile(const std::string& filename) const;
+
+ private:
+  DescriptorLshIndex() = default;
+
+  // Validates header and bounds of all sections and sets up pointers into
+  // data. Returns false for invalid data.
+  bool Init(absl::string_view data);
+
+  absl::string_view data_;
+  const DescriptorLshIndexHeader* header_ = nullptr;
+  const float* mean_ = nullptr;
+  const float* hyperplanes_ = nullptr;
+  const int32* bucket_starts_ = nullptr;
+  const int32* bucket_ids_ = nullptr;
+  const float* descriptors_ = nullptr;
+
+  std::unique_ptr<MappedFile> file_;  // Set for indices opened from file.
+  std::string buffer_;  // Used for indices that are not memory mapped.
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_TRACKING_DESCRIPTOR_LSH_INDEX_H_
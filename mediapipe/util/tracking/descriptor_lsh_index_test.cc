@@ -0,0 +1,192 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/descriptor_lsh_index.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kDims = 40;
+constexpr int kDescriptorsPerTemplate = 20;
+
+// Returns num_templates * kDescriptorsPerTemplate random descriptors in
+// [-1, 1]^kDims, stored row-major.
+std::vector<float> RandomDescriptors(int num_templates, uint32 seed) {
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  std::vector<float> values(num_templates * kDescriptorsPerTemplate * kDims);
+  for (float& value : values) {
+    value = uniform(random);
+  }
+  return values;
+}
+
+std::vector<const float*> RowPointers(const std::vector<float>& values) {
+  std::vector<const float*> rows;
+  for (int k = 0; k < values.size(); k += kDims) {
+    rows.push_back(values.data() + k);
+  }
+  return rows;
+}
+
+// Returns copies of the first num_queries descriptors with added noise.
+std::vector<float> NoisyQueries(const std::vector<float>& descriptors,
+                                int num_queries, float noise) {
+  std::mt19937 random(42);
+  std::uniform_real_distribution<float> uniform(-noise, noise);
+  std::vector<float> queries(descriptors.begin(),
+                             descriptors.begin() + num_queries * kDims);
+  for (float& value : queries) {
+    value += uniform(random);
+  }
+  return queries;
+}
+
+int BruteForceNearest(const std::vector<const float*>& descriptors,
+                      const float* query) {
+  int best_id = -1;
+  float best_distance = std::numeric_limits<float>::max();
+  for (int k = 0; k < descriptors.size(); ++k) {
+    const float distance =
+        DescriptorLshIndex::SquaredDistance(query, descriptors[k], kDims);
+    if (distance < best_distance) {
+      best_distance = distance;
+      best_id = k;
+    }
+  }
+  return best_id;
+}
+
+TEST(DescriptorLshIndexTest, FindsNearestNeighbors) {
+  const std::vector<float> descriptors = RandomDescriptors(100, 1);
+  const std::vector<const float*> rows = RowPointers(descriptors);
+  auto index =
+      DescriptorLshIndex::Build(DescriptorLshIndex::Options(), rows, kDims);
+  ASSERT_TRUE(index != nullptr);
+  EXPECT_EQ(rows.size(), index->num_descriptors());
+  EXPECT_EQ(DescriptorLshIndex::Fingerprint(rows, kDims),
+            index->fingerprint());
+
+  constexpr int kNumQueries = 200;
+  const std::vector<float> queries = NoisyQueries(descriptors, kNumQueries,
+                                                  /*noise=*/0.1f);
+  int num_found = 0;
+  for (int q = 0; q < kNumQueries; ++q) {
+    const float* query = queries.data() + q * kDims;
+    const int expected = BruteForceNearest(rows, query);
+    if (index->FindNearest(query, /*num_probes=*/4) == expected) {
+      ++num_found;
+    }
+  }
+  EXPECT_GE(num_found, kNumQueries * 0.9f);
+
+  // Candidates are sorted and free of duplicates.
+  std::vector<int> candidates;
+  index->FindCandidates(queries.data(), /*num_probes=*/4, &candidates);
+  EXPECT_TRUE(std::is_sorted(candidates.begin(), candidates.end()));
+  EXPECT_TRUE(std::adjacent_find(candidates.begin(), candidates.end()) ==
+              candidates.end());
+}
+
+TEST(DescriptorLshIndexTest, MemoryMappedIndex) {
+  const std::vector<float> descriptors = RandomDescriptors(10, 2);
+  const std::vector<const float*> rows = RowPointers(descriptors);
+  DescriptorLshIndex::Options options;
+  options.num_tables = 4;
+  options.num_bits = 6;
+  auto index = DescriptorLshIndex::Build(options, rows, kDims);
+
+  const std::string filename =
+      absl::StrCat(getenv("TEST_TMPDIR") ? getenv("TEST_TMPDIR") : "/tmp",
+                   "/descriptor_lsh_index_test.idx");
+  ASSERT_TRUE(index->WriteToFile(filename));
+  auto mapped = DescriptorLshIndex::Open(filename);
+  ASSERT_TRUE(mapped != nullptr);
+  EXPECT_EQ(index->data(), mapped->data());
+  EXPECT_EQ(6, mapped->num_bits());
+  EXPECT_EQ(index->fingerprint(), mapped->fingerprint());
+
+  std::vector<int> expected, candidates;
+  for (int k = 0; k < rows.size(); ++k) {
+    index->FindCandidates(rows[k], /*num_probes=*/2, &expected);
+    mapped->FindCandidates(rows[k], /*num_probes=*/2, &candidates);
+    EXPECT_EQ(expected, candidates);
+    EXPECT_EQ(k, mapped->FindNearest(rows[k], /*num_probes=*/0));
+  }
+}
+
+TEST(DescriptorLshIndexTest, RejectsInvalidData) {
+  const std::vector<float> descriptors = RandomDescriptors(1, 3);
+  auto index = DescriptorLshIndex::Build(DescriptorLshIndex::Options(),
+                                         RowPointers(descriptors), kDims);
+  const std::string data(index->data());
+  EXPECT_TRUE(DescriptorLshIndex::FromData(data) != nullptr);
+  EXPECT_TRUE(DescriptorLshIndex::FromData(data.substr(0, data.size() - 8)) ==
+              nullptr);
+
+  // Corrupt first bucket id of first table.
+  std::string corrupted = data;
+  const uint64 ids_offset =
+      reinterpret_cast<const DescriptorLshIndexHeader*>(data.data())
+          ->bucket_ids_offset;
+  corrupted[ids_offset + 3] = 0x7f;
+  EXPECT_TRUE(DescriptorLshIndex::FromData(corrupted) == nullptr);
+}
+
+// Matches descriptors of a single frame against an index of
+// state.range(0) templates. Compare against BM_BruteForceQuery.
+void BM_LshQuery(benchmark::State& state) {
+  const std::vector<float> descriptors = RandomDescriptors(state.range(0), 1);
+  auto index = DescriptorLshIndex::Build(DescriptorLshIndex::Options(),
+                                         RowPointers(descriptors), kDims);
+  constexpr int kNumQueries = 200;
+  const std::vector<float> queries =
+      NoisyQueries(descriptors, kNumQueries, /*noise=*/0.1f);
+  for (auto _ : state) {
+    for (int q = 0; q < kNumQueries; ++q) {
+      benchmark::DoNotOptimize(
+          index->FindNearest(queries.data() + q * kDims, /*num_probes=*/4));
+    }
+  }
+}
+BENCHMARK(BM_LshQuery)->RangeMultiplier(10)->Range(10, 10000);
+
+void BM_BruteForceQuery(benchmark::State& state) {
+  const std::vector<float> descriptors = RandomDescriptors(state.range(0), 1);
+  const std::vector<const float*> rows = RowPointers(descriptors);
+  constexpr int kNumQueries = 200;
+  const std::vector<float> queries =
+      NoisyQueries(descriptors, kNumQueries, /*noise=*/0.1f);
+  for (auto _ : state) {
+    for (int q = 0; q < kNumQueries; ++q) {
+      benchmark::DoNotOptimize(
+          BruteForceNearest(rows, queries.data() + q * kDims));
+    }
+  }
+}
+BENCHMARK(BM_BruteForceQuery)->RangeMultiplier(10)->Range(10, 10000);
+
+}  // namespace
+}  // namespace mediapipe
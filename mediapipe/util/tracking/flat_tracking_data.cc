@@ -0,0 +1,446 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/flat_tracking_data.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kFlatTrackingDataMagic[] = "FTRK";
+constexpr char kFlatTrackingDataChunkMagic[] = "FTCH";
+
+// Pads string to multiple of alignment.
+void PadTo(int alignment, std::string* data) {
+  const int remainder = data->size() % alignment;
+  if (remainder != 0) {
+    data->append(alignment - remainder, 0);
+  }
+}
+
+template <typename T>
+void AppendArray(const T* values, int num_values, std::string* data) {
+  data->append(reinterpret_cast<const char*>(values), num_values * sizeof(T));
+}
+
+// Returns pointer to num_values entries of type T at offset w.r.t. base, or
+// nullptr if out of bounds or misaligned.
+template <typename T>
+const T* ArrayAt(absl::string_view data, uint32 offset, int num_values) {
+  if (num_values < 0 || offset % alignof(T) != 0 || offset > data.size() ||
+      (data.size() - offset) / sizeof(T) < static_cast<size_t>(num_values)) {
+    return nullptr;
+  }
+  return reinterpret_cast<const T*>(data.data() + offset);
+}
+
+}  // namespace.
+
+void EncodeFlatTrackingData(const TrackingData& tracking_data,
+                            std::string* flat_data) {
+  CHECK(flat_data != nullptr);
+  PadTo(8, flat_data);
+  const size_t start = flat_data->size();
+
+  const TrackingData::MotionData& motion_data = tracking_data.motion_data();
+  const int num_vectors = motion_data.row_indices_size();
+  CHECK_EQ(2 * num_vectors, motion_data.vector_data_size());
+
+  // Frames without any motion data might not specify column starts.
+  std::vector<int32> col_starts(motion_data.col_starts().begin(),
+                                motion_data.col_starts().end());
+  if (col_starts.empty() && num_vectors == 0) {
+    col_starts.resize(tracking_data.domain_width() + 1, 0);
+  }
+  CHECK_EQ(tracking_data.domain_width() + 1, col_starts.size());
+  const int num_track_ids = motion_data.track_id_size();
+  CHECK(num_track_ids == 0 || num_track_ids == num_vectors);
+  const int num_descriptors = motion_data.feature_descriptors_size();
+  CHECK(num_descriptors == 0 || num_descriptors == num_vectors);
+
+  std::vector<uint32> descriptor_offsets(1, 0);
+  descriptor_offsets.reserve(num_descriptors + 1);
+  for (const auto& descriptor : motion_data.feature_descriptors()) {
+    descriptor_offsets.push_back(descriptor_offsets.back() +
+                                 descriptor.data().size());
+  }
+  const uint32 descriptor_data_size = descriptor_offsets.back();
+
+  FlatTrackingDataHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kFlatTrackingDataMagic, 4);
+  header.version = kFlatTrackingDataVersion;
+  header.frame_flags = tracking_data.frame_flags();
+  header.domain_width = tracking_data.domain_width();
+  header.domain_height = tracking_data.domain_height();
+  header.frame_aspect = tracking_data.frame_aspect();
+
+  const Homography& model = tracking_data.background_model();
+  const float background_model[8] = {model.h_00(), model.h_01(), model.h_02(),
+                                     model.h_10(), model.h_11(), model.h_12(),
+                                     model.h_20(), model.h_21()};
+  memcpy(header.background_model, background_model, sizeof(background_model));
+
+  header.global_feature_count = tracking_data.global_feature_count();
+  header.average_motion_magnitude = tracking_data.average_motion_magnitude();
+  header.num_vectors = num_vectors;
+  header.num_track_ids = num_track_ids;
+  header.num_discarded_ids = motion_data.actively_discarded_tracked_ids_size();
+  header.num_descriptors = num_descriptors;
+
+  // All sections consist of 4 byte values, therefore sections stay aligned.
+  uint32 offset = sizeof(header);
+  header.col_starts_offset = offset;
+  offset += col_starts.size() * sizeof(int32);
+  header.row_indices_offset = offset;
+  offset += num_vectors * sizeof(int32);
+  header.vector_data_offset = offset;
+  offset += 2 * num_vectors * sizeof(float);
+  header.track_ids_offset = offset;
+  offset += num_track_ids * sizeof(int32);
+  header.discarded_ids_offset = offset;
+  offset += header.num_discarded_ids * sizeof(int32);
+  header.descriptor_offsets_offset = offset;
+  offset += descriptor_offsets.size() * sizeof(uint32);
+  header.descriptor_data_offset = offset;
+  // Pad descriptor data, so that consecutive blobs stay aligned.
+  offset += (descriptor_data_size + 3) / 4 * 4;
+  header.size = offset;
+
+  flat_data->reserve(start + header.size);
+  AppendArray(&header, 1, flat_data);
+  AppendArray(col_starts.data(), col_starts.size(), flat_data);
+  AppendArray(motion_data.row_indices().data(), num_vectors, flat_data);
+  AppendArray(motion_data.vector_data().data(), 2 * num_vectors, flat_data);
+  AppendArray(motion_data.track_id().data(), num_track_ids, flat_data);
+  AppendArray(motion_data.actively_discarded_tracked_ids().data(),
+              header.num_discarded_ids, flat_data);
+  AppendArray(descriptor_offsets.data(), descriptor_offsets.size(), flat_data);
+  for (const auto& descriptor : motion_data.feature_descriptors()) {
+    flat_data->append(descriptor.data());
+  }
+  PadTo(4, flat_data);
+  CHECK_EQ(start + header.size, flat_data->size());
+}
+
+void EncodeFlatTrackingDataChunk(const TrackingDataChunk& chunk,
+                                 std::string* flat_chunk) {
+  CHECK(flat_chunk != nullptr);
+  flat_chunk->clear();
+
+  const int num_items = chunk.item_size();
+  FlatTrackingDataChunkHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kFlatTrackingDataChunkMagic, 4);
+  header.version = kFlatTrackingDataVersion;
+  header.num_items = num_items;
+  header.flags = (chunk.first_chunk() ? FLAT_CHUNK_FIRST : 0) |
+                 (chunk.last_chunk() ? FLAT_CHUNK_LAST : 0);
+
+  std::vector<FlatTrackingDataChunkItem> items(num_items);
+  std::string item_data;
+  const size_t data_start = sizeof(header) + num_items * sizeof(items[0]);
+  for (int k = 0; k < num_items; ++k) {
+    const TrackingDataChunk::Item& item = chunk.item(k);
+    if (k > 0) {
+      CHECK_GE(item.timestamp_usec(), chunk.item(k - 1).timestamp_usec())
+          << "Chunk items need to be sorted by time.";
+    }
+    FlatTrackingDataChunkItem& flat_item = items[k];
+    memset(&flat_item, 0, sizeof(flat_item));
+    flat_item.timestamp_usec = item.timestamp_usec();
+    flat_item.prev_timestamp_usec = item.prev_timestamp_usec();
+    flat_item.has_prev_timestamp = item.has_prev_timestamp_usec();
+    flat_item.frame_idx = item.frame_idx();
+
+    PadTo(8, &item_data);
+    const size_t item_start = item_data.size();
+    EncodeFlatTrackingData(item.tracking_data(), &item_data);
+    flat_item.data_offset = data_start + item_start;
+    flat_item.data_size = item_data.size() - item_start;
+  }
+
+  flat_chunk->reserve(data_start + item_data.size());
+  AppendArray(&header, 1, flat_chunk);
+  AppendArray(items.data(), num_items, flat_chunk);
+  flat_chunk->append(item_data);
+}
+
+bool IsFlatTrackingDataChunk(absl::string_view data) {
+  return data.size() >= sizeof(FlatTrackingDataChunkHeader) &&
+         memcmp(data.data(), kFlatTrackingDataChunkMagic, 4) == 0;
+}
+
+bool FlatTrackingDataView::Init(absl::string_view data) {
+  header_ = nullptr;
+  const FlatTrackingDataHeader* header =
+      ArrayAt<FlatTrackingDataHeader>(data, 0, 1);
+  if (header == nullptr ||
+      reinterpret_cast<uintptr_t>(data.data()) % alignof(int64) != 0) {
+    LOG(ERROR) << "Flat tracking data truncated or misaligned.";
+    return false;
+  }
+
+  if (memcmp(header->magic, kFlatTrackingDataMagic, 4) != 0) {
+    LOG(ERROR) << "Not a flat tracking data blob.";
+    return false;
+  }
+
+  if (header->version != kFlatTrackingDataVersion) {
+    LOG(ERROR) << "Unsupported flat tracking data version: "
+               << header->version;
+    return false;
+  }
+
+  if (header->size > data.size() || header->domain_width < 0 ||
+      (header->num_track_ids != 0 &&
+       header->num_track_ids != header->num_vectors) ||
+      (header->num_descriptors != 0 &&
+       header->num_descriptors != header->num_vectors)) {
+    LOG(ERROR) << "Invalid flat tracking data header.";
+    return false;
+  }
+
+  data = data.substr(0, header->size);
+  col_starts_ =
+      ArrayAt<int32>(data, header->col_starts_offset, header->domain_width + 1);
+  row_indices_ =
+      ArrayAt<int32>(data, header->row_indices_offset, header->num_vectors);
+  vector_data_ =
+      ArrayAt<float>(data, header->vector_data_offset, 2 * header->num_vectors);
+  track_ids_ =
+      ArrayAt<int32>(data, header->track_ids_offset, header->num_track_ids);
+  discarded_ids_ = ArrayAt<int32>(data, header->discarded_ids_offset,
+                                  header->num_discarded_ids);
+  descriptor_offsets_ = ArrayAt<uint32>(
+      data, header->descriptor_offsets_offset, header->num_descriptors + 1);
+
+  if (!col_starts_ || !row_indices_ || !vector_data_ || !track_ids_ ||
+      !discarded_ids_ || !descriptor_offsets_) {
+    LOG(ERROR) << "Flat tracking data section out of bounds.";
+    return false;
+  }
+
+  if (descriptor_offsets_[0] != 0) {
+    LOG(ERROR) << "Inconsistent descriptor offsets in flat tracking data.";
+    return false;
+  }
+  for (int r = 0; r < header->num_descriptors; ++r) {
+    if (descriptor_offsets_[r] > descriptor_offsets_[r + 1]) {
+      LOG(ERROR) << "Descriptor offsets are not monotonic.";
+      return false;
+    }
+  }
+  descriptor_data_ =
+      ArrayAt<char>(data, header->descriptor_data_offset,
+                    descriptor_offsets_[header->num_descriptors]);
+  if (!descriptor_data_) {
+    LOG(ERROR) << "Flat tracking data descriptors out of bounds.";
+    return false;
+  }
+
+  // Guard against out of bounds reads when iterating over columns.
+  if (col_starts_[0] != 0 ||
+      col_starts_[header->domain_width] != header->num_vectors) {
+    LOG(ERROR) << "Inconsistent column starts in flat tracking data.";
+    return false;
+  }
+  for (int c = 0; c < header->domain_width; ++c) {
+    if (col_starts_[c] > col_starts_[c + 1]) {
+      LOG(ERROR) << "Column starts are not monotonic.";
+      return false;
+    }
+  }
+
+  if (header->num_track_ids == 0) {
+    track_ids_ = nullptr;
+  }
+
+  header_ = header;
+  return true;
+}
+
+Homography FlatTrackingDataView::background_model() const {
+  Homography model;
+  const float* h = header_->background_model;
+  model.set_h_00(h[0]);
+  model.set_h_01(h[1]);
+  model.set_h_02(h[2]);
+  model.set_h_10(h[3]);
+  model.set_h_11(h[4]);
+  model.set_h_12(h[5]);
+  model.set_h_20(h[6]);
+  model.set_h_21(h[7]);
+  return model;
+}
+
+void FlatTrackingDataView::ToTrackingData(TrackingData* tracking_data) const {
+  CHECK(tracking_data != nullptr);
+  CHECK(IsValid());
+  tracking_data->Clear();
+  tracking_data->set_frame_flags(frame_flags());
+  tracking_data->set_domain_width(domain_width());
+  tracking_data->set_domain_height(domain_height());
+  tracking_data->set_frame_aspect(frame_aspect());
+  *tracking_data->mutable_background_model() = background_model();
+  tracking_data->set_global_feature_count(global_feature_count());
+  tracking_data->set_average_motion_magnitude(average_motion_magnitude());
+
+  TrackingData::MotionData* motion_data = tracking_data->mutable_motion_data();
+  const int num = num_vectors();
+  motion_data->set_num_elements(num);
+  motion_data->mutable_vector_data()->Add(vector_data_,
+                                          vector_data_ + 2 * num);
+  motion_data->mutable_row_indices()->Add(row_indices_, row_indices_ + num);
+  motion_data->mutable_col_starts()->Add(col_starts_,
+                                         col_starts_ + domain_width() + 1);
+  if (has_track_ids()) {
+    motion_data->mutable_track_id()->Add(track_ids_, track_ids_ + num);
+  }
+  motion_data->mutable_actively_discarded_tracked_ids()->Add(
+      discarded_ids_, discarded_ids_ + num_discarded_ids());
+  if (has_descriptors()) {
+    for (int r = 0; r < num; ++r) {
+      const absl::string_view data = descriptor(r);
+      motion_data->add_feature_descriptors()->set_data(data.data(),
+                                                       data.size());
+    }
+  }
+}
+
+bool FlatTrackingDataChunkView::Init(absl::string_view data) {
+  header_ = nullptr;
+  items_ = nullptr;
+  num_items_ = 0;
+
+  const FlatTrackingDataChunkHeader* header =
+      ArrayAt<FlatTrackingDataChunkHeader>(data, 0, 1);
+  if (header == nullptr || !IsFlatTrackingDataChunk(data) ||
+      reinterpret_cast<uintptr_t>(data.data()) % alignof(int64) != 0) {
+    LOG(ERROR) << "Not a flat tracking data chunk or misaligned.";
+    return false;
+  }
+
+  if (header->version != kFlatTrackingDataVersion) {
+    LOG(ERROR) << "Unsupported flat chunk version: " << header->version;
+    return false;
+  }
+
+  const FlatTrackingDataChunkItem* items =
+      ArrayAt<FlatTrackingDataChunkItem>(data, sizeof(*header),
+                                         header->num_items);
+  if (items == nullptr) {
+    LOG(ERROR) << "Flat chunk item index truncated.";
+    return false;
+  }
+
+  data_ = data;
+  header_ = header;
+  items_ = items;
+  num_items_ = header->num_items;
+  return true;
+}
+
+FlatTrackingDataView FlatTrackingDataChunkView::item_data(int idx) const {
+  CHECK_GE(idx, 0);
+  CHECK_LT(idx, num_items_);
+  FlatTrackingDataView view;
+  const FlatTrackingDataChunkItem& chunk_item = items_[idx];
+  if (chunk_item.data_offset > data_.size() ||
+      chunk_item.data_size > data_.size() - chunk_item.data_offset) {
+    LOG(ERROR) << "Flat chunk item " << idx << " out of bounds.";
+    return view;
+  }
+  view.Init(data_.substr(chunk_item.data_offset, chunk_item.data_size));
+  return view;
+}
+
+int FlatTrackingDataChunkView::ClosestItemIndex(int64 timestamp_usec) const {
+  if (num_items_ == 0) {
+    return -1;
+  }
+
+  const FlatTrackingDataChunkItem* end = items_ + num_items_;
+  const FlatTrackingDataChunkItem* pos = std::lower_bound(
+      items_, end, timestamp_usec,
+      [](const FlatTrackingDataChunkItem& item, int64 value) -> bool {
+        return item.timestamp_usec < value;
+      });
+
+  if (pos == end) {
+    return num_items_ - 1;
+  }
+  if (pos != items_ && timestamp_usec - (pos - 1)->timestamp_usec <
+                           pos->timestamp_usec - timestamp_usec) {
+    --pos;
+  }
+  return pos - items_;
+}
+
+bool FlatTrackingDataChunkView::ToTrackingDataChunk(
+    TrackingDataChunk* chunk) const {
+  CHECK(chunk != nullptr);
+  chunk->Clear();
+  if (header_ == nullptr) {
+    return false;
+  }
+
+  chunk->set_first_chunk(first_chunk());
+  chunk->set_last_chunk(last_chunk());
+  for (int k = 0; k < num_items_; ++k) {
+    const FlatTrackingDataView view = item_data(k);
+    if (!view.IsValid()) {
+      return false;
+    }
+
+    TrackingDataChunk::Item* item = chunk->add_item();
+    item->set_frame_idx(items_[k].frame_idx);
+    item->set_timestamp_usec(items_[k].timestamp_usec);
+    if (items_[k].has_prev_timestamp) {
+      item->set_prev_timestamp_usec(items_[k].prev_timestamp_usec);
+    }
+    view.ToTrackingData(item->mutable_tracking_data());
+  }
+  return true;
+}
+
+std::unique_ptr<MappedFlatTrackingDataChunk> MappedFlatTrackingDataChunk::Open(
+    const std::string& filename) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(filename);
+  if (file == nullptr) {
+    return nullptr;
+  }
+  return FromMappedFile(std::move(file));
+}
+
+std::unique_ptr<MappedFlatTrackingDataChunk>
+MappedFlatTrackingDataChunk::FromMappedFile(std::unique_ptr<MappedFile> file) {
+  CHECK(file != nullptr);
+  std::unique_ptr<MappedFlatTrackingDataChunk> chunk(
+      new MappedFlatTrackingDataChunk());
+  if (!chunk->view_.Init(file->data())) {
+    return nullptr;
+  }
+  chunk->file_ = std::move(file);
+  return chunk;
+}
+
+}  // namespace mediapipe
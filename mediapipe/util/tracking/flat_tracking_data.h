@@ -0,0 +1,273 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Flat, versioned layout of TrackingData and TrackingDataChunk that can be
+// read in place, e.g. directly from a memory mapped file, without parsing
+// protos or decoding the compressed BinaryTrackingData representation.
+//
+// Usage (output):
+// TrackingDataChunk chunk;          // Externally supplied.
+// std::string flat_chunk;
+// EncodeFlatTrackingDataChunk(chunk, &flat_chunk);
+// // Write flat_chunk to file.
+//
+// Usage (input):
+// auto mapped = MappedFlatTrackingDataChunk::Open(chunk_file);
+// const FlatTrackingDataChunkView& view = mapped->view();
+// const int idx = view.ClosestItemIndex(timestamp_usec);
+// const FlatTrackingDataView& data = view.item_data(idx);
+// MotionVectorFrame mvf;
+// MotionVectorFrameFromFlatTrackingData(data, &mvf);  // See tracking.h.
+//
+// All values are stored LITTLE ENDIAN. Every section is 4 byte aligned within
+// its enclosing buffer, which itself is required to be 8 byte aligned (true
+// for heap allocated strings and memory mapped files).
+//
+// Layout of a flat TrackingData blob:
+// {  FlatTrackingDataHeader  (see below)
+//    col_starts             : (domain_width + 1) * 32 bit int
+//    row_indices            : num_vectors * 32 bit int
+//    vector_data            : 2 * num_vectors * 32 bit float (dx, dy)
+//    track_ids              : num_track_ids * 32 bit int (0 or num_vectors)
+//    discarded_ids          : num_discarded_ids * 32 bit int
+//    descriptor_offsets     : (num_descriptors + 1) * 32 bit int, byte
+//                             offsets of each descriptor w.r.t. start of
+//                             descriptor_data (num_descriptors is 0 or
+//                             num_vectors)
+//    descriptor_data        : binary feature descriptors, concatenated and
+//                             padded to 4 bytes
+// }
+//
+// Layout of a flat TrackingDataChunk file:
+// {  FlatTrackingDataChunkHeader
+//    items                  : num_items * FlatTrackingDataChunkItem, sorted
+//                             by timestamp (index for random seek)
+//    item data              : num_items * flat TrackingData blob (8 byte
+//                             aligned, located via item offsets)
+// }
+
+#ifndef MEDIAPIPE_UTIL_TRACKING_FLAT_TRACKING_DATA_H_
+#define MEDIAPIPE_UTIL_TRACKING_FLAT_TRACKING_DATA_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/util/tracking/flow_packager.pb.h"
+#include "mediapipe/util/tracking/mapped_file.h"
+#include "mediapipe/util/tracking/motion_models.pb.h"
+
+namespace mediapipe {
+
+// Increase on any change of the layouts below.
+constexpr uint32 kFlatTrackingDataVersion = 2;
+
+struct FlatTrackingDataHeader {
+  char magic[4];  // "FTRK"
+  uint32 version;
+  uint32 size;  // Total size of blob in bytes, including header.
+  int32 frame_flags;
+  int32 domain_width;
+  int32 domain_height;
+  float frame_aspect;
+  float background_model[8];  // h_00, h_01, h_02, h_10, h_11, h_12, h_20, h_21
+  uint32 global_feature_count;
+  float average_motion_magnitude;
+  int32 num_vectors;
+  int32 num_track_ids;
+  int32 num_discarded_ids;
+  // Offsets in bytes w.r.t. beginning of the header.
+  uint32 col_starts_offset;
+  uint32 row_indices_offset;
+  uint32 vector_data_offset;
+  uint32 track_ids_offset;
+  uint32 discarded_ids_offset;
+  int32 num_descriptors;
+  uint32 descriptor_offsets_offset;
+  uint32 descriptor_data_offset;
+};
+
+static_assert(sizeof(FlatTrackingDataHeader) == 112,
+              "Do not alter layout of FlatTrackingDataHeader, use version.");
+
+struct FlatTrackingDataChunkHeader {
+  char magic[4];  // "FTCH"
+  uint32 version;
+  uint32 num_items;
+  uint32 flags;  // Combination of FlatTrackingDataChunkFlags.
+};
+
+enum FlatTrackingDataChunkFlags {
+  FLAT_CHUNK_FIRST = 1,
+  FLAT_CHUNK_LAST = 2,
+};
+
+struct FlatTrackingDataChunkItem {
+  int64 timestamp_usec;
+  int64 prev_timestamp_usec;  // Only valid if has_prev_timestamp is set.
+  int32 frame_idx;
+  uint32 has_prev_timestamp;
+  // Offset in bytes w.r.t. beginning of the chunk and size of the flat
+  // TrackingData blob for this item.
+  uint32 data_offset;
+  uint32 data_size;
+};
+
+static_assert(sizeof(FlatTrackingDataChunkHeader) == 16,
+              "Do not alter layout of FlatTrackingDataChunkHeader.");
+static_assert(sizeof(FlatTrackingDataChunkItem) == 32,
+              "Do not alter layout of FlatTrackingDataChunkItem.");
+
+// Encodes TrackingData (as output by FlowPackager::PackFlow) to a flat blob.
+// Output is appended to flat_data, after padding flat_data to 8 bytes.
+void EncodeFlatTrackingData(const TrackingData& tracking_data,
+                            std::string* flat_data);
+
+// Encodes all items of a TrackingDataChunk into a flat chunk.
+void EncodeFlatTrackingDataChunk(const TrackingDataChunk& chunk,
+                                 std::string* flat_chunk);
+
+// Returns true if data starts with a flat chunk header (used to distinguish
+// flat chunk files from serialized TrackingDataChunk protos).
+bool IsFlatTrackingDataChunk(absl::string_view data);
+
+// Read-only view of a flat TrackingData blob. Does not own the underlying
+// memory, which has to outlive the view. All accessors return pointers into
+// the viewed buffer.
+class FlatTrackingDataView {
+ public:
+  FlatTrackingDataView() = default;
+
+  // Validates header, version and bounds of all sections. Returns false for
+  // truncated, misaligned or otherwise invalid data.
+  bool Init(absl::string_view data);
+
+  bool IsValid() const { return header_ != nullptr; }
+
+  int frame_flags() const { return header_->frame_flags; }
+  int domain_width() const { return header_->domain_width; }
+  int domain_height() const { return header_->domain_height; }
+  float frame_aspect() const { return header_->frame_aspect; }
+  uint32 global_feature_count() const { return header_->global_feature_count; }
+  float average_motion_magnitude() const {
+    return header_->average_motion_magnitude;
+  }
+  int num_vectors() const { return header_->num_vectors; }
+
+  // Returns background model as Homography (copied, 8 floats).
+  Homography background_model() const;
+
+  // domain_width + 1 entries.
+  const int32* col_starts() const { return col_starts_; }
+  // num_vectors entries.
+  const int32* row_indices() const { return row_indices_; }
+  // 2 * num_vectors entries, packed as (dx, dy).
+  const float* vector_data() const { return vector_data_; }
+
+  // Track ids are optional, returns nullptr if not present.
+  bool has_track_ids() const { return header_->num_track_ids > 0; }
+  const int32* track_ids() const { return track_ids_; }
+
+  int num_discarded_ids() const { return header_->num_discarded_ids; }
+  const int32* discarded_ids() const { return discarded_ids_; }
+
+  // Feature descriptors are optional, present for all or none of the
+  // features.
+  bool has_descriptors() const { return header_->num_descriptors > 0; }
+  // Returns binary descriptor of the r'th feature, r < num_vectors().
+  absl::string_view descriptor(int r) const {
+    return absl::string_view(
+        descriptor_data_ + descriptor_offsets_[r],
+        descriptor_offsets_[r + 1] - descriptor_offsets_[r]);
+  }
+
+  // Copies viewed data into TrackingData proto.
+  void ToTrackingData(TrackingData* tracking_data) const;
+
+ private:
+  const FlatTrackingDataHeader* header_ = nullptr;
+  const int32* col_starts_ = nullptr;
+  const int32* row_indices_ = nullptr;
+  const float* vector_data_ = nullptr;
+  const int32* track_ids_ = nullptr;
+  const int32* discarded_ids_ = nullptr;
+  const uint32* descriptor_offsets_ = nullptr;
+  const char* descriptor_data_ = nullptr;
+};
+
+// Read-only view of a flat TrackingDataChunk. Item data is validated lazily
+// on access, so opening a chunk is O(num_items) independent of data size.
+class FlatTrackingDataChunkView {
+ public:
+  FlatTrackingDataChunkView() = default;
+
+  // Validates chunk header and item index. Returns false on invalid data.
+  bool Init(absl::string_view data);
+
+  int num_items() const { return num_items_; }
+  bool first_chunk() const { return header_->flags & FLAT_CHUNK_FIRST; }
+  bool last_chunk() const { return header_->flags & FLAT_CHUNK_LAST; }
+
+  const FlatTrackingDataChunkItem& item(int idx) const { return items_[idx]; }
+
+  // Returns view of item's tracking data. Returned view is invalid (see
+  // FlatTrackingDataView::IsValid) if data is corrupted.
+  FlatTrackingDataView item_data(int idx) const;
+
+  // Returns index of item with timestamp closest to timestamp_usec, -1 for
+  // empty chunks. Uses binary search over the item index.
+  int ClosestItemIndex(int64 timestamp_usec) const;
+
+  // Copies whole chunk into proto representation.
+  bool ToTrackingDataChunk(TrackingDataChunk* chunk) const;
+
+ private:
+  absl::string_view data_;
+  const FlatTrackingDataChunkHeader* header_ = nullptr;
+  const FlatTrackingDataChunkItem* items_ = nullptr;
+  int num_items_ = 0;
+};
+
+// Flat chunk backed by a read-only memory mapped file (or a heap copy on
+// platforms without mmap support). See MappedFile for how to safely replace
+// chunk files that might be mapped.
+class MappedFlatTrackingDataChunk {
+ public:
+  // Returns nullptr if file can not be opened or is not a valid flat chunk.
+  static std::unique_ptr<MappedFlatTrackingDataChunk> Open(
+      const std::string& filename);
+
+  // Same as above for an already mapped file. Returns nullptr if file is not a
+  // valid flat chunk.
+  static std::unique_ptr<MappedFlatTrackingDataChunk> FromMappedFile(
+      std::unique_ptr<MappedFile> file);
+
+  MappedFlatTrackingDataChunk(const MappedFlatTrackingDataChunk&) = delete;
+  MappedFlatTrackingDataChunk& operator=(const MappedFlatTrackingDataChunk&) =
+      delete;
+
+  const FlatTrackingDataChunkView& view() const { return view_; }
+
+ private:
+  MappedFlatTrackingDataChunk() = default;
+
+  std::unique_ptr<MappedFile> file_;
+  FlatTrackingDataChunkView view_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_TRACKING_FLAT_TRACKING_DATA_H_
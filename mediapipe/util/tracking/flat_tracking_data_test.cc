@@ -0,0 +1,187 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/flat_tracking_data.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// Returns tracking data over a 4x3 domain with features in columns 0 and 2.
+TrackingData MakeTrackingData(float offset) {
+  TrackingData data;
+  data.set_frame_flags(TrackingData::FLAG_DUPLICATED);
+  data.set_domain_width(4);
+  data.set_domain_height(3);
+  data.set_frame_aspect(1.5f);
+  Homography* background_model = data.mutable_background_model();
+  background_model->set_h_00(1.0f);
+  background_model->set_h_01(0.0f);
+  background_model->set_h_02(offset);
+  background_model->set_h_10(0.0f);
+  background_model->set_h_11(1.0f);
+  background_model->set_h_12(0.0f);
+  background_model->set_h_20(0.0f);
+  background_model->set_h_21(0.0f);
+  data.set_global_feature_count(3);
+  data.set_average_motion_magnitude(0.5f);
+
+  TrackingData::MotionData* motion_data = data.mutable_motion_data();
+  motion_data->set_num_elements(3);
+  for (int k = 0; k < 3; ++k) {
+    motion_data->add_vector_data(k + offset);
+    motion_data->add_vector_data(-k - offset);
+    motion_data->add_track_id(10 + k);
+  }
+  motion_data->add_row_indices(0);
+  motion_data->add_row_indices(2);
+  motion_data->add_row_indices(1);
+  for (int col_start : {0, 2, 2, 3, 3}) {
+    motion_data->add_col_starts(col_start);
+  }
+  motion_data->add_actively_discarded_tracked_ids(7);
+  return data;
+}
+
+TEST(FlatTrackingDataTest, RoundTrip) {
+  const TrackingData data = MakeTrackingData(0.25f);
+  std::string flat;
+  EncodeFlatTrackingData(data, &flat);
+
+  FlatTrackingDataView view;
+  ASSERT_TRUE(view.Init(flat));
+  EXPECT_EQ(4, view.domain_width());
+  EXPECT_EQ(3, view.num_vectors());
+  EXPECT_EQ(2, view.row_indices()[1]);
+  EXPECT_FLOAT_EQ(-2.25f, view.vector_data()[5]);
+  ASSERT_TRUE(view.has_track_ids());
+  EXPECT_EQ(12, view.track_ids()[2]);
+  EXPECT_FLOAT_EQ(0.25f, view.background_model().h_02());
+
+  TrackingData decoded;
+  view.ToTrackingData(&decoded);
+  EXPECT_EQ(data.SerializeAsString(), decoded.SerializeAsString());
+}
+
+TEST(FlatTrackingDataTest, RoundTripDescriptors) {
+  TrackingData data = MakeTrackingData(0.5f);
+  TrackingData::MotionData* motion_data = data.mutable_motion_data();
+  // Descriptors of varying, unaligned length.
+  for (const char* descriptor : {"abcde", "", "fg"}) {
+    motion_data->add_feature_descriptors()->set_data(descriptor);
+  }
+  std::string flat;
+  EncodeFlatTrackingData(data, &flat);
+  EXPECT_EQ(0, flat.size() % 4);
+
+  FlatTrackingDataView view;
+  ASSERT_TRUE(view.Init(flat));
+  ASSERT_TRUE(view.has_descriptors());
+  EXPECT_EQ("abcde", view.descriptor(0));
+  EXPECT_EQ("", view.descriptor(1));
+  EXPECT_EQ("fg", view.descriptor(2));
+
+  TrackingData decoded;
+  view.ToTrackingData(&decoded);
+  EXPECT_EQ(data.SerializeAsString(), decoded.SerializeAsString());
+}
+
+TEST(FlatTrackingDataTest, RejectsInvalidData) {
+  std::string flat;
+  EncodeFlatTrackingData(MakeTrackingData(0), &flat);
+
+  FlatTrackingDataView view;
+  EXPECT_FALSE(view.Init(absl::string_view(flat).substr(0, flat.size() - 4)));
+  EXPECT_FALSE(view.IsValid());
+
+  std::string wrong_version = flat;
+  wrong_version[4] = 99;
+  EXPECT_FALSE(view.Init(wrong_version));
+}
+
+TEST(FlatTrackingDataTest, ChunkSeek) {
+  TrackingDataChunk chunk;
+  chunk.set_first_chunk(true);
+  chunk.set_last_chunk(false);
+  for (int k = 0; k < 5; ++k) {
+    TrackingDataChunk::Item* item = chunk.add_item();
+    *item->mutable_tracking_data() = MakeTrackingData(k);
+    item->set_frame_idx(k);
+    item->set_timestamp_usec(k * 33000);
+    if (k > 0) {
+      item->set_prev_timestamp_usec((k - 1) * 33000);
+    }
+  }
+
+  std::string flat_chunk;
+  EncodeFlatTrackingDataChunk(chunk, &flat_chunk);
+  EXPECT_TRUE(IsFlatTrackingDataChunk(flat_chunk));
+
+  FlatTrackingDataChunkView view;
+  ASSERT_TRUE(view.Init(flat_chunk));
+  EXPECT_EQ(5, view.num_items());
+  EXPECT_TRUE(view.first_chunk());
+  EXPECT_FALSE(view.last_chunk());
+
+  EXPECT_EQ(0, view.ClosestItemIndex(-1000));
+  EXPECT_EQ(2, view.ClosestItemIndex(70000));
+  EXPECT_EQ(3, view.ClosestItemIndex(99000));
+  EXPECT_EQ(4, view.ClosestItemIndex(1000000));
+
+  const FlatTrackingDataView item_view = view.item_data(3);
+  ASSERT_TRUE(item_view.IsValid());
+  EXPECT_FLOAT_EQ(3.0f, item_view.background_model().h_02());
+
+  TrackingDataChunk decoded;
+  ASSERT_TRUE(view.ToTrackingDataChunk(&decoded));
+  EXPECT_EQ(chunk.SerializeAsString(), decoded.SerializeAsString());
+}
+
+TEST(FlatTrackingDataTest, MappedChunk) {
+  TrackingDataChunk chunk;
+  chunk.set_first_chunk(false);
+  chunk.set_last_chunk(true);
+  for (int k = 0; k < 3; ++k) {
+    TrackingDataChunk::Item* item = chunk.add_item();
+    *item->mutable_tracking_data() = MakeTrackingData(k);
+    item->set_frame_idx(k);
+    item->set_timestamp_usec(k * 33000);
+  }
+  std::string flat_chunk;
+  EncodeFlatTrackingDataChunk(chunk, &flat_chunk);
+
+  const std::string filename =
+      absl::StrCat(getenv("TEST_TMPDIR"), "/flat_chunk");
+  MP_ASSERT_OK(file::SetContents(filename, flat_chunk));
+  auto mapped = MappedFlatTrackingDataChunk::Open(filename);
+  ASSERT_TRUE(mapped != nullptr);
+  EXPECT_EQ(3, mapped->view().num_items());
+  TrackingDataChunk decoded;
+  ASSERT_TRUE(mapped->view().ToTrackingDataChunk(&decoded));
+  EXPECT_EQ(chunk.SerializeAsString(), decoded.SerializeAsString());
+
+  // Serialized protos are rejected.
+  MP_ASSERT_OK(file::SetContents(filename, chunk.SerializeAsString()));
+  EXPECT_TRUE(MappedFlatTrackingDataChunk::Open(filename) == nullptr);
+}
+
+}  // namespace
+}  // namespace mediapipe
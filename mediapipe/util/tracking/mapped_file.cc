@@ -0,0 +1,139 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/mapped_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+
+#include "mediapipe/framework/port/logging.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mediapipe {
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& filename) {
+  std::unique_ptr<MappedFile> file(new MappedFile());
+
+#if !defined(_WIN32)
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not open file: " << filename;
+    return nullptr;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    LOG(ERROR) << "Could not stat file or file is empty: " << filename;
+    close(fd);
+    return nullptr;
+  }
+
+  void* mapped =
+      mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // Mapping persists after close.
+  if (mapped == MAP_FAILED) {
+    LOG(ERROR) << "Could not memory map file: " << filename;
+    return nullptr;
+  }
+
+  file->mapped_data_ = mapped;
+  file->mapped_size_ = file_stat.st_size;
+  file->data_ =
+      absl::string_view(static_cast<const char*>(mapped), file->mapped_size_);
+#else
+  std::ifstream in(filename, std::ios::in | std::ios::binary);
+  if (!in) {
+    LOG(ERROR) << "Could not read file: " << filename;
+    return nullptr;
+  }
+  in.seekg(0, std::ios::end);
+  file->buffer_.resize(in.tellg());
+  if (file->buffer_.empty()) {
+    LOG(ERROR) << "File is empty: " << filename;
+    return nullptr;
+  }
+  in.seekg(0, std::ios::beg);
+  in.read(&file->buffer_[0], file->buffer_.size());
+  file->data_ = file->buffer_;
+#endif
+
+  return file;
+}
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+  if (mapped_data_ != nullptr) {
+    munmap(mapped_data_, mapped_size_);
+  }
+#endif
+}
+
+bool ReplaceFileContents(const std::string& filename, absl::string_view data) {
+#if !defined(_WIN32)
+  std::string temp_filename = filename + ".XXXXXX";
+  const int fd = mkstemp(&temp_filename[0]);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not create temporary file for: " << filename;
+    return false;
+  }
+
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t result =
+        write(fd, data.data() + written, data.size() - written);
+    if (result < 0) {
+      break;
+    }
+    written += result;
+  }
+  // mkstemp creates files only accessible by the owner.
+  fchmod(fd, 0644);
+  if (close(fd) != 0 || written != data.size()) {
+    LOG(ERROR) << "Could not write temporary file: " << temp_filename;
+    unlink(temp_filename.c_str());
+    return false;
+  }
+#else
+  const std::string temp_filename = filename + ".tmp";
+  {
+    std::ofstream out(temp_filename, std::ios::out | std::ios::binary);
+    out.write(data.data(), data.size());
+    if (!out) {
+      LOG(ERROR) << "Could not write temporary file: " << temp_filename;
+      remove(temp_filename.c_str());
+      return false;
+    }
+  }
+  // rename does not replace existing files on Windows, files are not mapped
+  // on this platform (see MappedFile::Open).
+  remove(filename.c_str());
+#endif
+
+  if (rename(temp_filename.c_str(), filename.c_str()) != 0) {
+    LOG(ERROR) << "Could not rename " << temp_filename << " to " << filename;
+    remove(temp_filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace mediapipe
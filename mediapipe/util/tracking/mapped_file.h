@@ -0,0 +1,64 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Read-only view of a whole file, memory mapped where supported (read into
+// memory on platforms without mmap). Used for the flat, in place readable
+// tracking formats (flat_tracking_data.h, descriptor_lsh_index.h).
+//
+// Note: A mapping reflects later changes to the file, and reading a mapped
+// file that is truncated raises SIGBUS. Writers must therefore never modify
+// a file that might be mapped, but replace it atomically (write a temporary
+// file in the same directory and rename(2) it over the target).
+
+#ifndef MEDIAPIPE_UTIL_TRACKING_MAPPED_FILE_H_
+#define MEDIAPIPE_UTIL_TRACKING_MAPPED_FILE_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace mediapipe {
+
+class MappedFile {
+ public:
+  // Returns nullptr if file does not exist, is empty or can not be mapped.
+  static std::unique_ptr<MappedFile> Open(const std::string& filename);
+
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Contents of the file. Page aligned if memory mapped, otherwise aligned
+  // for any fundamental type.
+  absl::string_view data() const { return data_; }
+
+ private:
+  MappedFile() = default;
+
+  absl::string_view data_;
+  void* mapped_data_ = nullptr;
+  size_t mapped_size_ = 0;
+  std::string buffer_;  // Used if memory mapping is unavailable.
+};
+
+// Writes data to a temporary file in the directory of filename and renames it
+// over filename. Readers that mapped the previous file keep their consistent
+// view of it, new readers see the complete new contents. Returns false on
+// failure, in which case filename is unchanged.
+bool ReplaceFileContents(const std::string& filename, absl::string_view data);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_TRACKING_MAPPED_FILE_H_
@@ -21,6 +21,8 @@
 #include <memory>
 
 #include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/vector.h"
@@ -98,22 +100,18 @@ MotionAnalysis::MotionAnalysis(const MotionAnalysisOptions& options,
     prev_frame_.reset(new cv::Mat(frame_height_, frame_width_, CV_8UC3));
   }
 
+  InitAdaptiveResolution();
+
   // Setup streaming buffer. By default we buffer features and motion.
   // If saliency is computed, also buffer saliency and filtered/smoothed
   // output_saliency.
-  std::vector<TaggedType> data_config{
-      TaggedPointerType<RegionFlowFeatureList>("features"),
-      TaggedPointerType<CameraMotion>("motion")};
-  std::vector<TaggedType> data_config_saliency = data_config;
-  data_config_saliency.push_back(
-      TaggedPointerType<SalientPointFrame>("saliency"));
-  data_config_saliency.push_back(
-      TaggedPointerType<SalientPointFrame>("output_saliency"));
-
-  // Store twice the overlap.
-  buffer_.reset(new StreamingBuffer(
-      options_.compute_motion_saliency() ? data_config_saliency : data_config,
-      2 * overlap_size_));
+  const bool compute_saliency = options_.compute_motion_saliency();
+
+  // Store twice the overlap. Preallocate for one clip plus overlap, buffer
+  // grows if more frames are added before results are requested.
+  buffer_.reset(new AnalysisBuffer(
+      2 * overlap_size_, options_.estimation_clip_size() + 2 * overlap_size_,
+      {true, true, compute_saliency, compute_saliency}));
 }
 
 void MotionAnalysis::InitPolicyOptions() {
@@ -338,6 +336,51 @@ void MotionAnalysis::InitPolicyOptions() {
   }
 }
 
+void MotionAnalysis::InitAdaptiveResolution() {
+  const auto& adaptive_options = options_.adaptive_resolution_options();
+  if (!adaptive_options.enabled()) {
+    return;
+  }
+
+  const auto& flow_options = options_.flow_options();
+  if (flow_options.tracking_options().tracking_policy() ==
+          TrackingOptions::POLICY_MULTI_FRAME ||
+      flow_options.downsample_mode() ==
+          RegionFlowComputationOptions::DOWNSAMPLE_TO_INPUT_SIZE) {
+    LOG(WARNING) << "Adaptive resolution not supported for multi frame "
+                 << "tracking or pre-downsampled input, disabling.";
+    return;
+  }
+
+  CHECK_GE(adaptive_options.low_resolution_factor(), 1.0f);
+
+  // Low resolution pass downsamples w.r.t. the scale of the full resolution
+  // pass, which is already determined by region_flow_computation_.
+  RegionFlowComputationOptions low_resolution_options = flow_options;
+  low_resolution_options.set_downsample_mode(
+      RegionFlowComputationOptions::DOWNSAMPLE_BY_FACTOR);
+  low_resolution_options.set_downsample_factor(
+      region_flow_computation_->DownsampleScale() *
+      adaptive_options.low_resolution_factor());
+  low_resolution_flow_computation_.reset(new RegionFlowComputation(
+      low_resolution_options, frame_width_, frame_height_));
+
+  // The stability check runs on its own estimator, as estimation keeps
+  // temporal state (e.g. the inlier mask for TEMPORAL_IRLS_MASK) that has to
+  // reflect the frames estimated in GetResults only. Frames without any low
+  // resolution features are flagged as invalid, to escalate them instead of
+  // accepting their identity motion.
+  MotionEstimationOptions probe_options = options_.motion_options();
+  probe_options.set_label_empty_frames_as_valid(false);
+  probe_motion_estimation_.reset(
+      new MotionEstimation(probe_options, frame_width_, frame_height_));
+
+  // Previous frame is needed to resync the full resolution pass.
+  if (prev_frame_ == nullptr) {
+    prev_frame_.reset(new cv::Mat(frame_height_, frame_width_, CV_8UC3));
+  }
+}
+
 bool MotionAnalysis::AddFrame(const cv::Mat& frame, int64 timestamp_usec,
                               RegionFlowFeatureList* feature_list) {
   return AddFrameWithSeed(frame, timestamp_usec, Homography(), feature_list);
@@ -365,23 +408,11 @@ bool MotionAnalysis::AddFrameGeneric(
   CHECK(feature_computation_) << "Calls to AddFrame* can NOT be mixed "
                               << "with AddFeatures";
 
-  // Compute RegionFlow.
-  {
-    MEASURE_TIME << "CALL RegionFlowComputation::AddImage";
-    if (!region_flow_computation_->AddImageWithSeed(frame, timestamp_usec,
-                                                    initial_transform)) {
-      LOG(ERROR) << "Error while computing region flow.";
-      return false;
-    }
-  }
-
-  // Buffer features.
   std::unique_ptr<RegionFlowFeatureList> feature_list;
-  {
-    MEASURE_TIME << "CALL RegionFlowComputation::RetrieveRegionFlowFeatureList";
-    const bool compute_feature_match_descriptors =
-        compute_feature_descriptors_ && frame_num_ > 0;
-
+  if (low_resolution_flow_computation_) {
+    feature_list =
+        ComputeAdaptiveRegionFlow(frame, timestamp_usec, initial_transform);
+  } else {
     // Determine which region flow should be computed in case multi frame
     // tracking has been requested.
     int max_track_index = 0;
@@ -393,17 +424,17 @@ bool MotionAnalysis::AddFrameGeneric(
           options_.track_index());
     }
 
-    feature_list.reset(
-        region_flow_computation_->RetrieveMultiRegionFlowFeatureList(
-            std::min(std::max(0, frame_num_ - 1), max_track_index),
-            compute_feature_descriptors_, compute_feature_match_descriptors,
-            &frame,
-            compute_feature_match_descriptors ? prev_frame_.get() : nullptr));
+    const bool compute_feature_match_descriptors =
+        compute_feature_descriptors_ && frame_num_ > 0;
+    feature_list = ComputeRegionFlow(
+        region_flow_computation_.get(), frame, timestamp_usec,
+        initial_transform,
+        std::min(std::max(0, frame_num_ - 1), max_track_index),
+        compute_feature_match_descriptors ? prev_frame_.get() : nullptr);
+  }
 
-    if (feature_list == nullptr) {
-      LOG(ERROR) << "Error retrieving feature list.";
-      return false;
-    }
+  if (feature_list == nullptr) {
+    return false;
   }
 
   if (external_features) {
@@ -439,11 +470,12 @@ bool MotionAnalysis::AddFrameGeneric(
     (*modify_features)(feature_list.get());
   }
 
-  buffer_->EmplaceDatum("features", feature_list.release());
+  buffer_->EmplaceDatum<kFeatures>(feature_list.release());
 
   // Store frame for next call.
-  if (compute_feature_descriptors_) {
+  if (prev_frame_ != nullptr) {
     frame.copyTo(*prev_frame_);
+    prev_timestamp_usec_ = timestamp_usec;
   }
 
   ++frame_num_;
@@ -451,9 +483,123 @@ bool MotionAnalysis::AddFrameGeneric(
   return true;
 }
 
+std::unique_ptr<RegionFlowFeatureList> MotionAnalysis::ComputeRegionFlow(
+    RegionFlowComputation* computation, const cv::Mat& frame,
+    int64 timestamp_usec, const Homography& initial_transform,
+    int track_index, const cv::Mat* prev_frame) {
+  {
+    MEASURE_TIME << "CALL RegionFlowComputation::AddImage";
+    if (!computation->AddImageWithSeed(frame, timestamp_usec,
+                                       initial_transform)) {
+      LOG(ERROR) << "Error while computing region flow.";
+      return nullptr;
+    }
+  }
+
+  MEASURE_TIME << "CALL RegionFlowComputation::RetrieveRegionFlowFeatureList";
+  std::unique_ptr<RegionFlowFeatureList> feature_list(
+      computation->RetrieveMultiRegionFlowFeatureList(
+          track_index, compute_feature_descriptors_, prev_frame != nullptr,
+          &frame, prev_frame));
+
+  if (feature_list == nullptr) {
+    LOG(ERROR) << "Error retrieving feature list.";
+  }
+  return feature_list;
+}
+
+std::unique_ptr<RegionFlowFeatureList>
+MotionAnalysis::ComputeAdaptiveRegionFlow(
+    const cv::Mat& frame, int64 timestamp_usec,
+    const Homography& initial_transform) {
+  const cv::Mat* prev_frame =
+      compute_feature_descriptors_ && frame_num_ > 0 ? prev_frame_.get()
+                                                     : nullptr;
+
+  // Low resolution pass is run for every frame to keep its tracking state
+  // current.
+  std::unique_ptr<RegionFlowFeatureList> feature_list;
+  {
+    MEASURE_TIME << "Adaptive resolution: low resolution pass";
+    const absl::Time start_time = absl::Now();
+    feature_list = ComputeRegionFlow(low_resolution_flow_computation_.get(),
+                                     frame, timestamp_usec, initial_transform,
+                                     0, prev_frame);
+    adaptive_resolution_stats_.low_resolution_time +=
+        absl::Now() - start_time;
+  }
+  if (feature_list == nullptr) {
+    return nullptr;
+  }
+  ++adaptive_resolution_stats_.num_frames;
+
+  // First frame has no motion to assess.
+  if (frame_num_ == 0) {
+    full_resolution_synced_ = false;
+    return feature_list;
+  }
+
+  // Estimate motion on a copy, as estimation modifies the feature's irls
+  // weights. Buffered features are re-estimated jointly in GetResults.
+  std::vector<CameraMotion> camera_motions;
+  {
+    MEASURE_TIME << "Adaptive resolution: stability check";
+    const absl::Time start_time = absl::Now();
+    RegionFlowFeatureList probe_features(*feature_list);
+    std::vector<RegionFlowFeatureList*> probe_lists(1, &probe_features);
+    probe_motion_estimation_->EstimateMotionsParallel(false, &probe_lists,
+                                                      &camera_motions);
+    adaptive_resolution_stats_.stability_check_time +=
+        absl::Now() - start_time;
+  }
+  CHECK_EQ(1, camera_motions.size());
+
+  if (camera_motions[0].type() <=
+      options_.adaptive_resolution_options().max_accepted_type()) {
+    full_resolution_synced_ = false;
+    return feature_list;
+  }
+
+  // Escalate to full resolution. If the full resolution pass did not process
+  // the previous frame, restart its tracking from the previous frame.
+  MEASURE_TIME << "Adaptive resolution: full resolution pass";
+  const absl::Time start_time = absl::Now();
+  ++adaptive_resolution_stats_.num_full_resolution_frames;
+  if (!full_resolution_synced_) {
+    ++adaptive_resolution_stats_.num_resync_frames;
+    region_flow_computation_->Reset();
+    if (ComputeRegionFlow(region_flow_computation_.get(), *prev_frame_,
+                          prev_timestamp_usec_, Homography(), 0,
+                          nullptr) == nullptr) {
+      return nullptr;
+    }
+  }
+
+  feature_list =
+      ComputeRegionFlow(region_flow_computation_.get(), frame, timestamp_usec,
+                        initial_transform, 0, prev_frame);
+  adaptive_resolution_stats_.full_resolution_time += absl::Now() - start_time;
+  if (feature_list == nullptr) {
+    full_resolution_synced_ = false;
+    return nullptr;
+  }
+  full_resolution_synced_ = true;
+
+  // Track ids of both passes are assigned independently, shift full
+  // resolution ids to avoid collisions.
+  constexpr int kFullResolutionTrackIdShift = 1 << 21;
+  for (auto& feature : *feature_list->mutable_feature()) {
+    if (feature.track_id() >= 0) {
+      feature.set_track_id(feature.track_id() + kFullResolutionTrackIdShift);
+    }
+  }
+
+  return feature_list;
+}
+
 void MotionAnalysis::AddFeatures(const RegionFlowFeatureList& features) {
   feature_computation_ = false;
-  buffer_->EmplaceDatum("features", new RegionFlowFeatureList(features));
+  buffer_->AddDatumCopy<kFeatures>(features);
 
   ++frame_num_;
 }
@@ -461,13 +607,16 @@ void MotionAnalysis::AddFeatures(const RegionFlowFeatureList& features) {
 void MotionAnalysis::EnqueueFeaturesAndMotions(
     const RegionFlowFeatureList& features, const CameraMotion& motion) {
   feature_computation_ = false;
-  CHECK(buffer_->HaveEqualSize({"motion", "features"}))
+  CHECK((buffer_->HaveEqualSize<kMotion, kFeatures>()))
       << "Can not be mixed with other Add* calls";
-  buffer_->EmplaceDatum("features", new RegionFlowFeatureList(features));
-  buffer_->EmplaceDatum("motion", new CameraMotion(motion));
+  buffer_->AddDatumCopy<kFeatures>(features);
+  buffer_->AddDatumCopy<kMotion>(motion);
 }
 
 cv::Mat MotionAnalysis::GetGrayscaleFrameFromResults() {
+  if (low_resolution_flow_computation_ && !full_resolution_synced_) {
+    return low_resolution_flow_computation_->GetGrayscaleFrameFromResults();
+  }
   return region_flow_computation_->GetGrayscaleFrameFromResults();
 }
 
@@ -477,7 +626,7 @@ int MotionAnalysis::GetResults(
     std::vector<std::unique_ptr<SalientPointFrame>>* saliency) {
   MEASURE_TIME << "GetResults";
 
-  const int num_features_lists = buffer_->BufferSize("features");
+  const int num_features_lists = buffer_->BufferSize<kFeatures>();
   const int num_new_feature_lists = num_features_lists - overlap_start_;
   CHECK_GE(num_new_feature_lists, 0);
 
@@ -494,14 +643,13 @@ int MotionAnalysis::GetResults(
   // computes IRLS feature weights for foreground estimation, if needed
   // (otherwise could be externally added).
   const int num_motions_to_compute =
-      buffer_->BufferSize("features") - buffer_->BufferSize("motion");
+      buffer_->BufferSize<kFeatures>() - buffer_->BufferSize<kMotion>();
 
   if (num_motions_to_compute > 0) {
     std::vector<CameraMotion> camera_motions;
     std::vector<RegionFlowFeatureList*> feature_lists;
     for (int k = overlap_start_; k < num_features_lists; ++k) {
-      feature_lists.push_back(
-          buffer_->GetMutableDatum<RegionFlowFeatureList>("features", k));
+      feature_lists.push_back(buffer_->GetMutableDatum<kFeatures>(k));
     }
 
     // TODO: Result should be vector of unique_ptr.
@@ -509,12 +657,14 @@ int MotionAnalysis::GetResults(
         options_.post_irls_smoothing(), &feature_lists, &camera_motions);
 
     // Add solution to buffer.
-    for (const auto& motion : camera_motions) {
-      buffer_->EmplaceDatum("motion", new CameraMotion(motion));
+    for (auto& motion : camera_motions) {
+      std::unique_ptr<CameraMotion> datum = buffer_->NewDatum<kMotion>();
+      *datum = std::move(motion);
+      buffer_->AddDatum<kMotion>(std::move(datum));
     }
   }
 
-  CHECK(buffer_->HaveEqualSize({"features", "motion"}));
+  CHECK((buffer_->HaveEqualSize<kFeatures, kMotion>()));
 
   if (compute_saliency) {
     ComputeSaliency();
@@ -530,10 +680,10 @@ int MotionAnalysis::OutputResults(
   const bool compute_saliency = options_.compute_motion_saliency();
   CHECK_EQ(compute_saliency, saliency != nullptr)
       << "Computing saliency requires saliency output and vice versa";
-  CHECK(buffer_->HaveEqualSize({"features", "motion"}));
+  CHECK((buffer_->HaveEqualSize<kFeatures, kMotion>()));
 
   // Discard prev. overlap (already output, just used for filtering here).
-  buffer_->DiscardData(buffer_->AllTags(), prev_overlap_start_);
+  buffer_->DiscardAll(prev_overlap_start_);
   prev_overlap_start_ = 0;
 
   // Output only frames not part of the overlap.
@@ -563,21 +713,19 @@ int MotionAnalysis::OutputResults(
 
     if (k >= new_overlap_start) {
       // Create copy.
-      out_features.reset(new RegionFlowFeatureList(
-          *buffer_->GetDatum<RegionFlowFeatureList>("features", k)));
-      out_motion.reset(
-          new CameraMotion(*buffer_->GetDatum<CameraMotion>("motion", k)));
+      out_features = buffer_->NewDatum<kFeatures>();
+      *out_features = *buffer_->GetDatum<kFeatures>(k);
+      out_motion = buffer_->NewDatum<kMotion>();
+      *out_motion = *buffer_->GetDatum<kMotion>(k);
     } else {
       // Release datum.
-      out_features =
-          buffer_->ReleaseDatum<RegionFlowFeatureList>("features", k);
-      out_motion = buffer_->ReleaseDatum<CameraMotion>("motion", k);
+      out_features = buffer_->ReleaseDatum<kFeatures>(k);
+      out_motion = buffer_->ReleaseDatum<kMotion>(k);
     }
 
     // output_saliency is temporary so we never need to buffer it.
     if (compute_saliency) {
-      out_saliency =
-          buffer_->ReleaseDatum<SalientPointFrame>("output_saliency", k);
+      out_saliency = buffer_->ReleaseDatum<kOutputSaliency>(k);
     }
 
     if (options_.subtract_camera_motion_from_features()) {
@@ -797,45 +945,45 @@ void MotionAnalysis::VisualizeBlurAnalysisRegions(cv::Mat* input_view) {
 
 void MotionAnalysis::ComputeSaliency() {
   MEASURE_TIME << "Saliency computation.";
-  CHECK_EQ(overlap_start_, buffer_->BufferSize("saliency"));
+  CHECK_EQ(overlap_start_, buffer_->BufferSize<kSaliency>());
 
-  const int num_features_lists = buffer_->BufferSize("features");
+  const int num_features_lists = buffer_->BufferSize<kFeatures>();
 
   // Compute saliency only for newly buffered RegionFlowFeatureLists.
   for (int k = overlap_start_; k < num_features_lists; ++k) {
     std::vector<float> foreground_weights;
     ForegroundWeightsFromFeatures(
-        *buffer_->GetDatum<RegionFlowFeatureList>("features", k),
+        *buffer_->GetDatum<kFeatures>(k),
         options_.foreground_options().foreground_threshold(),
         options_.foreground_options().foreground_gamma(),
         options_.foreground_options().threshold_coverage_scaling()
-            ? buffer_->GetDatum<CameraMotion>("motion", k)
+            ? buffer_->GetDatum<kMotion>(k)
             : nullptr,
         &foreground_weights);
 
-    std::unique_ptr<SalientPointFrame> saliency(new SalientPointFrame());
+    std::unique_ptr<SalientPointFrame> saliency =
+        buffer_->NewDatum<kSaliency>();
+    saliency->Clear();
     motion_saliency_->SaliencyFromFeatures(
-        *buffer_->GetDatum<RegionFlowFeatureList>("features", k),
+        *buffer_->GetDatum<kFeatures>(k),
         &foreground_weights, saliency.get());
 
-    buffer_->AddDatum("saliency", std::move(saliency));
+    buffer_->AddDatum<kSaliency>(std::move(saliency));
   }
 
-  CHECK(buffer_->HaveEqualSize({"features", "motion", "saliency"}));
+  CHECK((buffer_->HaveEqualSize<kFeatures, kMotion, kSaliency>()));
 
   // Clear output saliency and copy from saliency.
-  buffer_->DiscardDatum("output_saliency",
-                        buffer_->BufferSize("output_saliency"));
+  buffer_->DiscardDatum<kOutputSaliency>(
+      buffer_->BufferSize<kOutputSaliency>());
 
-  for (int k = 0; k < buffer_->BufferSize("saliency"); ++k) {
-    std::unique_ptr<SalientPointFrame> copy(new SalientPointFrame());
-    *copy = *buffer_->GetDatum<SalientPointFrame>("saliency", k);
-    buffer_->AddDatum("output_saliency", std::move(copy));
+  for (int k = 0; k < buffer_->BufferSize<kSaliency>(); ++k) {
+    buffer_->AddDatumCopy<kOutputSaliency>(*buffer_->GetDatum<kSaliency>(k));
   }
 
   // Create view.
-  std::vector<SalientPointFrame*> saliency_view =
-      buffer_->GetMutableDatumVector<SalientPointFrame>("output_saliency");
+  std::vector<SalientPointFrame*> saliency_view;
+  buffer_->GetMutableDatumVector<kOutputSaliency>(&saliency_view);
 
   // saliency_frames are filtered after this point and ready for output.
   if (options_.select_saliency_inliers()) {
@@ -58,6 +58,7 @@
 #include <string>
 #include <vector>
 
+#include "absl/time/time.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/util/tracking/camera_motion.pb.h"
 #include "mediapipe/util/tracking/motion_analysis.pb.h"
@@ -68,7 +69,7 @@
 #include "mediapipe/util/tracking/region_flow.h"
 #include "mediapipe/util/tracking/region_flow.pb.h"
 #include "mediapipe/util/tracking/region_flow_computation.h"
-#include "mediapipe/util/tracking/streaming_buffer.h"
+#include "mediapipe/util/tracking/typed_streaming_buffer.h"
 
 namespace mediapipe {
 
@@ -176,9 +177,46 @@ class MotionAnalysis {
   // Number of frames/features added so far.
   int NumFrames() const { return frame_num_; }
 
+  // Statistics for adaptive resolution mode (see AdaptiveResolutionOptions).
+  struct AdaptiveResolutionStats {
+    // Frames for which region flow was computed in adaptive mode.
+    int num_frames = 0;
+    // Frames recomputed at full resolution.
+    int num_full_resolution_frames = 0;
+    // Full resolution frames that additionally required recomputing the
+    // previous frame, as the full resolution pass was not run for it.
+    int num_resync_frames = 0;
+    // Wall time spent in each pass. Full resolution time includes resyncs.
+    absl::Duration low_resolution_time;
+    absl::Duration stability_check_time;
+    absl::Duration full_resolution_time;
+  };
+
+  const AdaptiveResolutionStats& GetAdaptiveResolutionStats() const {
+    return adaptive_resolution_stats_;
+  }
+
  private:
   void InitPolicyOptions();
 
+  // Sets up low resolution region flow computation if adaptive resolution
+  // mode is requested and supported.
+  void InitAdaptiveResolution();
+
+  // Computes region flow for frame via passed computation. Feature match
+  // descriptors are computed only if prev_frame is passed.
+  // Returns nullptr on error.
+  std::unique_ptr<RegionFlowFeatureList> ComputeRegionFlow(
+      RegionFlowComputation* computation, const cv::Mat& frame,
+      int64 timestamp_usec, const Homography& initial_transform,
+      int track_index, const cv::Mat* prev_frame);
+
+  // Computes region flow at low resolution and escalates to full resolution
+  // if the resulting camera motion is not stable. Returns nullptr on error.
+  std::unique_ptr<RegionFlowFeatureList> ComputeAdaptiveRegionFlow(
+      const cv::Mat& frame, int64 timestamp_usec,
+      const Homography& initial_transform);
+
   // Compute saliency from buffered features and motions.
   void ComputeSaliency();
 
@@ -203,7 +241,18 @@ class MotionAnalysis {
   // Used for visualization if long feature tracks are present.
   std::unique_ptr<LongFeatureStream> long_feature_stream_;
 
-  std::unique_ptr<StreamingBuffer> buffer_;
+  // Buffers features and motion. If saliency is computed, also buffers
+  // saliency and filtered/smoothed output_saliency.
+  enum BufferIndex {
+    kFeatures = 0,
+    kMotion = 1,
+    kSaliency = 2,
+    kOutputSaliency = 3,
+  };
+  typedef TypedStreamingBuffer<RegionFlowFeatureList, CameraMotion,
+                               SalientPointFrame, SalientPointFrame>
+      AnalysisBuffer;
+  std::unique_ptr<AnalysisBuffer> buffer_;
 
   // Indicates where previous overlap in above buffers starts (earlier data is
   // just to improve smoothing).
@@ -214,6 +263,17 @@ class MotionAnalysis {
 
   // Buffers previous frame.
   std::unique_ptr<cv::Mat> prev_frame_;
+  int64 prev_timestamp_usec_ = 0;
+
+  // Set if adaptive resolution mode is active, in which case
+  // region_flow_computation_ is only used for frames that are escalated to
+  // full resolution.
+  std::unique_ptr<RegionFlowComputation> low_resolution_flow_computation_;
+  // Estimates the low resolution camera motion that decides escalation.
+  std::unique_ptr<MotionEstimation> probe_motion_estimation_;
+  // Indicates that region_flow_computation_ processed the previous frame.
+  bool full_resolution_synced_ = false;
+  AdaptiveResolutionStats adaptive_resolution_stats_;
 
   bool compute_feature_descriptors_ = false;
 
@@ -0,0 +1,216 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/motion_analysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/util/tracking/camera_motion.pb.h"
+#include "mediapipe/util/tracking/motion_analysis.pb.h"
+#include "mediapipe/util/tracking/motion_estimation.pb.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kFrameWidth = 320;
+constexpr int kFrameHeight = 240;
+constexpr int kNumFrames = 12;
+
+// Returns a smooth texture of random gray cells, which is trackable at any
+// of the resolutions used below.
+cv::Mat MakeCoarseTexture(int width, int height) {
+  constexpr int kCellSize = 16;
+  std::mt19937 random(900913);
+  std::uniform_int_distribution<int> gray(0, 255);
+  cv::Mat texture(height, width, CV_8UC3);
+  for (int y = 0; y < height; y += kCellSize) {
+    for (int x = 0; x < width; x += kCellSize) {
+      const int value = gray(random);
+      texture(cv::Rect(x, y, std::min(kCellSize, width - x),
+                       std::min(kCellSize, height - y)))
+          .setTo(cv::Scalar(value, value, value));
+    }
+  }
+  cv::GaussianBlur(texture, texture, cv::Size(0, 0), 3.0);
+  return texture;
+}
+
+// Returns a texture of black and white cells of cell_size pixels. Each
+// block of 2x2 cells has two black and two white cells, so the texture is a
+// uniform gray after area downsampling by a multiple of 2 * cell_size, as
+// long as the blocks stay aligned.
+cv::Mat MakeBalancedTexture(int width, int height, int cell_size) {
+  std::mt19937 random(900913);
+  std::vector<int> block = {0, 0, 255, 255};
+  cv::Mat texture(height, width, CV_8UC3);
+  const int block_size = 2 * cell_size;
+  for (int y = 0; y < height; y += block_size) {
+    for (int x = 0; x < width; x += block_size) {
+      std::shuffle(block.begin(), block.end(), random);
+      for (int c = 0; c < 4; ++c) {
+        texture(cv::Rect(x + (c % 2) * cell_size, y + (c / 2) * cell_size,
+                         cell_size, cell_size))
+            .setTo(cv::Scalar(block[c], block[c], block[c]));
+      }
+    }
+  }
+  return texture;
+}
+
+// Crops kNumFrames frames from texture, moving right by shift pixels per
+// frame.
+std::vector<cv::Mat> MakeClip(const cv::Mat& texture, int shift) {
+  std::vector<cv::Mat> clip;
+  for (int f = 0; f < kNumFrames; ++f) {
+    clip.push_back(
+        texture(cv::Rect(f * shift, 0, kFrameWidth, kFrameHeight)).clone());
+  }
+  return clip;
+}
+
+MotionAnalysisOptions AdaptiveOptions(bool enabled, float factor) {
+  MotionAnalysisOptions options;
+  auto* adaptive_options = options.mutable_adaptive_resolution_options();
+  adaptive_options->set_enabled(enabled);
+  adaptive_options->set_low_resolution_factor(factor);
+  return options;
+}
+
+std::vector<CameraMotion> Analyze(
+    const MotionAnalysisOptions& options, const std::vector<cv::Mat>& clip,
+    MotionAnalysis::AdaptiveResolutionStats* stats) {
+  MotionAnalysis analysis(options, kFrameWidth, kFrameHeight);
+  std::vector<CameraMotion> camera_motions;
+  for (int f = 0; f < clip.size(); ++f) {
+    EXPECT_TRUE(analysis.AddFrame(clip[f], f * 33333, nullptr));
+    std::vector<std::unique_ptr<CameraMotion>> results;
+    analysis.GetResults(f + 1 == clip.size(), nullptr, &results);
+    for (const auto& motion : results) {
+      camera_motions.push_back(*motion);
+    }
+  }
+  *stats = analysis.GetAdaptiveResolutionStats();
+  return camera_motions;
+}
+
+// Frames whose low resolution motion is stable are not recomputed, and
+// yield the same motion as the full resolution pass.
+TEST(MotionAnalysisTest, AdaptiveResolutionMatchesFullResolutionOnEasyClip) {
+  constexpr int kShift = 2;
+  const std::vector<cv::Mat> clip = MakeClip(
+      MakeCoarseTexture(kFrameWidth + kNumFrames * kShift, kFrameHeight),
+      kShift);
+
+  MotionAnalysis::AdaptiveResolutionStats stats;
+  const std::vector<CameraMotion> full_motions =
+      Analyze(AdaptiveOptions(false, 2.0f), clip, &stats);
+  EXPECT_EQ(0, stats.num_frames);
+  const std::vector<CameraMotion> adaptive_motions =
+      Analyze(AdaptiveOptions(true, 2.0f), clip, &stats);
+  EXPECT_EQ(kNumFrames, stats.num_frames);
+  EXPECT_EQ(0, stats.num_full_resolution_frames);
+  EXPECT_GT(stats.low_resolution_time, absl::ZeroDuration());
+  EXPECT_GT(stats.stability_check_time, absl::ZeroDuration());
+  EXPECT_EQ(absl::ZeroDuration(), stats.full_resolution_time);
+
+  ASSERT_EQ(kNumFrames, full_motions.size());
+  ASSERT_EQ(kNumFrames, adaptive_motions.size());
+  for (int f = 1; f < kNumFrames; ++f) {
+    EXPECT_EQ(full_motions[f].type(), adaptive_motions[f].type()) << f;
+    EXPECT_NEAR(full_motions[f].translation().dx(),
+                adaptive_motions[f].translation().dx(), 0.25f)
+        << f;
+    EXPECT_NEAR(full_motions[f].translation().dy(),
+                adaptive_motions[f].translation().dy(), 0.25f)
+        << f;
+  }
+}
+
+// With a low resolution factor of 1 both passes see the same features, so
+// temporally dependent estimation must not notice the stability checks.
+TEST(MotionAnalysisTest, AdaptiveResolutionKeepsTemporalEstimationState) {
+  constexpr int kShift = 2;
+  const std::vector<cv::Mat> clip = MakeClip(
+      MakeCoarseTexture(kFrameWidth + kNumFrames * kShift, kFrameHeight),
+      kShift);
+
+  MotionAnalysisOptions full_options = AdaptiveOptions(false, 1.0f);
+  full_options.mutable_motion_options()->set_estimation_policy(
+      MotionEstimationOptions::TEMPORAL_IRLS_MASK);
+  MotionAnalysisOptions adaptive_options = full_options;
+  adaptive_options.mutable_adaptive_resolution_options()->set_enabled(true);
+
+  MotionAnalysis::AdaptiveResolutionStats stats;
+  const std::vector<CameraMotion> full_motions =
+      Analyze(full_options, clip, &stats);
+  const std::vector<CameraMotion> adaptive_motions =
+      Analyze(adaptive_options, clip, &stats);
+  EXPECT_EQ(0, stats.num_full_resolution_frames);
+
+  ASSERT_EQ(kNumFrames, full_motions.size());
+  ASSERT_EQ(kNumFrames, adaptive_motions.size());
+  for (int f = 0; f < kNumFrames; ++f) {
+    EXPECT_EQ(full_motions[f].type(), adaptive_motions[f].type()) << f;
+    EXPECT_FLOAT_EQ(full_motions[f].translation().dx(),
+                    adaptive_motions[f].translation().dx())
+        << f;
+    EXPECT_FLOAT_EQ(full_motions[f].translation().dy(),
+                    adaptive_motions[f].translation().dy())
+        << f;
+  }
+}
+
+// The clip has no texture left at low resolution, so every frame after the
+// first is escalated to full resolution, which has to resync only once.
+TEST(MotionAnalysisTest, AdaptiveResolutionEscalatesUntrackableFrames) {
+  constexpr int kCellSize = 4;
+  constexpr float kFactor = 2 * kCellSize;
+  constexpr int kShift = 2 * kCellSize;
+  const std::vector<cv::Mat> clip =
+      MakeClip(MakeBalancedTexture(kFrameWidth + kNumFrames * kShift,
+                                   kFrameHeight, kCellSize),
+               kShift);
+
+  MotionAnalysis::AdaptiveResolutionStats stats;
+  const std::vector<CameraMotion> full_motions =
+      Analyze(AdaptiveOptions(false, kFactor), clip, &stats);
+  const std::vector<CameraMotion> adaptive_motions =
+      Analyze(AdaptiveOptions(true, kFactor), clip, &stats);
+  EXPECT_EQ(kNumFrames, stats.num_frames);
+  EXPECT_EQ(kNumFrames - 1, stats.num_full_resolution_frames);
+  EXPECT_EQ(1, stats.num_resync_frames);
+  EXPECT_GT(stats.full_resolution_time, absl::ZeroDuration());
+
+  ASSERT_EQ(kNumFrames, full_motions.size());
+  ASSERT_EQ(kNumFrames, adaptive_motions.size());
+  for (int f = 1; f < kNumFrames; ++f) {
+    EXPECT_NEAR(kShift, std::abs(full_motions[f].translation().dx()), 1.0f)
+        << f;
+    EXPECT_EQ(full_motions[f].type(), adaptive_motions[f].type()) << f;
+    EXPECT_NEAR(full_motions[f].translation().dx(),
+                adaptive_motions[f].translation().dx(), 0.25f)
+        << f;
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
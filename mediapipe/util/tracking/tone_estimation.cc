@@ -26,6 +26,20 @@
 
 namespace mediapipe {
 
+namespace {
+
+// Moments of the tone matches (x = curr_val, y = prev_val) of a patch.
+struct PatchMoments {
+  int num = 0;
+  double sum_x = 0;
+  double sum_y = 0;
+  double sum_xx = 0;
+  double sum_xy = 0;
+  double sum_yy = 0;
+};
+
+}  // namespace
+
 ToneEstimation::ToneEstimation(const ToneEstimationOptions& options,
                                int frame_width, int frame_height)
     : options_(options),
@@ -112,9 +126,11 @@ void ToneEstimation::EstimateToneChange(
   ClipMask<3> curr_clip;
   ComputeClipMask<3>(options_.clip_mask_options(), curr_frame, &curr_clip);
 
-  // Compute tone statistics.
-  tone_change->set_frac_clipped(cv::sum(curr_clip.mask)[0] /
-                                (frame_height_ * frame_width_));
+  // Compute tone statistics. Bottom right element of the integral image
+  // equals the number of clipped pixels.
+  tone_change->set_frac_clipped(
+      curr_clip.mask_integral.at<int>(frame_height_, frame_width_) /
+      static_cast<float>(frame_height_ * frame_width_));
 
   IntensityPercentiles(curr_frame, curr_clip.mask,
                        options_.tone_match_options().log_domain(), tone_change);
@@ -148,21 +164,32 @@ void ToneEstimation::IntensityPercentiles(const cv::Mat& frame,
                                           const cv::Mat& clip_mask,
                                           bool log_domain,
                                           ToneChange* tone_change) const {
-  cv::Mat intensity(frame.rows, frame.cols, CV_8UC1);
-  cv::cvtColor(frame, intensity, cv::COLOR_RGB2GRAY);
+  // Optionally restrict statistics to a subsampled grid.
+  const int sample_step = std::max(1, options_.stats_sample_step());
+  cv::Mat sampled_frame = frame;
+  cv::Mat sampled_mask = clip_mask;
+  if (sample_step > 1) {
+    const cv::Size sampled_size((frame.cols + sample_step - 1) / sample_step,
+                                (frame.rows + sample_step - 1) / sample_step);
+    cv::resize(frame, sampled_frame, sampled_size, 0, 0, cv::INTER_NEAREST);
+    cv::resize(clip_mask, sampled_mask, sampled_size, 0, 0, cv::INTER_NEAREST);
+  }
 
-  std::vector<float> histogram(256, 0.0f);
+  cv::Mat intensity(sampled_frame.rows, sampled_frame.cols, CV_8UC1);
+  cv::cvtColor(sampled_frame, intensity, cv::COLOR_RGB2GRAY);
 
-  for (int i = 0; i < intensity.rows; ++i) {
-    const uint8* intensity_ptr = intensity.ptr<uint8>(i);
-    const uint8* clip_ptr = clip_mask.ptr<uint8>(i);
+  // Histogram over unclipped pixels.
+  const cv::Mat unclipped = sampled_mask == 0;
+  cv::Mat intensity_histogram;
+  const int channels[] = {0};
+  const int hist_size[] = {256};
+  const float hist_range[] = {0, 256};
+  const float* hist_ranges[] = {hist_range};
+  cv::calcHist(&intensity, 1, channels, unclipped, intensity_histogram, 1,
+               hist_size, hist_ranges);
 
-    for (int j = 0; j < intensity.cols; ++j) {
-      if (!clip_ptr[j]) {
-        ++histogram[intensity_ptr[j]];
-      }
-    }
-  }
+  const float* histogram_ptr = intensity_histogram.ptr<float>(0);
+  std::vector<float> histogram(histogram_ptr, histogram_ptr + 256);
 
   // Construct cumulative histogram.
   std::partial_sum(histogram.begin(), histogram.end(), histogram.begin());
@@ -225,11 +252,31 @@ void ToneEstimation::EstimateGainBiasModel(int irls_iterations,
   // TODO: One IRLS weight per color match.
   for (int c = 0; c < num_channels; ++c) {
     std::deque<PatchToneMatch>& patch_tone_matches = (*color_tone_matches)[c];
-    // Reset irls weight.
+
+    // All matches of a patch share the same irls weight, therefore the
+    // weighted least squares problem only depends on the per patch moments
+    // of the matches, that are accumulated once in contiguous memory.
+    // Per patch error is evaluated from the moments as well, so that each
+    // iteration is linear in the number of patches, not matches.
+    std::vector<PatchMoments> moments;
+    moments.reserve(patch_tone_matches.size());
     int num_matches = 0;
     for (auto& patch_tone_match : patch_tone_matches) {
+      // Reset irls weight.
       patch_tone_match.set_irls_weight(1.0);
-      num_matches += patch_tone_match.tone_match_size();
+      PatchMoments patch_moments;
+      for (const auto& tone_match : patch_tone_match.tone_match()) {
+        const double x = tone_match.curr_val();
+        const double y = tone_match.prev_val();
+        patch_moments.sum_x += x;
+        patch_moments.sum_y += y;
+        patch_moments.sum_xx += x * x;
+        patch_moments.sum_xy += x * y;
+        patch_moments.sum_yy += y * y;
+      }
+      patch_moments.num = patch_tone_match.tone_match_size();
+      num_matches += patch_moments.num;
+      moments.push_back(patch_moments);
     }
 
     // Do not attempt solution if not matches have been found.
@@ -237,63 +284,59 @@ void ToneEstimation::EstimateGainBiasModel(int irls_iterations,
       continue;
     }
 
-    cv::Mat model_mat(num_matches, 2, CV_32F);
-    cv::Mat rhs(num_matches, 1, CV_32F);
-    cv::Mat solution(2, 1, CV_32F);
-
+    std::vector<double> weights(moments.size(), 1.0);
     for (int iteration = 0; iteration < irls_iterations; ++iteration) {
-      // Setup matrix.
-      int row = 0;
-      for (const auto& patch_tone_match : patch_tone_matches) {
-        const float irls_weight = patch_tone_match.irls_weight();
-        for (const auto& tone_match : patch_tone_match.tone_match()) {
-          float* row_ptr = model_mat.ptr<float>(row);
-          float* rhs_ptr = rhs.ptr<float>(row);
-          row_ptr[0] = tone_match.curr_val() * irls_weight;
-          row_ptr[1] = irls_weight;
-          rhs_ptr[0] = tone_match.prev_val() * irls_weight;
-          ++row;
-        }
+      // Setup normal equations of rows irls_weight * [curr_val 1] with
+      // rhs irls_weight * prev_val.
+      double sum_w = 0, sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+      for (int k = 0; k < moments.size(); ++k) {
+        const double w_sq = weights[k] * weights[k];
+        sum_w += w_sq * moments[k].num;
+        sum_x += w_sq * moments[k].sum_x;
+        sum_y += w_sq * moments[k].sum_y;
+        sum_xx += w_sq * moments[k].sum_xx;
+        sum_xy += w_sq * moments[k].sum_xy;
       }
 
-      // Solve.
-      if (!cv::solve(model_mat, rhs, solution, cv::DECOMP_QR)) {
+      // Solve. Degenerate if weighted variance of curr_val vanishes.
+      const double det = sum_w * sum_xx - sum_x * sum_x;
+      if (sum_w <= 0 || det <= 1e-10 * sum_w * sum_w) {
         // Fallback to identity.
         solution_ptr[2 * c] = 1;
         solution_ptr[2 * c + 1] = 0;
         break;  // Break to next color channel.
       }
 
-      float a = solution.at<float>(0, 0);
-      float b = solution.at<float>(1, 0);
+      const double a = (sum_w * sum_xy - sum_x * sum_y) / det;
+      const double b = (sum_y - a * sum_x) / sum_w;
 
       // Copy to solution.
       solution_ptr[2 * c] = a;
       solution_ptr[2 * c + 1] = b;
 
-      // Evaluate error.
-      for (auto& patch_tone_match : patch_tone_matches) {
-        const int num_tone_matches = patch_tone_match.tone_match_size();
-
-        if (num_tone_matches == 0) {
+      // Evaluate error, sum_i (a * x_i + b - y_i)^2 expanded in terms of
+      // moments.
+      for (int k = 0; k < moments.size(); ++k) {
+        const PatchMoments& m = moments[k];
+        if (m.num == 0) {
           continue;
         }
 
-        float summed_error = 0.0f;
-        for (const auto& tone_match : patch_tone_match.tone_match()) {
-          // Express tone registration error in 0 .. 100.
-          const float error =
-              100.0f * (tone_match.curr_val() * a + b - tone_match.prev_val());
-          summed_error += error * error;
-        }
+        const double summed_sq_error =
+            a * a * m.sum_xx + b * b * m.num + m.sum_yy +
+            2.0 * (a * b * m.sum_x - a * m.sum_xy - b * m.sum_y);
 
-        // Compute RMSE.
-        const float patch_error =
-            std::sqrt(static_cast<double>(summed_error / num_tone_matches));
+        // Express tone registration error in 0 .. 100 and compute RMSE.
+        const double patch_error =
+            100.0 * std::sqrt(std::max(0.0, summed_sq_error / m.num));
         // TODO: L1 instead of L0?
-        patch_tone_match.set_irls_weight(1.0f / (patch_error + 1e-6f));
+        weights[k] = 1.0 / (patch_error + 1e-6);
       }
     }
+
+    for (int k = 0; k < moments.size(); ++k) {
+      patch_tone_matches[k].set_irls_weight(weights[k]);
+    }
   }
 
   gain_bias_model->CopyFrom(
@@ -54,6 +54,9 @@ struct ClipMask {
   }
 
   cv::Mat mask;
+  // Integral image of mask (CV_32S, one row and column larger than mask), for
+  // constant time summation of clipped pixels over patches. Optional.
+  cv::Mat mask_integral;
   std::vector<float> min_exposure_threshold;
   std::vector<float> max_exposure_threshold;
 };
@@ -83,7 +86,8 @@ class ToneEstimation {
 
   // Returns mask of clipped pixels for input frame
   // (pixels that are clipped due to limited dynamic range are set to 1),
-  // as well as per channel value denoting the min and max exposure threshold.
+  // as well as per channel value denoting the min and max exposure threshold
+  // and the mask's integral image.
   template <int C>
   static void ComputeClipMask(const ClipMaskOptions& options,
                               const cv::Mat& frame, ClipMask<C>* clip_mask);
@@ -126,6 +130,11 @@ class ToneEstimation {
       ToneChange::StabilityStats* stats = nullptr);
 
  private:
+  // Returns number of clipped pixels within [start, end) of clip_mask.
+  template <int C>
+  static int ClippedPixelsInPatch(const ClipMask<C>& clip_mask,
+                                  const Vector2_i& start, const Vector2_i& end);
+
   // Computes normalized intensity percentiles.
   void IntensityPercentiles(const cv::Mat& frame, const cv::Mat& clip_mask,
                             bool log_domain, ToneChange* tone_change) const;
@@ -164,39 +173,30 @@ void ToneEstimation::ComputeClipMask(const ClipMaskOptions& options,
   std::vector<cv::Mat> planes;
   cv::split(frame, planes);
   CHECK_EQ(C, planes.size());
-  float min_exposure[C];
-  float max_exposure[C];
+
   for (int c = 0; c < C; ++c) {
-    min_exposure[c] = min_exposure_thresh;
-    max_exposure[c] = max_exposure_thresh;
+    clip_mask->min_exposure_threshold[c] = min_exposure_thresh;
+    clip_mask->max_exposure_threshold[c] = max_exposure_thresh;
   }
 
+  // A channel value v is clipped iff v < min_exposure_thresh or
+  // v > max_exposure_thresh, i.e. for 8 bit values iff v is outside
+  // [ceil(min_exposure_thresh), floor(max_exposure_thresh)].
+  // Count unclipped channels per pixel via vectorized OpenCV primitives.
+  const cv::Scalar lower_bound(std::ceil(min_exposure_thresh));
+  const cv::Scalar upper_bound(std::floor(max_exposure_thresh));
+  cv::Mat unclipped_channels(frame.rows, frame.cols, CV_8U, cv::Scalar(0));
+  cv::Mat in_range;
   for (int c = 0; c < C; ++c) {
-    clip_mask->min_exposure_threshold[c] = min_exposure[c];
-    clip_mask->max_exposure_threshold[c] = max_exposure[c];
+    cv::inRange(planes[c], lower_bound, upper_bound, in_range);
+    cv::add(unclipped_channels, cv::Scalar(1), unclipped_channels, in_range);
   }
 
-  for (int i = 0; i < frame.rows; ++i) {
-    const uint8* img_ptr = frame.ptr<uint8>(i);
-    uint8* clip_ptr = clip_mask->mask.template ptr<uint8>(i);
-
-    for (int j = 0; j < frame.cols; ++j) {
-      const int idx = C * j;
-      int clipped_channels = 0;  // Count clipped channels.
-
-      for (int p = 0; p < C; ++p) {
-        clipped_channels +=
-            static_cast<int>(img_ptr[idx + p] < min_exposure[p] ||
-                             img_ptr[idx + p] > max_exposure[p]);
-      }
-
-      if (clipped_channels > max_clipped_channels) {
-        clip_ptr[j] = 1;
-      } else {
-        clip_ptr[j] = 0;
-      }
-    }
-  }
+  // Pixel is clipped if more than max_clipped_channels are clipped, compare
+  // outputs 255 for clipped pixels which is mapped to 1.
+  cv::compare(unclipped_channels, cv::Scalar(C - max_clipped_channels),
+              clip_mask->mask, cv::CMP_LT);
+  cv::bitwise_and(clip_mask->mask, cv::Scalar(1), clip_mask->mask);
 
   // Dilate to address blooming.
   const int dilate_diam = options.clip_mask_diameter();
@@ -214,6 +214,24 @@ void ToneEstimation::ComputeClipMask(const ClipMaskOptions& options,
     kernel.setTo(1.0);
     cv::dilate(dilate_domain, dilate_domain, kernel);
   }
+
+  cv::integral(clip_mask->mask, clip_mask->mask_integral, CV_32S);
+}
+
+template <int C>
+int ToneEstimation::ClippedPixelsInPatch(const ClipMask<C>& clip_mask,
+                                         const Vector2_i& start,
+                                         const Vector2_i& end) {
+  if (clip_mask.mask_integral.empty()) {
+    return cv::sum(cv::Mat(clip_mask.mask, cv::Range(start.y(), end.y()),
+                           cv::Range(start.x(), end.x())))[0];
+  }
+
+  const cv::Mat& integral = clip_mask.mask_integral;
+  return integral.at<int>(end.y(), end.x()) -
+         integral.at<int>(start.y(), end.x()) -
+         integral.at<int>(end.y(), start.x()) +
+         integral.at<int>(start.y(), start.x());
 }
 
 template <int C>
@@ -233,6 +251,9 @@ void ToneEstimation::ComputeToneMatches(
   const int patch_diam = 2 * options.patch_radius() + 1;
   const int patch_area = patch_diam * patch_diam;
   const float patch_denom = 1.0f / (patch_area);
+  const int sample_step = std::max(1, options.patch_sample_step());
+  const int samples_per_dim = (patch_diam + sample_step - 1) / sample_step;
+  const int sample_area = samples_per_dim * samples_per_dim;
   const float log_denom = 1.0f / LogDomainLUT().MaxLogDomainValue();
 
   int num_matches = 0;
@@ -290,19 +311,12 @@ void ToneEstimation::ComputeToneMatches(
       continue;  // Ignore border patches.
     }
 
-    // TODO: Instead of summing masks, perform box filter over mask
-    // and just grab element at feature location.
-    cv::Mat curr_patch_mask(curr_clip_mask.mask,
-                            cv::Range(curr_start.y(), curr_end.y()),
-                            cv::Range(curr_start.x(), curr_end.x()));
-    cv::Mat prev_patch_mask(prev_clip_mask.mask,
-                            cv::Range(prev_start.y(), prev_end.y()),
-                            cv::Range(prev_start.x(), prev_end.x()));
-
     // Skip patch if too many clipped pixels.
-    if (cv::sum(curr_patch_mask)[0] * patch_denom >
+    if (ClippedPixelsInPatch(curr_clip_mask, curr_start, curr_end) *
+                patch_denom >
             options.max_frac_clipped() ||
-        cv::sum(prev_patch_mask)[0] * patch_denom >
+        ClippedPixelsInPatch(prev_clip_mask, prev_start, prev_end) *
+                patch_denom >
             options.max_frac_clipped()) {
       continue;
     }
@@ -326,10 +340,11 @@ void ToneEstimation::ComputeToneMatches(
     // (If the average intensity increases by N, histogram shifts by N
     // bins to the right). However, matches that are over or underexposed
     // are discarded afterwards.
-    for (int i = 0; i < patch_diam; ++i) {
+    // Patches are optionally sampled on a grid with spacing sample_step.
+    for (int i = 0; i < patch_diam; i += sample_step) {
       const uint8* prev_ptr = prev_patch.ptr<uint8>(i);
       const uint8* curr_ptr = curr_patch.ptr<uint8>(i);
-      for (int j = 0; j < patch_diam; ++j) {
+      for (int j = 0; j < patch_diam; j += sample_step) {
         const int j_c = C * j;
         for (int c = 0; c < C; ++c) {
           ++curr_intensities[c][curr_ptr[j_c + c]];
@@ -356,11 +371,11 @@ void ToneEstimation::ComputeToneMatches(
            ++k, percentile += percentile_step) {
         const auto& curr_iter = std::lower_bound(curr_intensities[c].begin(),
                                                  curr_intensities[c].end(),
-                                                 percentile * patch_area);
+                                                 percentile * sample_area);
 
         const auto& prev_iter = std::lower_bound(prev_intensities[c].begin(),
                                                  prev_intensities[c].end(),
-                                                 percentile * patch_area);
+                                                 percentile * sample_area);
 
         const int curr_int = curr_iter - curr_intensities[c].begin();
         const int prev_int = prev_iter - prev_intensities[c].begin();
@@ -0,0 +1,260 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/tone_estimation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/util/tracking/tone_estimation.pb.h"
+#include "mediapipe/util/tracking/tone_models.pb.h"
+
+namespace mediapipe {
+namespace {
+
+// Per pixel clip mask computation that ToneEstimation::ComputeClipMask
+// replaced, serves as reference.
+template <int C>
+cv::Mat ReferenceClipMask(const ClipMaskOptions& options,
+                          const cv::Mat& frame) {
+  cv::Mat mask(frame.rows, frame.cols, CV_8U);
+  const float min_exposure = options.min_exposure() * 255.0f;
+  const float max_exposure = options.max_exposure() * 255.0f;
+  for (int i = 0; i < frame.rows; ++i) {
+    const uint8* img_ptr = frame.ptr<uint8>(i);
+    uint8* clip_ptr = mask.ptr<uint8>(i);
+    for (int j = 0; j < frame.cols; ++j) {
+      int clipped_channels = 0;
+      for (int p = 0; p < C; ++p) {
+        const uint8 value = img_ptr[C * j + p];
+        clipped_channels +=
+            static_cast<int>(value < min_exposure || value > max_exposure);
+      }
+      clip_ptr[j] = clipped_channels > options.max_clipped_channels() ? 1 : 0;
+    }
+  }
+
+  const int dilate_rad = ceil(options.clip_mask_diameter() * 0.5);
+  if (mask.rows > 2 * dilate_rad && mask.cols > 2 * dilate_rad) {
+    cv::Mat dilate_domain(mask, cv::Range(dilate_rad, mask.rows - dilate_rad),
+                          cv::Range(dilate_rad, mask.cols - dilate_rad));
+    cv::Mat kernel(options.clip_mask_diameter(), options.clip_mask_diameter(),
+                   CV_8U);
+    kernel.setTo(1.0);
+    cv::dilate(dilate_domain, dilate_domain, kernel);
+  }
+  return mask;
+}
+
+// Least squares fit over all tone matches that
+// ToneEstimation::EstimateGainBiasModel replaced, serves as reference.
+void ReferenceGainBiasModel(int irls_iterations,
+                            ColorToneMatches* color_tone_matches,
+                            GainBiasModel* gain_bias_model) {
+  float solution_ptr[6] = {1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f};
+  for (int c = 0; c < color_tone_matches->size(); ++c) {
+    PatchToneMatches& patch_tone_matches = (*color_tone_matches)[c];
+    int num_matches = 0;
+    for (auto& patch_tone_match : patch_tone_matches) {
+      patch_tone_match.set_irls_weight(1.0);
+      num_matches += patch_tone_match.tone_match_size();
+    }
+    if (num_matches == 0) {
+      continue;
+    }
+
+    cv::Mat model_mat(num_matches, 2, CV_32F);
+    cv::Mat rhs(num_matches, 1, CV_32F);
+    cv::Mat solution(2, 1, CV_32F);
+    for (int iteration = 0; iteration < irls_iterations; ++iteration) {
+      int row = 0;
+      for (const auto& patch_tone_match : patch_tone_matches) {
+        const float irls_weight = patch_tone_match.irls_weight();
+        for (const auto& tone_match : patch_tone_match.tone_match()) {
+          model_mat.at<float>(row, 0) = tone_match.curr_val() * irls_weight;
+          model_mat.at<float>(row, 1) = irls_weight;
+          rhs.at<float>(row, 0) = tone_match.prev_val() * irls_weight;
+          ++row;
+        }
+      }
+
+      if (!cv::solve(model_mat, rhs, solution, cv::DECOMP_QR)) {
+        solution_ptr[2 * c] = 1;
+        solution_ptr[2 * c + 1] = 0;
+        break;
+      }
+
+      const float a = solution.at<float>(0, 0);
+      const float b = solution.at<float>(1, 0);
+      solution_ptr[2 * c] = a;
+      solution_ptr[2 * c + 1] = b;
+
+      for (auto& patch_tone_match : patch_tone_matches) {
+        const int num_tone_matches = patch_tone_match.tone_match_size();
+        if (num_tone_matches == 0) {
+          continue;
+        }
+        float summed_error = 0.0f;
+        for (const auto& tone_match : patch_tone_match.tone_match()) {
+          const float error =
+              100.0f * (tone_match.curr_val() * a + b - tone_match.prev_val());
+          summed_error += error * error;
+        }
+        const float patch_error =
+            std::sqrt(static_cast<double>(summed_error / num_tone_matches));
+        patch_tone_match.set_irls_weight(1.0f / (patch_error + 1e-6f));
+      }
+    }
+  }
+
+  gain_bias_model->set_gain_c1(solution_ptr[0]);
+  gain_bias_model->set_bias_c1(solution_ptr[1]);
+  gain_bias_model->set_gain_c2(solution_ptr[2]);
+  gain_bias_model->set_bias_c2(solution_ptr[3]);
+  gain_bias_model->set_gain_c3(solution_ptr[4]);
+  gain_bias_model->set_bias_c3(solution_ptr[5]);
+}
+
+// Returns a random 3 channel frame, with a fraction of channel values set to
+// the clip thresholds and the values next to them, and a clipped border.
+cv::Mat MakeFrame(const ClipMaskOptions& options, int width, int height) {
+  std::mt19937 random(900913);
+  std::uniform_int_distribution<int> value(0, 255);
+  std::uniform_int_distribution<int> offset(-1, 1);
+  std::uniform_int_distribution<int> choice(0, 3);
+  const int thresholds[2] = {
+      static_cast<int>(options.min_exposure() * 255.0f),
+      static_cast<int>(options.max_exposure() * 255.0f)};
+  cv::Mat frame(height, width, CV_8UC3);
+  for (int i = 0; i < height; ++i) {
+    uint8* frame_ptr = frame.ptr<uint8>(i);
+    for (int j = 0; j < 3 * width; ++j) {
+      const int c = choice(random);
+      frame_ptr[j] = c < 2 ? value(random)
+                           : std::max(0, std::min(255, thresholds[c - 2] +
+                                                           offset(random)));
+    }
+  }
+
+  // Fully clipped frame border.
+  frame.row(0).setTo(cv::Scalar(255, 255, 255));
+  frame.col(width - 1).setTo(cv::Scalar(0, 0, 0));
+  return frame;
+}
+
+TEST(ToneEstimationTest, ClipMaskMatchesReference) {
+  for (int max_clipped_channels = 0; max_clipped_channels < 3;
+       ++max_clipped_channels) {
+    for (int diameter : {1, 5}) {
+      for (float min_exposure : {0.02f, 0.2f}) {
+        ClipMaskOptions options;
+        options.set_min_exposure(min_exposure);
+        options.set_max_exposure(0.98f);
+        options.set_max_clipped_channels(max_clipped_channels);
+        options.set_clip_mask_diameter(diameter);
+        const cv::Mat frame = MakeFrame(options, 67, 41);
+
+        ClipMask<3> clip_mask;
+        ToneEstimation::ComputeClipMask<3>(options, frame, &clip_mask);
+        const cv::Mat expected = ReferenceClipMask<3>(options, frame);
+
+        ASSERT_EQ(CV_8U, clip_mask.mask.type());
+        EXPECT_EQ(0, cv::countNonZero(clip_mask.mask != expected))
+            << "max_clipped_channels: " << max_clipped_channels
+            << " diameter: " << diameter << " min_exposure: " << min_exposure;
+        EXPECT_EQ(cv::sum(expected)[0],
+                  clip_mask.mask_integral.at<int>(frame.rows, frame.cols));
+      }
+    }
+  }
+}
+
+TEST(ToneEstimationTest, GainBiasModelMatchesReference) {
+  std::mt19937 random(900913);
+  std::uniform_real_distribution<float> value(0.05f, 0.95f);
+  std::normal_distribution<float> noise(0.0f, 0.01f);
+  const float gains[3] = {1.1f, 0.9f, 1.0f};
+  const float biases[3] = {-0.05f, 0.02f, 0.0f};
+
+  ColorToneMatches tone_matches(3);
+  for (int c = 0; c < 3; ++c) {
+    for (int p = 0; p < 100; ++p) {
+      PatchToneMatch patch_tone_match;
+      // Every fifth patch is an outlier.
+      const float gain = p % 5 == 0 ? 0.5f : gains[c];
+      for (int k = 0; k < 5; ++k) {
+        const float curr_val = value(random);
+        ToneMatch* tone_match = patch_tone_match.add_tone_match();
+        tone_match->set_curr_val(curr_val);
+        tone_match->set_prev_val(gain * curr_val + biases[c] + noise(random));
+      }
+      tone_matches[c].push_back(patch_tone_match);
+    }
+  }
+  ColorToneMatches expected_tone_matches = tone_matches;
+
+  constexpr int kIrlsIterations = 10;
+  GainBiasModel model;
+  ToneEstimation::EstimateGainBiasModel(kIrlsIterations, &tone_matches,
+                                        &model);
+  GainBiasModel expected_model;
+  ReferenceGainBiasModel(kIrlsIterations, &expected_tone_matches,
+                         &expected_model);
+
+  EXPECT_NEAR(expected_model.gain_c1(), model.gain_c1(), 1e-3);
+  EXPECT_NEAR(expected_model.bias_c1(), model.bias_c1(), 1e-3);
+  EXPECT_NEAR(expected_model.gain_c2(), model.gain_c2(), 1e-3);
+  EXPECT_NEAR(expected_model.bias_c2(), model.bias_c2(), 1e-3);
+  EXPECT_NEAR(expected_model.gain_c3(), model.gain_c3(), 1e-3);
+  EXPECT_NEAR(expected_model.bias_c3(), model.bias_c3(), 1e-3);
+  EXPECT_NEAR(gains[0], model.gain_c1(), 0.01);
+
+  for (int c = 0; c < 3; ++c) {
+    for (int p = 0; p < tone_matches[c].size(); ++p) {
+      const float expected_weight = expected_tone_matches[c][p].irls_weight();
+      EXPECT_NEAR(expected_weight, tone_matches[c][p].irls_weight(),
+                  1e-2 * expected_weight);
+    }
+  }
+}
+
+// Channels without matches keep the identity model.
+TEST(ToneEstimationTest, GainBiasModelWithoutMatches) {
+  ColorToneMatches tone_matches(2);
+  PatchToneMatch patch_tone_match;
+  for (float curr_val : {0.2f, 0.4f, 0.6f}) {
+    ToneMatch* tone_match = patch_tone_match.add_tone_match();
+    tone_match->set_curr_val(curr_val);
+    tone_match->set_prev_val(0.5f * curr_val + 0.1f);
+  }
+  tone_matches[0].push_back(patch_tone_match);
+  tone_matches[1].push_back(PatchToneMatch());
+
+  GainBiasModel model;
+  ToneEstimation::EstimateGainBiasModel(3, &tone_matches, &model);
+  EXPECT_NEAR(0.5f, model.gain_c1(), 1e-4);
+  EXPECT_NEAR(0.1f, model.bias_c1(), 1e-4);
+  EXPECT_EQ(1.0f, model.gain_c2());
+  EXPECT_EQ(0.0f, model.bias_c2());
+  EXPECT_EQ(1.0f, model.gain_c3());
+  EXPECT_EQ(0.0f, model.bias_c3());
+}
+
+}  // namespace
+}  // namespace mediapipe
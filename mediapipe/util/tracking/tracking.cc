@@ -3162,12 +3162,20 @@ void MotionBox::TrackStepImplDeNormalized(
   next_pos->set_track_status(MotionBoxState::BOX_TRACKED);
 }
 
-void MotionVectorFrameFromTrackingData(const TrackingData& tracking_data,
-                                       MotionVectorFrame* motion_vector_frame) {
+namespace {
+
+// Shared by MotionVectorFrameFromTrackingData and
+// MotionVectorFrameFromFlatTrackingData. Column c holds features
+// col_starts[c] to col_starts[c + 1] - 1, for c < num_cols. track_ids is
+// optional.
+void MotionVectorFrameFromMotionData(
+    int frame_flags, float frame_aspect, int domain_width, int domain_height,
+    const Homography& background_model, int num_cols, const int32* col_starts,
+    const int32* row_indices, const float* vector_data, const int32* track_ids,
+    MotionVectorFrame* motion_vector_frame) {
   CHECK(motion_vector_frame != nullptr);
 
-  const auto& motion_data = tracking_data.motion_data();
-  float aspect_ratio = tracking_data.frame_aspect();
+  float aspect_ratio = frame_aspect;
   if (aspect_ratio < 0.1 || aspect_ratio > 10.0f) {
     LOG(ERROR) << "Aspect ratio : " << aspect_ratio << " is out of bounds. "
                << "Resetting to 1.0.";
@@ -3178,11 +3186,11 @@ void MotionVectorFrameFromTrackingData(const TrackingData& tracking_data,
   // Normalize longest dimension to 1 under aspect ratio preserving scaling.
   ScaleFromAspect(aspect_ratio, false, &scale_x, &scale_y);
 
-  scale_x /= tracking_data.domain_width();
-  scale_y /= tracking_data.domain_height();
+  scale_x /= domain_width;
+  scale_y /= domain_height;
 
   const bool use_background_model =
-      !(tracking_data.frame_flags() & TrackingData::FLAG_BACKGROUND_UNSTABLE);
+      !(frame_flags & TrackingData::FLAG_BACKGROUND_UNSTABLE);
 
   Homography homog_scale = HomographyAdapter::Embed(
       AffineAdapter::FromArgs(0, 0, scale_x, 0, 0, scale_y));
@@ -3191,36 +3199,34 @@ void MotionVectorFrameFromTrackingData(const TrackingData& tracking_data,
       AffineAdapter::FromArgs(0, 0, 1.0f / scale_x, 0, 0, 1.0f / scale_y));
 
   // Might be just the identity if not set.
-  const Homography background_model = tracking_data.background_model();
   const Homography background_model_scaled =
       ModelCompose3(homog_scale, background_model, inv_homog_scale);
 
   motion_vector_frame->background_model.CopyFrom(background_model_scaled);
   motion_vector_frame->valid_background_model = use_background_model;
   motion_vector_frame->is_duplicated =
-      tracking_data.frame_flags() & TrackingData::FLAG_DUPLICATED;
+      frame_flags & TrackingData::FLAG_DUPLICATED;
   motion_vector_frame->is_chunk_boundary =
-      tracking_data.frame_flags() & TrackingData::FLAG_CHUNK_BOUNDARY;
-  motion_vector_frame->aspect_ratio = tracking_data.frame_aspect();
-  motion_vector_frame->motion_vectors.reserve(motion_data.row_indices_size());
+      frame_flags & TrackingData::FLAG_CHUNK_BOUNDARY;
+  motion_vector_frame->aspect_ratio = frame_aspect;
 
   motion_vector_frame->motion_vectors.clear();
-  const bool long_tracks = motion_data.track_id_size() > 0;
+  if (num_cols > 0) {
+    motion_vector_frame->motion_vectors.reserve(col_starts[num_cols]);
+  }
 
-  for (int c = 0; c < motion_data.col_starts_size() - 1; ++c) {
+  for (int c = 0; c < num_cols; ++c) {
     const float x = c;
     const float scaled_x = x * scale_x;
 
-    for (int r = motion_data.col_starts(c),
-             r_end = motion_data.col_starts(c + 1);
-         r < r_end; ++r) {
+    for (int r = col_starts[c], r_end = col_starts[c + 1]; r < r_end; ++r) {
       MotionVector motion_vector;
 
-      const float y = motion_data.row_indices(r);
+      const float y = row_indices[r];
       const float scaled_y = y * scale_y;
 
-      const float dx = motion_data.vector_data(2 * r);
-      const float dy = motion_data.vector_data(2 * r + 1);
+      const float dx = vector_data[2 * r];
+      const float dy = vector_data[2 * r + 1];
 
       if (use_background_model) {
         Vector2_f loc(x, y);
@@ -3233,14 +3239,43 @@ void MotionVectorFrameFromTrackingData(const TrackingData& tracking_data,
       motion_vector.pos = Vector2_f(scaled_x, scaled_y);
       motion_vector.object = Vector2_f(dx * scale_x, dy * scale_y);
 
-      if (long_tracks) {
-        motion_vector.track_id = motion_data.track_id(r);
+      if (track_ids != nullptr) {
+        motion_vector.track_id = track_ids[r];
       }
       motion_vector_frame->motion_vectors.push_back(motion_vector);
     }
   }
 }
 
+}  // namespace.
+
+void MotionVectorFrameFromTrackingData(const TrackingData& tracking_data,
+                                       MotionVectorFrame* motion_vector_frame) {
+  const auto& motion_data = tracking_data.motion_data();
+  const bool long_tracks = motion_data.track_id_size() > 0;
+  MotionVectorFrameFromMotionData(
+      tracking_data.frame_flags(), tracking_data.frame_aspect(),
+      tracking_data.domain_width(), tracking_data.domain_height(),
+      tracking_data.background_model(), motion_data.col_starts_size() - 1,
+      motion_data.col_starts().data(), motion_data.row_indices().data(),
+      motion_data.vector_data().data(),
+      long_tracks ? motion_data.track_id().data() : nullptr,
+      motion_vector_frame);
+}
+
+void MotionVectorFrameFromFlatTrackingData(
+    const FlatTrackingDataView& tracking_data,
+    MotionVectorFrame* motion_vector_frame) {
+  CHECK(tracking_data.IsValid());
+  MotionVectorFrameFromMotionData(
+      tracking_data.frame_flags(), tracking_data.frame_aspect(),
+      tracking_data.domain_width(), tracking_data.domain_height(),
+      tracking_data.background_model(), tracking_data.domain_width(),
+      tracking_data.col_starts(), tracking_data.row_indices(),
+      tracking_data.vector_data(), tracking_data.track_ids(),
+      motion_vector_frame);
+}
+
 void FeatureAndDescriptorFromTrackingData(
     const TrackingData& tracking_data, std::vector<Vector2_f>* features,
     std::vector<std::string>* descriptors) {
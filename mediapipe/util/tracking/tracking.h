@@ -27,6 +27,7 @@
 
 #include "absl/container/flat_hash_set.h"
 #include "mediapipe/framework/port/vector.h"
+#include "mediapipe/util/tracking/flat_tracking_data.h"
 #include "mediapipe/util/tracking/flow_packager.pb.h"
 #include "mediapipe/util/tracking/motion_models.h"
 #include "mediapipe/util/tracking/motion_models.pb.h"
@@ -231,6 +232,12 @@ struct MotionVectorFrame {
 void MotionVectorFrameFromTrackingData(const TrackingData& tracking_data,
                                        MotionVectorFrame* motion_vector_frame);
 
+// Same as above for flat tracking data read in place (e.g. from a memory
+// mapped flat chunk file), avoiding any intermediate TrackingData proto.
+void MotionVectorFrameFromFlatTrackingData(
+    const FlatTrackingDataView& tracking_data,
+    MotionVectorFrame* motion_vector_frame);
+
 // Transform TrackingData to feature positions and descriptors, ready to be used
 // by detection (re-acquisition) algorithm (so the "features" is denomalized).
 // Descriptors with all 0s will be discarded.
@@ -0,0 +1,416 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_UTIL_TRACKING_TYPED_STREAMING_BUFFER_H_
+#define MEDIAPIPE_UTIL_TRACKING_TYPED_STREAMING_BUFFER_H_
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+// Compile-time typed version of StreamingBuffer (see streaming_buffer.h for
+// the semantics of chunks, overlap, output and truncation).
+// Instead of string tags and type erased storage, each buffered type is
+// addressed by its index in the template argument list, resolved at compile
+// time. Each index is backed by a ring buffer of unique_ptr's with
+// preallocated capacity, so adding and accessing data neither hashes tags nor
+// reallocates the buffer in steady state. Elements discarded from the buffer
+// are kept for reuse via NewDatum, so that data that is buffered and
+// discarded every frame is not reallocated either.
+//
+// Usage example (compare to StreamingBuffer):
+// enum { kFrame = 0, kMotion = 1, kSaliency = 2 };
+// TypedStreamingBuffer<cv::Mat, AffineModel, SaliencyPointList> buffer(
+//     10,    // overlap
+//     110);  // initial capacity, e.g. chunk size + overlap.
+//
+// buffer.AddDatum<kFrame>(std::move(input_frame));
+// std::unique_ptr<AffineModel> model = buffer.NewDatum<kMotion>();
+// *model = affine_model;  // Reuses a discarded AffineModel if available.
+// buffer.AddDatum<kMotion>(std::move(model));
+// if (buffer.MaxBufferSize() == 100) {
+//   for (int k = 0; k < 100; ++k) {
+//     const cv::Mat& frame = *buffer.GetDatum<kFrame>(k);
+//     ...
+//     buffer.AddDatum<kSaliency>(std::move(saliency));
+//   }
+//   buffer.OutputDatum<kFrame>(false, [](int frame_idx,
+//                                        std::unique_ptr<cv::Mat> frame) {
+//   });
+//   buffer.TruncateBuffer(false);
+// }
+
+// Ring buffer of owned pointers, grows by doubling if capacity is exceeded.
+// Popped elements are retained (up to capacity many) for reuse via Recycle.
+template <class T>
+class PointerRingBuffer {
+ public:
+  explicit PointerRingBuffer(int capacity) : slots_(std::max(1, capacity)) {}
+
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  void push_back(std::unique_ptr<T> pointer) {
+    if (size_ == capacity()) {
+      Grow();
+    }
+    slots_[SlotIndex(size_)] = std::move(pointer);
+    ++size_;
+  }
+
+  // Returns owned pointer at index, can be nullptr if released.
+  std::unique_ptr<T>& operator[](int index) {
+    DCHECK_LT(index, size_);
+    return slots_[SlotIndex(index)];
+  }
+  const std::unique_ptr<T>& operator[](int index) const {
+    DCHECK_LT(index, size_);
+    return slots_[SlotIndex(index)];
+  }
+
+  // Removes the first num_elements (clamped to size).
+  void PopFront(int num_elements) {
+    num_elements = std::min(num_elements, size_);
+    for (int k = 0; k < num_elements; ++k) {
+      Retain(std::move(slots_[SlotIndex(k)]));
+    }
+    head_ = SlotIndex(num_elements);
+    size_ -= num_elements;
+  }
+
+  // Removes the last num_elements (clamped to size).
+  void PopBack(int num_elements) {
+    num_elements = std::min(num_elements, size_);
+    for (int k = size_ - num_elements; k < size_; ++k) {
+      Retain(std::move(slots_[SlotIndex(k)]));
+    }
+    size_ -= num_elements;
+  }
+
+  // Returns a previously popped element, or a new default constructed one if
+  // none is retained. Recycled elements keep their previous value, callers
+  // are expected to overwrite it (e.g. by assignment, which reuses memory
+  // already allocated by protos and containers).
+  std::unique_ptr<T> Recycle() {
+    if (free_.empty()) {
+      return std::unique_ptr<T>(new T());
+    }
+    std::unique_ptr<T> pointer = std::move(free_.back());
+    free_.pop_back();
+    return pointer;
+  }
+
+ private:
+  int capacity() const { return static_cast<int>(slots_.size()); }
+
+  int SlotIndex(int index) const {
+    const int slot = head_ + index;
+    return slot < capacity() ? slot : slot - capacity();
+  }
+
+  void Grow() {
+    std::vector<std::unique_ptr<T>> slots(2 * slots_.size());
+    for (int k = 0; k < size_; ++k) {
+      slots[k] = std::move(slots_[SlotIndex(k)]);
+    }
+    slots_.swap(slots);
+    head_ = 0;
+  }
+
+  void Retain(std::unique_ptr<T> pointer) {
+    if (pointer != nullptr && free_.size() < slots_.size()) {
+      free_.push_back(std::move(pointer));
+    }
+  }
+
+  std::vector<std::unique_ptr<T>> slots_;
+  std::vector<std::unique_ptr<T>> free_;
+  int head_ = 0;
+  int size_ = 0;
+};
+
+template <class... Types>
+class TypedStreamingBuffer {
+ public:
+  static constexpr int kNumTypes = sizeof...(Types);
+
+  template <int I>
+  using TypeAt = typename std::tuple_element<I, std::tuple<Types...>>::type;
+
+  // Constructs a new buffer with passed overlap, each ring buffer is
+  // preallocated to hold capacity elements. Types can be disabled via enabled,
+  // in which case they are excluded from MaxBufferSize and consistency checks
+  // in TruncateBuffer, and adding data to them fails with CHECK.
+  TypedStreamingBuffer(int overlap, int capacity,
+                       const std::array<bool, kNumTypes>& enabled);
+  TypedStreamingBuffer(int overlap, int capacity);
+
+  TypedStreamingBuffer(const TypedStreamingBuffer&) = delete;
+  TypedStreamingBuffer& operator=(const TypedStreamingBuffer&) = delete;
+
+  // Transfers ownership to buffer.
+  template <int I>
+  void AddDatum(std::unique_ptr<TypeAt<I>> pointer);
+
+  // Same as above but takes ownership of T*.
+  template <int I>
+  void EmplaceDatum(TypeAt<I>* pointer) {
+    AddDatum<I>(std::unique_ptr<TypeAt<I>>(pointer));
+  }
+
+  // Creates a deep copy and stores it in the buffer.
+  template <int I>
+  void AddDatumCopy(const TypeAt<I>& datum) {
+    std::unique_ptr<TypeAt<I>> copy = NewDatum<I>();
+    *copy = datum;
+    AddDatum<I>(std::move(copy));
+  }
+
+  // Returns an element previously discarded for index I (see
+  // PointerRingBuffer::Recycle), or a new default constructed one. The
+  // returned element's value is unspecified and is meant to be overwritten.
+  template <int I>
+  std::unique_ptr<TypeAt<I>> NewDatum() {
+    return std::get<I>(buffers_).Recycle();
+  }
+
+  // Retrieves datum at frame index. Returns nullptr if datum does not exist or
+  // was released.
+  template <int I>
+  const TypeAt<I>* GetDatum(int frame_index) const {
+    return GetMutableDatum<I>(frame_index);
+  }
+
+  template <int I>
+  TypeAt<I>* GetMutableDatum(int frame_index) const;
+
+  // Appends pointers to all buffered elements for index I to output.
+  template <int I>
+  void GetMutableDatumVector(std::vector<TypeAt<I>*>* output) const;
+
+  // Returns number of buffered elements for index I.
+  template <int I>
+  int BufferSize() const {
+    return std::get<I>(buffers_).size();
+  }
+
+  // Returns maximum over all enabled types.
+  int MaxBufferSize() const;
+
+  // Returns true if buffers for all passed indices have equal size.
+  template <int I, int... Is>
+  bool HaveEqualSize() const {
+    return ((BufferSize<I>() == BufferSize<Is>()) && ...);
+  }
+
+  // Releases and returns datum at frame index, element in buffer is reset to
+  // nullptr. Returns nullptr if datum does not exist.
+  template <int I>
+  std::unique_ptr<TypeAt<I>> ReleaseDatum(int frame_index);
+
+  // Calls functor(int frame_index, std::unique_ptr<TypeAt<I>>) for each frame
+  // in [0, MaxBufferSize() - (flush ? 0 : overlap)), releasing each datum.
+  template <int I, class Functor>
+  void OutputDatum(bool flush, const Functor& functor);
+
+  // Discards all elements in [0, MaxBufferSize() - overlap) (or all elements
+  // if flush is set). Returns true if all enabled buffers had sufficient
+  // elements and have the same number of remaining elements.
+  bool TruncateBuffer(bool flush);
+
+  // Discards first (respectively last) num_frames of data for index I.
+  template <int I>
+  void DiscardDatum(int num_frames) {
+    std::get<I>(buffers_).PopFront(num_frames);
+  }
+  template <int I>
+  void DiscardDatumFromEnd(int num_frames) {
+    std::get<I>(buffers_).PopBack(num_frames);
+  }
+
+  // Discards first num_frames of data for all types.
+  void DiscardAll(int num_frames);
+
+  // Returns frame index of the first item in the buffer.
+  int FirstFrameIndex() const { return first_frame_index_; }
+
+ private:
+  template <size_t... Is>
+  int MaxBufferSizeImpl(std::index_sequence<Is...>) const;
+
+  template <size_t... Is>
+  bool TruncateBufferImpl(int elems_to_clear, int remaining_elems,
+                          std::index_sequence<Is...>);
+
+  template <size_t... Is>
+  void DiscardAllImpl(int num_frames, std::index_sequence<Is...>);
+
+  int overlap_ = 0;
+  int first_frame_index_ = 0;
+  std::array<bool, kNumTypes> enabled_;
+  std::tuple<PointerRingBuffer<Types>...> buffers_;
+};
+
+//// Implementation details.
+template <class... Types>
+TypedStreamingBuffer<Types...>::TypedStreamingBuffer(
+    int overlap, int capacity, const std::array<bool, kNumTypes>& enabled)
+    : overlap_(overlap),
+      enabled_(enabled),
+      buffers_(PointerRingBuffer<Types>(capacity)...) {
+  CHECK_GE(overlap, 0);
+}
+
+template <class... Types>
+TypedStreamingBuffer<Types...>::TypedStreamingBuffer(int overlap, int capacity)
+    : TypedStreamingBuffer(
+          overlap, capacity,
+          std::array<bool, kNumTypes>{(sizeof(Types) > 0)...}) {}
+
+template <class... Types>
+template <int I>
+void TypedStreamingBuffer<Types...>::AddDatum(
+    std::unique_ptr<TypeAt<I>> pointer) {
+  CHECK(enabled_[I]) << "Type at index " << I << " is disabled.";
+  std::get<I>(buffers_).push_back(std::move(pointer));
+}
+
+template <class... Types>
+template <int I>
+typename TypedStreamingBuffer<Types...>::template TypeAt<I>*
+TypedStreamingBuffer<Types...>::GetMutableDatum(int frame_index) const {
+  CHECK_GE(frame_index, 0);
+  const auto& buffer = std::get<I>(buffers_);
+  if (frame_index >= buffer.size()) {
+    return nullptr;
+  }
+  return buffer[frame_index].get();
+}
+
+template <class... Types>
+template <int I>
+void TypedStreamingBuffer<Types...>::GetMutableDatumVector(
+    std::vector<TypeAt<I>*>* output) const {
+  CHECK(output != nullptr);
+  const auto& buffer = std::get<I>(buffers_);
+  output->reserve(output->size() + buffer.size());
+  for (int k = 0; k < buffer.size(); ++k) {
+    output->push_back(buffer[k].get());
+  }
+}
+
+template <class... Types>
+int TypedStreamingBuffer<Types...>::MaxBufferSize() const {
+  return MaxBufferSizeImpl(std::index_sequence_for<Types...>());
+}
+
+template <class... Types>
+template <size_t... Is>
+int TypedStreamingBuffer<Types...>::MaxBufferSizeImpl(
+    std::index_sequence<Is...>) const {
+  int max_buffer = 0;
+  ((max_buffer = enabled_[Is] ? std::max(max_buffer, BufferSize<Is>())
+                              : max_buffer),
+   ...);
+  return max_buffer;
+}
+
+template <class... Types>
+template <int I>
+std::unique_ptr<typename TypedStreamingBuffer<Types...>::template TypeAt<I>>
+TypedStreamingBuffer<Types...>::ReleaseDatum(int frame_index) {
+  CHECK_GE(frame_index, 0);
+  auto& buffer = std::get<I>(buffers_);
+  if (frame_index >= buffer.size()) {
+    return nullptr;
+  }
+  return std::move(buffer[frame_index]);
+}
+
+template <class... Types>
+template <int I, class Functor>
+void TypedStreamingBuffer<Types...>::OutputDatum(bool flush,
+                                                 const Functor& functor) {
+  const int end_frame = MaxBufferSize() - (flush ? 0 : overlap_);
+  for (int k = 0; k < end_frame; ++k) {
+    functor(k, ReleaseDatum<I>(k));
+  }
+}
+
+template <class... Types>
+bool TypedStreamingBuffer<Types...>::TruncateBuffer(bool flush) {
+  // Only truncate if sufficient elements have been buffered.
+  const int elems_to_clear =
+      std::max(0, MaxBufferSize() - (flush ? 0 : overlap_));
+
+  if (elems_to_clear == 0) {
+    return true;
+  }
+
+  const bool is_consistent =
+      TruncateBufferImpl(elems_to_clear, flush ? 0 : overlap_,
+                         std::index_sequence_for<Types...>());
+  first_frame_index_ += elems_to_clear;
+  return is_consistent;
+}
+
+template <class... Types>
+template <size_t... Is>
+bool TypedStreamingBuffer<Types...>::TruncateBufferImpl(
+    int elems_to_clear, int remaining_elems, std::index_sequence<Is...>) {
+  bool is_consistent = true;
+  auto truncate = [&](auto& buffer, int index) {
+    if (!enabled_[index]) {
+      return;
+    }
+    if (buffer.size() < elems_to_clear) {
+      LOG(WARNING) << "For type " << index << " got "
+                   << elems_to_clear - buffer.size()
+                   << " fewer elements than buffer can hold.";
+      is_consistent = false;
+    }
+    buffer.PopFront(elems_to_clear);
+    if (buffer.size() != remaining_elems) {
+      LOG(WARNING) << "After truncation, for type " << index << " got "
+                   << buffer.size() << " elements, expected "
+                   << remaining_elems;
+      is_consistent = false;
+    }
+  };
+  (truncate(std::get<Is>(buffers_), Is), ...);
+  return is_consistent;
+}
+
+template <class... Types>
+void TypedStreamingBuffer<Types...>::DiscardAll(int num_frames) {
+  DiscardAllImpl(num_frames, std::index_sequence_for<Types...>());
+}
+
+template <class... Types>
+template <size_t... Is>
+void TypedStreamingBuffer<Types...>::DiscardAllImpl(
+    int num_frames, std::index_sequence<Is...>) {
+  (std::get<Is>(buffers_).PopFront(num_frames), ...);
+}
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_TRACKING_TYPED_STREAMING_BUFFER_H_
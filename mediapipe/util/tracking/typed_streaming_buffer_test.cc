@@ -0,0 +1,116 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/typed_streaming_buffer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+enum { kInt = 0, kString = 1, kUnused = 2 };
+typedef TypedStreamingBuffer<int, std::string, float> TestBuffer;
+
+TEST(TypedStreamingBufferTest, RingBufferWrapsAndGrows) {
+  PointerRingBuffer<int> buffer(2);
+  for (int k = 0; k < 3; ++k) {
+    buffer.push_back(std::unique_ptr<int>(new int(k)));
+  }
+  buffer.PopFront(2);
+  buffer.push_back(std::unique_ptr<int>(new int(3)));
+  buffer.push_back(std::unique_ptr<int>(new int(4)));
+  buffer.push_back(std::unique_ptr<int>(new int(5)));
+  ASSERT_EQ(4, buffer.size());
+  for (int k = 0; k < 4; ++k) {
+    EXPECT_EQ(k + 2, *buffer[k]);
+  }
+  buffer.PopBack(1);
+  EXPECT_EQ(3, buffer.size());
+  EXPECT_EQ(4, *buffer[2]);
+}
+
+TEST(TypedStreamingBufferTest, OutputAndTruncate) {
+  TestBuffer buffer(2, 4, {true, true, false});
+  for (int k = 0; k < 6; ++k) {
+    buffer.EmplaceDatum<kInt>(new int(k));
+    buffer.AddDatumCopy<kString>(std::to_string(k));
+  }
+  EXPECT_EQ(6, buffer.MaxBufferSize());
+  EXPECT_TRUE((buffer.HaveEqualSize<kInt, kString>()));
+  EXPECT_EQ("3", *buffer.GetDatum<kString>(3));
+  EXPECT_EQ(nullptr, buffer.GetDatum<kInt>(6));
+
+  std::vector<int> output;
+  buffer.OutputDatum<kInt>(false, [&output](int frame_index,
+                                            std::unique_ptr<int> value) {
+    EXPECT_EQ(frame_index, *value);
+    output.push_back(*value);
+  });
+  EXPECT_EQ(4, output.size());
+  EXPECT_EQ(nullptr, buffer.GetDatum<kInt>(0));
+
+  // Disabled type is ignored by consistency checks.
+  EXPECT_TRUE(buffer.TruncateBuffer(false));
+  EXPECT_EQ(4, buffer.FirstFrameIndex());
+  EXPECT_EQ(2, buffer.BufferSize<kInt>());
+  EXPECT_EQ(4, *buffer.GetDatum<kInt>(0));
+
+  std::vector<std::string*> strings;
+  buffer.GetMutableDatumVector<kString>(&strings);
+  ASSERT_EQ(2, strings.size());
+  EXPECT_EQ("5", *strings[1]);
+
+  buffer.DiscardAll(1);
+  EXPECT_EQ(1, buffer.MaxBufferSize());
+  EXPECT_TRUE(buffer.TruncateBuffer(true));
+  EXPECT_EQ(0, buffer.MaxBufferSize());
+}
+
+TEST(TypedStreamingBufferTest, RecyclesDiscardedData) {
+  TestBuffer buffer(0, 2);
+  std::vector<const std::string*> added;
+  for (int k = 0; k < 2; ++k) {
+    buffer.AddDatumCopy<kString>(std::to_string(k));
+    added.push_back(buffer.GetDatum<kString>(k));
+  }
+  buffer.DiscardDatum<kString>(2);
+
+  // Discarded strings are reused in order of discarding, most recent first.
+  std::unique_ptr<std::string> recycled = buffer.NewDatum<kString>();
+  EXPECT_EQ(added[1], recycled.get());
+  buffer.AddDatum<kString>(std::move(recycled));
+  buffer.AddDatumCopy<kString>("2");
+  EXPECT_EQ(added[0], buffer.GetDatum<kString>(1));
+  EXPECT_EQ("2", *buffer.GetDatum<kString>(1));
+
+  // Released data is not retained, new data is allocated.
+  std::unique_ptr<std::string> released = buffer.ReleaseDatum<kString>(0);
+  buffer.DiscardDatum<kString>(2);
+  std::unique_ptr<std::string> next = buffer.NewDatum<kString>();
+  EXPECT_EQ(added[0], next.get());
+  EXPECT_NE(nullptr, buffer.NewDatum<kString>());
+}
+
+TEST(TypedStreamingBufferTest, InconsistentTruncate) {
+  TestBuffer buffer(0, 4);
+  buffer.EmplaceDatum<kInt>(new int(0));
+  EXPECT_FALSE(buffer.TruncateBuffer(true));
+}
+
+}  // namespace
+}  // namespace mediapipe